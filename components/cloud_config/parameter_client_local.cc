@@ -56,6 +56,47 @@ ABSL_FLAG(std::int32_t, logging_verbosity_level, 0,
           "Loggging verbosity level.");
 ABSL_FLAG(absl::Duration, udf_timeout, absl::Seconds(5),
           "Timeout for one UDF invocation");
+ABSL_FLAG(int32_t, sharding_function_version, 0,
+          "Version of the function used to assign keys to shards.");
+ABSL_FLAG(std::string, sharding_key_delimiter, "",
+          "If set, keys are sharded by their part before this delimiter.");
+ABSL_FLAG(absl::Duration, realtime_batch_max_delay, absl::ZeroDuration(),
+          "How long realtime updates may be held to be applied to the cache "
+          "together with later ones. Zero applies every update right away.");
+ABSL_FLAG(int32_t, realtime_batch_max_size, 10000,
+          "Number of pending realtime mutations after which they are applied "
+          "without waiting for --realtime_batch_max_delay.");
+ABSL_FLAG(bool, bypass_passthrough_udf, false,
+          "Whether V1 requests are looked up directly, without executing the "
+          "UDF, while the default passthrough UDF is loaded.");
+ABSL_FLAG(int32_t, partition_result_cache_max_megabytes, 0,
+          "Memory budget of the cache of UDF outputs of v2 partitions. Zero "
+          "disables the cache.");
+ABSL_FLAG(absl::Duration, partition_result_cache_max_age, absl::Seconds(10),
+          "How long UDF outputs of v2 partitions may be served from the "
+          "cache.");
+ABSL_FLAG(int32_t, json_value_cache_max_megabytes, 0,
+          "Memory budget of the cache of values parsed from JSON for V1 "
+          "responses. Zero disables the cache.");
+ABSL_FLAG(int32_t, sharded_lookup_hedging_percentile, 0,
+          "Latency percentile after which requests to remote shards are "
+          "hedged. Zero disables hedging.");
+ABSL_FLAG(absl::Duration, sharded_lookup_coalescing_window,
+          absl::ZeroDuration(),
+          "How long lookups of remote keys wait for concurrent ones. Zero "
+          "disables coalescing.");
+ABSL_FLAG(bool, sharded_lookup_use_stream, false,
+          "Whether lookups of remote keys are multiplexed over one stream per "
+          "replica.");
+ABSL_FLAG(int32_t, sharded_lookup_padding_buckets, 0,
+          "Number of length buckets between consecutive powers of two that "
+          "requests to remote shards are padded to.");
+ABSL_FLAG(int32_t, near_cache_max_megabytes, 0,
+          "Memory budget of the cache of values looked up on remote shards. "
+          "Zero disables the cache.");
+ABSL_FLAG(absl::Duration, near_cache_max_age, absl::Seconds(1),
+          "How long values looked up on remote shards may be served from the "
+          "cache.");
 
 namespace kv_server {
 namespace {
@@ -79,6 +120,8 @@ class LocalParameterClient : public ParameterClient {
                                 absl::GetFlag(FLAGS_realtime_directory)});
     string_flag_values_.insert({"kv-server-local-data-loading-file-format",
                                 absl::GetFlag(FLAGS_data_loading_file_format)});
+    string_flag_values_.insert({"kv-server-local-sharding-key-delimiter",
+                                absl::GetFlag(FLAGS_sharding_key_delimiter)});
     // Insert more string flag values here.
 
     int32_t_flag_values_.insert(
@@ -111,6 +154,41 @@ class LocalParameterClient : public ParameterClient {
     int32_t_flag_values_.insert(
         {"kv-server-local-udf-timeout-millis",
          absl::ToInt64Milliseconds(absl::GetFlag(FLAGS_udf_timeout))});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-sharding-function-version",
+         absl::GetFlag(FLAGS_sharding_function_version)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-realtime-batch-max-delay-millis",
+         absl::ToInt64Milliseconds(
+             absl::GetFlag(FLAGS_realtime_batch_max_delay))});
+    int32_t_flag_values_.insert({"kv-server-local-realtime-batch-max-size",
+                                 absl::GetFlag(FLAGS_realtime_batch_max_size)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-partition-result-cache-max-megabytes",
+         absl::GetFlag(FLAGS_partition_result_cache_max_megabytes)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-partition-result-cache-max-age-millis",
+         absl::ToInt64Milliseconds(
+             absl::GetFlag(FLAGS_partition_result_cache_max_age))});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-json-value-cache-max-megabytes",
+         absl::GetFlag(FLAGS_json_value_cache_max_megabytes)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-sharded-lookup-hedging-percentile",
+         absl::GetFlag(FLAGS_sharded_lookup_hedging_percentile)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-sharded-lookup-coalescing-micros",
+         absl::ToInt64Microseconds(
+             absl::GetFlag(FLAGS_sharded_lookup_coalescing_window))});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-sharded-lookup-padding-buckets",
+         absl::GetFlag(FLAGS_sharded_lookup_padding_buckets)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-near-cache-max-megabytes",
+         absl::GetFlag(FLAGS_near_cache_max_megabytes)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-near-cache-max-age-millis",
+         absl::ToInt64Milliseconds(absl::GetFlag(FLAGS_near_cache_max_age))});
     // Insert more int32 flag values here.
     bool_flag_values_.insert({"kv-server-local-route-v1-to-v2",
                               absl::GetFlag(FLAGS_route_v1_to_v2)});
@@ -118,6 +196,10 @@ class LocalParameterClient : public ParameterClient {
     bool_flag_values_.insert(
         {"kv-server-local-use-external-metrics-collector-endpoint", false});
     bool_flag_values_.insert({"kv-server-local-use-sharding-key-regex", false});
+    bool_flag_values_.insert({"kv-server-local-bypass-passthrough-udf",
+                              absl::GetFlag(FLAGS_bypass_passthrough_udf)});
+    bool_flag_values_.insert({"kv-server-local-sharded-lookup-use-stream",
+                              absl::GetFlag(FLAGS_sharded_lookup_use_stream)});
     // Insert more bool flag values here.
   }
 
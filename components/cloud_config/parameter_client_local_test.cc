@@ -44,6 +44,12 @@ TEST(ParameterClientLocal, ExpectedFlagDefaultsArePresent) {
     ASSERT_TRUE(statusor.ok());
     EXPECT_EQ("", *statusor);
   }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-sharding-key-delimiter");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
   {
     const auto statusor = client->GetInt32Parameter(
         "kv-server-local-metrics-export-interval-millis");
@@ -104,6 +110,72 @@ TEST(ParameterClientLocal, ExpectedFlagDefaultsArePresent) {
     ASSERT_TRUE(statusor.ok());
     EXPECT_EQ(5000, *statusor);
   }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-sharding-function-version");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-realtime-batch-max-delay-millis");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-realtime-batch-max-size");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(10000, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-partition-result-cache-max-megabytes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-partition-result-cache-max-age-millis");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(10000, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-json-value-cache-max-megabytes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-sharded-lookup-hedging-percentile");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-sharded-lookup-coalescing-micros");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-sharded-lookup-padding-buckets");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-near-cache-max-megabytes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-near-cache-max-age-millis");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1000, *statusor);
+  }
   {
     const auto statusor =
         client->GetBoolParameter("kv-server-local-route-v1-to-v2");
@@ -122,6 +194,18 @@ TEST(ParameterClientLocal, ExpectedFlagDefaultsArePresent) {
     ASSERT_TRUE(statusor.ok());
     EXPECT_EQ(false, *statusor);
   }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-bypass-passthrough-udf");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-sharded-lookup-use-stream");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
 }
 
 }  // namespace
@@ -26,7 +26,9 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/key_value_mutation_batch.h"
 
 namespace kv_server {
 
@@ -40,6 +42,27 @@ class Cache {
   virtual absl::flat_hash_map<std::string, std::string> GetKeyValuePairs(
       const absl::flat_hash_set<std::string_view>& key_list) const = 0;
 
+  // Returns the values of `keys`, which must be distinct, in the same order,
+  // or null for keys without a value. Values are shared with the cache rather
+  // than copied, and stay valid after they are updated or deleted in it. The
+  // default implementation goes through `GetKeyValuePairs`.
+  virtual std::vector<std::shared_ptr<const std::string>> GetValues(
+      absl::Span<const std::string_view> keys) const {
+    auto kv_pairs = GetKeyValuePairs(
+        absl::flat_hash_set<std::string_view>(keys.begin(), keys.end()));
+    std::vector<std::shared_ptr<const std::string>> values;
+    values.reserve(keys.size());
+    for (const auto key : keys) {
+      if (auto key_iter = kv_pairs.find(key); key_iter != kv_pairs.end()) {
+        values.push_back(
+            std::make_shared<const std::string>(std::move(key_iter->second)));
+      } else {
+        values.push_back(nullptr);
+      }
+    }
+    return values;
+  }
+
   // Looks up and returns key-value set result for the given key set.
   virtual std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
       const absl::flat_hash_set<std::string_view>& key_set) const = 0;
@@ -67,6 +90,34 @@ class Cache {
   // Removes the values that were deleted before the specified
   // logical_commit_time.
   virtual void RemoveDeletedKeys(int64_t logical_commit_time) = 0;
+
+  // Applies all mutations in `batch`. The default implementation applies
+  // mutations one by one, implementations can override it to amortize
+  // locking across the batch.
+  virtual void ApplyMutationBatch(const KeyValueMutationBatch& batch) {
+    std::vector<std::string_view> values;
+    for (int64_t i = 0; i < batch.size(); i++) {
+      const bool is_update =
+          batch.mutation_type(i) == KeyValueMutationType::Update;
+      if (batch.value_type(i) == Value::StringValue) {
+        if (is_update) {
+          UpdateKeyValue(batch.key(i), batch.value(i),
+                         batch.logical_commit_time(i));
+        } else {
+          DeleteKey(batch.key(i), batch.logical_commit_time(i));
+        }
+        continue;
+      }
+      batch.GetSetValues(i, values);
+      if (is_update) {
+        UpdateKeyValueSet(batch.key(i), absl::MakeSpan(values),
+                          batch.logical_commit_time(i));
+      } else {
+        DeleteValuesInSet(batch.key(i), absl::MakeSpan(values),
+                          batch.logical_commit_time(i));
+      }
+    }
+  }
 };
 
 }  // namespace kv_server
@@ -32,6 +32,7 @@ using privacy_sandbox::server_common::MetricsRecorder;
 using privacy_sandbox::server_common::ScopeLatencyRecorder;
 
 constexpr char kGetKeyValuePairsEvent[] = "GetKeyValuePairs";
+constexpr char kGetValuesEvent[] = "GetValues";
 constexpr char kGetKeyValueSetEvent[] = "GetKeyValueSet";
 constexpr char kUpdateKeyValueEvent[] = "UpdateKeyValue";
 constexpr char kUpdateKeyValueSetEvent[] = "UpdateKeyValueSet";
@@ -40,6 +41,7 @@ constexpr char kDeleteValuesInSetEvent[] = "DeleteValuesInSet";
 constexpr char kRemoveDeletedKeysEvent[] = "RemoveDeletedKeys";
 constexpr char kCleanUpKeyValueMapEvent[] = "CleanUpKeyValueMap";
 constexpr char kCleanUpKeyValueSetMapEvent[] = "CleanUpKeyValueSetMap";
+constexpr char kApplyMutationBatchEvent[] = "ApplyMutationBatch";
 
 absl::flat_hash_map<std::string, std::string> KeyValueCache::GetKeyValuePairs(
     const absl::flat_hash_set<std::string_view>& key_set) const {
@@ -60,6 +62,21 @@ absl::flat_hash_map<std::string, std::string> KeyValueCache::GetKeyValuePairs(
   return kv_pairs;
 }
 
+std::vector<std::shared_ptr<const std::string>> KeyValueCache::GetValues(
+    absl::Span<const std::string_view> keys) const {
+  ScopeLatencyRecorder latency_recorder(kGetValuesEvent, metrics_recorder_);
+  std::vector<std::shared_ptr<const std::string>> values;
+  values.reserve(keys.size());
+  absl::ReaderMutexLock lock(&mutex_);
+  for (std::string_view key : keys) {
+    const auto key_iter = map_.find(key);
+    // Deleted keys have a null value.
+    values.push_back(key_iter == map_.end() ? nullptr
+                                            : key_iter->second.value);
+  }
+  return values;
+}
+
 std::unique_ptr<GetKeyValueSetResult> KeyValueCache::GetKeyValueSet(
     const absl::flat_hash_set<std::string_view>& key_set) const {
   ScopeLatencyRecorder latency_recorder(kGetKeyValueSetEvent,
@@ -91,10 +108,15 @@ void KeyValueCache::UpdateKeyValue(std::string_view key, std::string_view value,
                                    int64_t logical_commit_time) {
   ScopeLatencyRecorder latency_recorder(kUpdateKeyValueEvent,
                                         metrics_recorder_);
-  VLOG(9) << "Received update for [" << key << "] at " << logical_commit_time
-          << ". value will be set to: " << value;
   absl::MutexLock lock(&mutex_);
+  UpdateKeyValueLocked(key, value, logical_commit_time);
+}
 
+void KeyValueCache::UpdateKeyValueLocked(std::string_view key,
+                                         std::string_view value,
+                                         int64_t logical_commit_time) {
+  VLOG(9) << "Received update for [" << key << "] at " << logical_commit_time
+          << ". value will be set to: " << value;
   if (logical_commit_time <= max_cleanup_logical_commit_time_) {
     VLOG(1) << "Skipping the update as its logical_commit_time: "
             << logical_commit_time
@@ -126,8 +148,9 @@ void KeyValueCache::UpdateKeyValue(std::string_view key, std::string_view value,
     }
   }
 
-  map_.insert_or_assign(key, {.value = std::make_unique<std::string>(value),
-                              .last_logical_commit_time = logical_commit_time});
+  map_.insert_or_assign(
+      key, {.value = std::make_shared<const std::string>(value),
+            .last_logical_commit_time = logical_commit_time});
 }
 
 void KeyValueCache::UpdateKeyValueSet(
@@ -195,6 +218,11 @@ void KeyValueCache::DeleteKey(std::string_view key,
                               int64_t logical_commit_time) {
   ScopeLatencyRecorder latency_recorder(kDeleteKeyEvent, metrics_recorder_);
   absl::MutexLock lock(&mutex_);
+  DeleteKeyLocked(key, logical_commit_time);
+}
+
+void KeyValueCache::DeleteKeyLocked(std::string_view key,
+                                    int64_t logical_commit_time) {
   if (logical_commit_time <= max_cleanup_logical_commit_time_) {
     return;
   }
@@ -278,6 +306,41 @@ void KeyValueCache::DeleteValuesInSet(std::string_view key,
   }
 }
 
+void KeyValueCache::ApplyMutationBatch(const KeyValueMutationBatch& batch) {
+  ScopeLatencyRecorder latency_recorder(kApplyMutationBatchEvent,
+                                        metrics_recorder_);
+  {
+    absl::MutexLock lock(&mutex_);
+    for (int64_t i = 0; i < batch.size(); i++) {
+      if (batch.value_type(i) != Value::StringValue) {
+        continue;
+      }
+      if (batch.mutation_type(i) == KeyValueMutationType::Update) {
+        UpdateKeyValueLocked(batch.key(i), batch.value(i),
+                             batch.logical_commit_time(i));
+      } else {
+        DeleteKeyLocked(batch.key(i), batch.logical_commit_time(i));
+      }
+    }
+  }
+  // Key-value sets live in a separate map, so applying them after the
+  // key-value mutations does not change the outcome.
+  std::vector<std::string_view> values;
+  for (int64_t i = 0; i < batch.size(); i++) {
+    if (batch.value_type(i) != Value::StringSet) {
+      continue;
+    }
+    batch.GetSetValues(i, values);
+    if (batch.mutation_type(i) == KeyValueMutationType::Update) {
+      UpdateKeyValueSet(batch.key(i), absl::MakeSpan(values),
+                        batch.logical_commit_time(i));
+    } else {
+      DeleteValuesInSet(batch.key(i), absl::MakeSpan(values),
+                        batch.logical_commit_time(i));
+    }
+  }
+}
+
 void KeyValueCache::RemoveDeletedKeys(int64_t logical_commit_time) {
   ScopeLatencyRecorder latency_recorder(kRemoveDeletedKeysEvent,
                                         metrics_recorder_);
@@ -29,6 +29,7 @@
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
 #include "public/base_types.pb.h"
@@ -47,6 +48,10 @@ class KeyValueCache : public Cache {
   absl::flat_hash_map<std::string, std::string> GetKeyValuePairs(
       const absl::flat_hash_set<std::string_view>& key_set) const override;
 
+  // Only takes references to the values under the lock of the cache.
+  std::vector<std::shared_ptr<const std::string>> GetValues(
+      absl::Span<const std::string_view> keys) const override;
+
   // Looks up and returns key-value set result for the given key set.
   std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
       const absl::flat_hash_set<std::string_view>& key_set) const override;
@@ -77,6 +82,10 @@ class KeyValueCache : public Cache {
   // background thread
   void RemoveDeletedKeys(int64_t logical_commit_time) override;
 
+  // Applies all key-value mutations in `batch` under a single lock
+  // acquisition. Key-value set mutations are applied one by one.
+  void ApplyMutationBatch(const KeyValueMutationBatch& batch) override;
+
   static std::unique_ptr<Cache> Create(
       privacy_sandbox::server_common::MetricsRecorder& metrics_recorder);
 
@@ -87,9 +96,11 @@ class KeyValueCache : public Cache {
     // delete-update messages issue) until it is later cleaned up.
     // We've also considered using optional, but it takes more space.
     // sizeof(string) + sizeof(bool) -- for optional
-    // sizeof(string*) when null, sizeof(string*) + sizeof(string) otherwise
-    // -- for the unique pointer
-    std::unique_ptr<std::string> value;
+    // 2 * sizeof(string*) when null, 2 * sizeof(string*) + sizeof(string) +
+    // a control block allocated with it otherwise -- for the shared pointer,
+    // which lets `GetValues` return values without copying them or holding
+    // the lock while they are used.
+    std::shared_ptr<const std::string> value;
     int64_t last_logical_commit_time;
   };
   struct SetValueMeta {
@@ -144,6 +155,12 @@ class KeyValueCache : public Cache {
                                std::string, absl::flat_hash_set<std::string>>>
       deleted_set_nodes_ ABSL_GUARDED_BY(set_map_mutex_);
 
+  void UpdateKeyValueLocked(std::string_view key, std::string_view value,
+                            int64_t logical_commit_time)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void DeleteKeyLocked(std::string_view key, int64_t logical_commit_time)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Removes deleted keys from key-value map
   void CleanUpKeyValueMap(int64_t logical_commit_time);
 
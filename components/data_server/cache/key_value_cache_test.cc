@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/notification.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
@@ -166,6 +167,44 @@ TEST(CacheTest, GetForEmptyCacheReturnsEmptyList) {
   EXPECT_EQ(kv_pairs.size(), 0);
 }
 
+TEST(CacheTest, GetValuesReturnsValuesInKeyOrder) {
+  auto noop_metrics_recorder =
+      TelemetryProvider::GetInstance().CreateMetricsRecorder();
+  std::unique_ptr<Cache> cache = KeyValueCache::Create(*noop_metrics_recorder);
+  cache->UpdateKeyValue("key1", "value1", 1);
+  cache->UpdateKeyValue("key2", "value2", 2);
+  cache->UpdateKeyValue("deleted_key", "value3", 3);
+  cache->DeleteKey("deleted_key", 4);
+
+  const std::vector<std::string_view> keys = {"key2", "missing_key",
+                                              "deleted_key", "key1"};
+  const auto values = cache->GetValues(keys);
+  ASSERT_EQ(values.size(), 4);
+  ASSERT_NE(values[0], nullptr);
+  EXPECT_EQ(*values[0], "value2");
+  EXPECT_EQ(values[1], nullptr);
+  EXPECT_EQ(values[2], nullptr);
+  ASSERT_NE(values[3], nullptr);
+  EXPECT_EQ(*values[3], "value1");
+}
+
+TEST(CacheTest, GetValuesOutliveUpdatesAndDeletes) {
+  auto noop_metrics_recorder =
+      TelemetryProvider::GetInstance().CreateMetricsRecorder();
+  std::unique_ptr<Cache> cache = KeyValueCache::Create(*noop_metrics_recorder);
+  cache->UpdateKeyValue("key1", "value1", 1);
+  cache->UpdateKeyValue("key2", "value2", 1);
+
+  const std::vector<std::string_view> keys = {"key1", "key2"};
+  const auto values = cache->GetValues(keys);
+  cache->UpdateKeyValue("key1", "new_value1", 2);
+  cache->DeleteKey("key2", 2);
+  ASSERT_NE(values[0], nullptr);
+  EXPECT_EQ(*values[0], "value1");
+  ASSERT_NE(values[1], nullptr);
+  EXPECT_EQ(*values[1], "value2");
+}
+
 TEST(CacheTest, GetForCacheReturnsValueSet) {
   auto noop_metrics_recorder =
       TelemetryProvider::GetInstance().CreateMetricsRecorder();
@@ -190,6 +229,27 @@ TEST(CacheTest, GetForCacheMissingKeyReturnsEmptySet) {
               UnorderedElementsAre("v1", "v2"));
 }
 
+TEST(CacheTest, ApplyMutationBatchAppliesAllMutations) {
+  auto noop_metrics_recorder =
+      TelemetryProvider::GetInstance().CreateMetricsRecorder();
+  std::unique_ptr<Cache> cache = KeyValueCache::Create(*noop_metrics_recorder);
+  cache->UpdateKeyValue("deleted_key", "value", 1);
+  KeyValueMutationBatch batch;
+  batch.AddKeyValue(KeyValueMutationType::Update, 2, "key1", "value1");
+  batch.AddKeyValueSet(KeyValueMutationType::Update, 2, "set_key");
+  batch.AddSetValue("v1");
+  batch.AddSetValue("v2");
+  batch.AddKeyValue(KeyValueMutationType::Delete, 3, "deleted_key", "");
+  batch.AddKeyValueSet(KeyValueMutationType::Delete, 3, "set_key");
+  batch.AddSetValue("v1");
+  cache->ApplyMutationBatch(batch);
+
+  EXPECT_THAT(cache->GetKeyValuePairs({"key1", "deleted_key"}),
+              UnorderedElementsAre(KVPairEq("key1", "value1")));
+  EXPECT_THAT(cache->GetKeyValueSet({"set_key"})->GetValueSet("set_key"),
+              UnorderedElementsAre("v2"));
+}
+
 TEST(DeleteKeyTest, RemovesKeyEntry) {
   auto noop_metrics_recorder =
       TelemetryProvider::GetInstance().CreateMetricsRecorder();
@@ -759,6 +819,48 @@ TEST(CleanUpTimestampsForSetCache, CantAddOldDeletedRecordsAfterCleanup) {
   EXPECT_EQ(kv_set.size(), 0);
 }
 
+TEST(ConcurrentMemoryAccessTest, ConcurrentGetValuesAndUpdate) {
+  auto noop_metrics_recorder =
+      TelemetryProvider::GetInstance().CreateMetricsRecorder();
+  auto cache = std::make_unique<KeyValueCache>(*noop_metrics_recorder);
+  cache->UpdateKeyValue("key1", "value", 1);
+  const std::vector<std::string_view> keys = {"key1"};
+  absl::Notification start;
+  auto lookup_fn = [&cache, &keys, &start]() {
+    start.WaitForNotification();
+    for (int i = 0; i < 100; ++i) {
+      const auto values = cache->GetValues(keys);
+      // Either deleted or one of the values written, even if it is replaced
+      // while in use.
+      if (values[0] != nullptr) {
+        EXPECT_THAT(*values[0], testing::StartsWith("value"));
+      }
+    }
+  };
+  auto update_fn = [&cache, &start](int64_t first_logical_commit_time) {
+    start.WaitForNotification();
+    for (int64_t i = 0; i < 100; ++i) {
+      const int64_t logical_commit_time = first_logical_commit_time + 2 * i;
+      if (i % 10 == 0) {
+        cache->DeleteKey("key1", logical_commit_time);
+      } else {
+        cache->UpdateKeyValue("key1", absl::StrCat("value", i),
+                              logical_commit_time);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < std::min(20, (int)std::thread::hardware_concurrency());
+       i++) {
+    threads.emplace_back(lookup_fn);
+    threads.emplace_back(update_fn, 2 + i % 2);
+  }
+  start.Notify();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST(ConcurrentSetMemoryAccessTest, ConcurrentGetAndGet) {
   auto noop_metrics_recorder =
       TelemetryProvider::GetInstance().CreateMetricsRecorder();
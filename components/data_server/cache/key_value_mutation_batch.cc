@@ -0,0 +1,63 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/key_value_mutation_batch.h"
+
+namespace kv_server {
+
+void KeyValueMutationBatch::AddKeyValue(KeyValueMutationType mutation_type,
+                                        int64_t logical_commit_time,
+                                        std::string_view key,
+                                        std::string_view value) {
+  mutation_types_.push_back(mutation_type);
+  value_types_.push_back(Value::StringValue);
+  logical_commit_times_.push_back(logical_commit_time);
+  keys_.push_back(key);
+  values_begin_.push_back(values_.size());
+  values_.push_back(value);
+}
+
+void KeyValueMutationBatch::AddKeyValueSet(KeyValueMutationType mutation_type,
+                                           int64_t logical_commit_time,
+                                           std::string_view key) {
+  mutation_types_.push_back(mutation_type);
+  value_types_.push_back(Value::StringSet);
+  logical_commit_times_.push_back(logical_commit_time);
+  keys_.push_back(key);
+  values_begin_.push_back(values_.size());
+}
+
+void KeyValueMutationBatch::AddSetValue(std::string_view value) {
+  values_.push_back(value);
+}
+
+void KeyValueMutationBatch::Clear() {
+  mutation_types_.clear();
+  value_types_.clear();
+  logical_commit_times_.clear();
+  keys_.clear();
+  values_begin_.clear();
+  values_.clear();
+}
+
+void KeyValueMutationBatch::GetSetValues(
+    int64_t i, std::vector<std::string_view>& values) const {
+  values.clear();
+  const size_t end = i + 1 < size() ? values_begin_[i + 1] : values_.size();
+  for (size_t v = values_begin_[i]; v < end; v++) {
+    values.push_back(values_[v]);
+  }
+}
+
+}  // namespace kv_server
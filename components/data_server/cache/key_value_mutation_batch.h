@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_MUTATION_BATCH_H_
+#define COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_MUTATION_BATCH_H_
+
+#include <string_view>
+#include <vector>
+
+#include "public/data_loading/data_loading_generated.h"
+
+namespace kv_server {
+
+// Columnar batch of decoded key value mutations.
+//
+// The batch does not copy keys and values, it only holds views into them, so
+// they must outlive the batch or its next `Clear` call. Per-mutation fields
+// are stored in parallel arrays, so a batch can be filled and cleared
+// repeatedly without allocations once its arrays have grown to the working
+// size.
+//
+// Not thread safe.
+class KeyValueMutationBatch {
+ public:
+  // Appends a mutation with a single string value.
+  void AddKeyValue(KeyValueMutationType mutation_type,
+                   int64_t logical_commit_time, std::string_view key,
+                   std::string_view value);
+
+  // Appends a mutation with a string set value. The values of the set are
+  // added by calling `AddSetValue` right after this call.
+  void AddKeyValueSet(KeyValueMutationType mutation_type,
+                      int64_t logical_commit_time, std::string_view key);
+
+  // Adds `value` to the set of the last mutation added with `AddKeyValueSet`.
+  void AddSetValue(std::string_view value);
+
+  // Removes all mutations but keeps the allocated arrays.
+  void Clear();
+
+  int64_t size() const { return mutation_types_.size(); }
+  bool empty() const { return mutation_types_.empty(); }
+
+  KeyValueMutationType mutation_type(int64_t i) const {
+    return mutation_types_[i];
+  }
+  Value value_type(int64_t i) const { return value_types_[i]; }
+  int64_t logical_commit_time(int64_t i) const {
+    return logical_commit_times_[i];
+  }
+  std::string_view key(int64_t i) const { return keys_[i]; }
+
+  // Returns the value of mutation `i`. Must only be called for mutations with
+  // `Value::StringValue` values.
+  std::string_view value(int64_t i) const { return values_[values_begin_[i]]; }
+
+  // Replaces the contents of `values` with the set values of mutation `i`.
+  // Must only be called for mutations with `Value::StringSet` values.
+  // `values` is meant to be reused across calls to avoid allocations.
+  void GetSetValues(int64_t i, std::vector<std::string_view>& values) const;
+
+ private:
+  std::vector<KeyValueMutationType> mutation_types_;
+  std::vector<Value> value_types_;
+  std::vector<int64_t> logical_commit_times_;
+  std::vector<std::string_view> keys_;
+  // Index of the first value of each mutation in `values_`. The values of
+  // mutation `i` end where the values of mutation `i + 1` begin.
+  std::vector<size_t> values_begin_;
+  std::vector<std::string_view> values_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_MUTATION_BATCH_H_
@@ -0,0 +1,85 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/key_value_mutation_batch.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+
+TEST(KeyValueMutationBatchTest, StoresMutationsInOrder) {
+  KeyValueMutationBatch batch;
+  batch.AddKeyValue(KeyValueMutationType::Update, 10, "key1", "value1");
+  batch.AddKeyValueSet(KeyValueMutationType::Delete, 20, "key2");
+  batch.AddSetValue("v1");
+  batch.AddSetValue("v2");
+  batch.AddKeyValueSet(KeyValueMutationType::Update, 30, "key3");
+  ASSERT_EQ(batch.size(), 3);
+
+  EXPECT_EQ(batch.mutation_type(0), KeyValueMutationType::Update);
+  EXPECT_EQ(batch.value_type(0), Value::StringValue);
+  EXPECT_EQ(batch.logical_commit_time(0), 10);
+  EXPECT_EQ(batch.key(0), "key1");
+  EXPECT_EQ(batch.value(0), "value1");
+
+  std::vector<std::string_view> values;
+  EXPECT_EQ(batch.mutation_type(1), KeyValueMutationType::Delete);
+  EXPECT_EQ(batch.value_type(1), Value::StringSet);
+  EXPECT_EQ(batch.logical_commit_time(1), 20);
+  EXPECT_EQ(batch.key(1), "key2");
+  batch.GetSetValues(1, values);
+  EXPECT_THAT(values, ElementsAre("v1", "v2"));
+
+  EXPECT_EQ(batch.key(2), "key3");
+  batch.GetSetValues(2, values);
+  EXPECT_TRUE(values.empty());
+}
+
+TEST(KeyValueMutationBatchTest, HoldsViewsIntoTheAddedBytes) {
+  KeyValueMutationBatch batch;
+  const std::string key = "key1";
+  const std::string value(1024, 'a');
+  const std::string set_value = "v1";
+  batch.AddKeyValue(KeyValueMutationType::Update, 10, key, value);
+  batch.AddKeyValueSet(KeyValueMutationType::Update, 20, key);
+  batch.AddSetValue(set_value);
+  EXPECT_EQ(batch.key(0).data(), key.data());
+  EXPECT_EQ(batch.value(0).data(), value.data());
+  std::vector<std::string_view> values;
+  batch.GetSetValues(1, values);
+  ASSERT_EQ(values.size(), 1);
+  EXPECT_EQ(values[0].data(), set_value.data());
+}
+
+TEST(KeyValueMutationBatchTest, ClearRemovesAllMutations) {
+  KeyValueMutationBatch batch;
+  batch.AddKeyValue(KeyValueMutationType::Update, 10, "key1", "value1");
+  batch.Clear();
+  EXPECT_TRUE(batch.empty());
+  batch.AddKeyValue(KeyValueMutationType::Update, 20, "key2", "value2");
+  ASSERT_EQ(batch.size(), 1);
+  EXPECT_EQ(batch.key(0), "key2");
+  EXPECT_EQ(batch.value(0), "value2");
+}
+
+}  // namespace
+}  // namespace kv_server
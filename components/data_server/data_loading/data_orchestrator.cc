@@ -16,11 +16,17 @@
 
 #include <algorithm>
 #include <deque>
+#include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include "absl/functional/bind_front.h"
+#include "absl/functional/function_ref.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "components/data_server/cache/key_value_mutation_batch.h"
 #include "components/errors/retry.h"
 #include "glog/logging.h"
 #include "public/constants.h"
@@ -64,35 +70,26 @@ void LogDataLoadingMetrics(const DataLoadingStats& data_loading_stats) {
               static_cast<double>(data_loading_stats.total_dropped_records)));
 }
 
-absl::Status ApplyUpdateMutation(const KeyValueMutationRecord& record,
-                                 Cache& cache) {
-  if (record.value_type() == Value::StringValue) {
-    cache.UpdateKeyValue(record.key()->string_view(),
-                         GetRecordValue<std::string_view>(record),
-                         record.logical_commit_time());
-    return absl::OkStatus();
-  }
-  if (record.value_type() == Value::StringSet) {
-    auto values = GetRecordValue<std::vector<std::string_view>>(record);
-    cache.UpdateKeyValueSet(record.key()->string_view(), absl::MakeSpan(values),
-                            record.logical_commit_time());
-    return absl::OkStatus();
-  }
-  return absl::InvalidArgumentError(
-      absl::StrCat("Record with key: ", record.key()->string_view(),
-                   " has unsupported value type: ", record.value_type()));
-}
+// Number of records that are decoded into one `KeyValueMutationBatch` before
+// the batch is applied to the cache.
+constexpr int64_t kDataLoadingBatchSize = 1024;
 
-absl::Status ApplyDeleteMutation(const KeyValueMutationRecord& record,
-                                 Cache& cache) {
+// Adds `record` to `batch`. The batch holds views into `record`, so `record`
+// must outlive the batch's use.
+absl::Status AddMutationToBatch(const KeyValueMutationRecord& record,
+                                KeyValueMutationBatch& batch) {
   if (record.value_type() == Value::StringValue) {
-    cache.DeleteKey(record.key()->string_view(), record.logical_commit_time());
+    batch.AddKeyValue(record.mutation_type(), record.logical_commit_time(),
+                      record.key()->string_view(),
+                      GetRecordValue<std::string_view>(record));
     return absl::OkStatus();
   }
   if (record.value_type() == Value::StringSet) {
-    auto values = GetRecordValue<std::vector<std::string_view>>(record);
-    cache.DeleteValuesInSet(record.key()->string_view(), absl::MakeSpan(values),
-                            record.logical_commit_time());
+    batch.AddKeyValueSet(record.mutation_type(), record.logical_commit_time(),
+                         record.key()->string_view());
+    for (const auto value : *record.value_as_StringSet()->value()) {
+      batch.AddSetValue(value->string_view());
+    }
     return absl::OkStatus();
   }
   return absl::InvalidArgumentError(
@@ -122,12 +119,38 @@ bool ShouldProcessRecord(const KeyValueMutationRecord& record,
   return false;
 }
 
-absl::Status ApplyKeyValueMutationToCache(
-    const KeyValueMutationRecord& record, Cache& cache, int64_t& max_timestamp,
-    DataLoadingStats& data_loading_stats) {
+// File level sharding information (the shard number and the shard index) is
+// only valid for servers that use the same sharding function as the writer of
+// the file. Otherwise all records are read and filtered one by one, which
+// allows migrating to a different sharding function without rewriting data.
+bool HasCompatibleShardingFunction(const KVFileMetadata& metadata,
+                                   const KeySharder& key_sharder) {
+  return static_cast<ShardingFunctionVersion>(
+             metadata.sharding_metadata().sharding_function_version()) ==
+         key_sharder.sharding_function_version();
+}
+
+// A shard index is also only valid for servers that extract sharding keys
+// from keys the same way as the writer of the file. Otherwise, records of the
+// server's shard could be in sections of other shards.
+bool HasCompatibleShardIndex(const KVFileMetadata& metadata,
+                             const KeySharder& key_sharder) {
+  const auto& sharding_metadata = metadata.sharding_metadata();
+  return sharding_metadata.num_index_shards() > 1 &&
+         HasCompatibleShardingFunction(metadata, key_sharder) &&
+         sharding_metadata.sharding_key_regex() ==
+             key_sharder.sharding_key_regex() &&
+         sharding_metadata.sharding_key_delimiter() ==
+             key_sharder.sharding_key_delimiter();
+}
+
+absl::Status AddKeyValueMutationToBatch(const KeyValueMutationRecord& record,
+                                        KeyValueMutationBatch& batch,
+                                        int64_t& max_timestamp,
+                                        DataLoadingStats& data_loading_stats) {
   switch (record.mutation_type()) {
     case KeyValueMutationType::Update: {
-      if (auto status = ApplyUpdateMutation(record, cache); !status.ok()) {
+      if (auto status = AddMutationToBatch(record, batch); !status.ok()) {
         return status;
       }
       max_timestamp = std::max(max_timestamp, record.logical_commit_time());
@@ -135,7 +158,7 @@ absl::Status ApplyKeyValueMutationToCache(
       break;
     }
     case KeyValueMutationType::Delete: {
-      if (auto status = ApplyDeleteMutation(record, cache); !status.ok()) {
+      if (auto status = AddMutationToBatch(record, batch); !status.ok()) {
         return status;
       }
       max_timestamp = std::max(max_timestamp, record.logical_commit_time());
@@ -150,44 +173,136 @@ absl::Status ApplyKeyValueMutationToCache(
   return absl::OkStatus();
 }
 
+// Hands out `KeyValueMutationBatch`es for reuse. Each reader worker holds at
+// most one batch at a time, so the pool grows to one batch per worker and
+// batches are cleared instead of reallocated for every record batch.
+class MutationBatchPool {
+ public:
+  std::unique_ptr<KeyValueMutationBatch> Get() ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    if (free_batches_.empty()) {
+      return std::make_unique<KeyValueMutationBatch>();
+    }
+    auto batch = std::move(free_batches_.back());
+    free_batches_.pop_back();
+    return batch;
+  }
+
+  void Return(std::unique_ptr<KeyValueMutationBatch> batch)
+      ABSL_LOCKS_EXCLUDED(mu_) {
+    batch->Clear();
+    absl::MutexLock lock(&mu_);
+    free_batches_.push_back(std::move(batch));
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<std::unique_ptr<KeyValueMutationBatch>> free_batches_
+      ABSL_GUARDED_BY(mu_);
+};
+
+// Decodes each batch of raw records read by `record_reader` once into a
+// `KeyValueMutationBatch` and passes the whole batch to
+// `apply_mutation_batch`. The mutation batch only holds views into the raw
+// records, which stay valid until the record batch callback returns. Batches
+// may be processed concurrently, so per-batch stats are merged under a lock.
 absl::StatusOr<DataLoadingStats> LoadCacheWithData(
-    StreamRecordReader& record_reader, Cache& cache, int64_t& max_timestamp,
-    const int32_t server_shard_num, const int32_t num_shards,
-    UdfClient& udf_client, const KeySharder& key_sharder) {
+    StreamRecordReader& record_reader,
+    absl::FunctionRef<void(const KeyValueMutationBatch&)> apply_mutation_batch,
+    int64_t& max_timestamp, const int32_t server_shard_num,
+    const int32_t num_shards, UdfClient& udf_client,
+    const KeySharder& key_sharder,
+    const std::function<void()>& on_udf_code_updated,
+    const std::function<absl::Status(std::string_view, int64_t)>&
+        set_compression_dictionary) {
+  absl::Mutex stats_mu;
   DataLoadingStats data_loading_stats;
-  const auto process_data_record_fn =
-      [&cache, &max_timestamp, &data_loading_stats, server_shard_num,
-       num_shards, &udf_client, &key_sharder](const DataRecord& data_record) {
-        if (data_record.record_type() == Record::KeyValueMutationRecord) {
-          const auto* record = data_record.record_as_KeyValueMutationRecord();
-          if (!ShouldProcessRecord(*record, num_shards, server_shard_num,
-                                   key_sharder, data_loading_stats)) {
-            // NOTE: currently upstream logic retries on non-ok status
-            // this will get us in a loop
-            return absl::OkStatus();
-          }
-          return ApplyKeyValueMutationToCache(*record, cache, max_timestamp,
-                                              data_loading_stats);
-        } else if (data_record.record_type() ==
-                   Record::UserDefinedFunctionsConfig) {
-          const auto* udf_config =
-              data_record.record_as_UserDefinedFunctionsConfig();
-          VLOG(3) << "Setting UDF code snippet for version: "
-                  << udf_config->version();
-          return udf_client.SetCodeObject(CodeConfig{
-              .js = udf_config->code_snippet()->str(),
-              .udf_handler_name = udf_config->handler_name()->str(),
-              .logical_commit_time = udf_config->logical_commit_time(),
-              .version = udf_config->version()});
+  MutationBatchPool batch_pool;
+  const auto process_record_batch_fn =
+      [&apply_mutation_batch, &max_timestamp, &data_loading_stats, &stats_mu,
+       &batch_pool, server_shard_num, num_shards, &udf_client, &key_sharder,
+       &on_udf_code_updated, &set_compression_dictionary](
+          absl::Span<const std::string_view> raw_records) {
+        std::unique_ptr<KeyValueMutationBatch> pooled_batch = batch_pool.Get();
+        KeyValueMutationBatch& batch = *pooled_batch;
+        int64_t batch_max_timestamp = 0;
+        DataLoadingStats batch_stats;
+        const auto process_data_record_fn =
+            [&batch, &batch_max_timestamp, &batch_stats, server_shard_num,
+             num_shards, &udf_client, &key_sharder, &on_udf_code_updated,
+             &set_compression_dictionary](const DataRecord& data_record) {
+              if (data_record.record_type() ==
+                  Record::KeyValueMutationRecord) {
+                const auto* record =
+                    data_record.record_as_KeyValueMutationRecord();
+                if (!ShouldProcessRecord(*record, num_shards,
+                                         server_shard_num, key_sharder,
+                                         batch_stats)) {
+                  // NOTE: currently upstream logic retries on non-ok status
+                  // this will get us in a loop
+                  return absl::OkStatus();
+                }
+                return AddKeyValueMutationToBatch(
+                    *record, batch, batch_max_timestamp, batch_stats);
+              } else if (data_record.record_type() ==
+                         Record::UserDefinedFunctionsConfig) {
+                const auto* udf_config =
+                    data_record.record_as_UserDefinedFunctionsConfig();
+                VLOG(3) << "Setting UDF code snippet for version: "
+                        << udf_config->version();
+                auto status = udf_client.SetCodeObject(CodeConfig{
+                    .js = udf_config->code_snippet()->str(),
+                    .udf_handler_name = udf_config->handler_name()->str(),
+                    .logical_commit_time = udf_config->logical_commit_time(),
+                    .version = udf_config->version(),
+                    .binary_io = udf_config->binary_io()});
+                if (status.ok() && on_udf_code_updated) {
+                  on_udf_code_updated();
+                }
+                return status;
+              } else if (data_record.record_type() ==
+                         Record::CompressionDictionaryRecord) {
+                const auto* dictionary_record =
+                    data_record.record_as_CompressionDictionaryRecord();
+                if (!set_compression_dictionary) {
+                  VLOG(3) << "Ignoring compression dictionary record";
+                  return absl::OkStatus();
+                }
+                const auto* dictionary = dictionary_record->dictionary();
+                VLOG(3) << "Setting compression dictionary for logical commit "
+                           "time: "
+                        << dictionary_record->logical_commit_time();
+                return set_compression_dictionary(
+                    dictionary == nullptr
+                        ? std::string_view()
+                        : std::string_view(
+                              reinterpret_cast<const char*>(dictionary->data()),
+                              dictionary->size()),
+                    dictionary_record->logical_commit_time());
+              }
+              LOG(ERROR) << "Received unsupported record ";
+              return absl::InvalidArgumentError("Record type not supported.");
+            };
+        absl::Status overall_status;
+        for (const std::string_view raw : raw_records) {
+          overall_status.Update(
+              DeserializeDataRecord(raw, process_data_record_fn));
         }
-        LOG(ERROR) << "Received unsupported record ";
-        return absl::InvalidArgumentError("Record type not supported.");
+        apply_mutation_batch(batch);
+        batch_pool.Return(std::move(pooled_batch));
+        absl::MutexLock lock(&stats_mu);
+        max_timestamp = std::max(max_timestamp, batch_max_timestamp);
+        data_loading_stats.total_updated_records +=
+            batch_stats.total_updated_records;
+        data_loading_stats.total_deleted_records +=
+            batch_stats.total_deleted_records;
+        data_loading_stats.total_dropped_records +=
+            batch_stats.total_dropped_records;
+        return overall_status;
       };
 
-  auto status = record_reader.ReadStreamRecords(
-      [&process_data_record_fn](std::string_view raw) {
-        return DeserializeDataRecord(raw, process_data_record_fn);
-      });
+  auto status = record_reader.ReadStreamRecordBatches(kDataLoadingBatchSize,
+                                                      process_record_batch_fn);
   if (!status.ok()) {
     return status;
   }
@@ -212,7 +327,10 @@ absl::StatusOr<DataLoadingStats> LoadCacheWithDataFromFile(
   if (!metadata.ok()) {
     return metadata.status();
   }
-  if (metadata->has_sharding_metadata() &&
+  const bool has_compatible_sharding_function =
+      HasCompatibleShardingFunction(*metadata, options.key_sharder);
+  if (has_compatible_sharding_function &&
+      metadata->sharding_metadata().has_shard_num() &&
       metadata->sharding_metadata().shard_num() != options.shard_num) {
     LOG(INFO) << "Blob " << location << " belongs to shard num "
               << metadata->sharding_metadata().shard_num()
@@ -224,9 +342,30 @@ absl::StatusOr<DataLoadingStats> LoadCacheWithDataFromFile(
         .total_dropped_records = 0,
     };
   }
-  auto status = LoadCacheWithData(*record_reader, cache, max_timestamp,
-                                  options.shard_num, options.num_shards,
-                                  options.udf_client, options.key_sharder);
+  if (HasCompatibleShardIndex(*metadata, options.key_sharder)) {
+    // Records of other shards are still filtered out while loading, the
+    // shard index only lets us skip reading most of them.
+    auto restricted =
+        record_reader->RestrictToShard(options.shard_num, options.num_shards);
+    if (!restricted.ok()) {
+      return restricted.status();
+    }
+    LOG(INFO) << "Blob " << location << " has a shard index for "
+              << metadata->sharding_metadata().num_index_shards()
+              << " shards, restricted reads to shard " << options.shard_num
+              << ": " << (*restricted ? "yes" : "no");
+  }
+  auto status = LoadCacheWithData(
+      *record_reader,
+      [&cache, &options](const KeyValueMutationBatch& batch) {
+        cache.ApplyMutationBatch(batch);
+        if (options.on_update_applied) {
+          options.on_update_applied();
+        }
+      },
+      max_timestamp, options.shard_num, options.num_shards, options.udf_client,
+      options.key_sharder, options.on_udf_code_updated,
+      options.set_compression_dictionary);
   if (status.ok()) {
     cache.RemoveDeletedKeys(max_timestamp);
   }
@@ -244,13 +383,25 @@ absl::StatusOr<DataLoadingStats> TraceLoadCacheWithDataFromFile(
        {"key", std::move(location.key)}});
 }
 
+RealtimeUpdateBatcher::Options GetRealtimeUpdateBatcherOptions(
+    const DataOrchestrator::Options& options) {
+  RealtimeUpdateBatcher::Options batcher_options =
+      options.realtime_update_batcher_options;
+  if (options.on_update_applied) {
+    batcher_options.on_batch_applied = options.on_update_applied;
+  }
+  return batcher_options;
+}
+
 class DataOrchestratorImpl : public DataOrchestrator {
  public:
   // `last_basename` is the last file seen during init. The cache is up to
   // date until this file.
   DataOrchestratorImpl(Options options, std::string last_basename)
       : options_(std::move(options)),
-        last_basename_of_init_(std::move(last_basename)) {}
+        last_basename_of_init_(std::move(last_basename)),
+        realtime_update_batcher_(options_.cache,
+                                 GetRealtimeUpdateBatcherOptions(options_)) {}
 
   ~DataOrchestratorImpl() override {
     if (!data_loader_thread_) return;
@@ -321,11 +472,11 @@ class DataOrchestratorImpl : public DataOrchestrator {
         absl::bind_front(&DataOrchestratorImpl::ProcessNewFiles, this));
 
     return options_.realtime_thread_pool_manager.Start(
-        [this, &cache = options_.cache,
+        [this,
          &delta_stream_reader_factory = options_.delta_stream_reader_factory](
             const std::string& message_body) {
           return LoadCacheWithHighPriorityUpdates(delta_stream_reader_factory,
-                                                  message_body, cache);
+                                                  message_body);
         });
   }
 
@@ -409,7 +560,8 @@ class DataOrchestratorImpl : public DataOrchestrator {
       if (!metadata.ok()) {
         return metadata.status();
       }
-      if (metadata->has_sharding_metadata() &&
+      if (HasCompatibleShardingFunction(*metadata, options.key_sharder) &&
+          metadata->sharding_metadata().has_shard_num() &&
           metadata->sharding_metadata().shard_num() != options.shard_num) {
         LOG(INFO) << "Snapshot " << location << " belongs to shard num "
                   << metadata->sharding_metadata().shard_num()
@@ -431,15 +583,23 @@ class DataOrchestratorImpl : public DataOrchestrator {
     return ending_delta_file;
   }
 
+  // Mutations are handed to `realtime_update_batcher_`, so they might only
+  // be visible in the cache after this returns. The batcher calls
+  // `on_update_applied` once they are.
   absl::StatusOr<DataLoadingStats> LoadCacheWithHighPriorityUpdates(
       StreamRecordReaderFactory& delta_stream_reader_factory,
-      const std::string& record_string, Cache& cache) {
+      const std::string& record_string) {
     std::istringstream is(record_string);
     int64_t max_timestamp = 0;
     auto record_reader = delta_stream_reader_factory.CreateReader(is);
-    return LoadCacheWithData(*record_reader, cache, max_timestamp,
-                             options_.shard_num, options_.num_shards,
-                             options_.udf_client, options_.key_sharder);
+    return LoadCacheWithData(
+        *record_reader,
+        [this](const KeyValueMutationBatch& batch) {
+          realtime_update_batcher_.Add(batch);
+        },
+        max_timestamp, options_.shard_num, options_.num_shards,
+        options_.udf_client, options_.key_sharder,
+        options_.on_udf_code_updated, options_.set_compression_dictionary);
   }
 
   const Options options_;
@@ -449,6 +609,7 @@ class DataOrchestratorImpl : public DataOrchestrator {
   bool stop_ ABSL_GUARDED_BY(mu_) = false;
   // last basename of file in initialization.
   const std::string last_basename_of_init_;
+  RealtimeUpdateBatcher realtime_update_batcher_;
 };
 
 }  // namespace
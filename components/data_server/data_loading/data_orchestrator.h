@@ -15,8 +15,10 @@
 #ifndef COMPONENTS_DATA_SERVER_DATA_LOADING_DATA_ORCHESTRATOR_H_
 #define COMPONENTS_DATA_SERVER_DATA_LOADING_DATA_ORCHESTRATOR_H_
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -28,6 +30,7 @@
 #include "components/data/realtime/realtime_notifier.h"
 #include "components/data/realtime/realtime_thread_pool_manager.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/data_loading/realtime_update_batcher.h"
 #include "components/udf/udf_client.h"
 #include "public/data_loading/readers/riegeli_stream_io.h"
 #include "public/data_loading/readers/stream_record_reader_factory.h"
@@ -56,6 +59,21 @@ class DataOrchestrator {
     const int32_t shard_num = 0;
     const int32_t num_shards = 1;
     const KeySharder key_sharder;
+    // Controls how realtime updates are batched before they are applied to
+    // `cache`.
+    const RealtimeUpdateBatcher::Options realtime_update_batcher_options = {};
+    // Called after data updates have been applied to `cache`, if set. Realtime
+    // updates are only reported once their batch is applied, not when they
+    // are queued. Can be called concurrently.
+    const std::function<void()> on_update_applied;
+    // Called after new UDF code has been loaded, if set. Can be called
+    // concurrently.
+    const std::function<void()> on_udf_code_updated;
+    // Installs the dictionary of a compression dictionary record, if set.
+    // Records are ignored otherwise. Can be called concurrently.
+    const std::function<absl::Status(std::string_view dictionary,
+                                     int64_t logical_commit_time)>
+        set_compression_dictionary;
   };
 
   // Creates initial state. Scans the bucket and initializes the cache with data
@@ -14,6 +14,7 @@
 
 #include "components/data_server/data_loading/data_orchestrator.h"
 
+#include <atomic>
 #include <string>
 #include <utility>
 #include <vector>
@@ -41,6 +42,7 @@
 using kv_server::BlobStorageChangeNotifier;
 using kv_server::BlobStorageClient;
 using kv_server::CodeConfig;
+using kv_server::CompressionDictionaryRecordStruct;
 using kv_server::DataOrchestrator;
 using kv_server::DataRecordStruct;
 using kv_server::FilePrefix;
@@ -415,6 +417,118 @@ TEST_F(DataOrchestratorTest, UpdateUdfCodeSuccess) {
   EXPECT_FALSE((*maybe_orchestrator)->Start().ok());
 }
 
+TEST_F(DataOrchestratorTest, UpdateUdfCodeNotifiesUpdateApplied) {
+  const std::vector<std::string> fnames({ToDeltaFileName(1).value()});
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::DELTA>())))
+      .WillOnce(Return(fnames));
+
+  KVFileMetadata metadata;
+  auto reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*reader, GetKVFileMetadata).Times(1).WillOnce(Return(metadata));
+  EXPECT_CALL(*reader, ReadStreamRecords)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            callback(ToStringView(ToFlatBufferBuilder(DataRecordStruct{
+                         .record =
+                             UserDefinedFunctionsConfigStruct{
+                                 .code_snippet = "function hello(){}",
+                                 .handler_name = "hello",
+                                 .language =
+                                     UserDefinedFunctionsLanguage::Javascript,
+                                 .logical_commit_time = 1,
+                                 .binary_io = true}})))
+                .IgnoreError();
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(reader))));
+  EXPECT_CALL(udf_client_, SetCodeObject(Field(&CodeConfig::binary_io, true)))
+      .WillOnce(Return(absl::OkStatus()));
+
+  std::atomic<int> num_updates_applied = 0;
+  std::atomic<int> num_udf_code_updates = 0;
+  auto maybe_orchestrator = DataOrchestrator::TryCreate({
+      .data_bucket = GetTestLocation().bucket,
+      .cache = cache_,
+      .blob_client = blob_client_,
+      .delta_notifier = notifier_,
+      .change_notifier = change_notifier_,
+      .udf_client = udf_client_,
+      .delta_stream_reader_factory = delta_stream_reader_factory_,
+      .realtime_thread_pool_manager = realtime_thread_pool_manager_,
+      .key_sharder =
+          kv_server::KeySharder(kv_server::ShardingFunction{/*seed=*/""}),
+      .on_update_applied = [&num_updates_applied]() { ++num_updates_applied; },
+      .on_udf_code_updated =
+          [&num_udf_code_updates]() { ++num_udf_code_updates; },
+  });
+  ASSERT_TRUE(maybe_orchestrator.ok());
+  EXPECT_GE(num_updates_applied, 1);
+  EXPECT_EQ(num_udf_code_updates, 1);
+}
+
+TEST_F(DataOrchestratorTest, SetsCompressionDictionary) {
+  const std::vector<std::string> fnames({ToDeltaFileName(1).value()});
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::DELTA>())))
+      .WillOnce(Return(fnames));
+
+  KVFileMetadata metadata;
+  auto reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*reader, GetKVFileMetadata).Times(1).WillOnce(Return(metadata));
+  EXPECT_CALL(*reader, ReadStreamRecords)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            callback(ToStringView(ToFlatBufferBuilder(DataRecordStruct{
+                         .record =
+                             CompressionDictionaryRecordStruct{
+                                 .dictionary = "dictionary",
+                                 .logical_commit_time = 3}})))
+                .IgnoreError();
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(reader))));
+
+  std::vector<std::pair<std::string, int64_t>> dictionaries;
+  auto maybe_orchestrator = DataOrchestrator::TryCreate({
+      .data_bucket = GetTestLocation().bucket,
+      .cache = cache_,
+      .blob_client = blob_client_,
+      .delta_notifier = notifier_,
+      .change_notifier = change_notifier_,
+      .udf_client = udf_client_,
+      .delta_stream_reader_factory = delta_stream_reader_factory_,
+      .realtime_thread_pool_manager = realtime_thread_pool_manager_,
+      .key_sharder =
+          kv_server::KeySharder(kv_server::ShardingFunction{/*seed=*/""}),
+      .set_compression_dictionary =
+          [&dictionaries](std::string_view dictionary,
+                          int64_t logical_commit_time) {
+            dictionaries.emplace_back(dictionary, logical_commit_time);
+            return absl::OkStatus();
+          },
+  });
+  ASSERT_TRUE(maybe_orchestrator.ok());
+  EXPECT_THAT(dictionaries,
+              testing::ElementsAre(testing::Pair("dictionary", 3)));
+}
+
 TEST_F(DataOrchestratorTest, UpdateUdfCodeFails_OrchestratorContinues) {
   const std::vector<std::string> fnames({ToDeltaFileName(1).value()});
   EXPECT_CALL(
@@ -659,4 +773,154 @@ TEST_F(DataOrchestratorTest, InitCacheSkipsSnapshotFilesForOtherShards) {
   EXPECT_TRUE(DataOrchestrator::TryCreate(options_).ok());
 }
 
+TEST_F(DataOrchestratorTest,
+       InitCacheLoadsSnapshotFilesShardedWithOtherShardingFunction) {
+  auto snapshot_name = ToSnapshotFileName(1);
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::SNAPSHOT>()))))
+      .WillOnce(Return(std::vector<std::string>({*snapshot_name})));
+  KVFileMetadata metadata;
+  *metadata.mutable_snapshot()->mutable_starting_file() =
+      ToDeltaFileName(1).value();
+  *metadata.mutable_snapshot()->mutable_ending_delta_file() =
+      ToDeltaFileName(5).value();
+  // The shard number was computed with a different sharding function than
+  // the server's, so it says nothing about the keys of the server's shard.
+  metadata.mutable_sharding_metadata()->set_shard_num(17);
+  metadata.mutable_sharding_metadata()->set_sharding_function_version(
+      static_cast<int32_t>(kv_server::ShardingFunctionVersion::kHighwayHash));
+  auto record_reader1 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader1, GetKVFileMetadata).WillOnce(Return(metadata));
+  auto record_reader2 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader2, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(*record_reader2, ReadStreamRecords)
+      .WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .Times(2)
+      .WillOnce(Return(ByMove(std::move(record_reader1))))
+      .WillOnce(Return(ByMove(std::move(record_reader2))));
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after,
+                            ToDeltaFileName(5).value()),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_TRUE(DataOrchestrator::TryCreate(options_).ok());
+}
+
+
+TEST_F(DataOrchestratorTest, InitCacheUsesShardIndexOfCompatibleFiles) {
+  auto snapshot_name = ToSnapshotFileName(1);
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::SNAPSHOT>()))))
+      .WillOnce(Return(std::vector<std::string>({*snapshot_name})));
+  KVFileMetadata metadata;
+  *metadata.mutable_snapshot()->mutable_starting_file() =
+      ToDeltaFileName(1).value();
+  *metadata.mutable_snapshot()->mutable_ending_delta_file() =
+      ToDeltaFileName(5).value();
+  metadata.mutable_sharding_metadata()->set_num_index_shards(2);
+  metadata.mutable_sharding_metadata()->set_sharding_key_regex("(.*)_.*");
+  auto record_reader1 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader1, GetKVFileMetadata).WillOnce(Return(metadata));
+  auto record_reader2 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader2, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(*record_reader2, RestrictToShard(1, 2)).WillOnce(Return(true));
+  EXPECT_CALL(*record_reader2, ReadStreamRecords)
+      .WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .Times(2)
+      .WillOnce(Return(ByMove(std::move(record_reader1))))
+      .WillOnce(Return(ByMove(std::move(record_reader2))));
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after,
+                            ToDeltaFileName(5).value()),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(std::vector<std::string>()));
+
+  auto sharded_options = DataOrchestrator::Options{
+      .data_bucket = GetTestLocation().bucket,
+      .cache = cache_,
+      .blob_client = blob_client_,
+      .delta_notifier = notifier_,
+      .change_notifier = change_notifier_,
+      .udf_client = udf_client_,
+      .delta_stream_reader_factory = delta_stream_reader_factory_,
+      .realtime_thread_pool_manager = realtime_thread_pool_manager_,
+      .shard_num = 1,
+      .num_shards = 2,
+      .key_sharder = kv_server::KeySharder(
+          kv_server::ShardingFunction{/*seed=*/""},
+          kv_server::ShardingKeyRegex{.pattern = "(.*)_.*"})};
+  EXPECT_TRUE(DataOrchestrator::TryCreate(sharded_options).ok());
+}
+
+TEST_F(DataOrchestratorTest,
+       InitCacheIgnoresShardIndexOfFilesWithOtherShardingKeys) {
+  auto snapshot_name = ToSnapshotFileName(1);
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::SNAPSHOT>()))))
+      .WillOnce(Return(std::vector<std::string>({*snapshot_name})));
+  KVFileMetadata metadata;
+  *metadata.mutable_snapshot()->mutable_starting_file() =
+      ToDeltaFileName(1).value();
+  *metadata.mutable_snapshot()->mutable_ending_delta_file() =
+      ToDeltaFileName(5).value();
+  // Sections were built from whole keys, but the server shards by the
+  // sharding key before "_", so its records may be in any section.
+  metadata.mutable_sharding_metadata()->set_num_index_shards(2);
+  auto record_reader1 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader1, GetKVFileMetadata).WillOnce(Return(metadata));
+  auto record_reader2 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader2, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(*record_reader2, RestrictToShard).Times(0);
+  EXPECT_CALL(*record_reader2, ReadStreamRecords)
+      .WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .Times(2)
+      .WillOnce(Return(ByMove(std::move(record_reader1))))
+      .WillOnce(Return(ByMove(std::move(record_reader2))));
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after,
+                            ToDeltaFileName(5).value()),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(std::vector<std::string>()));
+
+  auto sharded_options = DataOrchestrator::Options{
+      .data_bucket = GetTestLocation().bucket,
+      .cache = cache_,
+      .blob_client = blob_client_,
+      .delta_notifier = notifier_,
+      .change_notifier = change_notifier_,
+      .udf_client = udf_client_,
+      .delta_stream_reader_factory = delta_stream_reader_factory_,
+      .realtime_thread_pool_manager = realtime_thread_pool_manager_,
+      .shard_num = 1,
+      .num_shards = 2,
+      .key_sharder = kv_server::KeySharder(
+          kv_server::ShardingFunction{/*seed=*/""},
+          kv_server::ShardingKeyDelimiter{.delimiter = "_"})};
+  EXPECT_TRUE(DataOrchestrator::TryCreate(sharded_options).ok());
+}
+
 }  // namespace
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "components/data_server/data_loading/realtime_update_batcher.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace kv_server {
+
+RealtimeUpdateBatcher::RealtimeUpdateBatcher(Cache& cache, Options options)
+    : cache_(cache), options_(std::move(options)) {
+  if (options_.max_batch_delay > absl::ZeroDuration()) {
+    flush_thread_ = std::make_unique<std::thread>(
+        &RealtimeUpdateBatcher::FlushPeriodically, this);
+  }
+}
+
+RealtimeUpdateBatcher::~RealtimeUpdateBatcher() {
+  if (flush_thread_ != nullptr) {
+    {
+      absl::MutexLock lock(&mu_);
+      stop_ = true;
+    }
+    flush_thread_->join();
+  }
+  Flush();
+}
+
+void RealtimeUpdateBatcher::Add(const KeyValueMutationBatch& batch) {
+  if (batch.empty()) {
+    return;
+  }
+  if (flush_thread_ == nullptr) {
+    // No batching window. Still coalesces updates within `batch`.
+    PendingUpdates coalesced;
+    {
+      absl::MutexLock lock(&mu_);
+      AddLocked(batch);
+      TakePendingLocked(coalesced);
+    }
+    KeyValueMutationBatch coalesced_batch;
+    Apply(coalesced, coalesced_batch);
+    return;
+  }
+  absl::MutexLock lock(&mu_);
+  if (NumPendingLocked() == 0) {
+    oldest_pending_time_ = absl::Now();
+  }
+  AddLocked(batch);
+}
+
+void RealtimeUpdateBatcher::Flush() {
+  PendingUpdates updates;
+  {
+    absl::MutexLock lock(&mu_);
+    TakePendingLocked(updates);
+  }
+  KeyValueMutationBatch batch;
+  Apply(updates, batch);
+}
+
+void RealtimeUpdateBatcher::Apply(const PendingUpdates& updates,
+                                  KeyValueMutationBatch& batch) {
+  batch.Clear();
+  for (const auto& [key, mutation] : updates.string_mutations) {
+    batch.AddKeyValue(mutation.mutation_type, mutation.logical_commit_time,
+                      key, mutation.value);
+  }
+  for (const SetMutation& mutation : updates.set_mutations) {
+    batch.AddKeyValueSet(mutation.mutation_type, mutation.logical_commit_time,
+                         mutation.key);
+    for (const std::string& value : mutation.values) {
+      batch.AddSetValue(value);
+    }
+  }
+  if (batch.empty()) {
+    return;
+  }
+  VLOG(8) << "Applying " << batch.size() << " realtime mutations";
+  cache_.ApplyMutationBatch(batch);
+  if (options_.on_batch_applied) {
+    options_.on_batch_applied();
+  }
+}
+
+void RealtimeUpdateBatcher::AddLocked(const KeyValueMutationBatch& batch) {
+  std::vector<std::string_view> set_values;
+  for (int64_t i = 0; i < batch.size(); i++) {
+    if (batch.value_type(i) != Value::StringValue) {
+      batch.GetSetValues(i, set_values);
+      pending_.set_mutations.push_back(SetMutation{
+          .mutation_type = batch.mutation_type(i),
+          .logical_commit_time = batch.logical_commit_time(i),
+          .key = std::string(batch.key(i)),
+          .values = std::vector<std::string>(set_values.begin(),
+                                             set_values.end()),
+      });
+      continue;
+    }
+    auto [it, inserted] = pending_.string_mutations.try_emplace(batch.key(i));
+    // Same as the cache, an update only wins over a strictly older one.
+    if (!inserted &&
+        it->second.logical_commit_time >= batch.logical_commit_time(i)) {
+      continue;
+    }
+    it->second.mutation_type = batch.mutation_type(i);
+    it->second.logical_commit_time = batch.logical_commit_time(i);
+    it->second.value = batch.value(i);
+  }
+}
+
+void RealtimeUpdateBatcher::TakePendingLocked(PendingUpdates& updates) {
+  updates = std::move(pending_);
+  pending_ = PendingUpdates();
+}
+
+void RealtimeUpdateBatcher::FlushPeriodically() {
+  // Reused for every batch, so that applying batches does not allocate once
+  // the batch has grown to the working size.
+  KeyValueMutationBatch batch;
+  while (true) {
+    PendingUpdates updates;
+    {
+      absl::MutexLock lock(&mu_);
+      mu_.Await(absl::Condition(this, &RealtimeUpdateBatcher::HasPending));
+      if (stop_) {
+        return;
+      }
+      // Waits for the batching window to end unless the batch fills up
+      // first.
+      mu_.AwaitWithDeadline(
+          absl::Condition(this, &RealtimeUpdateBatcher::IsBatchFull),
+          oldest_pending_time_ + options_.max_batch_delay);
+      TakePendingLocked(updates);
+    }
+    Apply(updates, batch);
+  }
+}
+
+}  // namespace kv_server
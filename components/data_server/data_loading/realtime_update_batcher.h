@@ -0,0 +1,119 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_DATA_LOADING_REALTIME_UPDATE_BATCHER_H_
+#define COMPONENTS_DATA_SERVER_DATA_LOADING_REALTIME_UPDATE_BATCHER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/key_value_mutation_batch.h"
+
+namespace kv_server {
+
+// Accumulates realtime updates and applies them to the cache in batches.
+//
+// Updates are held for at most `max_batch_delay` (or until
+// `max_batch_size` mutations are pending) and multiple updates to the same
+// string value key are coalesced, keeping only the one with the newest
+// logical commit time. With a zero `max_batch_delay`, updates are applied
+// right away by the calling thread.
+//
+// Thread safe.
+class RealtimeUpdateBatcher {
+ public:
+  struct Options {
+    absl::Duration max_batch_delay = absl::ZeroDuration();
+    int64_t max_batch_size = 10000;
+    // Called after each batch has been applied to the cache, if set.
+    std::function<void()> on_batch_applied;
+  };
+
+  RealtimeUpdateBatcher(Cache& cache, Options options);
+  // Applies all pending updates.
+  ~RealtimeUpdateBatcher();
+
+  RealtimeUpdateBatcher(const RealtimeUpdateBatcher&) = delete;
+  RealtimeUpdateBatcher& operator=(const RealtimeUpdateBatcher&) = delete;
+
+  // Queues the mutations in `batch`.
+  void Add(const KeyValueMutationBatch& batch);
+
+  // Applies all pending updates to the cache.
+  void Flush();
+
+ private:
+  struct StringMutation {
+    KeyValueMutationType mutation_type;
+    int64_t logical_commit_time;
+    std::string value;
+  };
+  struct SetMutation {
+    KeyValueMutationType mutation_type;
+    int64_t logical_commit_time;
+    std::string key;
+    std::vector<std::string> values;
+  };
+  // Copies of the queued mutations. Batches passed to `Add` only hold views
+  // into their callers' records, so they can't be kept around.
+  struct PendingUpdates {
+    // Newest pending mutation per key with a string value.
+    absl::flat_hash_map<std::string, StringMutation> string_mutations;
+    // Pending set mutations. These are not coalesced because every set value
+    // has its own logical commit time in the cache.
+    std::vector<SetMutation> set_mutations;
+  };
+
+  // Applies `updates` to the cache. `batch` is only used as scratch space
+  // and is meant to be reused across calls.
+  void Apply(const PendingUpdates& updates, KeyValueMutationBatch& batch);
+  void AddLocked(const KeyValueMutationBatch& batch)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Moves the pending updates into `updates`.
+  void TakePendingLocked(PendingUpdates& updates)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  int64_t NumPendingLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return pending_.string_mutations.size() + pending_.set_mutations.size();
+  }
+  // Conditions for the flush thread. Both are also true when stopping.
+  bool HasPending() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stop_ || NumPendingLocked() > 0;
+  }
+  bool IsBatchFull() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stop_ || NumPendingLocked() >= options_.max_batch_size;
+  }
+  void FlushPeriodically();
+
+  Cache& cache_;
+  const Options options_;
+  absl::Mutex mu_;
+  PendingUpdates pending_ ABSL_GUARDED_BY(mu_);
+  // When the oldest pending update was added.
+  absl::Time oldest_pending_time_ ABSL_GUARDED_BY(mu_);
+  bool stop_ ABSL_GUARDED_BY(mu_) = false;
+  std::unique_ptr<std::thread> flush_thread_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_DATA_LOADING_REALTIME_UPDATE_BATCHER_H_
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "components/data_server/data_loading/realtime_update_batcher.h"
+
+#include "absl/synchronization/notification.h"
+#include "components/data_server/cache/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::StrictMock;
+
+TEST(RealtimeUpdateBatcherTest, CoalescesUpdatesToTheSameKey) {
+  StrictMock<MockCache> cache;
+  EXPECT_CALL(cache, UpdateKeyValue("key1", "value3", 3)).Times(1);
+  EXPECT_CALL(cache, DeleteKey("key2", 5)).Times(1);
+  RealtimeUpdateBatcher batcher(cache, {});
+  KeyValueMutationBatch batch;
+  batch.AddKeyValue(KeyValueMutationType::Update, 1, "key1", "value1");
+  batch.AddKeyValue(KeyValueMutationType::Update, 3, "key1", "value3");
+  batch.AddKeyValue(KeyValueMutationType::Update, 2, "key1", "value2");
+  batch.AddKeyValue(KeyValueMutationType::Update, 4, "key2", "value4");
+  batch.AddKeyValue(KeyValueMutationType::Delete, 5, "key2", "");
+  batcher.Add(batch);
+}
+
+TEST(RealtimeUpdateBatcherTest, AppliesAllSetMutations) {
+  StrictMock<MockCache> cache;
+  EXPECT_CALL(cache, UpdateKeyValueSet("key1", ElementsAre("v1", "v2"), 1))
+      .Times(1);
+  EXPECT_CALL(cache, DeleteValuesInSet("key1", ElementsAre("v1"), 2))
+      .Times(1);
+  RealtimeUpdateBatcher batcher(cache, {});
+  KeyValueMutationBatch batch;
+  batch.AddKeyValueSet(KeyValueMutationType::Update, 1, "key1");
+  batch.AddSetValue("v1");
+  batch.AddSetValue("v2");
+  batch.AddKeyValueSet(KeyValueMutationType::Delete, 2, "key1");
+  batch.AddSetValue("v1");
+  batcher.Add(batch);
+}
+
+TEST(RealtimeUpdateBatcherTest, NotifiesAfterApplyingBatch) {
+  StrictMock<MockCache> cache;
+  int num_applied_batches = 0;
+  EXPECT_CALL(cache, UpdateKeyValue("key1", "value1", 1))
+      .WillOnce([&num_applied_batches]() {
+        EXPECT_EQ(num_applied_batches, 0);
+      });
+  RealtimeUpdateBatcher batcher(
+      cache, {.on_batch_applied = [&num_applied_batches]() {
+        ++num_applied_batches;
+      }});
+  KeyValueMutationBatch batch;
+  batcher.Add(batch);
+  EXPECT_EQ(num_applied_batches, 0);
+  batch.AddKeyValue(KeyValueMutationType::Update, 1, "key1", "value1");
+  batcher.Add(batch);
+  EXPECT_EQ(num_applied_batches, 1);
+}
+
+TEST(RealtimeUpdateBatcherTest, CoalescesUpdatesAcrossBatchesWithinWindow) {
+  StrictMock<MockCache> cache;
+  absl::Notification applied;
+  EXPECT_CALL(cache, UpdateKeyValue("key1", "value2", 2))
+      .WillOnce([&applied]() { applied.Notify(); });
+  RealtimeUpdateBatcher batcher(
+      cache, {.max_batch_delay = absl::Milliseconds(50)});
+  KeyValueMutationBatch batch;
+  batch.AddKeyValue(KeyValueMutationType::Update, 1, "key1", "value1");
+  batcher.Add(batch);
+  batch.Clear();
+  batch.AddKeyValue(KeyValueMutationType::Update, 2, "key1", "value2");
+  batcher.Add(batch);
+  EXPECT_TRUE(applied.WaitForNotificationWithTimeout(absl::Seconds(10)));
+}
+
+TEST(RealtimeUpdateBatcherTest, AppliesFullBatchBeforeWindowEnds) {
+  StrictMock<MockCache> cache;
+  absl::Notification applied;
+  EXPECT_CALL(cache, UpdateKeyValue("key1", "value1", 1)).Times(1);
+  EXPECT_CALL(cache, UpdateKeyValue("key2", "value2", 2))
+      .WillOnce([&applied]() { applied.Notify(); });
+  RealtimeUpdateBatcher batcher(
+      cache, {.max_batch_delay = absl::Hours(1), .max_batch_size = 2});
+  KeyValueMutationBatch batch;
+  batch.AddKeyValue(KeyValueMutationType::Update, 1, "key1", "value1");
+  batcher.Add(batch);
+  batch.Clear();
+  batch.AddKeyValue(KeyValueMutationType::Update, 2, "key2", "value2");
+  batcher.Add(batch);
+  EXPECT_TRUE(applied.WaitForNotificationWithTimeout(absl::Seconds(10)));
+}
+
+TEST(RealtimeUpdateBatcherTest, AppliesPendingUpdatesOnDestruction) {
+  StrictMock<MockCache> cache;
+  EXPECT_CALL(cache, UpdateKeyValue("key1", "value1", 1)).Times(1);
+  {
+    RealtimeUpdateBatcher batcher(cache,
+                                  {.max_batch_delay = absl::Hours(1)});
+    KeyValueMutationBatch batch;
+    batch.AddKeyValue(KeyValueMutationType::Update, 1, "key1", "value1");
+    batcher.Add(batch);
+  }
+}
+
+}  // namespace
+}  // namespace kv_server
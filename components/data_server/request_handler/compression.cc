@@ -14,6 +14,8 @@
 #include "components/data_server/request_handler/compression.h"
 
 #include "components/data_server/request_handler/compression_brotli.h"
+#include "components/data_server/request_handler/compression_gzip.h"
+#include "components/data_server/request_handler/compression_zstd.h"
 #include "components/data_server/request_handler/uncompressed.h"
 #include "glog/logging.h"
 #include "quiche/common/quiche_data_writer.h"
@@ -27,21 +29,36 @@ void CompressionGroupConcatenator::AddCompressionGroup(
 }
 
 std::unique_ptr<CompressionGroupConcatenator>
-CompressionGroupConcatenator::Create(CompressionType type) {
-  if (type == CompressionType::kUncompressed) {
-    return std::make_unique<UncompressedConcatenator>();
-  } else {
-    return std::make_unique<BrotliCompressionGroupConcatenator>();
+CompressionGroupConcatenator::Create(CompressionType type,
+                                     const ZstdDictionary* dictionary) {
+  switch (type) {
+    case CompressionType::kUncompressed:
+      return std::make_unique<UncompressedConcatenator>();
+    case CompressionType::kGzip:
+      return std::make_unique<GzipCompressionGroupConcatenator>();
+    case CompressionType::kZstd:
+      return std::make_unique<ZstdCompressionGroupConcatenator>();
+    case CompressionType::kZstdWithDictionary:
+      return std::make_unique<ZstdCompressionGroupConcatenator>(dictionary);
+    default:
+      return std::make_unique<BrotliCompressionGroupConcatenator>();
   }
 }
 
 std::unique_ptr<CompressedBlobReader> CompressedBlobReader::Create(
     CompressionGroupConcatenator::CompressionType type,
-    std::string_view compressed) {
-  if (type == CompressionGroupConcatenator::CompressionType::kUncompressed) {
-    return std::make_unique<UncompressedBlobReader>(compressed);
-  } else {
-    return std::make_unique<BrotliCompressionBlobReader>(compressed);
+    std::string_view compressed, const ZstdDictionary* dictionary) {
+  switch (type) {
+    case CompressionGroupConcatenator::CompressionType::kUncompressed:
+      return std::make_unique<UncompressedBlobReader>(compressed);
+    case CompressionGroupConcatenator::CompressionType::kGzip:
+      return std::make_unique<GzipCompressionBlobReader>(compressed);
+    case CompressionGroupConcatenator::CompressionType::kZstd:
+    case CompressionGroupConcatenator::CompressionType::kZstdWithDictionary:
+      return std::make_unique<ZstdCompressionBlobReader>(compressed,
+                                                         dictionary);
+    default:
+      return std::make_unique<BrotliCompressionBlobReader>(compressed);
   }
 }
 
@@ -27,6 +27,8 @@
 
 namespace kv_server {
 
+class ZstdDictionary;
+
 // Responsible for concatenating compression groups according to the compression
 // specification
 // https://github.com/WICG/turtledove/blob/main/FLEDGE_Key_Value_Server_API.md#response-version-20
@@ -41,10 +43,18 @@ class CompressionGroupConcatenator {
  public:
   virtual ~CompressionGroupConcatenator() = default;
 
-  enum class CompressionType { kUncompressed = 0, kBrotli /* TODO: kGzip */ };
+  // kZstdWithDictionary compresses with the dictionary given to Create, or
+  // falls back to kZstd if there is none.
+  enum class CompressionType {
+    kUncompressed = 0,
+    kBrotli,
+    kGzip,
+    kZstd,
+    kZstdWithDictionary
+  };
 
   static std::unique_ptr<CompressionGroupConcatenator> Create(
-      CompressionType type);
+      CompressionType type, const ZstdDictionary* dictionary = nullptr);
   using FactoryFunctionType = decltype(Create);
 
   // Adds the JSON representation of plaintext (uncompressed) to be
@@ -70,9 +80,10 @@ class CompressedBlobReader {
   explicit CompressedBlobReader(std::string_view compressed)
       : data_reader_(compressed) {}
 
+  // `dictionary` is needed to read groups compressed with it.
   static std::unique_ptr<CompressedBlobReader> Create(
       CompressionGroupConcatenator::CompressionType type,
-      std::string_view compressed);
+      std::string_view compressed, const ZstdDictionary* dictionary = nullptr);
 
   virtual ~CompressedBlobReader() = default;
 
@@ -28,6 +28,29 @@ namespace kv_server {
 
 namespace {
 
+constexpr size_t kMediumGroupBytes = 16 << 10;
+constexpr size_t kLargeGroupBytes = 1 << 20;
+
+// The default quality compresses best, but is slow enough on large groups to
+// add milliseconds to the response latency.
+int BrotliQualityForSize(size_t size) {
+  if (size < kMediumGroupBytes) {
+    return BROTLI_DEFAULT_QUALITY;
+  }
+  return size < kLargeGroupBytes ? 6 : 4;
+}
+
+// The smallest window holding the whole group, so that small groups need less
+// encoder and decoder memory. A window of `lgwin` bits holds
+// `(1 << lgwin) - 16` bytes.
+int BrotliWindowForSize(size_t size) {
+  int lgwin = BROTLI_MIN_WINDOW_BITS;
+  while (lgwin < BROTLI_DEFAULT_WINDOW && (size_t{1} << lgwin) - 16 < size) {
+    ++lgwin;
+  }
+  return lgwin;
+}
+
 // Responsible for compressing one compression group.
 absl::StatusOr<std::string> CompressOnePartition(std::string_view partition) {
   VLOG(5) << "Compressing " << partition;
@@ -37,8 +60,8 @@ absl::StatusOr<std::string> CompressOnePartition(std::string_view partition) {
   std::string partition_output(sizeof(uint32_t) + buffer_size, '\0');
 
   if (auto rc = BrotliEncoderCompress(
-          /*quality=*/BROTLI_DEFAULT_QUALITY,
-          /*lgwin=*/BROTLI_DEFAULT_WINDOW,
+          /*quality=*/BrotliQualityForSize(partition.size()),
+          /*lgwin=*/BrotliWindowForSize(partition.size()),
           /*mode=*/BROTLI_DEFAULT_MODE,
           /*input_size=*/partition.size(),
           /*input_buffer=*/
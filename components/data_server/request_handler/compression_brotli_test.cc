@@ -16,6 +16,8 @@
 
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "components/data_server/request_handler/uncompressed.h"
 #include "glog/logging.h"
@@ -91,5 +93,32 @@ TEST(CompressionGroupConcatenatorTest, Success) {
   EXPECT_TRUE(blob_reader.IsDoneReading());
 }
 
+TEST(CompressionGroupConcatenatorTest, GroupsOfAllSizesRoundTrip) {
+  // Sizes use different qualities and windows.
+  std::vector<std::string> groups;
+  for (const int size : {10, 5'000, 100'000, 3'000'000}) {
+    std::string group;
+    for (int i = 0; group.size() < static_cast<size_t>(size); ++i) {
+      group.append(std::to_string(i * 7919 % 10007));
+    }
+    groups.push_back(std::move(group));
+  }
+  BrotliCompressionGroupConcatenator concatenator;
+  for (const auto& group : groups) {
+    concatenator.AddCompressionGroup(group);
+  }
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+
+  BrotliCompressionBlobReader blob_reader(*maybe_output);
+  for (const auto& group : groups) {
+    auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+    ASSERT_TRUE(maybe_compression_group.ok())
+        << maybe_compression_group.status();
+    EXPECT_EQ(*maybe_compression_group, group);
+  }
+  EXPECT_TRUE(blob_reader.IsDoneReading());
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,144 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_gzip.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/cleanup/cleanup.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "glog/logging.h"
+#include "quiche/common/quiche_data_writer.h"
+#include "zlib.h"
+
+namespace kv_server {
+
+namespace {
+
+// Makes zlib read and write the gzip format rather than the zlib one.
+constexpr int kGzipWindowBits = MAX_WBITS + 16;
+constexpr size_t kLargeGroupBytes = 1 << 20;
+constexpr size_t kInflateChunkBytes = 16 << 10;
+
+// Large groups trade some compression ratio for speed, since they would
+// otherwise add milliseconds to the response latency.
+int GzipLevelForSize(size_t size) {
+  return size < kLargeGroupBytes ? Z_DEFAULT_COMPRESSION : 4;
+}
+
+// Responsible for compressing one compression group.
+absl::StatusOr<std::string> CompressOnePartition(std::string_view partition) {
+  VLOG(5) << "Compressing " << partition;
+  z_stream stream = {};
+  if (deflateInit2(&stream, GzipLevelForSize(partition.size()), Z_DEFLATED,
+                   kGzipWindowBits, /*memLevel=*/8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return absl::InternalError("Gzip encoder cannot be initialized");
+  }
+  absl::Cleanup stream_end = [&stream] { deflateEnd(&stream); };
+  const uLong buffer_size = deflateBound(&stream, partition.size());
+  // The output consists of the size of the compressed data and the compressed
+  // data
+  std::string partition_output(sizeof(uint32_t) + buffer_size, '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(partition.data()));
+  stream.avail_in = partition.size();
+  stream.next_out =
+      reinterpret_cast<Bytef*>(&partition_output.at(sizeof(uint32_t)));
+  stream.avail_out = buffer_size;
+  // The buffer is large enough for the whole output, so a single call
+  // finishes the stream.
+  if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+    return absl::InternalError("Gzip failed to compress");
+  }
+  partition_output.resize(sizeof(uint32_t) + stream.total_out);
+  quiche::QuicheDataWriter data_writer(sizeof(uint32_t),
+                                       partition_output.data());
+  data_writer.WriteUInt32(stream.total_out);
+  VLOG(5) << "partition output size: " << partition_output.size();
+  return partition_output;
+}
+
+absl::StatusOr<std::string> Decompress(std::string_view compressed) {
+  z_stream stream = {};
+  if (inflateInit2(&stream, kGzipWindowBits) != Z_OK) {
+    return absl::InternalError("Gzip decoder cannot be initialized");
+  }
+  absl::Cleanup stream_end = [&stream] { inflateEnd(&stream); };
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = compressed.size();
+  std::string output;
+  while (true) {
+    const size_t output_size = output.size();
+    output.resize(output_size + kInflateChunkBytes);
+    stream.next_out = reinterpret_cast<Bytef*>(&output[output_size]);
+    stream.avail_out = kInflateChunkBytes;
+    const int result = inflate(&stream, Z_NO_FLUSH);
+    output.resize(output_size + kInflateChunkBytes - stream.avail_out);
+    switch (result) {
+      case Z_STREAM_END:
+        // If Gzip stops before the input is fully consumed, there is a
+        // problem with the input.
+        if (stream.avail_in != 0) {
+          return absl::DataLossError("corrupted (exuberant) input");
+        }
+        return output;
+      case Z_OK:
+        break;
+      case Z_BUF_ERROR:
+        // No progress is possible: the whole input was given, so it is
+        // truncated.
+        return absl::DataLossError("corrupted (truncated) input");
+      default:
+        return absl::DataLossError(absl::StrCat(
+            "corrupted input: ", stream.msg != nullptr ? stream.msg : ""));
+    }
+  }
+}
+
+}  // namespace
+
+absl::StatusOr<std::string> GzipCompressionGroupConcatenator::Build() const {
+  std::vector<std::string> compression_groups;
+  // Go through every partition to compress them one by one.
+  for (const auto& partition : Partitions()) {
+    if (auto maybe_partition_output = CompressOnePartition(partition);
+        !maybe_partition_output.ok()) {
+      return maybe_partition_output.status();
+    } else {
+      compression_groups.push_back(std::move(maybe_partition_output).value());
+    }
+  }
+  return absl::StrJoin(compression_groups, "");
+}
+
+absl::StatusOr<std::string>
+GzipCompressionBlobReader::ExtractOneCompressionGroup() {
+  uint32_t compression_group_size = 0;
+  if (!data_reader_.ReadUInt32(&compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group size");
+  }
+  VLOG(9) << "compression_group_size: " << compression_group_size;
+  std::string_view compressed_data;
+  if (!data_reader_.ReadStringPiece(&compressed_data, compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group");
+  }
+  return Decompress(compressed_data);
+}
+
+}  // namespace kv_server
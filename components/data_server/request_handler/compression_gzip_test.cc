@@ -0,0 +1,79 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_gzip.h"
+
+#include <string>
+#include <string_view>
+
+#include "components/data_server/request_handler/uncompressed.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+const std::string_view kTestString = "large message";
+const std::string_view kTestString2 = "large message 2";
+
+TEST(GzipCompressionGroupConcatenatorTest, Success) {
+  GzipCompressionGroupConcatenator concatenator;
+  concatenator.AddCompressionGroup(std::string(kTestString));
+  concatenator.AddCompressionGroup(std::string(kTestString2));
+  // Larger than one decompression chunk.
+  std::string large_message(100'000, 'a');
+  concatenator.AddCompressionGroup(large_message);
+
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+
+  GzipCompressionBlobReader blob_reader(*maybe_output);
+
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+
+  auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  EXPECT_TRUE(maybe_compression_group.ok());
+  EXPECT_EQ(*maybe_compression_group, kTestString);
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+
+  maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  EXPECT_TRUE(maybe_compression_group.ok());
+  EXPECT_EQ(*maybe_compression_group, kTestString2);
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+
+  maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  EXPECT_TRUE(maybe_compression_group.ok());
+  EXPECT_EQ(*maybe_compression_group, large_message);
+  EXPECT_TRUE(blob_reader.IsDoneReading());
+}
+
+TEST(GzipCompressionBlobReaderTest, TruncatedInputFails) {
+  GzipCompressionGroupConcatenator concatenator;
+  concatenator.AddCompressionGroup(std::string(kTestString));
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+  // Drops the end of the gzip stream, keeping the group framing valid.
+  UncompressedConcatenator truncated_concatenator;
+  truncated_concatenator.AddCompressionGroup(
+      maybe_output->substr(sizeof(uint32_t), maybe_output->size() - 8));
+  auto maybe_truncated = truncated_concatenator.Build();
+  ASSERT_TRUE(maybe_truncated.ok());
+
+  GzipCompressionBlobReader blob_reader(*maybe_truncated);
+  EXPECT_EQ(blob_reader.ExtractOneCompressionGroup().status().code(),
+            absl::StatusCode::kDataLoss);
+}
+
+}  // namespace
+}  // namespace kv_server
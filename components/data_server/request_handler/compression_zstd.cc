@@ -0,0 +1,200 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_zstd.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/cleanup/cleanup.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "glog/logging.h"
+#include "quiche/common/quiche_data_writer.h"
+
+namespace kv_server {
+
+namespace {
+
+// Default zstd level. Dictionaries fix their level when they are created.
+constexpr int kZstdLevel = 3;
+
+// Responsible for compressing one compression group.
+absl::StatusOr<std::string> CompressOnePartition(
+    std::string_view partition, const ZstdDictionary* dictionary) {
+  VLOG(5) << "Compressing " << partition;
+  ZSTD_CCtx* context = ZSTD_createCCtx();
+  if (context == nullptr) {
+    return absl::InternalError("Zstd encoder cannot be initialized");
+  }
+  absl::Cleanup context_free = [context] { ZSTD_freeCCtx(context); };
+  const size_t buffer_size = ZSTD_compressBound(partition.size());
+  // The output consists of the size of the compressed data and the compressed
+  // data
+  std::string partition_output(sizeof(uint32_t) + buffer_size, '\0');
+  char* const compressed = &partition_output.at(sizeof(uint32_t));
+  const size_t compressed_size =
+      dictionary == nullptr
+          ? ZSTD_compressCCtx(context, compressed, buffer_size,
+                              partition.data(), partition.size(), kZstdLevel)
+          : ZSTD_compress_usingCDict(context, compressed, buffer_size,
+                                     partition.data(), partition.size(),
+                                     dictionary->compression_dictionary());
+  if (ZSTD_isError(compressed_size)) {
+    return absl::InternalError(absl::StrCat(
+        "Zstd failed to compress: ", ZSTD_getErrorName(compressed_size)));
+  }
+  partition_output.resize(sizeof(uint32_t) + compressed_size);
+  quiche::QuicheDataWriter data_writer(sizeof(uint32_t),
+                                       partition_output.data());
+  data_writer.WriteUInt32(compressed_size);
+  VLOG(5) << "partition output size: " << partition_output.size();
+  return partition_output;
+}
+
+absl::StatusOr<std::string> Decompress(std::string_view compressed,
+                                       const ZstdDictionary* dictionary) {
+  // The frame header names the dictionary it was compressed with, 0 if none.
+  const uint32_t dictionary_id =
+      ZSTD_getDictID_fromFrame(compressed.data(), compressed.size());
+  if (dictionary_id != 0 &&
+      (dictionary == nullptr || dictionary->id() != dictionary_id)) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "Compression group needs unavailable dictionary ", dictionary_id));
+  }
+  const unsigned long long content_size =
+      ZSTD_getFrameContentSize(compressed.data(), compressed.size());
+  if (content_size == ZSTD_CONTENTSIZE_ERROR ||
+      content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return absl::DataLossError("corrupted input: invalid zstd frame header");
+  }
+  ZSTD_DCtx* context = ZSTD_createDCtx();
+  if (context == nullptr) {
+    return absl::InternalError("Zstd decoder cannot be initialized");
+  }
+  absl::Cleanup context_free = [context] { ZSTD_freeDCtx(context); };
+  std::string output(content_size, '\0');
+  const size_t output_size =
+      dictionary_id == 0
+          ? ZSTD_decompressDCtx(context, output.data(), output.size(),
+                                compressed.data(), compressed.size())
+          : ZSTD_decompress_usingDDict(context, output.data(), output.size(),
+                                       compressed.data(), compressed.size(),
+                                       dictionary->decompression_dictionary());
+  if (ZSTD_isError(output_size)) {
+    return absl::DataLossError(
+        absl::StrCat("corrupted input: ", ZSTD_getErrorName(output_size)));
+  }
+  if (output_size != output.size()) {
+    return absl::DataLossError("corrupted (truncated) input");
+  }
+  return output;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<ZstdDictionary>> ZstdDictionary::Create(
+    std::string_view dictionary) {
+  // Raw content dictionaries have no id, so readers could not tell them
+  // apart.
+  const uint32_t id = ZSTD_getDictID_fromDict(dictionary.data(),
+                                              dictionary.size());
+  if (id == 0) {
+    return absl::InvalidArgumentError(
+        "Compression dictionary is not in the zstd dictionary format");
+  }
+  ZSTD_CDict* compression_dictionary =
+      ZSTD_createCDict(dictionary.data(), dictionary.size(), kZstdLevel);
+  ZSTD_DDict* decompression_dictionary =
+      ZSTD_createDDict(dictionary.data(), dictionary.size());
+  if (compression_dictionary == nullptr ||
+      decompression_dictionary == nullptr) {
+    ZSTD_freeCDict(compression_dictionary);
+    ZSTD_freeDDict(decompression_dictionary);
+    return absl::InvalidArgumentError("Compression dictionary is invalid");
+  }
+  return absl::WrapUnique(new ZstdDictionary(id, compression_dictionary,
+                                             decompression_dictionary));
+}
+
+ZstdDictionary::~ZstdDictionary() {
+  ZSTD_freeCDict(compression_dictionary_);
+  ZSTD_freeDDict(decompression_dictionary_);
+}
+
+absl::Status ZstdDictionaryStore::Update(std::string_view dictionary,
+                                         int64_t logical_commit_time) {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (logical_commit_time_ >= logical_commit_time) {
+      VLOG(1) << "Not updating compression dictionary. logical_commit_time "
+              << logical_commit_time << " too small, should be greater than "
+              << logical_commit_time_;
+      return absl::OkStatus();
+    }
+  }
+  // Built outside of the lock, which requests take to read the dictionary.
+  absl::StatusOr<std::unique_ptr<ZstdDictionary>> new_dictionary =
+      ZstdDictionary::Create(dictionary);
+  if (!new_dictionary.ok()) {
+    return new_dictionary.status();
+  }
+  absl::MutexLock lock(&mutex_);
+  if (logical_commit_time_ >= logical_commit_time) {
+    return absl::OkStatus();
+  }
+  LOG(INFO) << "Loaded compression dictionary " << (*new_dictionary)->id()
+            << " with logical_commit_time " << logical_commit_time;
+  dictionary_ = std::move(new_dictionary).value();
+  logical_commit_time_ = logical_commit_time;
+  return absl::OkStatus();
+}
+
+std::shared_ptr<const ZstdDictionary> ZstdDictionaryStore::Get() const {
+  absl::MutexLock lock(&mutex_);
+  return dictionary_;
+}
+
+absl::StatusOr<std::string> ZstdCompressionGroupConcatenator::Build() const {
+  std::vector<std::string> compression_groups;
+  // Go through every partition to compress them one by one.
+  for (const auto& partition : Partitions()) {
+    if (auto maybe_partition_output =
+            CompressOnePartition(partition, dictionary_);
+        !maybe_partition_output.ok()) {
+      return maybe_partition_output.status();
+    } else {
+      compression_groups.push_back(std::move(maybe_partition_output).value());
+    }
+  }
+  return absl::StrJoin(compression_groups, "");
+}
+
+absl::StatusOr<std::string>
+ZstdCompressionBlobReader::ExtractOneCompressionGroup() {
+  uint32_t compression_group_size = 0;
+  if (!data_reader_.ReadUInt32(&compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group size");
+  }
+  VLOG(9) << "compression_group_size: " << compression_group_size;
+  std::string_view compressed_data;
+  if (!data_reader_.ReadStringPiece(&compressed_data, compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group");
+  }
+  return Decompress(compressed_data, dictionary_);
+}
+
+}  // namespace kv_server
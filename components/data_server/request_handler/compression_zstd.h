@@ -0,0 +1,119 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_ZSTD_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_ZSTD_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data_server/request_handler/compression.h"
+#include "zstd.h"
+
+namespace kv_server {
+
+// Dictionary shared by the server and its clients to compress responses,
+// which repeat the same key names and values across requests. Must be in the
+// zstd dictionary format, e.g. trained with `zstd --train` on recent
+// responses. Its id is written in the header of every zstd frame compressed
+// with it, so that readers can tell which dictionary they need.
+//
+// Immutable and thread safe.
+class ZstdDictionary {
+ public:
+  static absl::StatusOr<std::unique_ptr<ZstdDictionary>> Create(
+      std::string_view dictionary);
+
+  ~ZstdDictionary();
+  ZstdDictionary(const ZstdDictionary&) = delete;
+  ZstdDictionary& operator=(const ZstdDictionary&) = delete;
+
+  uint32_t id() const { return id_; }
+  const ZSTD_CDict* compression_dictionary() const {
+    return compression_dictionary_;
+  }
+  const ZSTD_DDict* decompression_dictionary() const {
+    return decompression_dictionary_;
+  }
+
+ private:
+  ZstdDictionary(uint32_t id, ZSTD_CDict* compression_dictionary,
+                 ZSTD_DDict* decompression_dictionary)
+      : id_(id),
+        compression_dictionary_(compression_dictionary),
+        decompression_dictionary_(decompression_dictionary) {}
+
+  const uint32_t id_;
+  ZSTD_CDict* const compression_dictionary_;
+  ZSTD_DDict* const decompression_dictionary_;
+};
+
+// Holds the dictionary of the latest compression dictionary record loaded
+// from delta files.
+//
+// Thread safe.
+class ZstdDictionaryStore {
+ public:
+  // Replaces the dictionary unless the current one has a larger or equal
+  // `logical_commit_time`. Keeps the current dictionary if `dictionary` is
+  // invalid.
+  absl::Status Update(std::string_view dictionary, int64_t logical_commit_time)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the current dictionary, null if there is none. The dictionary
+  // stays valid while it is held, even if it is replaced in the meantime.
+  std::shared_ptr<const ZstdDictionary> Get() const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<const ZstdDictionary> dictionary_ ABSL_GUARDED_BY(mutex_);
+  int64_t logical_commit_time_ ABSL_GUARDED_BY(mutex_) = -1;
+};
+
+// Builds compression groups that are compressed by zstd, with `dictionary` if
+// it is not null.
+class ZstdCompressionGroupConcatenator : public CompressionGroupConcatenator {
+ public:
+  explicit ZstdCompressionGroupConcatenator(
+      const ZstdDictionary* dictionary = nullptr)
+      : dictionary_(dictionary) {}
+
+  absl::StatusOr<std::string> Build() const override;
+
+ private:
+  const ZstdDictionary* dictionary_;
+};
+
+// Reads compression groups built with ZstdCompressionGroupConcatenator.
+// Groups compressed with a dictionary other than `dictionary` can't be read.
+class ZstdCompressionBlobReader : public CompressedBlobReader {
+ public:
+  explicit ZstdCompressionBlobReader(std::string_view compressed,
+                                     const ZstdDictionary* dictionary = nullptr)
+      : CompressedBlobReader(compressed), dictionary_(dictionary) {}
+
+  absl::StatusOr<std::string> ExtractOneCompressionGroup() override;
+
+ private:
+  const ZstdDictionary* dictionary_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_ZSTD_H_
@@ -0,0 +1,150 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_zstd.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zdict.h"
+
+namespace kv_server {
+namespace {
+
+const std::string_view kTestString = "large message";
+const std::string_view kTestString2 = "large message 2";
+
+std::string Response(int i) {
+  return absl::StrCat(
+      R"({"keyGroupOutputs":[{"tags":["custom","keys"],"keyValues":{"key)", i,
+      R"(":{"value":"https://render.example.com/ads?id=)", i * 7919,
+      R"(&size=300x250"}}}]})");
+}
+
+// Builds a dictionary in the zstd format out of sample responses, as
+// `zstd --train` would.
+std::string BuildDictionary(unsigned dictionary_id) {
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (int i = 0; i < 100; ++i) {
+    const std::string sample = Response(i);
+    samples.append(sample);
+    sample_sizes.push_back(sample.size());
+  }
+  std::string dictionary(4096, '\0');
+  ZDICT_params_t params = {};
+  params.dictID = dictionary_id;
+  const size_t dictionary_size = ZDICT_finalizeDictionary(
+      dictionary.data(), dictionary.size(), samples.data(), 1024,
+      samples.data(), sample_sizes.data(), sample_sizes.size(), params);
+  EXPECT_FALSE(ZDICT_isError(dictionary_size))
+      << ZDICT_getErrorName(dictionary_size);
+  dictionary.resize(dictionary_size);
+  return dictionary;
+}
+
+TEST(ZstdCompressionGroupConcatenatorTest, Success) {
+  ZstdCompressionGroupConcatenator concatenator;
+  concatenator.AddCompressionGroup(std::string(kTestString));
+  concatenator.AddCompressionGroup(std::string(kTestString2));
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+
+  ZstdCompressionBlobReader blob_reader(*maybe_output);
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+  auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  ASSERT_TRUE(maybe_compression_group.ok());
+  EXPECT_EQ(*maybe_compression_group, kTestString);
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+  maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  ASSERT_TRUE(maybe_compression_group.ok());
+  EXPECT_EQ(*maybe_compression_group, kTestString2);
+  EXPECT_TRUE(blob_reader.IsDoneReading());
+}
+
+TEST(ZstdDictionaryTest, RejectsRawContent) {
+  EXPECT_EQ(ZstdDictionary::Create(Response(0)).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(ZstdDictionaryTest, CompressesSmallerWithDictionary) {
+  auto dictionary = ZstdDictionary::Create(BuildDictionary(1234));
+  ASSERT_TRUE(dictionary.ok()) << dictionary.status();
+  EXPECT_EQ((*dictionary)->id(), 1234u);
+
+  const std::string response = Response(100);
+  ZstdCompressionGroupConcatenator plain_concatenator;
+  plain_concatenator.AddCompressionGroup(response);
+  auto plain_output = plain_concatenator.Build();
+  ASSERT_TRUE(plain_output.ok()) << plain_output.status();
+  ZstdCompressionGroupConcatenator concatenator(dictionary->get());
+  concatenator.AddCompressionGroup(response);
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+  EXPECT_LT(maybe_output->size(), plain_output->size());
+
+  ZstdCompressionBlobReader blob_reader(*maybe_output, dictionary->get());
+  auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  ASSERT_TRUE(maybe_compression_group.ok()) << maybe_compression_group.status();
+  EXPECT_EQ(*maybe_compression_group, response);
+  EXPECT_TRUE(blob_reader.IsDoneReading());
+}
+
+TEST(ZstdCompressionBlobReaderTest, FailsWithoutTheDictionary) {
+  auto dictionary = ZstdDictionary::Create(BuildDictionary(1234));
+  ASSERT_TRUE(dictionary.ok()) << dictionary.status();
+  auto other_dictionary = ZstdDictionary::Create(BuildDictionary(5678));
+  ASSERT_TRUE(other_dictionary.ok()) << other_dictionary.status();
+  ZstdCompressionGroupConcatenator concatenator(dictionary->get());
+  concatenator.AddCompressionGroup(Response(100));
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+
+  ZstdCompressionBlobReader blob_reader(*maybe_output);
+  EXPECT_EQ(blob_reader.ExtractOneCompressionGroup().status().code(),
+            absl::StatusCode::kFailedPrecondition);
+  ZstdCompressionBlobReader other_blob_reader(*maybe_output,
+                                              other_dictionary->get());
+  EXPECT_EQ(other_blob_reader.ExtractOneCompressionGroup().status().code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+TEST(ZstdDictionaryStoreTest, KeepsTheNewestValidDictionary) {
+  ZstdDictionaryStore store;
+  EXPECT_EQ(store.Get(), nullptr);
+  ASSERT_TRUE(store.Update(BuildDictionary(1234), 2).ok());
+  std::shared_ptr<const ZstdDictionary> dictionary = store.Get();
+  ASSERT_NE(dictionary, nullptr);
+  EXPECT_EQ(dictionary->id(), 1234u);
+
+  // Older records and invalid dictionaries do not replace it.
+  EXPECT_TRUE(store.Update(BuildDictionary(5678), 1).ok());
+  EXPECT_EQ(store.Get()->id(), 1234u);
+  EXPECT_EQ(store.Update(Response(0), 3).code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(store.Get()->id(), 1234u);
+
+  ASSERT_TRUE(store.Update(BuildDictionary(5678), 3).ok());
+  EXPECT_EQ(store.Get()->id(), 5678u);
+  // Holders of the replaced dictionary can still use it.
+  EXPECT_EQ(dictionary->id(), 1234u);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -18,12 +18,13 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "components/data_server/request_handler/v2_response_data.pb.h"
 #include "glog/logging.h"
-#include "google/protobuf/util/json_util.h"
 #include "public/api_schema.pb.h"
 #include "public/applications/pa/api_overlay.pb.h"
 #include "public/applications/pa/response_utils.h"
@@ -34,7 +35,6 @@ namespace {
 using google::protobuf::RepeatedPtrField;
 using google::protobuf::Struct;
 using google::protobuf::Value;
-using google::protobuf::util::JsonStringToMessage;
 
 constexpr char kKeysTag[] = "keys";
 constexpr char kRenderUrlsTag[] = "renderUrls";
@@ -80,32 +80,57 @@ v2::GetValuesRequest BuildV2Request(const v1::GetValuesRequest& v1_request) {
   return v2_request;
 }
 
+// Sets the value of a lookup result. String values holding JSON are set as
+// the parsed JSON value.
+void SetLookupResultValue(Value value, JsonValueCache* json_value_cache,
+                          v1::V1SingleLookupResult& result) {
+  if (value.has_string_value()) {
+    *result.mutable_value() = ParseJsonValue(
+        std::move(*value.mutable_string_value()), json_value_cache);
+    return;
+  }
+  *result.mutable_value() = std::move(value);
+}
+
 // Add key value pairs to the result struct
 void ProcessKeyValues(
     application_pa::KeyGroupOutput key_group_output,
+    JsonValueCache* json_value_cache,
     google::protobuf::Map<std::string, v1::V1SingleLookupResult>&
         result_struct) {
   for (auto&& [k, v] : std::move(key_group_output.key_values())) {
     v1::V1SingleLookupResult result;
-    if (v.value().has_string_value()) {
-      Value value_proto;
-      absl::Status status =
-          JsonStringToMessage(v.value().string_value(), &value_proto);
-      if (status.ok()) {
-        *result.mutable_value() = value_proto;
-      } else {
-        // If string is not a Json string that can be parsed into Value
-        // proto,
-        // simply set it as pure string value to the response.
-        *result.mutable_value() = std::move(v.value());
-      }
-    } else {
-      *result.mutable_value() = std::move(v.value());
-    }
+    SetLookupResultValue(std::move(v.value()), json_value_cache, result);
     result_struct[std::move(k)] = std::move(result);
   }
 }
 
+// Looks up the keys of one namespace like the passthrough UDF does for one
+// argument: failed lookups and keys without value are left out.
+void LookupKeyValues(
+    const RepeatedPtrField<std::string>& keys,
+    const GetValuesHook& get_values_hook, JsonValueCache* json_value_cache,
+    google::protobuf::Map<std::string, v1::V1SingleLookupResult>&
+        result_struct) {
+  if (keys.empty()) {
+    return;
+  }
+  const absl::flat_hash_set<std::string_view> key_set(keys.begin(),
+                                                      keys.end());
+  auto maybe_response = get_values_hook.GetKeyValues(key_set);
+  if (!maybe_response.ok()) {
+    VLOG(5) << "Lookup failed: " << maybe_response.status();
+    return;
+  }
+  for (auto& [key, lookup_result] : *maybe_response->mutable_kv_pairs()) {
+    if (!lookup_result.has_value()) {
+      continue;
+    }
+    *result_struct[key].mutable_value() = ParseJsonValue(
+        std::move(*lookup_result.mutable_value()), json_value_cache);
+  }
+}
+
 // Find the namespace tag that is paired with the "custom" tag.
 absl::StatusOr<std::string> FindNamespace(RepeatedPtrField<std::string> tags) {
   if (tags.size() != 2) {
@@ -130,6 +155,7 @@ absl::StatusOr<std::string> FindNamespace(RepeatedPtrField<std::string> tags) {
 }
 
 void ProcessKeyGroupOutput(application_pa::KeyGroupOutput key_group_output,
+                           JsonValueCache* json_value_cache,
                            v1::GetValuesResponse& v1_response) {
   // Ignore if no valid namespace tag that is paired with a 'custom' tag
   auto tag_namespace_status_or =
@@ -138,24 +164,26 @@ void ProcessKeyGroupOutput(application_pa::KeyGroupOutput key_group_output,
     return;
   }
   if (tag_namespace_status_or.value() == kKeysTag) {
-    ProcessKeyValues(std::move(key_group_output), *v1_response.mutable_keys());
+    ProcessKeyValues(std::move(key_group_output), json_value_cache,
+                     *v1_response.mutable_keys());
   }
   if (tag_namespace_status_or.value() == kRenderUrlsTag) {
-    ProcessKeyValues(std::move(key_group_output),
+    ProcessKeyValues(std::move(key_group_output), json_value_cache,
                      *v1_response.mutable_render_urls());
   }
   if (tag_namespace_status_or.value() == kAdComponentRenderUrlsTag) {
-    ProcessKeyValues(std::move(key_group_output),
+    ProcessKeyValues(std::move(key_group_output), json_value_cache,
                      *v1_response.mutable_ad_component_render_urls());
   }
   if (tag_namespace_status_or.value() == kKvInternalTag) {
-    ProcessKeyValues(std::move(key_group_output),
+    ProcessKeyValues(std::move(key_group_output), json_value_cache,
                      *v1_response.mutable_kv_internal());
   }
 }
 
 // Converts a v2 response into v1 response.
 absl::Status ConvertToV1Response(const v2::GetValuesResponse& v2_response,
+                                 JsonValueCache* json_value_cache,
                                  v1::GetValuesResponse& v1_response) {
   if (!v2_response.has_single_partition()) {
     // This should not happen. V1 request always maps to 1 partition so the
@@ -175,24 +203,70 @@ absl::Status ConvertToV1Response(const v2::GetValuesResponse& v2_response,
   PS_ASSIGN_OR_RETURN(application_pa::KeyGroupOutputs outputs,
                       application_pa::KeyGroupOutputsFromJson(string_output));
   for (const auto& key_group_output : outputs.key_group_outputs()) {
-    ProcessKeyGroupOutput(key_group_output, v1_response);
+    ProcessKeyGroupOutput(key_group_output, json_value_cache, v1_response);
   }
 
   return absl::OkStatus();
 }
 
+// Converts the output of a UDF invoked in binary mode into v1 response.
+absl::Status ConvertBinaryOutputToV1Response(
+    std::string_view binary_output, JsonValueCache* json_value_cache,
+    v1::GetValuesResponse& v1_response) {
+  application_pa::KeyGroupOutputs outputs;
+  if (!outputs.ParseFromArray(binary_output.data(), binary_output.size())) {
+    return absl::InvalidArgumentError(
+        "Binary UDF output is not a serialized KeyGroupOutputs");
+  }
+  for (auto& key_group_output : *outputs.mutable_key_group_outputs()) {
+    ProcessKeyGroupOutput(std::move(key_group_output), json_value_cache,
+                          v1_response);
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 class GetValuesAdapterImpl : public GetValuesAdapter {
  public:
-  explicit GetValuesAdapterImpl(std::unique_ptr<GetValuesV2Handler> v2_handler)
-      : v2_handler_(std::move(v2_handler)) {}
+  GetValuesAdapterImpl(std::unique_ptr<GetValuesV2Handler> v2_handler,
+                       const GetValuesHook* get_values_hook,
+                       JsonValueCache* json_value_cache)
+      : v2_handler_(std::move(v2_handler)),
+        get_values_hook_(get_values_hook),
+        json_value_cache_(json_value_cache) {}
 
   grpc::Status CallV2Handler(const v1::GetValuesRequest& v1_request,
                              v1::GetValuesResponse& v1_response) const {
+    if (CanBypassUdf()) {
+      VLOG(7) << "Passthrough UDF is loaded, looking up V1 request "
+              << v1_request.DebugString() << " directly";
+      LookupKeyValues(v1_request.keys(), *get_values_hook_,
+                      json_value_cache_, *v1_response.mutable_keys());
+      LookupKeyValues(v1_request.render_urls(), *get_values_hook_,
+                      json_value_cache_, *v1_response.mutable_render_urls());
+      LookupKeyValues(v1_request.ad_component_render_urls(), *get_values_hook_,
+                      json_value_cache_,
+                      *v1_response.mutable_ad_component_render_urls());
+      LookupKeyValues(v1_request.kv_internal(), *get_values_hook_,
+                      json_value_cache_, *v1_response.mutable_kv_internal());
+      return grpc::Status::OK;
+    }
     v2::GetValuesRequest v2_request = BuildV2Request(v1_request);
     VLOG(7) << "Converting V1 request " << v1_request.DebugString()
             << " to v2 request " << v2_request.DebugString();
+    if (v2_handler_->IsBinaryIoUdfLoaded()) {
+      // Skips the v2 response and its JSON encoded UDF output entirely.
+      const auto maybe_output = v2_handler_->ExecuteBinaryPartition(
+          v2_request.metadata(), v2_request.partitions(0));
+      if (!maybe_output.ok()) {
+        return privacy_sandbox::server_common::FromAbslStatus(
+            maybe_output.status());
+      }
+      return privacy_sandbox::server_common::FromAbslStatus(
+          ConvertBinaryOutputToV1Response(*maybe_output, json_value_cache_,
+                                          v1_response));
+    }
     v2::GetValuesResponse v2_response;
     if (auto status = v2_handler_->GetValues(v2_request, &v2_response);
         !status.ok()) {
@@ -200,16 +274,54 @@ class GetValuesAdapterImpl : public GetValuesAdapter {
     }
     VLOG(7) << "Received v2 response: " << v2_response.DebugString();
     return privacy_sandbox::server_common::FromAbslStatus(
-        ConvertToV1Response(v2_response, v1_response));
+        ConvertToV1Response(v2_response, json_value_cache_, v1_response));
+  }
+
+  void CallV2HandlerAsync(
+      const v1::GetValuesRequest& v1_request,
+      v1::GetValuesResponse& v1_response,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+    // Neither binary mode nor direct lookups go through the asynchronous UDF
+    // call.
+    if (v2_handler_->IsBinaryIoUdfLoaded() || CanBypassUdf()) {
+      std::move(on_done)(CallV2Handler(v1_request, v1_response));
+      return;
+    }
+    v2::GetValuesRequest v2_request = BuildV2Request(v1_request);
+    VLOG(7) << "Converting V1 request " << v1_request.DebugString()
+            << " to v2 request " << v2_request.DebugString();
+    auto v2_response = std::make_unique<v2::GetValuesResponse>();
+    v2::GetValuesResponse* v2_response_ptr = v2_response.get();
+    v2_handler_->GetValuesAsync(
+        v2_request, v2_response_ptr,
+        [v2_response = std::move(v2_response), &v1_response,
+         json_value_cache = json_value_cache_,
+         on_done = std::move(on_done)](grpc::Status status) mutable {
+          if (status.ok()) {
+            VLOG(7) << "Received v2 response: " << v2_response->DebugString();
+            status = privacy_sandbox::server_common::FromAbslStatus(
+                ConvertToV1Response(*v2_response, json_value_cache,
+                                    v1_response));
+          }
+          std::move(on_done)(std::move(status));
+        });
   }
 
  private:
+  bool CanBypassUdf() const {
+    return get_values_hook_ != nullptr && v2_handler_->IsPassthroughUdfLoaded();
+  }
+
   std::unique_ptr<GetValuesV2Handler> v2_handler_;
+  const GetValuesHook* get_values_hook_;
+  JsonValueCache* json_value_cache_;
 };
 
 std::unique_ptr<GetValuesAdapter> GetValuesAdapter::Create(
-    std::unique_ptr<GetValuesV2Handler> v2_handler) {
-  return std::make_unique<GetValuesAdapterImpl>(std::move(v2_handler));
+    std::unique_ptr<GetValuesV2Handler> v2_handler,
+    const GetValuesHook* get_values_hook, JsonValueCache* json_value_cache) {
+  return std::make_unique<GetValuesAdapterImpl>(
+      std::move(v2_handler), get_values_hook, json_value_cache);
 }
 
 }  // namespace kv_server
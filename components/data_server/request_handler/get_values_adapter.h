@@ -19,7 +19,10 @@
 
 #include <memory>
 
+#include "absl/functional/any_invocable.h"
 #include "components/data_server/request_handler/get_values_v2_handler.h"
+#include "components/data_server/request_handler/json_value_cache.h"
+#include "components/udf/hooks/get_values_hook.h"
 #include "grpcpp/grpcpp.h"
 #include "public/query/get_values.grpc.pb.h"
 
@@ -36,8 +39,26 @@ class GetValuesAdapter {
       const v1::GetValuesRequest& v1_request,
       v1::GetValuesResponse& v1_response) const = 0;
 
+  // Asynchronous version of CallV2Handler. `on_done` is called once
+  // `v1_response` is complete, which must stay valid until then.
+  virtual void CallV2HandlerAsync(
+      const v1::GetValuesRequest& v1_request,
+      v1::GetValuesResponse& v1_response,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const = 0;
+
+  // While a UDF marked as taking binary input and output is loaded, it is
+  // invoked in binary mode and must return a serialized
+  // `application_pa::KeyGroupOutputs`.
+  //
+  // With `get_values_hook`, requests are served from its lookup while the
+  // default passthrough UDF is loaded, without executing the UDF. The response
+  // is the same as the one built from the UDF output.
+  //
+  // With `json_value_cache`, parsed JSON values are reused across requests.
   static std::unique_ptr<GetValuesAdapter> Create(
-      std::unique_ptr<GetValuesV2Handler> v2_handler);
+      std::unique_ptr<GetValuesV2Handler> v2_handler,
+      const GetValuesHook* get_values_hook = nullptr,
+      JsonValueCache* json_value_cache = nullptr);
 };
 
 }  // namespace kv_server
@@ -14,10 +14,13 @@
 
 #include "components/data_server/request_handler/get_values_adapter.h"
 
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "components/internal_server/mocks.h"
+#include "components/udf/hooks/get_values_hook.h"
 #include "components/udf/mocks.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
@@ -528,5 +531,178 @@ TEST_F(GetValuesAdapterTest, ValueWithStatusSuccess) {
   EXPECT_THAT(v1_response, EqualsProto(v1_expected));
 }
 
+TEST_F(GetValuesAdapterTest, V1RequestWithBinaryUdfIoReturnsOk) {
+  EXPECT_CALL(mock_udf_client_, IsBinaryIoCodeLoaded())
+      .WillRepeatedly(Return(true));
+  UDFExecutionMetadata udf_metadata;
+  TextFormat::ParseFromString(kEmptyMetadata, &udf_metadata);
+  UDFArgument arg;
+  TextFormat::ParseFromString(R"pb(
+                                tags {
+                                  values { string_value: "custom" }
+                                  values { string_value: "keys" }
+                                }
+                                data {
+                                  list_value { values { string_value: "key1" } }
+                                })pb",
+                              &arg);
+  application_pa::KeyGroupOutputs key_group_outputs;
+  TextFormat::ParseFromString(R"pb(
+                                key_group_outputs: {
+                                  tags: "custom"
+                                  tags: "keys"
+                                  key_values: {
+                                    key: "key1"
+                                    value: { value: { string_value: "value1" } }
+                                  }
+                                })pb",
+                              &key_group_outputs);
+  EXPECT_CALL(mock_udf_client_,
+              ExecuteBinaryCode(EqualsProto(udf_metadata),
+                                testing::ElementsAre(EqualsProto(arg))))
+      .WillOnce(Return(key_group_outputs.SerializeAsString()));
+
+  v1::GetValuesRequest v1_request;
+  v1_request.add_keys("key1");
+  v1::GetValuesResponse v1_response;
+  auto status = get_values_adapter_->CallV2Handler(v1_request, v1_response);
+  EXPECT_TRUE(status.ok());
+  v1::GetValuesResponse v1_expected;
+  TextFormat::ParseFromString(R"pb(
+                                keys {
+                                  key: "key1"
+                                  value { value { string_value: "value1" } }
+                                })pb",
+                              &v1_expected);
+  EXPECT_THAT(v1_response, EqualsProto(v1_expected));
+}
+
+TEST_F(GetValuesAdapterTest, BinaryUdfOutputNotKeyGroupOutputsReturnsError) {
+  EXPECT_CALL(mock_udf_client_, IsBinaryIoCodeLoaded())
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(mock_udf_client_, ExecuteBinaryCode(_, _))
+      .WillOnce(Return("\xff\xff"));
+
+  v1::GetValuesRequest v1_request;
+  v1_request.add_keys("key1");
+  v1::GetValuesResponse v1_response;
+  auto status = get_values_adapter_->CallV2Handler(v1_request, v1_response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(GetValuesAdapterTest, V1RequestAsyncReturnsOk) {
+  application_pa::KeyGroupOutputs key_group_outputs;
+  TextFormat::ParseFromString(R"pb(
+                                key_group_outputs: {
+                                  tags: "custom"
+                                  tags: "keys"
+                                  key_values: {
+                                    key: "key1"
+                                    value: { value: { string_value: "value1" } }
+                                  }
+                                })pb",
+                              &key_group_outputs);
+  EXPECT_CALL(mock_udf_client_, ExecuteCodeAsync(_, _, _))
+      .WillOnce([&key_group_outputs](
+                    UDFExecutionMetadata&&,
+                    const google::protobuf::RepeatedPtrField<UDFArgument>&,
+                    UdfClient::ExecuteCodeCallback on_done) {
+        std::move(on_done)(
+            application_pa::KeyGroupOutputsToJson(key_group_outputs).value());
+      });
+
+  v1::GetValuesRequest v1_request;
+  v1_request.add_keys("key1");
+  v1::GetValuesResponse v1_response;
+  std::optional<grpc::Status> status;
+  get_values_adapter_->CallV2HandlerAsync(
+      v1_request, v1_response,
+      [&status](grpc::Status result) { status = std::move(result); });
+  ASSERT_TRUE(status.has_value());
+  EXPECT_TRUE(status->ok());
+  v1::GetValuesResponse v1_expected;
+  TextFormat::ParseFromString(R"pb(
+                                keys {
+                                  key: "key1"
+                                  value { value { string_value: "value1" } }
+                                })pb",
+                              &v1_expected);
+  EXPECT_THAT(v1_response, EqualsProto(v1_expected));
+}
+
+TEST_F(GetValuesAdapterTest, PassthroughUdfIsBypassed) {
+  auto mock_lookup = std::make_unique<MockLookup>();
+  InternalLookupResponse keys_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key2"
+                                     value { status { code: 5 } }
+                                   })pb",
+                              &keys_response);
+  InternalLookupResponse render_urls_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "url1"
+                                     value { value: "{\"a\": 1}" }
+                                   })pb",
+                              &render_urls_response);
+  EXPECT_CALL(*mock_lookup,
+              GetKeyValues(testing::UnorderedElementsAre("key1", "key2")))
+      .WillOnce(Return(keys_response));
+  EXPECT_CALL(*mock_lookup, GetKeyValues(testing::ElementsAre("url1")))
+      .WillOnce(Return(render_urls_response));
+  EXPECT_CALL(*mock_lookup, GetKeyValues(testing::ElementsAre("key3")))
+      .WillOnce(Return(absl::UnavailableError("shard is down")));
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::move(mock_lookup));
+  get_values_adapter_ = GetValuesAdapter::Create(
+      std::make_unique<GetValuesV2Handler>(mock_udf_client_,
+                                           mock_metrics_recorder_,
+                                           fake_key_fetcher_manager_),
+      get_values_hook.get());
+  EXPECT_CALL(mock_udf_client_, IsPassthroughCodeLoaded())
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(mock_udf_client_, ExecuteCode(_, _)).Times(0);
+  EXPECT_CALL(mock_udf_client_, ExecuteCodeAsync(_, _, _)).Times(0);
+
+  v1::GetValuesRequest v1_request;
+  v1_request.add_keys("key1");
+  v1_request.add_keys("key2");
+  v1_request.add_render_urls("url1");
+  v1_request.add_kv_internal("key3");
+  v1::GetValuesResponse v1_response;
+  std::optional<grpc::Status> status;
+  get_values_adapter_->CallV2HandlerAsync(
+      v1_request, v1_response,
+      [&status](grpc::Status result) { status = std::move(result); });
+  ASSERT_TRUE(status.has_value());
+  EXPECT_TRUE(status->ok());
+  v1::GetValuesResponse v1_expected;
+  TextFormat::ParseFromString(
+      R"pb(
+        keys {
+          key: "key1"
+          value { value { string_value: "value1" } }
+        }
+        render_urls {
+          key: "url1"
+          value {
+            value {
+              struct_value {
+                fields {
+                  key: "a"
+                  value { number_value: 1 }
+                }
+              }
+            }
+          }
+        })pb",
+      &v1_expected);
+  EXPECT_THAT(v1_response, EqualsProto(v1_expected));
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -22,6 +22,7 @@
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "components/data_server/request_handler/get_values_adapter.h"
+#include "components/data_server/request_handler/json_value_cache.h"
 #include "glog/logging.h"
 #include "grpcpp/grpcpp.h"
 #include "public/constants.h"
@@ -60,6 +61,7 @@ absl::flat_hash_set<std::string_view> GetKeys(
 
 void ProcessKeys(const RepeatedPtrField<std::string>& keys, const Cache& cache,
                  MetricsRecorder& metrics_recorder,
+                 JsonValueCache* json_value_cache,
                  google::protobuf::Map<std::string, v1::V1SingleLookupResult>&
                      result_struct) {
   if (keys.empty()) return;
@@ -78,18 +80,8 @@ void ProcessKeys(const RepeatedPtrField<std::string>& keys, const Cache& cache,
       status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
       status->set_message("Key not found");
     } else {
-      Value value_proto;
-      absl::Status status = google::protobuf::util::JsonStringToMessage(
-          key_iter->second, &value_proto);
-      if (status.ok()) {
-        *result.mutable_value() = value_proto;
-      } else {
-        // If string is not a Json string that can be parsed into Value
-        // proto, simply set it as pure string value to the response.
-        google::protobuf::Value value;
-        value.set_string_value(std::move(key_iter->second));
-        *result.mutable_value() = std::move(value);
-      }
+      *result.mutable_value() =
+          ParseJsonValue(std::move(key_iter->second), json_value_cache);
     }
     result_struct[key] = std::move(result);
   }
@@ -107,25 +99,38 @@ grpc::Status GetValuesHandler::GetValues(const GetValuesRequest& request,
   if (!request.kv_internal().empty()) {
     VLOG(5) << "Processing kv_internal for " << request.DebugString();
     ProcessKeys(request.kv_internal(), cache_, metrics_recorder_,
-                *response->mutable_kv_internal());
+                json_value_cache_, *response->mutable_kv_internal());
   }
   if (!request.keys().empty()) {
     VLOG(5) << "Processing keys for " << request.DebugString();
     ProcessKeys(request.keys(), cache_, metrics_recorder_,
-                *response->mutable_keys());
+                json_value_cache_, *response->mutable_keys());
   }
   if (!request.render_urls().empty()) {
     VLOG(5) << "Processing render_urls for " << request.DebugString();
     ProcessKeys(request.render_urls(), cache_, metrics_recorder_,
-                *response->mutable_render_urls());
+                json_value_cache_, *response->mutable_render_urls());
   }
   if (!request.ad_component_render_urls().empty()) {
     VLOG(5) << "Processing ad_component_render_urls for "
             << request.DebugString();
     ProcessKeys(request.ad_component_render_urls(), cache_, metrics_recorder_,
+                json_value_cache_,
                 *response->mutable_ad_component_render_urls());
   }
   return grpc::Status::OK;
 }
 
+void GetValuesHandler::GetValuesAsync(
+    const GetValuesRequest& request, GetValuesResponse* response,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  if (use_v2_) {
+    VLOG(5) << "Using V2 adapter for " << request.DebugString();
+    adapter_.CallV2HandlerAsync(request, *response, std::move(on_done));
+    return;
+  }
+  // Cache lookups do not block, so they are served inline.
+  std::move(on_done)(GetValues(request, response));
+}
+
 }  // namespace kv_server
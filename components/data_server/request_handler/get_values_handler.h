@@ -21,7 +21,9 @@
 #include <string>
 #include <utility>
 
+#include "absl/functional/any_invocable.h"
 #include "components/data_server/request_handler/get_values_adapter.h"
+#include "components/data_server/request_handler/json_value_cache.h"
 #include "grpcpp/grpcpp.h"
 #include "public/query/get_values.grpc.pb.h"
 #include "src/cpp/telemetry/metrics_recorder.h"
@@ -36,16 +38,23 @@ class GetValuesHandler {
   explicit GetValuesHandler(
       const Cache& cache, const GetValuesAdapter& adapter,
       privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
-      bool use_v2)
+      bool use_v2, JsonValueCache* json_value_cache = nullptr)
       : cache_(std::move(cache)),
         adapter_(std::move(adapter)),
         metrics_recorder_(metrics_recorder),
-        use_v2_(use_v2) {}
+        use_v2_(use_v2),
+        json_value_cache_(json_value_cache) {}
 
   // TODO: Implement hostname, ad/render url lookups.
   grpc::Status GetValues(const v1::GetValuesRequest& request,
                          v1::GetValuesResponse* response) const;
 
+  // Asynchronous version of GetValues. `on_done` is called once `response` is
+  // complete, without blocking the calling thread on the UDF.
+  void GetValuesAsync(const v1::GetValuesRequest& request,
+                      v1::GetValuesResponse* response,
+                      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
  private:
   const Cache& cache_;
   const GetValuesAdapter& adapter_;
@@ -53,6 +62,9 @@ class GetValuesHandler {
 
   // If true, routes requests through V2 (UDF). Otherwise, calls cache.
   const bool use_v2_;
+
+  // Parsed values of cache reads, optional.
+  JsonValueCache* const json_value_cache_;
 };
 
 }  // namespace kv_server
@@ -22,6 +22,7 @@
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/key_value_cache.h"
 #include "components/data_server/cache/mocks.h"
+#include "components/data_server/request_handler/json_value_cache.h"
 #include "components/data_server/request_handler/mocks.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
@@ -275,6 +276,52 @@ TEST_F(GetValuesHandlerTest, TestResponseOnDifferentValueFormats) {
   EXPECT_THAT(response, EqualsProto(expected_from_json));
 }
 
+TEST_F(GetValuesHandlerTest, ReusesParsedValuesFromJsonValueCache) {
+  EXPECT_CALL(mock_cache_,
+              GetKeyValuePairs(UnorderedElementsAre("key1", "key2")))
+      .Times(2)
+      .WillRepeatedly(Return(absl::flat_hash_map<std::string, std::string>{
+          {"key1", R"({"k": [1, "v"]})"}, {"key2", "v2"}}));
+  GetValuesRequest request;
+  request.add_keys("key1");
+  request.add_keys("key2");
+  JsonValueCache json_value_cache(/*max_bytes=*/1 << 20);
+  GetValuesHandler handler(mock_cache_, mock_get_values_adapter_,
+                           mock_metrics_recorder_,
+                           /*use_v2=*/false, &json_value_cache);
+
+  GetValuesResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(keys {
+             key: "key1"
+             value {
+               value {
+                 struct_value {
+                   fields {
+                     key: "k"
+                     value {
+                       list_value {
+                         values { number_value: 1 }
+                         values { string_value: "v" }
+                       }
+                     }
+                   }
+                 }
+               }
+             }
+           }
+           keys {
+             key: "key2"
+             value { value { string_value: "v2" } }
+           })pb",
+      &expected);
+  for (int i = 0; i < 2; ++i) {
+    GetValuesResponse response;
+    ASSERT_TRUE(handler.GetValues(request, &response).ok());
+    EXPECT_THAT(response, EqualsProto(expected));
+  }
+}
+
 TEST_F(GetValuesHandlerTest, CallsV2Adapter) {
   GetValuesResponse adapter_response;
   TextFormat::ParseFromString(R"pb(keys {
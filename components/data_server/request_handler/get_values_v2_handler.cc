@@ -14,6 +14,8 @@
 
 #include "components/data_server/request_handler/get_values_v2_handler.h"
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -21,8 +23,15 @@
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "components/data_server/request_handler/get_values_v2_json.h"
 #include "components/data_server/request_handler/ohttp_server_encryptor.h"
 #include "glog/logging.h"
 #include "google/protobuf/util/json_util.h"
@@ -53,38 +62,291 @@ const std::string_view kOHTTPResponseContentType = "message/ohttp-res";
 constexpr std::string_view kAcceptEncodingHeader = "accept-encoding";
 constexpr std::string_view kContentEncodingHeader = "content-encoding";
 constexpr std::string_view kBrotliAlgorithmHeader = "br";
+constexpr std::string_view kGzipAlgorithmHeader = "gzip";
+constexpr std::string_view kZstdAlgorithmHeader = "zstd";
+// zstd, with or without a dictionary, goes beyond the brotli and gzip of the
+// v2 protocol. It is only used for clients that list it in Accept-Encoding,
+// and named in the response headers like the other encodings.
+// Id of the zstd dictionary the client holds, in decimal.
+constexpr std::string_view kAvailableDictionaryIdHeader =
+    "available-dictionary-id";
+// Id of the zstd dictionary the compression groups were compressed with, in
+// decimal. Only set if they were.
+constexpr std::string_view kContentDictionaryIdHeader = "content-dictionary-id";
 
-CompressionGroupConcatenator::CompressionType GetResponseCompressionType(
-    const std::vector<quiche::BinaryHttpMessage::Field>& headers) {
+// zstd with `dictionary` is preferred when the client holds it, then brotli,
+// zstd and gzip. Quality values are ignored.
+ResponseCompression GetResponseCompression(
+    const std::vector<quiche::BinaryHttpMessage::Field>& headers,
+    std::shared_ptr<const ZstdDictionary> dictionary) {
+  bool accepts_brotli = false;
+  bool accepts_gzip = false;
+  bool accepts_zstd = false;
+  bool has_dictionary = false;
   for (const quiche::BinaryHttpMessage::Field& header : headers) {
-    if (absl::AsciiStrToLower(header.name) != kAcceptEncodingHeader) continue;
-    // TODO(b/278271389): Right now for simplicity we support Accept-Encoding:
-    // br
-    if (absl::AsciiStrToLower(header.value) == kBrotliAlgorithmHeader) {
-      return CompressionGroupConcatenator::CompressionType::kBrotli;
+    const std::string name = absl::AsciiStrToLower(header.name);
+    if (name == kAvailableDictionaryIdHeader) {
+      uint32_t dictionary_id = 0;
+      has_dictionary |= dictionary != nullptr &&
+                        absl::SimpleAtoi(header.value, &dictionary_id) &&
+                        dictionary_id == dictionary->id();
+      continue;
     }
+    if (name != kAcceptEncodingHeader) continue;
+    for (std::string_view coding : absl::StrSplit(header.value, ',')) {
+      const std::string algorithm = absl::AsciiStrToLower(
+          absl::StripAsciiWhitespace(coding.substr(0, coding.find(';'))));
+      accepts_brotli |= algorithm == kBrotliAlgorithmHeader;
+      accepts_gzip |= algorithm == kGzipAlgorithmHeader;
+      accepts_zstd |= algorithm == kZstdAlgorithmHeader;
+    }
+  }
+  if (accepts_zstd && has_dictionary) {
+    return {
+        .type =
+            CompressionGroupConcatenator::CompressionType::kZstdWithDictionary,
+        .dictionary = std::move(dictionary),
+    };
+  }
+  if (accepts_brotli) {
+    return {.type = CompressionGroupConcatenator::CompressionType::kBrotli};
+  }
+  if (accepts_zstd) {
+    return {.type = CompressionGroupConcatenator::CompressionType::kZstd};
+  }
+  if (accepts_gzip) {
+    return {.type = CompressionGroupConcatenator::CompressionType::kGzip};
+  }
+  return ResponseCompression();
+}
+
+// Content coding of the compression groups, empty if they are uncompressed.
+std::string_view GetContentEncoding(
+    CompressionGroupConcatenator::CompressionType compression) {
+  switch (compression) {
+    case CompressionGroupConcatenator::CompressionType::kBrotli:
+      return kBrotliAlgorithmHeader;
+    case CompressionGroupConcatenator::CompressionType::kGzip:
+      return kGzipAlgorithmHeader;
+    case CompressionGroupConcatenator::CompressionType::kZstd:
+    case CompressionGroupConcatenator::CompressionType::kZstdWithDictionary:
+      return kZstdAlgorithmHeader;
+    case CompressionGroupConcatenator::CompressionType::kUncompressed:
+      break;
+  }
+  return "";
+}
+
+void SetPartitionOutput(absl::StatusOr<std::string> maybe_output_string,
+                        v2::ResponsePartition& resp_partition) {
+  if (!maybe_output_string.ok()) {
+    resp_partition.mutable_status()->set_code(
+        static_cast<int>(maybe_output_string.status().code()));
+    resp_partition.mutable_status()->set_message(
+        maybe_output_string.status().message());
+  } else {
+    VLOG(5) << "UDF output: " << maybe_output_string.value();
+    resp_partition.set_string_output(std::move(maybe_output_string).value());
+  }
+}
+
+// Serializes `maybe_bhttp_response`, or a 500 response if it is an error, so
+// that errors are encoded as a Binary HTTP response code.
+absl::StatusOr<std::string> SerializeBhttpResponse(
+    const absl::StatusOr<quiche::BinaryHttpResponse>& maybe_bhttp_response) {
+  static quiche::BinaryHttpResponse const* kDefaultBhttpResponse =
+      new quiche::BinaryHttpResponse(500);
+  return maybe_bhttp_response.ok() ? maybe_bhttp_response->Serialize()
+                                   : kDefaultBhttpResponse->Serialize();
+}
+
+// Encrypts `bhttp_response` with the context `encryptor` decrypted the
+// request with, into `oblivious_response`.
+grpc::Status SetObliviousResponse(OhttpServerEncryptor& encryptor,
+                                  std::string bhttp_response,
+                                  google::api::HttpBody& oblivious_response) {
+  auto encrypted_response =
+      encryptor.EncryptResponse(std::move(bhttp_response));
+  if (!encrypted_response.ok()) {
+    return grpc::Status(grpc::StatusCode::INTERNAL,
+                        absl::StrCat(encrypted_response.status().code(), " : ",
+                                     encrypted_response.status().message()));
   }
-  return CompressionGroupConcatenator::CompressionType::kUncompressed;
+  oblivious_response.set_content_type(std::string(kOHTTPResponseContentType));
+  oblivious_response.set_data(*std::move(encrypted_response));
+  return grpc::Status::OK;
+}
+
+// Converts the UDF output of one partition into its compression group
+// representation. Partitions whose UDF execution failed, or whose output is
+// not a valid key group output list, only carry their id.
+Partition ToCompressionGroupPartition(const v2::ResponsePartition& partition) {
+  Partition output;
+  if (partition.has_string_output()) {
+    google::protobuf::util::JsonParseOptions options;
+    options.ignore_unknown_fields = true;
+    if (const auto status = JsonStringToMessage(partition.string_output(),
+                                                &output, options);
+        !status.ok()) {
+      LOG(ERROR) << "Failed to parse UDF output of partition "
+                 << partition.id() << ": " << status;
+      output.Clear();
+    }
+  } else {
+    LOG(ERROR) << "UDF execution failed for partition " << partition.id()
+               << ": " << partition.status().message();
+  }
+  output.set_id(partition.id());
+  return output;
 }
+
+// Compresses each compression group as soon as the last of its partitions is
+// set, on the thread setting it. Groups are then compressed in parallel, while
+// the partitions of other groups are still being processed.
+class StreamingCompressionGroups {
+ public:
+  using CompressGroupFunction =
+      std::function<absl::StatusOr<std::string>(const V2CompressionGroup&)>;
+
+  StreamingCompressionGroups(const std::vector<int32_t>& compression_group_ids,
+                             CompressGroupFunction compress_group)
+      : compress_group_(std::move(compress_group)),
+        group_index_(compression_group_ids.size()),
+        position_in_group_(compression_group_ids.size()) {
+    // Groups are ordered by their first appearance in the request, partitions
+    // by their order in the request.
+    absl::flat_hash_map<int32_t, int> group_index_by_id;
+    const int num_partitions = compression_group_ids.size();
+    for (int i = 0; i < num_partitions; ++i) {
+      const auto [it, inserted] = group_index_by_id.try_emplace(
+          compression_group_ids[i], groups_.size());
+      if (inserted) {
+        groups_.push_back(std::make_unique<Group>());
+      }
+      group_index_[i] = it->second;
+      position_in_group_[i] = groups_[it->second]->num_remaining++;
+    }
+    for (auto& group : groups_) {
+      group->partitions.resize(group->num_remaining);
+    }
+  }
+
+  // Thread safe, as long as each partition is set once.
+  void SetPartition(int index, const v2::ResponsePartition& partition) {
+    Group& group = *groups_[group_index_[index]];
+    group.partitions[position_in_group_[index]] =
+        ToCompressionGroupPartition(partition);
+    if (group.num_remaining.fetch_sub(1) != 1) {
+      return;
+    }
+    V2CompressionGroup compression_group;
+    for (auto& group_partition : group.partitions) {
+      *compression_group.add_partitions() = std::move(group_partition);
+    }
+    group.compressed = compress_group_(compression_group);
+  }
+
+  // Must be called once all partitions are set.
+  absl::Status Finish(v2::CompressionGroups& compression_groups) {
+    for (auto& group : groups_) {
+      PS_ASSIGN_OR_RETURN(std::string compressed_group,
+                          std::move(group->compressed));
+      compression_groups.add_compressed_partition_groups(
+          std::move(compressed_group));
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  struct Group {
+    std::vector<Partition> partitions;
+    std::atomic<int> num_remaining{0};
+    absl::StatusOr<std::string> compressed;
+  };
+
+  const CompressGroupFunction compress_group_;
+  std::vector<std::unique_ptr<Group>> groups_;
+  // Group and position in the group of every partition.
+  std::vector<int> group_index_;
+  std::vector<int> position_in_group_;
+};
 }  // namespace
 
 grpc::Status GetValuesV2Handler::GetValuesHttp(
     const GetValuesHttpRequest& request,
     google::api::HttpBody* response) const {
-  return FromAbslStatus(
-      GetValuesHttp(request.raw_body().data(), *response->mutable_data()));
+  v2::GetValuesResponse response_proto;
+  if (const auto status = GetValuesHttp(
+          request.raw_body().data(), response_proto,
+          ResponseCompression());
+      !status.ok()) {
+    return FromAbslStatus(status);
+  }
+  *response->mutable_data() = GetValuesResponseToJson(response_proto);
+  return grpc::Status::OK;
+}
+
+void GetValuesV2Handler::GetValuesHttpAsync(
+    const GetValuesHttpRequest& request, google::api::HttpBody* response,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  auto response_proto = std::make_unique<v2::GetValuesResponse>();
+  v2::GetValuesResponse* response_proto_ptr = response_proto.get();
+  GetValuesHttpAsync(
+      request.raw_body().data(), response_proto_ptr,
+      ResponseCompression(),
+      [response, response_proto = std::move(response_proto),
+       on_done = std::move(on_done)](grpc::Status status) mutable {
+        if (status.ok()) {
+          *response->mutable_data() = GetValuesResponseToJson(*response_proto);
+        }
+        std::move(on_done)(std::move(status));
+      });
 }
 
 absl::Status GetValuesV2Handler::GetValuesHttp(
-    std::string_view request, std::string& json_response) const {
+    std::string_view request, v2::GetValuesResponse& response_proto,
+    const ResponseCompression& compression) const {
+  if (auto maybe_json_request = ParseGetValuesRequestJson(request);
+      maybe_json_request.ok()) {
+    PS_RETURN_IF_ERROR(GetValues(std::move(maybe_json_request).value(),
+                                 &response_proto, compression));
+  } else {
+    VLOG(5) << "Falling back to proto JSON parsing: "
+            << maybe_json_request.status();
+    v2::GetValuesRequest request_proto;
+    PS_RETURN_IF_ERROR(
+        google::protobuf::util::JsonStringToMessage(request, &request_proto));
+    VLOG(9) << "Converted the http request to proto: "
+            << request_proto.DebugString();
+    PS_RETURN_IF_ERROR(
+        GetValues(request_proto, &response_proto, compression));
+  }
+  return absl::OkStatus();
+}
+
+void GetValuesV2Handler::GetValuesHttpAsync(
+    std::string_view request, v2::GetValuesResponse* response_proto,
+    const ResponseCompression& compression,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  auto maybe_json_request = ParseGetValuesRequestJson(request);
+  if (maybe_json_request.ok()) {
+    GetValuesAsync(std::move(maybe_json_request).value(), response_proto,
+                   compression, std::move(on_done));
+    return;
+  }
+  VLOG(5) << "Falling back to proto JSON parsing: "
+          << maybe_json_request.status();
   v2::GetValuesRequest request_proto;
-  PS_RETURN_IF_ERROR(
-      google::protobuf::util::JsonStringToMessage(request, &request_proto));
+  if (const auto status = google::protobuf::util::JsonStringToMessage(
+          request, &request_proto);
+      !status.ok()) {
+    std::move(on_done)(FromAbslStatus(status));
+    return;
+  }
   VLOG(9) << "Converted the http request to proto: "
           << request_proto.DebugString();
-  v2::GetValuesResponse response_proto;
-  PS_RETURN_IF_ERROR(GetValues(request_proto, &response_proto));
-  return MessageToJsonString(response_proto, &json_response);
+  GetValuesAsync(request_proto, response_proto, compression,
+                 std::move(on_done));
 }
 
 grpc::Status GetValuesV2Handler::BinaryHttpGetValues(
@@ -94,6 +356,23 @@ grpc::Status GetValuesV2Handler::BinaryHttpGetValues(
                                             *response->mutable_data()));
 }
 
+void GetValuesV2Handler::BinaryHttpGetValuesAsync(
+    const v2::BinaryHttpGetValuesRequest& bhttp_request,
+    google::api::HttpBody* response,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  BinaryHttpGetValuesAsync(
+      bhttp_request.raw_body().data(),
+      [response, on_done = std::move(on_done)](
+          absl::StatusOr<std::string> maybe_bhttp_response) mutable {
+        if (!maybe_bhttp_response.ok()) {
+          std::move(on_done)(FromAbslStatus(maybe_bhttp_response.status()));
+          return;
+        }
+        response->set_data(*std::move(maybe_bhttp_response));
+        std::move(on_done)(grpc::Status::OK);
+      });
+}
+
 absl::StatusOr<quiche::BinaryHttpResponse>
 GetValuesV2Handler::BuildSuccessfulGetValuesBhttpResponse(
     std::string_view bhttp_request_body) const {
@@ -104,33 +383,84 @@ GetValuesV2Handler::BuildSuccessfulGetValuesBhttpResponse(
   VLOG(3) << "BinaryHttpGetValues request: "
           << maybe_deserialized_req.DebugString();
 
-  std::string json_response;
-  PS_RETURN_IF_ERROR(
-      GetValuesHttp(maybe_deserialized_req.body(), json_response));
+  const ResponseCompression compression =
+      GetResponseCompression(maybe_deserialized_req.GetHeaderFields(),
+                             GetCompressionDictionary());
+  v2::GetValuesResponse response_proto;
+  PS_RETURN_IF_ERROR(GetValuesHttp(maybe_deserialized_req.body(),
+                                   response_proto, compression));
+  return BuildGetValuesBhttpResponse(response_proto, compression);
+}
 
+quiche::BinaryHttpResponse GetValuesV2Handler::BuildGetValuesBhttpResponse(
+    const v2::GetValuesResponse& response_proto,
+    const ResponseCompression& compression) const {
   quiche::BinaryHttpResponse bhttp_response(200);
-  bhttp_response.set_body(std::move(json_response));
+  // Single partition responses are never compressed.
+  if (const std::string_view content_encoding =
+          GetContentEncoding(compression.type);
+      response_proto.has_compressed_partition_groups() &&
+      !content_encoding.empty()) {
+    bhttp_response.AddHeaderField({std::string(kContentEncodingHeader),
+                                   std::string(content_encoding)});
+    if (compression.type == CompressionGroupConcatenator::CompressionType::
+                                kZstdWithDictionary) {
+      bhttp_response.AddHeaderField(
+          {std::string(kContentDictionaryIdHeader),
+           absl::StrCat(compression.dictionary->id())});
+    }
+  }
+  bhttp_response.set_body(GetValuesResponseToJson(response_proto));
   return bhttp_response;
 }
 
 absl::Status GetValuesV2Handler::BinaryHttpGetValues(
     std::string_view bhttp_request_body, std::string& response) const {
-  static quiche::BinaryHttpResponse const* kDefaultBhttpResponse =
-      new quiche::BinaryHttpResponse(500);
-  const quiche::BinaryHttpResponse* bhttp_response = kDefaultBhttpResponse;
-  absl::StatusOr<quiche::BinaryHttpResponse> maybe_successful_bhttp_response =
-      BuildSuccessfulGetValuesBhttpResponse(bhttp_request_body);
-  if (maybe_successful_bhttp_response.ok()) {
-    bhttp_response = &(maybe_successful_bhttp_response.value());
-  }
-  PS_ASSIGN_OR_RETURN(auto serialized_bhttp_response,
-                      bhttp_response->Serialize());
+  PS_ASSIGN_OR_RETURN(
+      auto serialized_bhttp_response,
+      SerializeBhttpResponse(
+          BuildSuccessfulGetValuesBhttpResponse(bhttp_request_body)));
 
   response = std::move(serialized_bhttp_response);
   VLOG(9) << "BinaryHttpGetValues finished successfully";
   return absl::OkStatus();
 }
 
+void GetValuesV2Handler::BinaryHttpGetValuesAsync(
+    std::string_view bhttp_request_body,
+    absl::AnyInvocable<void(absl::StatusOr<std::string>) &&> on_done) const {
+  VLOG(9) << "Handling the binary http layer";
+  absl::StatusOr<quiche::BinaryHttpRequest> maybe_deserialized_req =
+      quiche::BinaryHttpRequest::Create(bhttp_request_body);
+  if (!maybe_deserialized_req.ok()) {
+    VLOG(3) << "Failed to deserialize binary http request: "
+            << maybe_deserialized_req.status();
+    std::move(on_done)(
+        SerializeBhttpResponse(maybe_deserialized_req.status()));
+    return;
+  }
+  VLOG(3) << "BinaryHttpGetValues request: "
+          << maybe_deserialized_req->DebugString();
+
+  const ResponseCompression compression =
+      GetResponseCompression(maybe_deserialized_req->GetHeaderFields(),
+                             GetCompressionDictionary());
+  auto response_proto = std::make_unique<v2::GetValuesResponse>();
+  v2::GetValuesResponse* response_proto_ptr = response_proto.get();
+  GetValuesHttpAsync(
+      maybe_deserialized_req->body(), response_proto_ptr, compression,
+      [this, compression, response_proto = std::move(response_proto),
+       on_done = std::move(on_done)](grpc::Status status) mutable {
+        if (!status.ok()) {
+          std::move(on_done)(SerializeBhttpResponse(
+              absl::InternalError(status.error_message())));
+          return;
+        }
+        std::move(on_done)(SerializeBhttpResponse(
+            BuildGetValuesBhttpResponse(*response_proto, compression)));
+      });
+}
+
 grpc::Status GetValuesV2Handler::ObliviousGetValues(
     const ObliviousGetValuesRequest& oblivious_request,
     google::api::HttpBody* oblivious_response) const {
@@ -147,15 +477,43 @@ grpc::Status GetValuesV2Handler::ObliviousGetValues(
       !s.ok()) {
     return FromAbslStatus(s);
   }
-  auto encrypted_response = encryptor.EncryptResponse(std::move(response));
-  if (!encrypted_response.ok()) {
-    return grpc::Status(grpc::StatusCode::INTERNAL,
-                        absl::StrCat(encrypted_response.status().code(), " : ",
-                                     encrypted_response.status().message()));
+  return SetObliviousResponse(encryptor, std::move(response),
+                              *oblivious_response);
+}
+
+void GetValuesV2Handler::ObliviousGetValuesAsync(
+    const ObliviousGetValuesRequest& oblivious_request,
+    google::api::HttpBody* oblivious_response,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  VLOG(9) << "Received ObliviousGetValues request. ";
+  // The response is encrypted with the context of the request, so the
+  // encryptor lives until the UDF callback.
+  auto encryptor = std::make_unique<OhttpServerEncryptor>(key_fetcher_manager_);
+  auto maybe_plain_text =
+      encryptor->DecryptRequest(oblivious_request.raw_body().data());
+  if (!maybe_plain_text.ok()) {
+    std::move(on_done)(FromAbslStatus(maybe_plain_text.status()));
+    return;
   }
-  oblivious_response->set_content_type(std::string(kOHTTPResponseContentType));
-  oblivious_response->set_data(*encrypted_response);
-  return grpc::Status::OK;
+  BinaryHttpGetValuesAsync(
+      *maybe_plain_text,
+      [encryptor = std::move(encryptor), oblivious_response,
+       on_done = std::move(on_done)](
+          absl::StatusOr<std::string> maybe_bhttp_response) mutable {
+        if (!maybe_bhttp_response.ok()) {
+          std::move(on_done)(FromAbslStatus(maybe_bhttp_response.status()));
+          return;
+        }
+        std::move(on_done)(SetObliviousResponse(
+            *encryptor, *std::move(maybe_bhttp_response),
+            *oblivious_response));
+      });
+}
+
+std::shared_ptr<const ZstdDictionary>
+GetValuesV2Handler::GetCompressionDictionary() const {
+  if (compression_dictionaries_ == nullptr) return nullptr;
+  return compression_dictionaries_->Get();
 }
 
 void GetValuesV2Handler::ProcessOnePartition(
@@ -163,24 +521,190 @@ void GetValuesV2Handler::ProcessOnePartition(
     const v2::RequestPartition& req_partition,
     v2::ResponsePartition& resp_partition) const {
   resp_partition.set_id(req_partition.id());
+  SetPartitionOutput(
+      ExecuteWithResultCache(
+          [&req_metadata, &req_partition] {
+            return PartitionResultCache::MakeKey(req_metadata,
+                                                 req_partition.arguments());
+          },
+          [this, &req_metadata, &req_partition] {
+            UDFExecutionMetadata udf_metadata;
+            *udf_metadata.mutable_request_metadata() = req_metadata;
+            return udf_client_.ExecuteCode(std::move(udf_metadata),
+                                           req_partition.arguments());
+          }),
+      resp_partition);
+}
+
+absl::StatusOr<std::string> GetValuesV2Handler::ExecuteBinaryPartition(
+    const google::protobuf::Struct& req_metadata,
+    const v2::RequestPartition& req_partition) const {
   UDFExecutionMetadata udf_metadata;
   *udf_metadata.mutable_request_metadata() = req_metadata;
-  const auto maybe_output_string = udf_client_.ExecuteCode(
-      std::move(udf_metadata), req_partition.arguments());
-  if (!maybe_output_string.ok()) {
-    resp_partition.mutable_status()->set_code(
-        static_cast<int>(maybe_output_string.status().code()));
-    resp_partition.mutable_status()->set_message(
-        maybe_output_string.status().message());
-  } else {
-    VLOG(5) << "UDF output: " << maybe_output_string.value();
-    resp_partition.set_string_output(std::move(maybe_output_string).value());
+  return udf_client_.ExecuteBinaryCode(std::move(udf_metadata),
+                                       req_partition.arguments());
+}
+
+void GetValuesV2Handler::ProcessOnePartition(
+    std::string_view json_metadata, JsonRequestPartition& req_partition,
+    v2::ResponsePartition& resp_partition) const {
+  resp_partition.set_id(req_partition.id);
+  SetPartitionOutput(
+      ExecuteWithResultCache(
+          [json_metadata, &req_partition] {
+            return PartitionResultCache::MakeKey(json_metadata,
+                                                 req_partition.udf_arguments);
+          },
+          [this, json_metadata, &req_partition] {
+            return udf_client_.ExecuteCodeWithJsonArguments(
+                json_metadata, std::move(req_partition.udf_arguments));
+          }),
+      resp_partition);
+}
+
+absl::StatusOr<std::string> GetValuesV2Handler::ExecuteWithResultCache(
+    absl::FunctionRef<std::string()> make_cache_key,
+    absl::FunctionRef<absl::StatusOr<std::string>()> execute) const {
+  if (partition_result_cache_ == nullptr) {
+    return execute();
+  }
+  std::string cache_key = make_cache_key();
+  if (auto cached_output = partition_result_cache_->Get(cache_key);
+      cached_output.has_value()) {
+    VLOG(8) << "Partition result cache hit";
+    return *std::move(cached_output);
+  }
+  // Read before executing the UDF, so that an output that might have seen
+  // older code or data is not cached.
+  const PartitionResultCache::Version version =
+      partition_result_cache_->version();
+  absl::StatusOr<std::string> maybe_output = execute();
+  if (maybe_output.ok()) {
+    partition_result_cache_->Put(std::move(cache_key), *maybe_output, version);
+  }
+  return maybe_output;
+}
+
+void GetValuesV2Handler::ExecuteWithResultCacheAsync(
+    absl::FunctionRef<std::string()> make_cache_key,
+    absl::FunctionRef<void(UdfClient::ExecuteCodeCallback)> execute_async,
+    UdfClient::ExecuteCodeCallback callback) const {
+  if (partition_result_cache_ == nullptr) {
+    execute_async(std::move(callback));
+    return;
+  }
+  std::string cache_key = make_cache_key();
+  if (auto cached_output = partition_result_cache_->Get(cache_key);
+      cached_output.has_value()) {
+    VLOG(8) << "Partition result cache hit";
+    std::move(callback)(*std::move(cached_output));
+    return;
+  }
+  const PartitionResultCache::Version version =
+      partition_result_cache_->version();
+  execute_async([cache = partition_result_cache_,
+                 cache_key = std::move(cache_key), version,
+                 callback = std::move(callback)](
+                    absl::StatusOr<std::string> maybe_output) mutable {
+    if (maybe_output.ok()) {
+      cache->Put(std::move(cache_key), *maybe_output, version);
+    }
+    std::move(callback)(std::move(maybe_output));
+  });
+}
+
+void GetValuesV2Handler::ExecutePartitionAsync(
+    const google::protobuf::Struct& req_metadata,
+    const v2::RequestPartition& req_partition,
+    UdfClient::ExecuteCodeCallback callback) const {
+  ExecuteWithResultCacheAsync(
+      [&req_metadata, &req_partition] {
+        return PartitionResultCache::MakeKey(req_metadata,
+                                             req_partition.arguments());
+      },
+      [this, &req_metadata,
+       &req_partition](UdfClient::ExecuteCodeCallback on_done) {
+        UDFExecutionMetadata udf_metadata;
+        *udf_metadata.mutable_request_metadata() = req_metadata;
+        udf_client_.ExecuteCodeAsync(std::move(udf_metadata),
+                                     req_partition.arguments(),
+                                     std::move(on_done));
+      },
+      std::move(callback));
+}
+
+void GetValuesV2Handler::ExecutePartitionAsync(
+    std::string_view json_metadata, JsonRequestPartition& req_partition,
+    UdfClient::ExecuteCodeCallback callback) const {
+  ExecuteWithResultCacheAsync(
+      [json_metadata, &req_partition] {
+        return PartitionResultCache::MakeKey(json_metadata,
+                                             req_partition.udf_arguments);
+      },
+      [this, json_metadata,
+       &req_partition](UdfClient::ExecuteCodeCallback on_done) {
+        udf_client_.ExecuteCodeWithJsonArgumentsAsync(
+            json_metadata, std::move(req_partition.udf_arguments),
+            std::move(on_done));
+      },
+      std::move(callback));
+}
+
+absl::StatusOr<std::string> GetValuesV2Handler::CompressOneGroup(
+    const V2CompressionGroup& compression_group,
+    const ResponseCompression& compression) const {
+  std::string json_group;
+  PS_RETURN_IF_ERROR(MessageToJsonString(compression_group, &json_group));
+  auto concatenator = create_compression_group_concatenator_(
+      compression.type, compression.dictionary.get());
+  concatenator->AddCompressionGroup(std::move(json_group));
+  return concatenator->Build();
+}
+
+absl::Status GetValuesV2Handler::ProcessMultiplePartitions(
+    const std::vector<int32_t>& partition_ids,
+    const std::vector<int32_t>& compression_group_ids,
+    absl::FunctionRef<void(int, UdfClient::ExecuteCodeCallback)>
+        execute_partition_async,
+    const ResponseCompression& compression,
+    v2::CompressionGroups& compression_groups) const {
+  // Partitions are independent of each other, so all UDF executions are
+  // dispatched before waiting and the request latency is bounded by the
+  // slowest partition. Like in GetValuesAsync, groups are compressed by the
+  // UDF callback of their last partition.
+  StreamingCompressionGroups streaming_groups(
+      compression_group_ids,
+      [this, compression](const V2CompressionGroup& compression_group) {
+        return CompressOneGroup(compression_group, compression);
+      });
+  const int num_partitions = partition_ids.size();
+  absl::BlockingCounter num_remaining(num_partitions);
+  for (int i = 0; i < num_partitions; ++i) {
+    execute_partition_async(
+        i, [&streaming_groups, &num_remaining, i, id = partition_ids[i]](
+               absl::StatusOr<std::string> maybe_output_string) {
+          v2::ResponsePartition resp_partition;
+          resp_partition.set_id(id);
+          SetPartitionOutput(std::move(maybe_output_string), resp_partition);
+          streaming_groups.SetPartition(i, resp_partition);
+          num_remaining.DecrementCount();
+        });
   }
+  num_remaining.Wait();
+  return streaming_groups.Finish(compression_groups);
 }
 
 grpc::Status GetValuesV2Handler::GetValues(
     const v2::GetValuesRequest& request,
     v2::GetValuesResponse* response) const {
+  return GetValues(
+      request, response,
+      ResponseCompression());
+}
+
+grpc::Status GetValuesV2Handler::GetValues(
+    const v2::GetValuesRequest& request, v2::GetValuesResponse* response,
+    const ResponseCompression& compression) const {
   if (request.partitions().size() == 1) {
     ProcessOnePartition(request.metadata(), request.partitions(0),
                         *response->mutable_single_partition());
@@ -190,8 +714,183 @@ grpc::Status GetValuesV2Handler::GetValues(
     return grpc::Status(StatusCode::INTERNAL,
                         "At least 1 partition is required");
   }
-  return grpc::Status(StatusCode::UNIMPLEMENTED,
-                      "Multiple partition support is not implemented");
+  std::vector<int32_t> partition_ids;
+  std::vector<int32_t> compression_group_ids;
+  partition_ids.reserve(request.partitions_size());
+  compression_group_ids.reserve(request.partitions_size());
+  for (const auto& partition : request.partitions()) {
+    partition_ids.push_back(partition.id());
+    compression_group_ids.push_back(partition.compression_group_id());
+  }
+  return FromAbslStatus(ProcessMultiplePartitions(
+      partition_ids, compression_group_ids,
+      [this, &request](int i, UdfClient::ExecuteCodeCallback callback) {
+        ExecutePartitionAsync(request.metadata(), request.partitions(i),
+                              std::move(callback));
+      },
+      compression, *response->mutable_compressed_partition_groups()));
+}
+
+void GetValuesV2Handler::GetValuesAsync(
+    const v2::GetValuesRequest& request, v2::GetValuesResponse* response,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  GetValuesAsync(request, response,
+                 ResponseCompression(),
+                 std::move(on_done));
+}
+
+void GetValuesV2Handler::GetValuesAsync(
+    const v2::GetValuesRequest& request, v2::GetValuesResponse* response,
+    const ResponseCompression& compression,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  if (request.partitions_size() == 1) {
+    const v2::RequestPartition& req_partition = request.partitions(0);
+    auto* resp_partition = response->mutable_single_partition();
+    resp_partition->set_id(req_partition.id());
+    ExecutePartitionAsync(
+        request.metadata(), req_partition,
+        [resp_partition, on_done = std::move(on_done)](
+            absl::StatusOr<std::string> maybe_output_string) mutable {
+          SetPartitionOutput(std::move(maybe_output_string), *resp_partition);
+          std::move(on_done)(grpc::Status::OK);
+        });
+    return;
+  }
+  if (request.partitions().empty()) {
+    std::move(on_done)(
+        grpc::Status(StatusCode::INTERNAL, "At least 1 partition is required"));
+    return;
+  }
+  std::vector<int32_t> partition_ids;
+  std::vector<int32_t> compression_group_ids;
+  partition_ids.reserve(request.partitions_size());
+  compression_group_ids.reserve(request.partitions_size());
+  for (const auto& partition : request.partitions()) {
+    partition_ids.push_back(partition.id());
+    compression_group_ids.push_back(partition.compression_group_id());
+  }
+  ProcessMultiplePartitionsAsync(
+      partition_ids, compression_group_ids,
+      [this, &request](int i, UdfClient::ExecuteCodeCallback callback) {
+        ExecutePartitionAsync(request.metadata(), request.partitions(i),
+                              std::move(callback));
+      },
+      compression, response->mutable_compressed_partition_groups(),
+      std::move(on_done));
+}
+
+void GetValuesV2Handler::GetValuesAsync(
+    JsonGetValuesRequest request, v2::GetValuesResponse* response,
+    const ResponseCompression& compression,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  // `request` only needs to live until the UDF executions are dispatched,
+  // which copies the arguments of every partition.
+  if (request.partitions.size() == 1) {
+    JsonRequestPartition& req_partition = request.partitions[0];
+    auto* resp_partition = response->mutable_single_partition();
+    resp_partition->set_id(req_partition.id);
+    ExecutePartitionAsync(
+        request.metadata, req_partition,
+        [resp_partition, on_done = std::move(on_done)](
+            absl::StatusOr<std::string> maybe_output_string) mutable {
+          SetPartitionOutput(std::move(maybe_output_string), *resp_partition);
+          std::move(on_done)(grpc::Status::OK);
+        });
+    return;
+  }
+  if (request.partitions.empty()) {
+    std::move(on_done)(
+        grpc::Status(StatusCode::INTERNAL, "At least 1 partition is required"));
+    return;
+  }
+  std::vector<int32_t> partition_ids;
+  std::vector<int32_t> compression_group_ids;
+  partition_ids.reserve(request.partitions.size());
+  compression_group_ids.reserve(request.partitions.size());
+  for (const auto& partition : request.partitions) {
+    partition_ids.push_back(partition.id);
+    compression_group_ids.push_back(partition.compression_group_id);
+  }
+  ProcessMultiplePartitionsAsync(
+      partition_ids, compression_group_ids,
+      [this, &request](int i, UdfClient::ExecuteCodeCallback callback) {
+        ExecutePartitionAsync(request.metadata, request.partitions[i],
+                              std::move(callback));
+      },
+      compression, response->mutable_compressed_partition_groups(),
+      std::move(on_done));
+}
+
+void GetValuesV2Handler::ProcessMultiplePartitionsAsync(
+    const std::vector<int32_t>& partition_ids,
+    const std::vector<int32_t>& compression_group_ids,
+    absl::FunctionRef<void(int, UdfClient::ExecuteCodeCallback)>
+        execute_partition_async,
+    const ResponseCompression& compression,
+    v2::CompressionGroups* compression_groups,
+    absl::AnyInvocable<void(grpc::Status) &&> on_done) const {
+  // Groups are compressed by the UDF callback of their last partition. The
+  // UDF callback of the last partition to finish completes the response.
+  struct PendingPartitions {
+    std::unique_ptr<StreamingCompressionGroups> streaming_groups;
+    std::atomic<int> num_remaining;
+    v2::CompressionGroups* compression_groups;
+    absl::AnyInvocable<void(grpc::Status) &&> on_done;
+  };
+  const int num_partitions = partition_ids.size();
+  auto pending = std::make_shared<PendingPartitions>();
+  pending->streaming_groups = std::make_unique<StreamingCompressionGroups>(
+      compression_group_ids,
+      [this, compression](const V2CompressionGroup& compression_group) {
+        return CompressOneGroup(compression_group, compression);
+      });
+  pending->num_remaining = num_partitions;
+  pending->compression_groups = compression_groups;
+  pending->on_done = std::move(on_done);
+  for (int i = 0; i < num_partitions; ++i) {
+    execute_partition_async(
+        i, [pending, i, id = partition_ids[i]](
+               absl::StatusOr<std::string> maybe_output_string) mutable {
+          v2::ResponsePartition resp_partition;
+          resp_partition.set_id(id);
+          SetPartitionOutput(std::move(maybe_output_string), resp_partition);
+          pending->streaming_groups->SetPartition(i, resp_partition);
+          if (pending->num_remaining.fetch_sub(1) != 1) {
+            return;
+          }
+          std::move(pending->on_done)(FromAbslStatus(
+              pending->streaming_groups->Finish(*pending->compression_groups)));
+        });
+  }
+}
+
+grpc::Status GetValuesV2Handler::GetValues(
+    JsonGetValuesRequest request, v2::GetValuesResponse* response,
+    const ResponseCompression& compression) const {
+  if (request.partitions.size() == 1) {
+    ProcessOnePartition(request.metadata, request.partitions[0],
+                        *response->mutable_single_partition());
+    return grpc::Status::OK;
+  }
+  if (request.partitions.empty()) {
+    return grpc::Status(StatusCode::INTERNAL,
+                        "At least 1 partition is required");
+  }
+  std::vector<int32_t> partition_ids;
+  std::vector<int32_t> compression_group_ids;
+  partition_ids.reserve(request.partitions.size());
+  compression_group_ids.reserve(request.partitions.size());
+  for (const auto& partition : request.partitions) {
+    partition_ids.push_back(partition.id);
+    compression_group_ids.push_back(partition.compression_group_id);
+  }
+  return FromAbslStatus(ProcessMultiplePartitions(
+      partition_ids, compression_group_ids,
+      [this, &request](int i, UdfClient::ExecuteCodeCallback callback) {
+        ExecutePartitionAsync(request.metadata, request.partitions[i],
+                              std::move(callback));
+      },
+      compression, *response->mutable_compressed_partition_groups()));
 }
 
 }  // namespace kv_server
@@ -17,15 +17,22 @@
 #ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_GET_VALUES_V2_HANDLER_H_
 #define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_GET_VALUES_V2_HANDLER_H_
 
+#include <memory>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/escaping.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/request_handler/compression.h"
+#include "components/data_server/request_handler/compression_zstd.h"
+#include "components/data_server/request_handler/get_values_v2_json.h"
+#include "components/data_server/request_handler/partition_result_cache.h"
+#include "components/data_server/request_handler/v2_response_data.pb.h"
 #include "components/udf/udf_client.h"
 #include "grpcpp/grpcpp.h"
 #include "public/query/v2/get_values_v2.grpc.pb.h"
@@ -35,11 +42,23 @@
 
 namespace kv_server {
 
+// How the compression groups of one response are compressed. `dictionary` is
+// only set for kZstdWithDictionary and is kept alive until the response is
+// built, even if a newer dictionary is installed meanwhile.
+struct ResponseCompression {
+  CompressionGroupConcatenator::CompressionType type =
+      CompressionGroupConcatenator::CompressionType::kUncompressed;
+  std::shared_ptr<const ZstdDictionary> dictionary;
+};
+
 // Handles the request family of *GetValues.
 // See the Service proto definition for details.
 class GetValuesV2Handler {
  public:
   // Accepts a functor to create compression blob builder for testing purposes.
+  // UDF outputs are cached in `partition_result_cache` if it is not null.
+  // Clients holding the latest dictionary of `compression_dictionaries` get
+  // responses compressed with it.
   explicit GetValuesV2Handler(
       const UdfClient& udf_client,
       privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
@@ -47,23 +66,46 @@ class GetValuesV2Handler {
           key_fetcher_manager,
       std::function<CompressionGroupConcatenator::FactoryFunctionType>
           create_compression_group_concatenator =
-              &CompressionGroupConcatenator::Create)
+              &CompressionGroupConcatenator::Create,
+      PartitionResultCache* partition_result_cache = nullptr,
+      const ZstdDictionaryStore* compression_dictionaries = nullptr)
       : udf_client_(udf_client),
         metrics_recorder_(metrics_recorder),
         create_compression_group_concatenator_(
             std::move(create_compression_group_concatenator)),
-        key_fetcher_manager_(key_fetcher_manager) {}
+        key_fetcher_manager_(key_fetcher_manager),
+        partition_result_cache_(partition_result_cache),
+        compression_dictionaries_(compression_dictionaries) {}
 
   grpc::Status GetValuesHttp(const v2::GetValuesHttpRequest& request,
                              google::api::HttpBody* response) const;
 
+  // Asynchronous version of GetValuesHttp, see GetValuesAsync.
+  void GetValuesHttpAsync(
+      const v2::GetValuesHttpRequest& request, google::api::HttpBody* response,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
   grpc::Status GetValues(const v2::GetValuesRequest& request,
                          v2::GetValuesResponse* response) const;
 
+  // Asynchronous version of GetValues that does not block on the UDF.
+  // `on_done` is called once `response` is complete, usually from the UDF
+  // callback thread. `request` only needs to outlive this call, `response`
+  // must stay valid until `on_done` is called.
+  void GetValuesAsync(const v2::GetValuesRequest& request,
+                      v2::GetValuesResponse* response,
+                      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
   grpc::Status BinaryHttpGetValues(
       const v2::BinaryHttpGetValuesRequest& request,
       google::api::HttpBody* response) const;
 
+  // Asynchronous version of BinaryHttpGetValues, see GetValuesAsync.
+  void BinaryHttpGetValuesAsync(
+      const v2::BinaryHttpGetValuesRequest& request,
+      google::api::HttpBody* response,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
   // Supports requests encrypted with a fixed key for debugging/demoing.
   // X25519 Secret key (priv key).
   // https://www.ietf.org/archive/id/draft-ietf-ohai-ohttp-03.html#appendix-A-2
@@ -80,9 +122,59 @@ class GetValuesV2Handler {
   grpc::Status ObliviousGetValues(const v2::ObliviousGetValuesRequest& request,
                                   google::api::HttpBody* response) const;
 
+  // Asynchronous version of ObliviousGetValues, see GetValuesAsync.
+  void ObliviousGetValuesAsync(
+      const v2::ObliviousGetValuesRequest& request,
+      google::api::HttpBody* response,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
+  // Returns true if the loaded UDF only returns the values of the keys it is
+  // given, see `UdfClient::IsPassthroughCodeLoaded`.
+  bool IsPassthroughUdfLoaded() const {
+    return udf_client_.IsPassthroughCodeLoaded();
+  }
+
+  // Returns true if the loaded UDF takes binary input and output, see
+  // `UdfClient::IsBinaryIoCodeLoaded`.
+  bool IsBinaryIoUdfLoaded() const {
+    return udf_client_.IsBinaryIoCodeLoaded();
+  }
+
+  // Invokes the UDF for one partition with binary UDF input and output, see
+  // `UdfClient::ExecuteBinaryCode`. Returns the serialized UDF output.
+  absl::StatusOr<std::string> ExecuteBinaryPartition(
+      const google::protobuf::Struct& req_metadata,
+      const v2::RequestPartition& req_partition) const;
+
  private:
-  absl::Status GetValuesHttp(std::string_view request,
-                             std::string& json_response) const;
+  absl::Status GetValuesHttp(
+      std::string_view request, v2::GetValuesResponse& response_proto,
+      const ResponseCompression& compression) const;
+
+  grpc::Status GetValues(
+      const v2::GetValuesRequest& request, v2::GetValuesResponse* response,
+      const ResponseCompression& compression) const;
+
+  // Same as above for a request decoded by the streaming JSON parser.
+  grpc::Status GetValues(
+      JsonGetValuesRequest request, v2::GetValuesResponse* response,
+      const ResponseCompression& compression) const;
+
+  // Asynchronous versions of the three functions above.
+  void GetValuesHttpAsync(
+      std::string_view request, v2::GetValuesResponse* response_proto,
+      const ResponseCompression& compression,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
+  void GetValuesAsync(
+      const v2::GetValuesRequest& request, v2::GetValuesResponse* response,
+      const ResponseCompression& compression,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
+  void GetValuesAsync(
+      JsonGetValuesRequest request, v2::GetValuesResponse* response,
+      const ResponseCompression& compression,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
 
   // On success, returns a BinaryHttpResponse with a successful response. The
   // reason that this is a separate function is so that the error status
@@ -98,17 +190,92 @@ class GetValuesV2Handler {
   absl::Status BinaryHttpGetValues(std::string_view bhttp_request_body,
                                    std::string& response) const;
 
+  // Asynchronous version of the function above. `on_done` is called with the
+  // serialized Binary HTTP response.
+  void BinaryHttpGetValuesAsync(
+      std::string_view bhttp_request_body,
+      absl::AnyInvocable<void(absl::StatusOr<std::string>) &&> on_done) const;
+
+  // Returns the Binary HTTP response carrying `response_proto`, whose
+  // compression groups were compressed as described by `compression`.
+  quiche::BinaryHttpResponse BuildGetValuesBhttpResponse(
+      const v2::GetValuesResponse& response_proto,
+      const ResponseCompression& compression) const;
+
+  // Returns the latest compression dictionary, if any.
+  std::shared_ptr<const ZstdDictionary> GetCompressionDictionary() const;
+
   // Invokes UDF to process one partition.
   void ProcessOnePartition(const google::protobuf::Struct& req_metadata,
                            const v2::RequestPartition& req_partition,
                            v2::ResponsePartition& resp_partition) const;
 
+  // Invokes UDF to process one partition whose arguments are already JSON.
+  // Consumes the arguments of `req_partition`.
+  void ProcessOnePartition(std::string_view json_metadata,
+                           JsonRequestPartition& req_partition,
+                           v2::ResponsePartition& resp_partition) const;
+
+  // Returns the output of `execute`, or the output cached for the key built
+  // by `make_cache_key` if there is a partition result cache.
+  absl::StatusOr<std::string> ExecuteWithResultCache(
+      absl::FunctionRef<std::string()> make_cache_key,
+      absl::FunctionRef<absl::StatusOr<std::string>()> execute) const;
+
+  // Asynchronous version of ExecuteWithResultCache. `callback` is called
+  // right away if the output is in the partition result cache.
+  void ExecuteWithResultCacheAsync(
+      absl::FunctionRef<std::string()> make_cache_key,
+      absl::FunctionRef<void(UdfClient::ExecuteCodeCallback)> execute_async,
+      UdfClient::ExecuteCodeCallback callback) const;
+
+  // Invokes UDF asynchronously to process one partition. `callback` is
+  // called right away if the output is in the partition result cache.
+  void ExecutePartitionAsync(const google::protobuf::Struct& req_metadata,
+                             const v2::RequestPartition& req_partition,
+                             UdfClient::ExecuteCodeCallback callback) const;
+
+  // Invokes UDF asynchronously to process one partition whose arguments are
+  // already JSON. Consumes the arguments of `req_partition`.
+  void ExecutePartitionAsync(std::string_view json_metadata,
+                             JsonRequestPartition& req_partition,
+                             UdfClient::ExecuteCodeCallback callback) const;
+
+  // Starts `execute_partition_async` for all partitions and waits until all
+  // their callbacks ran. Each compression group is compressed once all its
+  // partitions are processed.
+  absl::Status ProcessMultiplePartitions(
+      const std::vector<int32_t>& partition_ids,
+      const std::vector<int32_t>& compression_group_ids,
+      absl::FunctionRef<void(int, UdfClient::ExecuteCodeCallback)>
+          execute_partition_async,
+      const ResponseCompression& compression,
+      v2::CompressionGroups& compression_groups) const;
+
+  // Asynchronous version of ProcessMultiplePartitions. The UDF callback of the
+  // last partition to finish sets `compression_groups` and calls `on_done`.
+  void ProcessMultiplePartitionsAsync(
+      const std::vector<int32_t>& partition_ids,
+      const std::vector<int32_t>& compression_group_ids,
+      absl::FunctionRef<void(int, UdfClient::ExecuteCodeCallback)>
+          execute_partition_async,
+      const ResponseCompression& compression,
+      v2::CompressionGroups* compression_groups,
+      absl::AnyInvocable<void(grpc::Status) &&> on_done) const;
+
+  // Compresses one compression group with a dedicated concatenator.
+  absl::StatusOr<std::string> CompressOneGroup(
+      const V2CompressionGroup& compression_group,
+      const ResponseCompression& compression) const;
+
   const UdfClient& udf_client_;
   std::function<CompressionGroupConcatenator::FactoryFunctionType>
       create_compression_group_concatenator_;
   privacy_sandbox::server_common::MetricsRecorder& metrics_recorder_;
   privacy_sandbox::server_common::KeyFetcherManagerInterface&
       key_fetcher_manager_;
+  PartitionResultCache* partition_result_cache_;
+  const ZstdDictionaryStore* compression_dictionaries_;
 };
 
 }  // namespace kv_server
@@ -15,16 +15,26 @@
 #include "components/data_server/request_handler/get_values_v2_handler.h"
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/mocks.h"
+#include "components/data_server/request_handler/compression.h"
+#include "components/data_server/request_handler/compression_zstd.h"
+#include "components/data_server/request_handler/partition_result_cache.h"
+#include "components/data_server/request_handler/v2_response_data.pb.h"
 #include "components/udf/mocks.h"
 #include "glog/logging.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
+#include "google/protobuf/util/json_util.h"
 #include "grpcpp/grpcpp.h"
 #include "gtest/gtest.h"
 #include "nlohmann/json.hpp"
@@ -36,6 +46,7 @@
 #include "src/cpp/encryption/key_fetcher/src/fake_key_fetcher_manager.h"
 #include "src/cpp/telemetry/metrics_recorder.h"
 #include "src/cpp/telemetry/mocks.h"
+#include "zdict.h"
 
 namespace kv_server {
 namespace {
@@ -324,12 +335,103 @@ data {
   ]
 }
   )");
+  // The string partition id is only accepted by the proto JSON parser, so the
+  // UDF input goes through its proto representation.
   EXPECT_CALL(
       mock_udf_client_,
       ExecuteCode(EqualsProto(udf_metadata),
                   testing::ElementsAre(EqualsProto(arg1), EqualsProto(arg2))))
       .WillOnce(Return(output.dump()));
 
+  const std::string core_request_body = R"(
+{
+    "metadata": {
+        "hostname": "example.com"
+    },
+    "partitions": [
+        {
+            "id": "0",
+            "compressionGroupId": 0,
+            "arguments": [
+                {
+                    "tags": [
+                        "structured",
+                        "groupNames"
+                    ],
+                    "data": [
+                        "hello"
+                    ]
+                },
+                {
+                    "tags": [
+                        "custom",
+                        "keys"
+                    ],
+                    "data": [
+                        "key1"
+                    ]
+                }
+            ]
+        }
+    ]
+}
+  )";
+
+  google::api::HttpBody response;
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  int16_t bhttp_response_code = 0;
+  const auto result = GetValuesBasedOnProtocol(core_request_body, &response,
+                                               &bhttp_response_code, &handler);
+  ASSERT_EQ(bhttp_response_code, 200);
+  ASSERT_TRUE(result.ok()) << "code: " << result.error_code()
+                           << ", msg: " << result.error_message();
+
+  v2::GetValuesResponse actual_response, expected_response;
+  expected_response.mutable_single_partition()->set_string_output(
+      output.dump());
+
+  ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(response.data(),
+                                                          &actual_response)
+                  .ok());
+  EXPECT_THAT(actual_response, EqualsProto(expected_response));
+}
+
+TEST_P(GetValuesHandlerTest, SuccessWithJsonArguments) {
+  nlohmann::json output = nlohmann::json::parse(R"(
+{
+  "keyGroupOutputs": [
+      {
+          "keyValues": {
+              "key1": "value1"
+          },
+          "tags": [
+              "custom",
+              "keys"
+          ]
+      },
+      {
+          "keyValues": {
+              "hello": "world"
+          },
+          "tags": [
+              "structured",
+              "groupNames"
+          ]
+      }
+  ]
+}
+  )");
+  // JSON requests bypass the proto representation of the UDF input.
+  EXPECT_CALL(
+      mock_udf_client_,
+      ExecuteCodeWithJsonArguments(
+          R"({"hostname":"example.com"})",
+          testing::ElementsAre(
+              R"({"tags":["structured","groupNames"],"data":["hello"]})",
+              R"({"tags":["custom","keys"],"data":["key1"]})")))
+      .WillOnce(Return(output.dump()));
+
   const std::string core_request_body = R"(
 {
     "metadata": {
@@ -496,5 +598,537 @@ TEST_F(GetValuesHandlerTest, PureGRPCTestFailure) {
   EXPECT_THAT(resp, EqualsProto(res));
 }
 
+std::optional<std::string> GetHeader(
+    const quiche::BinaryHttpResponse& bhttp_response, std::string_view name) {
+  for (const auto& header : bhttp_response.GetHeaderFields()) {
+    if (header.name == name) {
+      return header.value;
+    }
+  }
+  return std::nullopt;
+}
+
+// Action that completes an asynchronous UDF execution right away.
+auto CompleteUdfWith(absl::StatusOr<std::string> output) {
+  return [output = std::move(output)](auto&&, auto&&,
+                                      UdfClient::ExecuteCodeCallback on_done) {
+    std::move(on_done)(output);
+  };
+}
+
+std::vector<V2CompressionGroup> ExtractCompressionGroups(
+    const v2::GetValuesResponse& response,
+    CompressionGroupConcatenator::CompressionType compression_type,
+    const ZstdDictionary* dictionary = nullptr) {
+  std::vector<V2CompressionGroup> groups;
+  for (const auto& compressed_group :
+       response.compressed_partition_groups().compressed_partition_groups()) {
+    auto reader = CompressedBlobReader::Create(compression_type,
+                                               compressed_group, dictionary);
+    auto maybe_json_group = reader->ExtractOneCompressionGroup();
+    EXPECT_TRUE(maybe_json_group.ok()) << maybe_json_group.status();
+    EXPECT_TRUE(reader->IsDoneReading());
+    V2CompressionGroup group;
+    EXPECT_TRUE(
+        google::protobuf::util::JsonStringToMessage(*maybe_json_group, &group)
+            .ok());
+    groups.push_back(std::move(group));
+  }
+  return groups;
+}
+
+TEST_F(GetValuesHandlerTest, MultiplePartitionsGroupedByCompressionGroup) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 0
+             compression_group_id: 1
+             arguments { data { string_value: "key0" } }
+           }
+           partitions {
+             id: 1
+             compression_group_id: 0
+             arguments { data { string_value: "key1" } }
+           }
+           partitions {
+             id: 2
+             compression_group_id: 1
+             arguments { data { string_value: "key2" } }
+           })pb",
+      &req);
+  for (const auto& partition : req.partitions()) {
+    const std::string& key = partition.arguments(0).data().string_value();
+    EXPECT_CALL(mock_udf_client_,
+                ExecuteCodeAsync(_,
+                                 testing::ElementsAre(
+                                     EqualsProto(partition.arguments(0))),
+                                 _))
+        .WillOnce(CompleteUdfWith(absl::StrCat(
+            R"({"keyGroupOutputs": [{"tags": ["custom", "keys"], )",
+            R"("keyValues": {")", key, R"(": {"value": "value_)", key,
+            R"("}}}], "udfOutputApiVersion": 1})")));
+  }
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  v2::GetValuesResponse resp;
+  const auto result = handler.GetValues(req, &resp);
+  ASSERT_TRUE(result.ok()) << "code: " << result.error_code()
+                           << ", msg: " << result.error_message();
+  ASSERT_TRUE(resp.has_compressed_partition_groups());
+
+  const auto groups = ExtractCompressionGroups(
+      resp, CompressionGroupConcatenator::CompressionType::kUncompressed);
+  ASSERT_EQ(groups.size(), 2);
+  V2CompressionGroup expected_group_1, expected_group_0;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 0
+             key_group_outputs {
+               tags: "custom"
+               tags: "keys"
+               key_values {
+                 key: "key0"
+                 value { value { string_value: "value_key0" } }
+               }
+             }
+           }
+           partitions {
+             id: 2
+             key_group_outputs {
+               tags: "custom"
+               tags: "keys"
+               key_values {
+                 key: "key2"
+                 value { value { string_value: "value_key2" } }
+               }
+             }
+           })pb",
+      &expected_group_1);
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 1
+             key_group_outputs {
+               tags: "custom"
+               tags: "keys"
+               key_values {
+                 key: "key1"
+                 value { value { string_value: "value_key1" } }
+               }
+             }
+           })pb",
+      &expected_group_0);
+  EXPECT_THAT(groups[0], EqualsProto(expected_group_1));
+  EXPECT_THAT(groups[1], EqualsProto(expected_group_0));
+}
+
+TEST_F(GetValuesHandlerTest, MultiplePartitionsWithUdfFailure) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 0
+             arguments { data { string_value: "key0" } }
+           }
+           partitions {
+             id: 1
+             arguments { data { string_value: "key1" } }
+           })pb",
+      &req);
+  EXPECT_CALL(mock_udf_client_,
+              ExecuteCodeAsync(_,
+                               testing::ElementsAre(
+                                   EqualsProto(req.partitions(0).arguments(0))),
+                               _))
+      .WillOnce(CompleteUdfWith(R"({"keyGroupOutputs": []})"));
+  EXPECT_CALL(mock_udf_client_,
+              ExecuteCodeAsync(_,
+                               testing::ElementsAre(
+                                   EqualsProto(req.partitions(1).arguments(0))),
+                               _))
+      .WillOnce(CompleteUdfWith(absl::InternalError("UDF execution error")));
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  v2::GetValuesResponse resp;
+  const auto result = handler.GetValues(req, &resp);
+  ASSERT_TRUE(result.ok()) << "code: " << result.error_code()
+                           << ", msg: " << result.error_message();
+
+  const auto groups = ExtractCompressionGroups(
+      resp, CompressionGroupConcatenator::CompressionType::kUncompressed);
+  ASSERT_EQ(groups.size(), 1);
+  V2CompressionGroup expected_group;
+  TextFormat::ParseFromString(R"pb(partitions { id: 0 }
+                                   partitions { id: 1 })pb",
+                              &expected_group);
+  EXPECT_THAT(groups[0], EqualsProto(expected_group));
+}
+
+TEST_F(GetValuesHandlerTest, MultiplePartitionsDispatchAllUdfsBeforeWaiting) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 0
+             arguments { data { string_value: "key0" } }
+           }
+           partitions {
+             id: 1
+             arguments { data { string_value: "key1" } }
+           })pb",
+      &req);
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  absl::Mutex mu;
+  std::vector<UdfClient::ExecuteCodeCallback> udf_callbacks;
+  EXPECT_CALL(mock_udf_client_, ExecuteCodeAsync(_, _, _))
+      .Times(2)
+      .WillRepeatedly([&mu, &udf_callbacks](
+                          UDFExecutionMetadata&&,
+                          const google::protobuf::RepeatedPtrField<
+                              UDFArgument>&,
+                          UdfClient::ExecuteCodeCallback on_done) {
+        absl::MutexLock lock(&mu);
+        udf_callbacks.push_back(std::move(on_done));
+      });
+  v2::GetValuesResponse resp;
+  grpc::Status result;
+  std::thread request_thread([&handler, &req, &resp, &result] {
+    result = handler.GetValues(req, &resp);
+  });
+  {
+    absl::MutexLock lock(&mu);
+    mu.Await(absl::Condition(
+        +[](std::vector<UdfClient::ExecuteCodeCallback>* callbacks) {
+          return callbacks->size() == 2;
+        },
+        &udf_callbacks));
+  }
+  // Both UDFs are in flight at once, and complete in reverse order.
+  std::move(udf_callbacks[1])(R"({"keyGroupOutputs": []})");
+  std::move(udf_callbacks[0])(R"({"keyGroupOutputs": []})");
+  request_thread.join();
+  ASSERT_TRUE(result.ok()) << "code: " << result.error_code()
+                           << ", msg: " << result.error_message();
+  const auto groups = ExtractCompressionGroups(
+      resp, CompressionGroupConcatenator::CompressionType::kUncompressed);
+  ASSERT_EQ(groups.size(), 1);
+  EXPECT_EQ(groups[0].partitions_size(), 2);
+}
+
+TEST_F(GetValuesHandlerTest, BinaryHttpCompressesGroupsWithAcceptedEncoding) {
+  EXPECT_CALL(mock_udf_client_, ExecuteCodeWithJsonArgumentsAsync(_, _, _))
+      .Times(8)
+      .WillRepeatedly(CompleteUdfWith(R"({"keyGroupOutputs": []})"));
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  for (const auto& [accept_encoding, compression_type, content_encoding] :
+       std::vector<std::tuple<std::string,
+                              CompressionGroupConcatenator::CompressionType,
+                              std::optional<std::string>>>{
+           {"deflate, gzip;q=0.8",
+            CompressionGroupConcatenator::CompressionType::kGzip, "gzip"},
+           {"gzip, BR", CompressionGroupConcatenator::CompressionType::kBrotli,
+            "br"},
+           {"gzip, zstd", CompressionGroupConcatenator::CompressionType::kZstd,
+            "zstd"},
+           {"deflate",
+            CompressionGroupConcatenator::CompressionType::kUncompressed,
+            std::nullopt},
+       }) {
+    quiche::BinaryHttpRequest bhttp_request({});
+    bhttp_request.AddHeaderField({"Accept-Encoding", accept_encoding});
+    bhttp_request.set_body(R"({
+      "partitions": [
+        {"id": 0, "compressionGroupId": 0,
+         "arguments": [{"data": ["key0"]}]},
+        {"id": 1, "compressionGroupId": 1,
+         "arguments": [{"data": ["key1"]}]}
+      ]
+    })");
+    auto maybe_serialized_request = bhttp_request.Serialize();
+    ASSERT_TRUE(maybe_serialized_request.ok());
+    BinaryHttpGetValuesRequest request;
+    request.mutable_raw_body()->set_data(*maybe_serialized_request);
+    google::api::HttpBody response;
+    ASSERT_TRUE(handler.BinaryHttpGetValues(request, &response).ok());
+
+    const auto maybe_bhttp_response =
+        quiche::BinaryHttpResponse::Create(response.data());
+    ASSERT_TRUE(maybe_bhttp_response.ok());
+    ASSERT_EQ(maybe_bhttp_response->status_code(), 200);
+    EXPECT_EQ(GetHeader(*maybe_bhttp_response, "content-encoding"),
+              content_encoding)
+        << accept_encoding;
+    v2::GetValuesResponse resp;
+    ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(
+                    std::string(maybe_bhttp_response->body()), &resp)
+                    .ok());
+    const auto groups = ExtractCompressionGroups(resp, compression_type);
+    ASSERT_EQ(groups.size(), 2) << accept_encoding;
+    EXPECT_EQ(groups[0].partitions(0).id(), 0);
+    EXPECT_EQ(groups[1].partitions(0).id(), 1);
+  }
+}
+
+TEST_F(GetValuesHandlerTest, BinaryHttpCompressesWithDictionaryClientHolds) {
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (int i = 0; i < 100; ++i) {
+    const std::string sample = absl::StrCat(
+        R"({"partitions":[{"id":)", i, R"(,"keyGroupOutputs":[]}]})");
+    samples.append(sample);
+    sample_sizes.push_back(sample.size());
+  }
+  std::string dictionary_content(4096, '\0');
+  ZDICT_params_t params = {};
+  params.dictID = 42;
+  const size_t dictionary_size = ZDICT_finalizeDictionary(
+      dictionary_content.data(), dictionary_content.size(), samples.data(),
+      1024, samples.data(), sample_sizes.data(), sample_sizes.size(), params);
+  ASSERT_FALSE(ZDICT_isError(dictionary_size));
+  dictionary_content.resize(dictionary_size);
+  ZstdDictionaryStore dictionaries;
+  ASSERT_TRUE(dictionaries.Update(dictionary_content, 1).ok());
+
+  EXPECT_CALL(mock_udf_client_, ExecuteCodeWithJsonArgumentsAsync(_, _, _))
+      .Times(2)
+      .WillRepeatedly(CompleteUdfWith(R"({"keyGroupOutputs": []})"));
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_,
+                             &CompressionGroupConcatenator::Create,
+                             /*partition_result_cache=*/nullptr,
+                             &dictionaries);
+  // Clients holding another dictionary get responses compressed without it.
+  for (const auto& [dictionary_id, compression_type, content_dictionary_id] :
+       std::vector<std::tuple<std::string,
+                              CompressionGroupConcatenator::CompressionType,
+                              std::optional<std::string>>>{
+           {"42",
+            CompressionGroupConcatenator::CompressionType::kZstdWithDictionary,
+            "42"},
+           {"7", CompressionGroupConcatenator::CompressionType::kZstd,
+            std::nullopt},
+       }) {
+    quiche::BinaryHttpRequest bhttp_request({});
+    bhttp_request.AddHeaderField({"Accept-Encoding", "br, zstd"});
+    bhttp_request.AddHeaderField({"Available-Dictionary-Id", dictionary_id});
+    bhttp_request.set_body(R"({
+      "partitions": [
+        {"id": 0, "compressionGroupId": 0,
+         "arguments": [{"data": ["key0"]}]},
+        {"id": 1, "compressionGroupId": 1,
+         "arguments": [{"data": ["key1"]}]}
+      ]
+    })");
+    auto maybe_serialized_request = bhttp_request.Serialize();
+    ASSERT_TRUE(maybe_serialized_request.ok());
+    BinaryHttpGetValuesRequest request;
+    request.mutable_raw_body()->set_data(*maybe_serialized_request);
+    google::api::HttpBody response;
+    ASSERT_TRUE(handler.BinaryHttpGetValues(request, &response).ok());
+
+    const auto maybe_bhttp_response =
+        quiche::BinaryHttpResponse::Create(response.data());
+    ASSERT_TRUE(maybe_bhttp_response.ok());
+    EXPECT_EQ(GetHeader(*maybe_bhttp_response, "content-encoding"), "zstd");
+    EXPECT_EQ(GetHeader(*maybe_bhttp_response, "content-dictionary-id"),
+              content_dictionary_id)
+        << dictionary_id;
+    v2::GetValuesResponse resp;
+    ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(
+                    std::string(maybe_bhttp_response->body()), &resp)
+                    .ok());
+    const auto groups =
+        ExtractCompressionGroups(resp, compression_type,
+                                 dictionaries.Get().get());
+    ASSERT_EQ(groups.size(), 2) << dictionary_id;
+    EXPECT_EQ(groups[0].partitions(0).id(), 0);
+    EXPECT_EQ(groups[1].partitions(0).id(), 1);
+  }
+}
+
+TEST_F(GetValuesHandlerTest, PureGRPCAsyncTest) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 9
+             arguments { data { string_value: "ECHO" } }
+           })pb",
+      &req);
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  UdfClient::ExecuteCodeCallback udf_callback;
+  EXPECT_CALL(mock_udf_client_,
+              ExecuteCodeAsync(_,
+                               testing::ElementsAre(
+                                   EqualsProto(req.partitions(0).arguments(0))),
+                               _))
+      .WillOnce([&udf_callback](UDFExecutionMetadata&&,
+                                const google::protobuf::RepeatedPtrField<
+                                    UDFArgument>&,
+                                UdfClient::ExecuteCodeCallback on_done) {
+        udf_callback = std::move(on_done);
+      });
+  v2::GetValuesResponse resp;
+  std::optional<grpc::Status> result;
+  handler.GetValuesAsync(req, &resp,
+                         [&result](grpc::Status status) { result = status; });
+  // Nothing is waiting for the UDF until it calls back.
+  EXPECT_FALSE(result.has_value());
+  std::move(udf_callback)("ECHO");
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->ok()) << "code: " << result->error_code()
+                            << ", msg: " << result->error_message();
+
+  v2::GetValuesResponse res;
+  TextFormat::ParseFromString(
+      R"pb(single_partition { id: 9 string_output: "ECHO" })pb", &res);
+  EXPECT_THAT(resp, EqualsProto(res));
+}
+
+TEST_F(GetValuesHandlerTest, PureGRPCAsyncMultiplePartitions) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 0
+             arguments { data { string_value: "key0" } }
+           }
+           partitions {
+             id: 1
+             arguments { data { string_value: "key1" } }
+           })pb",
+      &req);
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  std::vector<UdfClient::ExecuteCodeCallback> udf_callbacks;
+  EXPECT_CALL(mock_udf_client_, ExecuteCodeAsync(_, _, _))
+      .Times(2)
+      .WillRepeatedly([&udf_callbacks](
+                          UDFExecutionMetadata&&,
+                          const google::protobuf::RepeatedPtrField<
+                              UDFArgument>&,
+                          UdfClient::ExecuteCodeCallback on_done) {
+        udf_callbacks.push_back(std::move(on_done));
+      });
+  v2::GetValuesResponse resp;
+  std::optional<grpc::Status> result;
+  handler.GetValuesAsync(req, &resp,
+                         [&result](grpc::Status status) { result = status; });
+  ASSERT_EQ(udf_callbacks.size(), 2);
+  // Completes in reverse order, the response is only done after the last one.
+  std::move(udf_callbacks[1])(absl::InternalError("UDF execution error"));
+  EXPECT_FALSE(result.has_value());
+  std::move(udf_callbacks[0])(R"({"keyGroupOutputs": []})");
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->ok()) << "code: " << result->error_code()
+                            << ", msg: " << result->error_message();
+
+  const auto groups = ExtractCompressionGroups(
+      resp, CompressionGroupConcatenator::CompressionType::kUncompressed);
+  ASSERT_EQ(groups.size(), 1);
+  V2CompressionGroup expected_group;
+  TextFormat::ParseFromString(R"pb(partitions { id: 0 }
+                                   partitions { id: 1 })pb",
+                              &expected_group);
+  EXPECT_THAT(groups[0], EqualsProto(expected_group));
+}
+
+TEST_P(GetValuesHandlerTest, AsyncFinishesFromUdfCallback) {
+  UdfClient::ExecuteCodeCallback udf_callback;
+  EXPECT_CALL(mock_udf_client_, ExecuteCodeWithJsonArgumentsAsync(_, _, _))
+      .WillOnce([&udf_callback](std::string_view, std::vector<std::string>,
+                                UdfClient::ExecuteCodeCallback on_done) {
+        udf_callback = std::move(on_done);
+      });
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_);
+  PlainRequest plain_request(R"({
+    "partitions": [
+      {"id": 9, "compressionGroupId": 0, "arguments": [{"data": ["ECHO"]}]}
+    ]
+  })");
+  BHTTPRequest bhttp_request(plain_request);
+  auto [ohttp_request, response_unwrapper] =
+      OHTTPRequest(bhttp_request).Build();
+  google::api::HttpBody response;
+  std::optional<grpc::Status> result;
+  auto on_done = [&result](grpc::Status status) { result = status; };
+  if (IsUsing<ProtocolType::kPlain>()) {
+    handler.GetValuesHttpAsync(plain_request.Build(), &response, on_done);
+  } else if (IsUsing<ProtocolType::kBinaryHttp>()) {
+    handler.BinaryHttpGetValuesAsync(bhttp_request.Build(), &response,
+                                     on_done);
+  } else {
+    handler.ObliviousGetValuesAsync(ohttp_request, &response, on_done);
+  }
+  // Nothing is waiting for the UDF until it calls back.
+  EXPECT_FALSE(result.has_value());
+  ASSERT_TRUE(udf_callback);
+  std::move(udf_callback)("ECHO");
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->ok()) << "code: " << result->error_code()
+                            << ", msg: " << result->error_message();
+
+  std::string response_body = response.data();
+  if (!IsUsing<ProtocolType::kPlain>()) {
+    BHTTPResponse bhttp_response;
+    if (IsUsing<ProtocolType::kBinaryHttp>()) {
+      bhttp_response.RawResponse() = response;
+    } else {
+      response_unwrapper.RawResponse() = response;
+      bhttp_response = response_unwrapper.Unwrap();
+    }
+    ASSERT_EQ(bhttp_response.ResponseCode(), 200);
+    response_body = bhttp_response.Unwrap();
+  }
+  v2::GetValuesResponse actual_response, expected_response;
+  TextFormat::ParseFromString(
+      R"pb(single_partition { id: 9 string_output: "ECHO" })pb",
+      &expected_response);
+  ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(response_body,
+                                                          &actual_response)
+                  .ok());
+  EXPECT_THAT(actual_response, EqualsProto(expected_response));
+}
+
+TEST_F(GetValuesHandlerTest, PartitionResultCacheServesRepeatedPartitions) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 9
+             arguments { data { string_value: "ECHO" } }
+           })pb",
+      &req);
+  PartitionResultCache partition_result_cache({});
+  GetValuesV2Handler handler(mock_udf_client_, mock_metrics_recorder_,
+                             fake_key_fetcher_manager_,
+                             &CompressionGroupConcatenator::Create,
+                             &partition_result_cache);
+  // Failures are not cached, invalidation drops the cached output.
+  EXPECT_CALL(mock_udf_client_, ExecuteCode(_, _))
+      .WillOnce(Return(absl::InternalError("UDF execution error")))
+      .WillOnce(Return("ECHO"))
+      .WillOnce(Return("ECHO2"));
+  v2::GetValuesResponse resp;
+  ASSERT_TRUE(handler.GetValues(req, &resp).ok());
+  EXPECT_TRUE(resp.single_partition().has_status());
+  for (int i = 0; i < 3; ++i) {
+    resp.Clear();
+    ASSERT_TRUE(handler.GetValues(req, &resp).ok());
+    EXPECT_EQ(resp.single_partition().string_output(), "ECHO");
+  }
+  // Partition ids are not part of the key.
+  req.mutable_partitions(0)->set_id(10);
+  resp.Clear();
+  ASSERT_TRUE(handler.GetValues(req, &resp).ok());
+  v2::GetValuesResponse res;
+  TextFormat::ParseFromString(
+      R"pb(single_partition { id: 10 string_output: "ECHO" })pb", &res);
+  EXPECT_THAT(resp, EqualsProto(res));
+
+  partition_result_cache.Invalidate();
+  resp.Clear();
+  ASSERT_TRUE(handler.GetValues(req, &resp).ok());
+  EXPECT_EQ(resp.single_partition().string_output(), "ECHO2");
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,438 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/get_values_v2_json.h"
+
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "google/protobuf/util/json_util.h"
+#include "nlohmann/json.hpp"
+
+namespace kv_server {
+namespace {
+
+using Json = nlohmann::json;
+
+// The proto JSON parser stores numbers of `google.protobuf.Value` as doubles,
+// so larger integers would not round trip. Such requests take the slow path.
+constexpr int64_t kMaxExactInteger = int64_t{1} << 53;
+
+void AppendJsonString(std::string_view value, std::string& output) {
+  output.push_back('"');
+  for (const char c : value) {
+    switch (c) {
+      case '"':
+        output.append("\\\"");
+        break;
+      case '\\':
+        output.append("\\\\");
+        break;
+      case '\b':
+        output.append("\\b");
+        break;
+      case '\f':
+        output.append("\\f");
+        break;
+      case '\n':
+        output.append("\\n");
+        break;
+      case '\r':
+        output.append("\\r");
+        break;
+      case '\t':
+        output.append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&output, "\\u%04x", static_cast<int>(c));
+        } else {
+          output.push_back(c);
+        }
+    }
+  }
+  output.push_back('"');
+}
+
+// Walks the SAX events of a v2 request. Fields that are only inspected
+// (partition ids) are decoded in place. Values that are handed to the UDF
+// (metadata, argument tags and data) are re-emitted verbatim as compact JSON
+// into their destination string while they are being parsed.
+class GetValuesRequestSaxHandler : public nlohmann::json_sax<Json> {
+ public:
+  explicit GetValuesRequestSaxHandler(JsonGetValuesRequest& request)
+      : request_(request) {}
+
+  bool null() override { return OnScalar("null"); }
+
+  bool boolean(bool val) override { return OnScalar(val ? "true" : "false"); }
+
+  bool number_integer(number_integer_t val) override {
+    if (val > kMaxExactInteger || val < -kMaxExactInteger) {
+      return false;
+    }
+    return OnInteger(val);
+  }
+
+  bool number_unsigned(number_unsigned_t val) override {
+    if (val > kMaxExactInteger) {
+      return false;
+    }
+    return OnInteger(static_cast<int64_t>(val));
+  }
+
+  bool number_float(number_float_t val, const string_t& raw) override {
+    return OnScalar(raw);
+  }
+
+  bool string(string_t& val) override {
+    if (capture_ == nullptr) {
+      if (expected_ == Field::kClientVersion) {
+        expected_ = Field::kNone;
+        return true;
+      }
+      if (!BeginCapture(ValueKind::kScalar)) {
+        return false;
+      }
+    }
+    MaybeAppendComma();
+    AppendJsonString(val, *capture_);
+    EndValue();
+    return true;
+  }
+
+  bool binary(binary_t& val) override { return false; }
+
+  bool start_object(std::size_t elements) override {
+    if (capture_ != nullptr || BeginCapture(ValueKind::kObject)) {
+      Open('{');
+      return true;
+    }
+    if (expected_ != Field::kNone) {
+      return false;
+    }
+    if (contexts_.empty()) {
+      contexts_.push_back(Context::kRoot);
+      return true;
+    }
+    if (contexts_.back() == Context::kPartitions) {
+      contexts_.push_back(Context::kPartition);
+      request_.partitions.emplace_back();
+      return true;
+    }
+    if (contexts_.back() == Context::kArguments) {
+      contexts_.push_back(Context::kArgument);
+      tags_.clear();
+      data_.clear();
+      return true;
+    }
+    return false;
+  }
+
+  bool key(string_t& val) override {
+    if (capture_ != nullptr) {
+      MaybeAppendComma();
+      AppendJsonString(val, *capture_);
+      capture_->push_back(':');
+      need_comma_ = false;
+      return true;
+    }
+    if (expected_ != Field::kNone || contexts_.empty()) {
+      return false;
+    }
+    switch (contexts_.back()) {
+      case Context::kRoot:
+        if (val == "metadata") {
+          expected_ = Field::kMetadata;
+        } else if (val == "partitions") {
+          expected_ = Field::kPartitions;
+        } else if (val == "clientVersion" || val == "client_version") {
+          expected_ = Field::kClientVersion;
+        }
+        break;
+      case Context::kPartition:
+        if (val == "id") {
+          expected_ = Field::kId;
+        } else if (val == "compressionGroupId" ||
+                   val == "compression_group_id") {
+          expected_ = Field::kCompressionGroupId;
+        } else if (val == "arguments") {
+          expected_ = Field::kArguments;
+        }
+        break;
+      case Context::kArgument:
+        if (val == "tags") {
+          expected_ = Field::kTags;
+        } else if (val == "data") {
+          expected_ = Field::kData;
+        }
+        break;
+      default:
+        break;
+    }
+    // Unknown fields are rejected by the proto parser as well.
+    return expected_ != Field::kNone;
+  }
+
+  bool end_object() override {
+    if (capture_ != nullptr) {
+      Close('}');
+      return true;
+    }
+    if (contexts_.empty()) {
+      return false;
+    }
+    const Context context = contexts_.back();
+    contexts_.pop_back();
+    if (context == Context::kArgument) {
+      return FinishArgument();
+    }
+    return context == Context::kPartition || context == Context::kRoot;
+  }
+
+  bool start_array(std::size_t elements) override {
+    if (capture_ != nullptr || BeginCapture(ValueKind::kArray)) {
+      Open('[');
+      return true;
+    }
+    if (expected_ == Field::kPartitions) {
+      contexts_.push_back(Context::kPartitions);
+    } else if (expected_ == Field::kArguments) {
+      contexts_.push_back(Context::kArguments);
+    } else {
+      return false;
+    }
+    expected_ = Field::kNone;
+    return true;
+  }
+
+  bool end_array() override {
+    if (capture_ != nullptr) {
+      Close(']');
+      return true;
+    }
+    if (contexts_.empty() || (contexts_.back() != Context::kPartitions &&
+                              contexts_.back() != Context::kArguments)) {
+      return false;
+    }
+    contexts_.pop_back();
+    return true;
+  }
+
+  bool parse_error(std::size_t position, const std::string& last_token,
+                   const nlohmann::detail::exception& ex) override {
+    return false;
+  }
+
+ private:
+  enum class Context { kRoot, kPartitions, kPartition, kArguments, kArgument };
+  enum class Field {
+    kNone,
+    kMetadata,
+    kClientVersion,
+    kPartitions,
+    kId,
+    kCompressionGroupId,
+    kArguments,
+    kTags,
+    kData,
+  };
+  enum class ValueKind { kScalar, kObject, kArray };
+
+  bool OnInteger(int64_t val) {
+    if (capture_ == nullptr &&
+        (expected_ == Field::kId || expected_ == Field::kCompressionGroupId)) {
+      if (val > std::numeric_limits<int32_t>::max() ||
+          val < std::numeric_limits<int32_t>::min()) {
+        return false;
+      }
+      JsonRequestPartition& partition = request_.partitions.back();
+      if (expected_ == Field::kId) {
+        partition.id = static_cast<int32_t>(val);
+      } else {
+        partition.compression_group_id = static_cast<int32_t>(val);
+      }
+      expected_ = Field::kNone;
+      return true;
+    }
+    return OnScalar(absl::StrCat(val));
+  }
+
+  bool OnScalar(std::string_view token) {
+    if (capture_ == nullptr && !BeginCapture(ValueKind::kScalar)) {
+      return false;
+    }
+    MaybeAppendComma();
+    capture_->append(token);
+    EndValue();
+    return true;
+  }
+
+  // Starts copying the value of the expected field. Metadata must be an
+  // object and tags must be a list.
+  bool BeginCapture(ValueKind kind) {
+    if (expected_ == Field::kMetadata && kind == ValueKind::kObject) {
+      capture_ = &request_.metadata;
+    } else if (expected_ == Field::kTags && kind == ValueKind::kArray) {
+      capture_ = &tags_;
+    } else if (expected_ == Field::kData) {
+      capture_ = &data_;
+    } else {
+      return false;
+    }
+    capture_->clear();
+    depth_ = 0;
+    need_comma_ = false;
+    return true;
+  }
+
+  void MaybeAppendComma() {
+    if (need_comma_) {
+      capture_->push_back(',');
+    }
+  }
+
+  void Open(char bracket) {
+    MaybeAppendComma();
+    capture_->push_back(bracket);
+    ++depth_;
+    need_comma_ = false;
+  }
+
+  void Close(char bracket) {
+    capture_->push_back(bracket);
+    --depth_;
+    EndValue();
+  }
+
+  // Marks the end of one value, which ends the capture if it was top level.
+  void EndValue() {
+    need_comma_ = true;
+    if (depth_ == 0) {
+      capture_ = nullptr;
+      expected_ = Field::kNone;
+    }
+  }
+
+  // Builds the JSON form of UDFArgument that UdfClient passes to the UDF:
+  // only the data if there are no tags, the whole argument otherwise.
+  bool FinishArgument() {
+    std::vector<std::string>& arguments =
+        request_.partitions.back().udf_arguments;
+    if (tags_.empty() || tags_ == "[]") {
+      if (data_.empty()) {
+        return false;
+      }
+      arguments.push_back(std::move(data_));
+    } else if (data_.empty()) {
+      arguments.push_back(absl::StrCat(R"({"tags":)", tags_, "}"));
+    } else {
+      arguments.push_back(
+          absl::StrCat(R"({"tags":)", tags_, R"(,"data":)", data_, "}"));
+    }
+    tags_.clear();
+    data_.clear();
+    return true;
+  }
+
+  JsonGetValuesRequest& request_;
+  std::vector<Context> contexts_;
+  Field expected_ = Field::kNone;
+  // Destination of the value being copied, if any.
+  std::string* capture_ = nullptr;
+  int depth_ = 0;
+  bool need_comma_ = false;
+  std::string tags_;
+  std::string data_;
+};
+
+void AppendPartitionJson(const v2::ResponsePartition& partition,
+                         std::string& output) {
+  output.push_back('{');
+  bool has_field = false;
+  if (partition.id() != 0) {
+    absl::StrAppend(&output, R"("id":)", partition.id());
+    has_field = true;
+  }
+  if (partition.has_string_output()) {
+    absl::StrAppend(&output, has_field ? "," : "", R"("stringOutput":)");
+    AppendJsonString(partition.string_output(), output);
+  } else if (partition.has_status()) {
+    absl::StrAppend(&output, has_field ? "," : "", R"("status":{)");
+    const auto& status = partition.status();
+    if (status.code() != 0) {
+      absl::StrAppend(&output, R"("code":)", status.code());
+    }
+    if (!status.message().empty()) {
+      absl::StrAppend(&output, status.code() != 0 ? "," : "",
+                      R"("message":)");
+      AppendJsonString(status.message(), output);
+    }
+    output.push_back('}');
+  }
+  output.push_back('}');
+}
+
+}  // namespace
+
+absl::StatusOr<JsonGetValuesRequest> ParseGetValuesRequestJson(
+    std::string_view json) {
+  JsonGetValuesRequest request;
+  GetValuesRequestSaxHandler handler(request);
+  if (!Json::sax_parse(json.begin(), json.end(), &handler)) {
+    return absl::InvalidArgumentError(
+        "Request is not a canonical JSON v2 request");
+  }
+  return request;
+}
+
+std::string GetValuesResponseToJson(const v2::GetValuesResponse& response) {
+  std::string output;
+  if (response.has_single_partition()) {
+    if (response.single_partition().status().details_size() > 0) {
+      // Status details are `Any` messages, which only the proto printer can
+      // resolve.
+      google::protobuf::util::MessageToJsonString(response, &output)
+          .IgnoreError();
+      return output;
+    }
+    output.append(R"({"singlePartition":)");
+    AppendPartitionJson(response.single_partition(), output);
+    output.push_back('}');
+  } else if (response.has_compressed_partition_groups()) {
+    output.append(R"({"compressedPartitionGroups":{)");
+    const auto& groups =
+        response.compressed_partition_groups().compressed_partition_groups();
+    if (!groups.empty()) {
+      output.append(R"("compressedPartitionGroups":[)");
+      for (int i = 0; i < groups.size(); ++i) {
+        absl::StrAppend(&output, i > 0 ? "," : "", "\"",
+                        absl::Base64Escape(groups[i]), "\"");
+      }
+      output.push_back(']');
+    }
+    output.append("}}");
+  } else {
+    output.append("{}");
+  }
+  return output;
+}
+
+}  // namespace kv_server
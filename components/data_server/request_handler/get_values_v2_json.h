@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_GET_VALUES_V2_JSON_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_GET_VALUES_V2_JSON_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "public/query/v2/get_values_v2.pb.h"
+
+namespace kv_server {
+
+// One partition of a JSON v2 request, with every UDF argument already in the
+// JSON form that is passed to the UDF.
+struct JsonRequestPartition {
+  int32_t id = 0;
+  int32_t compression_group_id = 0;
+  std::vector<std::string> udf_arguments;
+};
+
+// A JSON v2 request decoded without going through `v2::GetValuesRequest`.
+struct JsonGetValuesRequest {
+  // JSON object of the request metadata. Empty if the request has none.
+  std::string metadata;
+  std::vector<JsonRequestPartition> partitions;
+};
+
+// Parses a JSON v2 request in one streaming pass, copying the metadata and
+// the UDF arguments out of the request as JSON strings.
+//
+// Only canonical requests are accepted. Returns an error for anything the
+// parser does not understand (unknown fields, non-integer ids, trailing
+// commas, ...), in which case callers should fall back to
+// `JsonStringToMessage`, which is more lenient.
+absl::StatusOr<JsonGetValuesRequest> ParseGetValuesRequestJson(
+    std::string_view json);
+
+// Serializes the response to its proto3 JSON form without going through the
+// proto JSON printer.
+std::string GetValuesResponseToJson(const v2::GetValuesResponse& response);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_GET_VALUES_V2_JSON_H_
@@ -0,0 +1,110 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/get_values_v2_json.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "google/protobuf/util/json_util.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using testing::ElementsAre;
+
+TEST(ParseGetValuesRequestJsonTest, ParsesPartitionsAndArguments) {
+  const auto maybe_request = ParseGetValuesRequestJson(R"(
+{
+  "clientVersion": "v1",
+  "metadata": {"hostname": "example.com", "n": [1, 2.5, true, null]},
+  "partitions": [
+    {
+      "id": 1,
+      "compressionGroupId": 2,
+      "arguments": [
+        {"tags": ["custom", "keys"], "data": ["key1", "ke\"y2"]},
+        {"data": {"a": 1}},
+        {"tags": [], "data": "plain"}
+      ]
+    },
+    {"id": 3, "arguments": []}
+  ]
+})");
+  ASSERT_TRUE(maybe_request.ok()) << maybe_request.status();
+  const JsonGetValuesRequest& request = *maybe_request;
+  EXPECT_EQ(request.metadata,
+            R"({"hostname":"example.com","n":[1,2.5,true,null]})");
+  ASSERT_EQ(request.partitions.size(), 2);
+  EXPECT_EQ(request.partitions[0].id, 1);
+  EXPECT_EQ(request.partitions[0].compression_group_id, 2);
+  EXPECT_THAT(
+      request.partitions[0].udf_arguments,
+      ElementsAre(R"({"tags":["custom","keys"],"data":["key1","ke\"y2"]})",
+                  R"({"a":1})", R"("plain")"));
+  EXPECT_EQ(request.partitions[1].id, 3);
+  EXPECT_EQ(request.partitions[1].compression_group_id, 0);
+  EXPECT_TRUE(request.partitions[1].udf_arguments.empty());
+}
+
+TEST(ParseGetValuesRequestJsonTest, NoMetadata) {
+  const auto maybe_request =
+      ParseGetValuesRequestJson(R"({"partitions": [{"id": 0}]})");
+  ASSERT_TRUE(maybe_request.ok()) << maybe_request.status();
+  EXPECT_TRUE(maybe_request->metadata.empty());
+  EXPECT_EQ(maybe_request->partitions.size(), 1);
+}
+
+TEST(ParseGetValuesRequestJsonTest, RejectsNonCanonicalRequests) {
+  for (const auto* json : {
+           R"({"partitions": [{"id": 0,}]})",
+           R"({"partitions": [{"id": "0"}]})",
+           R"({"partitions": [{"id": 1.5}]})",
+           R"({"partitions": [{"unknown": 0}]})",
+           R"({"metadata": []})",
+           R"({"partitions": [{"arguments": [{"tags": "custom"}]}]})",
+           R"({"partitions": [{"arguments": [{"data": 9007199254740993}]}]})",
+           R"({"partitions": [{"id": 4294967296}]})",
+       }) {
+    EXPECT_FALSE(ParseGetValuesRequestJson(json).ok()) << json;
+  }
+}
+
+TEST(GetValuesResponseToJsonTest, MatchesProtoJson) {
+  for (const auto* text_proto : {
+           R"pb(single_partition { id: 9 string_output: "{\"a\":\"\n\"}" })pb",
+           R"pb(single_partition {
+                  status: { code: 13 message: "UDF execution error" }
+                })pb",
+           R"pb(compressed_partition_groups {
+                  compressed_partition_groups: "\x00\x01group"
+                  compressed_partition_groups: ""
+                })pb",
+           "",
+       }) {
+    v2::GetValuesResponse response;
+    ASSERT_TRUE(TextFormat::ParseFromString(text_proto, &response));
+    std::string expected_json;
+    ASSERT_TRUE(google::protobuf::util::MessageToJsonString(response,
+                                                            &expected_json)
+                    .ok());
+    EXPECT_EQ(GetValuesResponseToJson(response), expected_json);
+  }
+}
+
+}  // namespace
+}  // namespace kv_server
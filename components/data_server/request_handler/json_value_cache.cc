@@ -0,0 +1,78 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/json_value_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "google/protobuf/util/json_util.h"
+
+namespace kv_server {
+
+google::protobuf::Value ParseJsonValue(std::string value) {
+  google::protobuf::Value value_proto;
+  if (!google::protobuf::util::JsonStringToMessage(value, &value_proto).ok()) {
+    // If string is not a Json string that can be parsed into Value proto,
+    // simply set it as pure string value to the response.
+    value_proto.set_string_value(std::move(value));
+  }
+  return value_proto;
+}
+
+JsonValueCache::JsonValueCache(int64_t max_bytes)
+    : max_shard_bytes_(max_bytes / kNumShards) {}
+
+google::protobuf::Value JsonValueCache::ToValue(std::string value) {
+  Shard& shard = shards_[absl::HashOf(value) % kNumShards];
+  std::shared_ptr<const google::protobuf::Value> cached_value;
+  {
+    absl::MutexLock lock(&shard.mu);
+    if (const auto it = shard.values.find(value); it != shard.values.end()) {
+      cached_value = it->second;
+    }
+  }
+  // Copying the parsed value is much cheaper than parsing it again.
+  if (cached_value != nullptr) {
+    return *cached_value;
+  }
+
+  auto parsed_value =
+      std::make_shared<const google::protobuf::Value>(ParseJsonValue(value));
+  const int64_t entry_size = value.size() + parsed_value->SpaceUsedLong();
+  if (entry_size > max_shard_bytes_) {
+    return *parsed_value;
+  }
+  absl::MutexLock lock(&shard.mu);
+  if (shard.size_bytes + entry_size > max_shard_bytes_) {
+    shard.values.clear();
+    shard.size_bytes = 0;
+  }
+  if (shard.values.try_emplace(std::move(value), parsed_value).second) {
+    shard.size_bytes += entry_size;
+  }
+  return *parsed_value;
+}
+
+google::protobuf::Value ParseJsonValue(std::string value,
+                                       JsonValueCache* json_value_cache) {
+  if (json_value_cache == nullptr) {
+    return ParseJsonValue(std::move(value));
+  }
+  return json_value_cache->ToValue(std::move(value));
+}
+
+}  // namespace kv_server
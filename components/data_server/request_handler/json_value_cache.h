@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_JSON_VALUE_CACHE_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_JSON_VALUE_CACHE_H_
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/struct.pb.h"
+
+namespace kv_server {
+
+// Converts a value returned to v1 clients into a `google::protobuf::Value`:
+// values holding JSON are parsed, other values are returned as strings.
+google::protobuf::Value ParseJsonValue(std::string value);
+
+// Memory bounded cache of `ParseJsonValue` results, keyed by the value itself.
+// Values only change when data is reloaded, so the same values are parsed
+// over and over by v1 requests. Keying by content means entries never go
+// stale, no invalidation is needed.
+//
+// The cache is split in shards to reduce lock contention. A shard that runs
+// out of memory is cleared, hot values are parsed again by the next requests.
+//
+// Thread safe.
+class JsonValueCache {
+ public:
+  explicit JsonValueCache(int64_t max_bytes);
+
+  JsonValueCache(const JsonValueCache&) = delete;
+  JsonValueCache& operator=(const JsonValueCache&) = delete;
+
+  // Same as `ParseJsonValue(value)`.
+  google::protobuf::Value ToValue(std::string value);
+
+ private:
+  static constexpr int kNumShards = 16;
+
+  struct Shard {
+    absl::Mutex mu;
+    absl::flat_hash_map<std::string,
+                        std::shared_ptr<const google::protobuf::Value>>
+        values ABSL_GUARDED_BY(mu);
+    int64_t size_bytes ABSL_GUARDED_BY(mu) = 0;
+  };
+
+  const int64_t max_shard_bytes_;
+  std::array<Shard, kNumShards> shards_;
+};
+
+// Uses `json_value_cache` if it is not null.
+google::protobuf::Value ParseJsonValue(std::string value,
+                                       JsonValueCache* json_value_cache);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_JSON_VALUE_CACHE_H_
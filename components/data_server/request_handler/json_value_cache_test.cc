@@ -0,0 +1,72 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/json_value_cache.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using google::protobuf::Value;
+
+TEST(ParseJsonValueTest, ParsesJsonAndKeepsOtherStrings) {
+  Value expected;
+  TextFormat::ParseFromString(R"pb(list_value {
+                                     values { number_value: 1 }
+                                     values { string_value: "a" }
+                                   })pb",
+                              &expected);
+  EXPECT_THAT(ParseJsonValue(R"([1, "a"])"), EqualsProto(expected));
+  TextFormat::ParseFromString(R"pb(string_value: "not json")pb", &expected);
+  EXPECT_THAT(ParseJsonValue("not json"), EqualsProto(expected));
+}
+
+TEST(JsonValueCacheTest, MatchesParseJsonValue) {
+  JsonValueCache cache(1 << 20);
+  for (int i = 0; i < 2; ++i) {
+    for (const auto* value :
+         {R"({"a": [true, null]})", "not json", R"("quoted")", ""}) {
+      EXPECT_THAT(cache.ToValue(value), EqualsProto(ParseJsonValue(value)))
+          << value;
+    }
+  }
+}
+
+TEST(JsonValueCacheTest, StaysCorrectWhenFull) {
+  // Small enough that every shard is cleared repeatedly.
+  JsonValueCache cache(/*max_bytes=*/1024);
+  for (int i = 0; i < 1000; ++i) {
+    const std::string value = absl::StrCat(R"({"n": )", i % 100, "}");
+    Value expected;
+    (*expected.mutable_struct_value()->mutable_fields())["n"].set_number_value(
+        i % 100);
+    EXPECT_THAT(cache.ToValue(value), EqualsProto(expected));
+  }
+}
+
+TEST(JsonValueCacheTest, WorksWithoutCache) {
+  EXPECT_THAT(ParseJsonValue("[]", /*json_value_cache=*/nullptr),
+              EqualsProto(ParseJsonValue("[]")));
+}
+
+}  // namespace
+}  // namespace kv_server
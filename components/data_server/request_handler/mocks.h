@@ -30,6 +30,11 @@ class MockGetValuesAdapter : public GetValuesAdapter {
               (const v1::GetValuesRequest& v1_request,
                v1::GetValuesResponse& v1_response),
               (const, override));
+  MOCK_METHOD(void, CallV2HandlerAsync,
+              (const v1::GetValuesRequest& v1_request,
+               v1::GetValuesResponse& v1_response,
+               absl::AnyInvocable<void(grpc::Status) &&> on_done),
+              (const, override));
 };
 
 }  // namespace kv_server
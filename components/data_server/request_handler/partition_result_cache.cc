@@ -0,0 +1,153 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/partition_result_cache.h"
+
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+
+namespace kv_server {
+namespace {
+
+// Accounts for the list node and the index slot of an entry.
+constexpr int64_t kEntryOverheadBytes = 64;
+
+// Every field is length prefixed so that different field splits never map to
+// the same key.
+void AppendField(std::string_view field, std::string& key) {
+  absl::StrAppend(&key, field.size(), ":", field);
+}
+
+void AppendDeterministic(const google::protobuf::Message& message,
+                         std::string& key) {
+  std::string serialized;
+  {
+    google::protobuf::io::StringOutputStream stream(&serialized);
+    google::protobuf::io::CodedOutputStream coded_stream(&stream);
+    coded_stream.SetSerializationDeterministic(true);
+    message.SerializeToCodedStream(&coded_stream);
+  }
+  AppendField(serialized, key);
+}
+
+}  // namespace
+
+PartitionResultCache::PartitionResultCache(Options options)
+    : options_(std::move(options)) {}
+
+std::string PartitionResultCache::MakeKey(
+    const google::protobuf::Struct& metadata,
+    const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) {
+  // Proto and JSON keys have different prefixes since the same request has
+  // different keys in both forms.
+  std::string key = "p";
+  AppendDeterministic(metadata, key);
+  for (const auto& argument : arguments) {
+    AppendDeterministic(argument, key);
+  }
+  return key;
+}
+
+std::string PartitionResultCache::MakeKey(
+    std::string_view json_metadata,
+    const std::vector<std::string>& json_arguments) {
+  std::string key = "j";
+  AppendField(json_metadata, key);
+  for (const auto& argument : json_arguments) {
+    AppendField(argument, key);
+  }
+  return key;
+}
+
+std::optional<std::string> PartitionResultCache::Get(std::string_view key) {
+  absl::MutexLock lock(&mu_);
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    return std::nullopt;
+  }
+  const auto entry = it->second;
+  if (entry->data_version < CurrentDataVersion() ||
+      absl::Now() - entry->insert_time > options_.max_age) {
+    EraseLocked(entry);
+    return std::nullopt;
+  }
+  entries_.splice(entries_.begin(), entries_, entry);
+  return entry->output;
+}
+
+PartitionResultCache::Version PartitionResultCache::version() const {
+  const int64_t data_version = CurrentDataVersion();
+  absl::MutexLock lock(&mu_);
+  return Version{.generation = generation_, .data_version = data_version};
+}
+
+void PartitionResultCache::Put(std::string key, std::string output,
+                               Version version) {
+  if (version.data_version < CurrentDataVersion()) {
+    return;
+  }
+  Entry new_entry{.key = std::move(key),
+                  .output = std::move(output),
+                  .insert_time = absl::Now(),
+                  .data_version = version.data_version};
+  const int64_t new_entry_size = EntrySize(new_entry);
+  if (new_entry_size > options_.max_bytes) {
+    return;
+  }
+  absl::MutexLock lock(&mu_);
+  if (version.generation != generation_) {
+    return;
+  }
+  if (const auto it = index_.find(new_entry.key); it != index_.end()) {
+    EraseLocked(it->second);
+  }
+  while (size_bytes_ + new_entry_size > options_.max_bytes) {
+    EraseLocked(std::prev(entries_.end()));
+  }
+  entries_.push_front(std::move(new_entry));
+  index_.emplace(entries_.front().key, entries_.begin());
+  size_bytes_ += new_entry_size;
+}
+
+void PartitionResultCache::Invalidate() {
+  absl::MutexLock lock(&mu_);
+  ++generation_;
+  index_.clear();
+  entries_.clear();
+  size_bytes_ = 0;
+}
+
+int64_t PartitionResultCache::EntrySize(const Entry& entry) {
+  return entry.key.size() + entry.output.size() + kEntryOverheadBytes;
+}
+
+int64_t PartitionResultCache::CurrentDataVersion() const {
+  return options_.data_version == nullptr
+             ? 0
+             : options_.data_version->load(std::memory_order_relaxed);
+}
+
+void PartitionResultCache::EraseLocked(std::list<Entry>::iterator it) {
+  size_bytes_ -= EntrySize(*it);
+  index_.erase(it->key);
+  entries_.erase(it);
+}
+
+}  // namespace kv_server
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_PARTITION_RESULT_CACHE_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_PARTITION_RESULT_CACHE_H_
+
+#include <atomic>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "google/protobuf/struct.pb.h"
+#include "public/api_schema.pb.h"
+
+namespace kv_server {
+
+// Memory bounded LRU cache of UDF outputs, keyed by everything the UDF sees
+// for one v2 partition: the request metadata and the UDF arguments. The
+// partition and compression group ids are not part of the key.
+//
+// UDF outputs depend on the UDF code and on the data it looks up. Each entry
+// records the `data_version` it was computed at and is a miss once the
+// version moves on, which takes one atomic read instead of flushing the cache
+// on every update. `Invalidate` must be called whenever the UDF code changes.
+// Lookups served by other shards are not observed by this server, so
+// `max_age` bounds how stale such data can get.
+//
+// Thread safe.
+class PartitionResultCache {
+ public:
+  struct Options {
+    // Upper bound of the size of all keys and outputs held by the cache.
+    int64_t max_bytes = 64 << 20;
+    // Entries older than this are not returned.
+    absl::Duration max_age = absl::Seconds(10);
+    // Version of the local data, which must never be newer than the data
+    // itself. If null, data updates don't invalidate entries.
+    const std::atomic<int64_t>* data_version = nullptr;
+  };
+
+  explicit PartitionResultCache(Options options);
+
+  PartitionResultCache(const PartitionResultCache&) = delete;
+  PartitionResultCache& operator=(const PartitionResultCache&) = delete;
+
+  // Returns the key of a partition parsed as proto. Map fields of the
+  // metadata are serialized deterministically, so equal requests have equal
+  // keys.
+  static std::string MakeKey(
+      const google::protobuf::Struct& metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments);
+
+  // Returns the key of a partition parsed by the streaming JSON parser.
+  static std::string MakeKey(std::string_view json_metadata,
+                             const std::vector<std::string>& json_arguments);
+
+  // Returns the cached UDF output for `key`, if any.
+  std::optional<std::string> Get(std::string_view key);
+
+  // Versions of the UDF code and of the data an output is computed from.
+  struct Version {
+    int64_t generation;
+    int64_t data_version;
+  };
+
+  // Returns the current version. It must be read before executing the UDF
+  // and passed to `Put`, so that an output that might have seen older code or
+  // data is dropped.
+  Version version() const;
+
+  // Caches `output` for `key`, unless the cache was invalidated or the data
+  // changed since `version` was read, or `output` does not fit.
+  void Put(std::string key, std::string output, Version version);
+
+  // Drops all cached outputs.
+  void Invalidate();
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string output;
+    absl::Time insert_time;
+    int64_t data_version;
+  };
+
+  static int64_t EntrySize(const Entry& entry);
+  int64_t CurrentDataVersion() const;
+  void EraseLocked(std::list<Entry>::iterator it)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+  mutable absl::Mutex mu_;
+  int64_t generation_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t size_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+  // Most recently used first.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mu_);
+  // Keys point into `entries_`.
+  absl::flat_hash_map<std::string_view, std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_PARTITION_RESULT_CACHE_H_
@@ -0,0 +1,146 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/partition_result_cache.h"
+
+#include <atomic>
+#include <string>
+
+#include "absl/time/clock.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/query/v2/get_values_v2.pb.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using testing::Eq;
+using testing::Optional;
+
+TEST(PartitionResultCacheTest, ReturnsCachedOutput) {
+  PartitionResultCache cache({});
+  EXPECT_EQ(cache.Get("key"), std::nullopt);
+  cache.Put("key", "output", cache.version());
+  EXPECT_THAT(cache.Get("key"), Optional(Eq("output")));
+  EXPECT_EQ(cache.Get("other"), std::nullopt);
+}
+
+TEST(PartitionResultCacheTest, InvalidateDropsOutputs) {
+  PartitionResultCache cache({});
+  const auto version = cache.version();
+  cache.Put("key1", "output1", version);
+  cache.Invalidate();
+  EXPECT_EQ(cache.Get("key1"), std::nullopt);
+  // Computed before the invalidation, so it may be stale.
+  cache.Put("key2", "output2", version);
+  EXPECT_EQ(cache.Get("key2"), std::nullopt);
+  cache.Put("key2", "output2", cache.version());
+  EXPECT_THAT(cache.Get("key2"), Optional(Eq("output2")));
+}
+
+TEST(PartitionResultCacheTest, DataVersionBumpDropsOutputs) {
+  std::atomic<int64_t> data_version = 1;
+  PartitionResultCache cache({.data_version = &data_version});
+  const auto version = cache.version();
+  cache.Put("key1", "output1", version);
+  EXPECT_THAT(cache.Get("key1"), Optional(Eq("output1")));
+  data_version = 2;
+  EXPECT_EQ(cache.Get("key1"), std::nullopt);
+  // Computed before the data changed, so it may be stale.
+  cache.Put("key2", "output2", version);
+  EXPECT_EQ(cache.Get("key2"), std::nullopt);
+  cache.Put("key2", "output2", cache.version());
+  EXPECT_THAT(cache.Get("key2"), Optional(Eq("output2")));
+}
+
+TEST(PartitionResultCacheTest, EvictsLeastRecentlyUsed) {
+  // Room for two entries of this size.
+  PartitionResultCache cache({.max_bytes = 2 * (4 + 7 + 64)});
+  const auto version = cache.version();
+  cache.Put("key1", "output1", version);
+  cache.Put("key2", "output2", version);
+  EXPECT_TRUE(cache.Get("key1").has_value());
+  cache.Put("key3", "output3", version);
+  EXPECT_TRUE(cache.Get("key1").has_value());
+  EXPECT_EQ(cache.Get("key2"), std::nullopt);
+  EXPECT_TRUE(cache.Get("key3").has_value());
+}
+
+TEST(PartitionResultCacheTest, DoesNotCacheOversizedOutput) {
+  PartitionResultCache cache({.max_bytes = 100});
+  cache.Put("key", std::string(100, 'a'), cache.version());
+  EXPECT_EQ(cache.Get("key"), std::nullopt);
+}
+
+TEST(PartitionResultCacheTest, ExpiresOldEntries) {
+  PartitionResultCache cache({.max_age = absl::ZeroDuration()});
+  cache.Put("key", "output", cache.version());
+  absl::SleepFor(absl::Milliseconds(1));
+  EXPECT_EQ(cache.Get("key"), std::nullopt);
+}
+
+TEST(PartitionResultCacheTest, ProtoKeyIgnoresPartitionIds) {
+  v2::GetValuesRequest request;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        metadata {
+          fields {
+            key: "hostname"
+            value { string_value: "example.com" }
+          }
+          fields {
+            key: "is_pas"
+            value { bool_value: true }
+          }
+        }
+        partitions {
+          id: 0
+          compression_group_id: 0
+          arguments { data { string_value: "key1" } }
+        }
+        partitions {
+          id: 1
+          compression_group_id: 1
+          arguments { data { string_value: "key1" } }
+        }
+        partitions {
+          id: 2
+          arguments { data { string_value: "key2" } }
+        }
+      )pb",
+      &request));
+  const auto key0 = PartitionResultCache::MakeKey(
+      request.metadata(), request.partitions(0).arguments());
+  EXPECT_EQ(key0, PartitionResultCache::MakeKey(
+                      request.metadata(), request.partitions(1).arguments()));
+  EXPECT_NE(key0, PartitionResultCache::MakeKey(
+                      request.metadata(), request.partitions(2).arguments()));
+  EXPECT_NE(key0, PartitionResultCache::MakeKey(
+                      google::protobuf::Struct(),
+                      request.partitions(0).arguments()));
+}
+
+TEST(PartitionResultCacheTest, JsonKeySeparatesArguments) {
+  EXPECT_EQ(PartitionResultCache::MakeKey("{}", {R"("a")", R"("b")"}),
+            PartitionResultCache::MakeKey("{}", {R"("a")", R"("b")"}));
+  EXPECT_NE(PartitionResultCache::MakeKey("{}", {R"("a")", R"("b")"}),
+            PartitionResultCache::MakeKey("{}", {R"("a""b")"}));
+  EXPECT_NE(PartitionResultCache::MakeKey("", {R"("a")"}),
+            PartitionResultCache::MakeKey(R"("a")", {}));
+}
+
+}  // namespace
+}  // namespace kv_server
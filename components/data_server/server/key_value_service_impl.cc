@@ -14,7 +14,9 @@
 
 #include "components/data_server/server/key_value_service_impl.h"
 
+#include <memory>
 #include <string>
+#include <utility>
 
 #include <grpcpp/grpcpp.h>
 
@@ -39,25 +41,30 @@ using v1::KeyValueService;
 grpc::ServerUnaryReactor* KeyValueServiceImpl::GetValues(
     CallbackServerContext* context, const GetValuesRequest* request,
     GetValuesResponse* response) {
-  ScopeLatencyRecorder latency_recorder(std::string(kGetValuesV1Latency),
-                                        metrics_recorder_);
-
-  grpc::Status status = handler_.GetValues(*request, response);
-
-  if (status.ok()) {
-    metrics_recorder_.IncrementEventStatus(kGetValuesSuccess, absl::OkStatus());
-  } else {
-    // TODO: use implicit conversion when it becomes available externally
-    // https://g3doc.corp.google.com/net/grpc/g3doc/grpc_prod/cpp/status_mapping.md?cl=head
-    absl::StatusCode absl_status_code =
-        static_cast<absl::StatusCode>(status.error_code());
-    absl::Status absl_status =
-        absl::Status(absl_status_code, status.error_message());
-    metrics_recorder_.IncrementEventStatus(kGetValuesSuccess, absl_status);
-  }
-
+  // The latency is recorded when the reactor is finished, which may happen on
+  // a UDF callback thread after this returns.
+  auto latency_recorder = std::make_unique<ScopeLatencyRecorder>(
+      std::string(kGetValuesV1Latency), metrics_recorder_);
   auto* reactor = context->DefaultReactor();
-  reactor->Finish(status);
+  handler_.GetValuesAsync(
+      *request, response,
+      [this, reactor, latency_recorder = std::move(latency_recorder)](
+          grpc::Status status) {
+        if (status.ok()) {
+          metrics_recorder_.IncrementEventStatus(kGetValuesSuccess,
+                                                 absl::OkStatus());
+        } else {
+          // TODO: use implicit conversion when it becomes available externally
+          // https://g3doc.corp.google.com/net/grpc/g3doc/grpc_prod/cpp/status_mapping.md?cl=head
+          absl::StatusCode absl_status_code =
+              static_cast<absl::StatusCode>(status.error_code());
+          absl::Status absl_status =
+              absl::Status(absl_status_code, status.error_message());
+          metrics_recorder_.IncrementEventStatus(kGetValuesSuccess,
+                                                 absl_status);
+        }
+        reactor->Finish(status);
+      });
   return reactor;
 }
 
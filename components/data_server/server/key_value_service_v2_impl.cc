@@ -16,6 +16,7 @@
 
 #include <grpcpp/grpcpp.h>
 
+#include "absl/functional/any_invocable.h"
 #include "public/query/v2/get_values_v2.grpc.pb.h"
 #include "src/cpp/telemetry/metrics_recorder.h"
 #include "src/cpp/telemetry/telemetry.h"
@@ -29,18 +30,20 @@ using v2::GetValuesHttpRequest;
 using v2::KeyValueService;
 
 template <typename RequestT, typename ResponseT>
-using HandlerFunctionT = grpc::Status (GetValuesV2Handler::*)(const RequestT&,
-                                                              ResponseT*) const;
+using HandlerFunctionT = void (GetValuesV2Handler::*)(
+    const RequestT&, ResponseT*,
+    absl::AnyInvocable<void(grpc::Status) &&>) const;
 
+// Finished from the UDF callback so that no gRPC thread waits on the UDF.
 template <typename RequestT, typename ResponseT>
 grpc::ServerUnaryReactor* HandleRequest(
     CallbackServerContext* context, const RequestT* request,
     ResponseT* response, const GetValuesV2Handler& handler,
     HandlerFunctionT<RequestT, ResponseT> handler_function) {
-  grpc::Status status = (handler.*handler_function)(*request, response);
-
   auto* reactor = context->DefaultReactor();
-  reactor->Finish(status);
+  (handler.*handler_function)(
+      *request, response,
+      [reactor](grpc::Status status) { reactor->Finish(status); });
   return reactor;
 }
 
@@ -50,13 +53,13 @@ grpc::ServerUnaryReactor* KeyValueServiceV2Impl::GetValuesHttp(
     CallbackServerContext* context, const GetValuesHttpRequest* request,
     google::api::HttpBody* response) {
   return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::GetValuesHttp);
+                       &GetValuesV2Handler::GetValuesHttpAsync);
 }
 grpc::ServerUnaryReactor* KeyValueServiceV2Impl::GetValues(
     grpc::CallbackServerContext* context, const v2::GetValuesRequest* request,
     v2::GetValuesResponse* response) {
   return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::GetValues);
+                       &GetValuesV2Handler::GetValuesAsync);
 }
 
 grpc::ServerUnaryReactor* KeyValueServiceV2Impl::BinaryHttpGetValues(
@@ -64,7 +67,7 @@ grpc::ServerUnaryReactor* KeyValueServiceV2Impl::BinaryHttpGetValues(
     const v2::BinaryHttpGetValuesRequest* request,
     google::api::HttpBody* response) {
   return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::BinaryHttpGetValues);
+                       &GetValuesV2Handler::BinaryHttpGetValuesAsync);
 }
 
 grpc::ServerUnaryReactor* KeyValueServiceV2Impl::ObliviousGetValues(
@@ -72,7 +75,7 @@ grpc::ServerUnaryReactor* KeyValueServiceV2Impl::ObliviousGetValues(
     const v2::ObliviousGetValuesRequest* request,
     google::api::HttpBody* response) {
   return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::ObliviousGetValues);
+                       &GetValuesV2Handler::ObliviousGetValuesAsync);
 }
 
 }  // namespace kv_server
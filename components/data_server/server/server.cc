@@ -21,7 +21,11 @@
 #include "absl/flags/usage.h"
 #include "absl/functional/bind_front.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "components/data_server/request_handler/compression.h"
+#include "components/data_server/request_handler/compression_zstd.h"
 #include "components/data_server/request_handler/get_values_adapter.h"
 #include "components/data_server/request_handler/get_values_handler.h"
 #include "components/data_server/request_handler/get_values_v2_handler.h"
@@ -95,7 +99,35 @@ constexpr absl::string_view kUseShardingKeyRegexParameterSuffix =
     "use-sharding-key-regex";
 constexpr absl::string_view kShardingKeyRegexParameterSuffix =
     "sharding-key-regex";
+constexpr absl::string_view kShardingKeyDelimiterParameterSuffix =
+    "sharding-key-delimiter";
+constexpr absl::string_view kShardingFunctionVersionParameterSuffix =
+    "sharding-function-version";
 constexpr absl::string_view kRouteV1ToV2Suffix = "route-v1-to-v2";
+constexpr absl::string_view kRealtimeBatchMaxDelayMillisParameterSuffix =
+    "realtime-batch-max-delay-millis";
+constexpr absl::string_view kRealtimeBatchMaxSizeParameterSuffix =
+    "realtime-batch-max-size";
+constexpr absl::string_view kBypassPassthroughUdfParameterSuffix =
+    "bypass-passthrough-udf";
+constexpr absl::string_view kPartitionResultCacheMaxMegabytesParameterSuffix =
+    "partition-result-cache-max-megabytes";
+constexpr absl::string_view kPartitionResultCacheMaxAgeMillisParameterSuffix =
+    "partition-result-cache-max-age-millis";
+constexpr absl::string_view kJsonValueCacheMaxMegabytesParameterSuffix =
+    "json-value-cache-max-megabytes";
+constexpr absl::string_view kShardedLookupHedgingPercentileParameterSuffix =
+    "sharded-lookup-hedging-percentile";
+constexpr absl::string_view kShardedLookupCoalescingMicrosParameterSuffix =
+    "sharded-lookup-coalescing-micros";
+constexpr absl::string_view kShardedLookupUseStreamParameterSuffix =
+    "sharded-lookup-use-stream";
+constexpr absl::string_view kShardedLookupPaddingBucketsParameterSuffix =
+    "sharded-lookup-padding-buckets";
+constexpr absl::string_view kNearCacheMaxMegabytesParameterSuffix =
+    "near-cache-max-megabytes";
+constexpr absl::string_view kNearCacheMaxAgeMillisParameterSuffix =
+    "near-cache-max-age-millis";
 constexpr absl::string_view kAutoscalerHealthcheck = "autoscaler-healthcheck";
 constexpr absl::string_view kLoadbalancerHealthcheck =
     "loadbalancer-healthcheck";
@@ -166,6 +198,10 @@ GetServerTelemetryConfig(const ParameterClient& parameter_client,
   return config;
 }
 
+int64_t MegabytesToBytes(int32_t megabytes) {
+  return static_cast<int64_t>(megabytes) << 20;
+}
+
 }  // namespace
 
 Server::Server()
@@ -247,6 +283,7 @@ absl::Status Server::CreateDefaultInstancesIfNecessaryAndGetEnvironment(
       parameter_fetcher.GetInt32Parameter(kUdfNumWorkersParameterSuffix);
   int32_t udf_timeout_ms =
       parameter_fetcher.GetInt32Parameter(kUdfTimeoutMillisParameterSuffix);
+  udf_timeout_ = absl::Milliseconds(udf_timeout_ms);
 
   // updating verbosity level flag as early as we can, as it affects all logging
   // downstream.
@@ -300,22 +337,60 @@ KeySharder GetKeySharder(const ParameterFetcher& parameter_fetcher) {
       parameter_fetcher.GetBoolParameter(kUseShardingKeyRegexParameterSuffix);
   LOG(INFO) << "Retrieved " << kUseShardingKeyRegexParameterSuffix
             << " parameter: " << use_sharding_key_regex;
-  ShardingFunction func(/*seed=*/"");
-  std::optional<std::regex> shard_key_regex;
+  const int32_t sharding_function_version = parameter_fetcher.GetInt32Parameter(
+      kShardingFunctionVersionParameterSuffix);
+  LOG(INFO) << "Retrieved " << kShardingFunctionVersionParameterSuffix
+            << " parameter: " << sharding_function_version;
+  auto version = ToShardingFunctionVersion(sharding_function_version);
+  CHECK(version.ok()) << version.status();
+  ShardingFunction func(/*seed=*/"", *version);
   if (use_sharding_key_regex) {
     std::string sharding_key_regex_value =
         parameter_fetcher.GetParameter(kShardingKeyRegexParameterSuffix);
     LOG(INFO) << "Retrieved " << kShardingKeyRegexParameterSuffix
               << " parameter: " << sharding_key_regex_value;
-    // https://en.cppreference.com/w/cpp/regex/syntax_option_type
-    // optimize -- "Instructs the regular expression engine to make matching
-    // faster, with the potential cost of making construction slower. For
-    // example, this might mean converting a non-deterministic FSA to a
-    // deterministic FSA." this matches our usecase.
-    shard_key_regex = std::regex(std::move(sharding_key_regex_value),
-                                 std::regex_constants::optimize);
-  }
-  return KeySharder(func, std::move(shard_key_regex));
+    return KeySharder(
+        func, ShardingKeyRegex{.pattern = std::move(sharding_key_regex_value)});
+  }
+  // Optional, so that deployments without the parameter keep working.
+  std::string sharding_key_delimiter = parameter_fetcher.GetParameter(
+      kShardingKeyDelimiterParameterSuffix, /*default_value=*/"");
+  LOG(INFO) << "Retrieved " << kShardingKeyDelimiterParameterSuffix
+            << " parameter: " << sharding_key_delimiter;
+  if (!sharding_key_delimiter.empty()) {
+    return KeySharder(
+        func,
+        ShardingKeyDelimiter{.delimiter = std::move(sharding_key_delimiter)});
+  }
+  return KeySharder(func);
+}
+
+// Returns the options of lookups on remote shards, without the timeout and
+// the near cache which are owned by the server.
+ShardedLookupOptions GetShardedLookupOptions(
+    const ParameterFetcher& parameter_fetcher) {
+  const int32_t hedging_percentile = parameter_fetcher.GetInt32Parameter(
+      kShardedLookupHedgingPercentileParameterSuffix);
+  LOG(INFO) << "Retrieved " << kShardedLookupHedgingPercentileParameterSuffix
+            << " parameter: " << hedging_percentile;
+  const int32_t coalescing_micros = parameter_fetcher.GetInt32Parameter(
+      kShardedLookupCoalescingMicrosParameterSuffix);
+  LOG(INFO) << "Retrieved " << kShardedLookupCoalescingMicrosParameterSuffix
+            << " parameter: " << coalescing_micros;
+  const bool use_stream = parameter_fetcher.GetBoolParameter(
+      kShardedLookupUseStreamParameterSuffix);
+  LOG(INFO) << "Retrieved " << kShardedLookupUseStreamParameterSuffix
+            << " parameter: " << use_stream;
+  const int32_t padding_buckets = parameter_fetcher.GetInt32Parameter(
+      kShardedLookupPaddingBucketsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kShardedLookupPaddingBucketsParameterSuffix
+            << " parameter: " << padding_buckets;
+  return {
+      .hedging_percentile = static_cast<double>(hedging_percentile),
+      .coalescing_window = absl::Microseconds(coalescing_micros),
+      .padding_buckets_per_doubling = padding_buckets,
+      .remote_lookup_client_options = {.use_lookup_stream = use_stream},
+  };
 }
 
 absl::Status Server::InitOnceInstancesAreCreated() {
@@ -370,10 +445,32 @@ absl::Status Server::InitOnceInstancesAreCreated() {
   grpc_server_ = CreateAndStartGrpcServer();
   local_lookup_ = CreateLocalLookup(*cache_, *metrics_recorder_);
   auto key_sharder = GetKeySharder(parameter_fetcher);
+  const int32_t near_cache_max_megabytes = parameter_fetcher.GetInt32Parameter(
+      kNearCacheMaxMegabytesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kNearCacheMaxMegabytesParameterSuffix
+            << " parameter: " << near_cache_max_megabytes;
+  const int32_t near_cache_max_age_millis = parameter_fetcher.GetInt32Parameter(
+      kNearCacheMaxAgeMillisParameterSuffix);
+  LOG(INFO) << "Retrieved " << kNearCacheMaxAgeMillisParameterSuffix
+            << " parameter: " << near_cache_max_age_millis;
+  if (num_shards_ > 1 && near_cache_max_megabytes > 0) {
+    near_cache_ = std::make_unique<NearCache>(
+        num_shards_,
+        NearCache::Options{
+            .max_bytes = MegabytesToBytes(near_cache_max_megabytes),
+            .max_age = absl::Milliseconds(near_cache_max_age_millis),
+        });
+  }
+  ShardedLookupOptions sharded_lookup_options =
+      GetShardedLookupOptions(parameter_fetcher);
+  // Remote lookups are only issued by the UDF, whose execution is bounded by
+  // its timeout, so their results are useless past it.
+  sharded_lookup_options.timeout = udf_timeout_;
+  sharded_lookup_options.near_cache = near_cache_.get();
   auto server_initializer = GetServerInitializer(
       num_shards_, *metrics_recorder_, *key_fetcher_manager_, *local_lookup_,
       environment_, shard_num_, *instance_client_, *cache_, parameter_fetcher,
-      key_sharder);
+      key_sharder, sharded_lookup_options, &data_version_);
   remote_lookup_ = server_initializer->CreateAndStartRemoteLookupServer();
   {
     auto status_or_notifier =
@@ -548,6 +645,19 @@ std::unique_ptr<DataOrchestrator> Server::CreateDataOrchestrator(
       parameter_fetcher.GetParameter(kDataBucketParameterSuffix);
   LOG(INFO) << "Retrieved " << kDataBucketParameterSuffix
             << " parameter: " << data_bucket;
+  const int32_t realtime_batch_max_delay_millis =
+      parameter_fetcher.GetInt32Parameter(
+          kRealtimeBatchMaxDelayMillisParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeBatchMaxDelayMillisParameterSuffix
+            << " parameter: " << realtime_batch_max_delay_millis;
+  const int32_t realtime_batch_max_size =
+      parameter_fetcher.GetInt32Parameter(kRealtimeBatchMaxSizeParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeBatchMaxSizeParameterSuffix
+            << " parameter: " << realtime_batch_max_size;
+  const RealtimeUpdateBatcher::Options realtime_update_batcher_options = {
+      .max_batch_delay = absl::Milliseconds(realtime_batch_max_delay_millis),
+      .max_batch_size = realtime_batch_max_size,
+  };
   auto metrics_callback =
       LogStatusSafeMetricsFn<kCreateDataOrchestratorStatus>();
   return TraceRetryUntilOk(
@@ -564,6 +674,26 @@ std::unique_ptr<DataOrchestrator> Server::CreateDataOrchestrator(
             .shard_num = shard_num_,
             .num_shards = num_shards_,
             .key_sharder = std::move(key_sharder),
+            .realtime_update_batcher_options =
+                realtime_update_batcher_options,
+            .on_update_applied =
+                [this] {
+                  data_version_.fetch_add(1, std::memory_order_relaxed);
+                },
+            // Data updates invalidate the partition result cache through
+            // `data_version_`.
+            .on_udf_code_updated =
+                [this] {
+                  if (partition_result_cache_ != nullptr) {
+                    partition_result_cache_->Invalidate();
+                  }
+                },
+            .set_compression_dictionary =
+                [this](std::string_view dictionary,
+                       int64_t logical_commit_time) {
+                  return compression_dictionaries_.Update(
+                      dictionary, logical_commit_time);
+                },
         });
       },
       "CreateDataOrchestrator", metrics_callback);
@@ -572,15 +702,54 @@ std::unique_ptr<DataOrchestrator> Server::CreateDataOrchestrator(
 void Server::CreateGrpcServices(const ParameterFetcher& parameter_fetcher) {
   const bool use_v2 = parameter_fetcher.GetBoolParameter(kRouteV1ToV2Suffix);
   LOG(INFO) << "Retrieved " << kRouteV1ToV2Suffix << " parameter: " << use_v2;
-  get_values_adapter_ =
-      GetValuesAdapter::Create(std::make_unique<GetValuesV2Handler>(
-          *udf_client_, *metrics_recorder_, *key_fetcher_manager_));
+  const int32_t partition_result_cache_max_megabytes =
+      parameter_fetcher.GetInt32Parameter(
+          kPartitionResultCacheMaxMegabytesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kPartitionResultCacheMaxMegabytesParameterSuffix
+            << " parameter: " << partition_result_cache_max_megabytes;
+  const int32_t partition_result_cache_max_age_millis =
+      parameter_fetcher.GetInt32Parameter(
+          kPartitionResultCacheMaxAgeMillisParameterSuffix);
+  LOG(INFO) << "Retrieved " << kPartitionResultCacheMaxAgeMillisParameterSuffix
+            << " parameter: " << partition_result_cache_max_age_millis;
+  if (partition_result_cache_max_megabytes > 0) {
+    partition_result_cache_ =
+        std::make_unique<PartitionResultCache>(PartitionResultCache::Options{
+            .max_bytes = MegabytesToBytes(partition_result_cache_max_megabytes),
+            .max_age =
+                absl::Milliseconds(partition_result_cache_max_age_millis),
+            .data_version = &data_version_,
+        });
+  }
+  const int32_t json_value_cache_max_megabytes =
+      parameter_fetcher.GetInt32Parameter(
+          kJsonValueCacheMaxMegabytesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kJsonValueCacheMaxMegabytesParameterSuffix
+            << " parameter: " << json_value_cache_max_megabytes;
+  if (json_value_cache_max_megabytes > 0) {
+    json_value_cache_ = std::make_unique<JsonValueCache>(
+        MegabytesToBytes(json_value_cache_max_megabytes));
+  }
+  const bool bypass_passthrough_udf =
+      parameter_fetcher.GetBoolParameter(kBypassPassthroughUdfParameterSuffix);
+  LOG(INFO) << "Retrieved " << kBypassPassthroughUdfParameterSuffix
+            << " parameter: " << bypass_passthrough_udf;
+  get_values_adapter_ = GetValuesAdapter::Create(
+      std::make_unique<GetValuesV2Handler>(
+          *udf_client_, *metrics_recorder_, *key_fetcher_manager_,
+          &CompressionGroupConcatenator::Create, partition_result_cache_.get(),
+          &compression_dictionaries_),
+      bypass_passthrough_udf ? string_get_values_hook_.get() : nullptr,
+      json_value_cache_.get());
   GetValuesHandler handler(*cache_, *get_values_adapter_, *metrics_recorder_,
-                           use_v2);
+                           use_v2, json_value_cache_.get());
   grpc_services_.push_back(std::make_unique<KeyValueServiceImpl>(
       std::move(handler), *metrics_recorder_));
   GetValuesV2Handler v2handler(*udf_client_, *metrics_recorder_,
-                               *key_fetcher_manager_);
+                               *key_fetcher_manager_,
+                               &CompressionGroupConcatenator::Create,
+                               partition_result_cache_.get(),
+                               &compression_dictionaries_);
   grpc_services_.push_back(std::make_unique<KeyValueServiceV2Impl>(
       std::move(v2handler), *metrics_recorder_));
 }
@@ -15,12 +15,14 @@
 #ifndef COMPONENTS_DATA_SERVER_SERVER_SERVER_H_
 #define COMPONENTS_DATA_SERVER_SERVER_SERVER_H_
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "components/cloud_config/instance_client.h"
 #include "components/cloud_config/parameter_client.h"
@@ -30,11 +32,15 @@
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/key_value_cache.h"
 #include "components/data_server/data_loading/data_orchestrator.h"
+#include "components/data_server/request_handler/compression_zstd.h"
 #include "components/data_server/request_handler/get_values_adapter.h"
+#include "components/data_server/request_handler/json_value_cache.h"
+#include "components/data_server/request_handler/partition_result_cache.h"
 #include "components/data_server/server/lifecycle_heartbeat.h"
 #include "components/data_server/server/parameter_fetcher.h"
 #include "components/data_server/server/server_initializer.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/near_cache.h"
 #include "components/sharding/cluster_mappings_manager.h"
 #include "components/sharding/shard_manager.h"
 #include "components/udf/hooks/get_values_hook.h"
@@ -112,6 +118,17 @@ class Server {
   std::string environment_;
   std::unique_ptr<privacy_sandbox::server_common::MetricsRecorder>
       metrics_recorder_;
+  // Must outlive the request handlers and DataOrchestrator.
+  std::unique_ptr<PartitionResultCache> partition_result_cache_;
+  std::unique_ptr<JsonValueCache> json_value_cache_;
+  // Latest dictionary of the compression dictionary records in delta files.
+  ZstdDictionaryStore compression_dictionaries_;
+  // Must outlive the sharded lookups of the UDF hooks.
+  std::unique_ptr<NearCache> near_cache_;
+  // Incremented whenever data is applied to the cache, must outlive the
+  // remote lookup server. Starts at the current time so that it keeps
+  // increasing across restarts.
+  std::atomic<int64_t> data_version_ = absl::ToUnixNanos(absl::Now());
   std::vector<std::unique_ptr<grpc::Service>> grpc_services_;
   std::unique_ptr<grpc::Server> grpc_server_;
   std::unique_ptr<Cache> cache_;
@@ -146,6 +163,8 @@ class Server {
 
   RemoteLookup remote_lookup_;
   std::unique_ptr<UdfClient> udf_client_;
+  // Bounds the execution of the UDF, and so the lookups it issues.
+  absl::Duration udf_timeout_ = absl::InfiniteDuration();
   ShardManagerState shard_manager_state_;
 
   int32_t shard_num_;
@@ -81,7 +81,8 @@ class ShardedServerInitializer : public ServerInitializer {
       KeyFetcherManagerInterface& key_fetcher_manager, Lookup& local_lookup,
       std::string environment, int32_t num_shards, int32_t current_shard_num,
       InstanceClient& instance_client, ParameterFetcher& parameter_fetcher,
-      KeySharder key_sharder)
+      KeySharder key_sharder, ShardedLookupOptions sharded_lookup_options,
+      const std::atomic<int64_t>* data_version)
       : metrics_recorder_(metrics_recorder),
         key_fetcher_manager_(key_fetcher_manager),
         local_lookup_(local_lookup),
@@ -90,12 +91,14 @@ class ShardedServerInitializer : public ServerInitializer {
         current_shard_num_(current_shard_num),
         instance_client_(instance_client),
         parameter_fetcher_(parameter_fetcher),
-        key_sharder_(std::move(key_sharder)) {}
+        key_sharder_(std::move(key_sharder)),
+        sharded_lookup_options_(std::move(sharded_lookup_options)),
+        data_version_(data_version) {}
 
   RemoteLookup CreateAndStartRemoteLookupServer() override {
     RemoteLookup remote_lookup;
     remote_lookup.remote_lookup_service = std::make_unique<LookupServiceImpl>(
-        local_lookup_, key_fetcher_manager_, metrics_recorder_);
+        local_lookup_, key_fetcher_manager_, metrics_recorder_, data_version_);
     grpc::ServerBuilder remote_lookup_server_builder;
     auto remoteLookupServerAddress =
         absl::StrCat(kLocalIp, ":", kRemoteLookupServerPort);
@@ -123,9 +126,11 @@ class ShardedServerInitializer : public ServerInitializer {
                             current_shard_num = current_shard_num_,
                             &shard_manager = *maybe_shard_state->shard_manager,
                             &metrics_recorder = metrics_recorder_,
-                            &key_sharder = key_sharder_]() {
+                            &key_sharder = key_sharder_,
+                            &options = sharded_lookup_options_]() {
       return CreateShardedLookup(local_lookup, num_shards, current_shard_num,
-                                 shard_manager, metrics_recorder, key_sharder);
+                                 shard_manager, metrics_recorder, key_sharder,
+                                 options);
     };
     InitializeUdfHooksInternal(std::move(lookup_supplier),
                                string_get_values_hook, binary_get_values_hook,
@@ -144,7 +149,9 @@ class ShardedServerInitializer : public ServerInitializer {
         [&cluster_mappings_manager =
              *shard_manager_state.cluster_mappings_manager,
          &num_shards = num_shards_, &key_fetcher_manager = key_fetcher_manager_,
-         &metrics_recorder = metrics_recorder_] {
+         &metrics_recorder = metrics_recorder_,
+         &client_options =
+             sharded_lookup_options_.remote_lookup_client_options] {
           // It might be that the cluster mappings that are passed don't pass
           // validation. E.g. a particular cluster might not have any
           // replicas
@@ -153,7 +160,8 @@ class ShardedServerInitializer : public ServerInitializer {
           // at that point in time might have new replicas spun up.
           return ShardManager::Create(
               num_shards, key_fetcher_manager,
-              cluster_mappings_manager.GetClusterMappings(), metrics_recorder);
+              cluster_mappings_manager.GetClusterMappings(), metrics_recorder,
+              client_options);
         },
         "GetShardManager", LogStatusSafeMetricsFn<kGetShardManagerStatus>());
     auto start_status = shard_manager_state.cluster_mappings_manager->Start(
@@ -173,6 +181,8 @@ class ShardedServerInitializer : public ServerInitializer {
   InstanceClient& instance_client_;
   ParameterFetcher& parameter_fetcher_;
   KeySharder key_sharder_;
+  ShardedLookupOptions sharded_lookup_options_;
+  const std::atomic<int64_t>* data_version_;
 };
 
 }  // namespace
@@ -182,7 +192,9 @@ std::unique_ptr<ServerInitializer> GetServerInitializer(
     KeyFetcherManagerInterface& key_fetcher_manager, Lookup& local_lookup,
     std::string environment, int32_t current_shard_num,
     InstanceClient& instance_client, Cache& cache,
-    ParameterFetcher& parameter_fetcher, KeySharder key_sharder) {
+    ParameterFetcher& parameter_fetcher, KeySharder key_sharder,
+    ShardedLookupOptions sharded_lookup_options,
+    const std::atomic<int64_t>* data_version) {
   CHECK_GT(num_shards, 0) << "num_shards must be greater than 0";
   if (num_shards == 1) {
     return std::make_unique<NonshardedServerInitializer>(metrics_recorder,
@@ -192,6 +204,6 @@ std::unique_ptr<ServerInitializer> GetServerInitializer(
   return std::make_unique<ShardedServerInitializer>(
       metrics_recorder, key_fetcher_manager, local_lookup, environment,
       num_shards, current_shard_num, instance_client, parameter_fetcher,
-      std::move(key_sharder));
+      std::move(key_sharder), std::move(sharded_lookup_options), data_version);
 }
 }  // namespace kv_server
@@ -17,6 +17,7 @@
 #ifndef COMPONENTS_DATA_SERVER_SERVER_INITIALIZER_H_
 #define COMPONENTS_DATA_SERVER_SERVER_INITIALIZER_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -24,6 +25,7 @@
 #include "absl/status/statusor.h"
 #include "components/data_server/server/parameter_fetcher.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/sharded_lookup.h"
 #include "components/sharding/cluster_mappings_manager.h"
 #include "components/udf/hooks/get_values_hook.h"
 #include "components/udf/hooks/run_query_hook.h"
@@ -64,7 +66,9 @@ std::unique_ptr<ServerInitializer> GetServerInitializer(
         key_fetcher_manager,
     Lookup& local_lookup, std::string environment, int32_t current_shard_num,
     InstanceClient& instance_client, Cache& cache,
-    ParameterFetcher& parameter_fetcher, KeySharder key_sharder);
+    ParameterFetcher& parameter_fetcher, KeySharder key_sharder,
+    ShardedLookupOptions sharded_lookup_options = {},
+    const std::atomic<int64_t>* data_version = nullptr);
 
 }  // namespace kv_server
 #endif  // COMPONENTS_DATA_SERVER_SERVER_INITIALIZER_H_
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <string_view>
 #include <thread>
 
 #include "components/data_server/server/mocks.h"
@@ -55,6 +56,36 @@ void RegisterRequiredTelemetryExpectations(MockParameterClient& client) {
       .WillOnce(::testing::Return(123));
 }
 
+// Parameters of optional features. Depending on how far Init gets, they may
+// not all be read.
+void RegisterFeatureParameterExpectations(MockParameterClient& client) {
+  for (std::string_view parameter : {
+           "kv-server-environment-realtime-batch-max-delay-millis",
+           "kv-server-environment-partition-result-cache-max-megabytes",
+           "kv-server-environment-partition-result-cache-max-age-millis",
+           "kv-server-environment-json-value-cache-max-megabytes",
+           "kv-server-environment-sharded-lookup-hedging-percentile",
+           "kv-server-environment-sharded-lookup-coalescing-micros",
+           "kv-server-environment-sharded-lookup-padding-buckets",
+           "kv-server-environment-near-cache-max-megabytes",
+           "kv-server-environment-near-cache-max-age-millis",
+       }) {
+    EXPECT_CALL(client, GetInt32Parameter(parameter))
+        .WillRepeatedly(::testing::Return(0));
+  }
+  EXPECT_CALL(
+      client,
+      GetInt32Parameter("kv-server-environment-realtime-batch-max-size"))
+      .WillRepeatedly(::testing::Return(10000));
+  for (std::string_view parameter : {
+           "kv-server-environment-bypass-passthrough-udf",
+           "kv-server-environment-sharded-lookup-use-stream",
+       }) {
+    EXPECT_CALL(client, GetBoolParameter(parameter))
+        .WillRepeatedly(::testing::Return(false));
+  }
+}
+
 void InitializeMetrics() {
   opentelemetry::sdk::metrics::PeriodicExportingMetricReaderOptions
       metrics_options;
@@ -84,6 +115,7 @@ TEST(ServerLocalTest, InitFailsWithNoDeltaDirectory) {
   auto instance_client = std::make_unique<MockInstanceClient>();
   auto parameter_client = std::make_unique<MockParameterClient>();
   RegisterRequiredTelemetryExpectations(*parameter_client);
+  RegisterFeatureParameterExpectations(*parameter_client);
   auto mock_udf_client = std::make_unique<MockUdfClient>();
 
   EXPECT_CALL(*instance_client, GetEnvironmentTag())
@@ -119,6 +151,14 @@ TEST(ServerLocalTest, InitFailsWithNoDeltaDirectory) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-key-delimiter",
+                           testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-sharding-function-version"))
+      .WillOnce(::testing::Return(0));
   kv_server::Server server;
   absl::Status status =
       server.Init(std::move(parameter_client), std::move(instance_client),
@@ -130,6 +170,7 @@ TEST(ServerLocalTest, InitPassesWithDeltaDirectoryAndRealtimeDirectory) {
   auto instance_client = std::make_unique<MockInstanceClient>();
   auto parameter_client = std::make_unique<MockParameterClient>();
   RegisterRequiredTelemetryExpectations(*parameter_client);
+  RegisterFeatureParameterExpectations(*parameter_client);
   auto mock_udf_client = std::make_unique<MockUdfClient>();
 
   EXPECT_CALL(*instance_client, GetEnvironmentTag())
@@ -177,6 +218,14 @@ TEST(ServerLocalTest, InitPassesWithDeltaDirectoryAndRealtimeDirectory) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-key-delimiter",
+                           testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-sharding-function-version"))
+      .WillOnce(::testing::Return(0));
   EXPECT_CALL(*mock_udf_client, SetCodeObject(_))
       .WillOnce(testing::Return(absl::OkStatus()));
 
@@ -191,6 +240,7 @@ TEST(ServerLocalTest, GracefulServerShutdown) {
   auto instance_client = std::make_unique<MockInstanceClient>();
   auto parameter_client = std::make_unique<MockParameterClient>();
   RegisterRequiredTelemetryExpectations(*parameter_client);
+  RegisterFeatureParameterExpectations(*parameter_client);
   auto mock_udf_client = std::make_unique<MockUdfClient>();
 
   EXPECT_CALL(*instance_client, GetEnvironmentTag())
@@ -237,6 +287,14 @@ TEST(ServerLocalTest, GracefulServerShutdown) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-key-delimiter",
+                           testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-sharding-function-version"))
+      .WillOnce(::testing::Return(0));
   EXPECT_CALL(*mock_udf_client, SetCodeObject(_))
       .WillOnce(testing::Return(absl::OkStatus()));
 
@@ -254,6 +312,7 @@ TEST(ServerLocalTest, ForceServerShutdown) {
   auto instance_client = std::make_unique<MockInstanceClient>();
   auto parameter_client = std::make_unique<MockParameterClient>();
   RegisterRequiredTelemetryExpectations(*parameter_client);
+  RegisterFeatureParameterExpectations(*parameter_client);
   auto mock_udf_client = std::make_unique<MockUdfClient>();
 
   EXPECT_CALL(*instance_client, GetEnvironmentTag())
@@ -301,6 +360,14 @@ TEST(ServerLocalTest, ForceServerShutdown) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-key-delimiter",
+                           testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-sharding-function-version"))
+      .WillOnce(::testing::Return(0));
 
   EXPECT_CALL(*mock_udf_client, SetCodeObject(_))
       .WillOnce(testing::Return(absl::OkStatus()));
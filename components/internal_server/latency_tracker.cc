@@ -0,0 +1,60 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/latency_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "absl/log/check.h"
+
+namespace kv_server {
+
+LatencyTracker::LatencyTracker(double percentile, int num_samples)
+    : percentile_(percentile),
+      percentile_nanos_(std::numeric_limits<int64_t>::max()) {
+  CHECK(percentile > 0 && percentile <= 100) << "Invalid percentile";
+  CHECK_GE(num_samples, kRecomputeInterval);
+  samples_.reserve(num_samples);
+}
+
+void LatencyTracker::Record(absl::Duration latency) {
+  absl::MutexLock lock(&mutex_);
+  if (samples_.size() < samples_.capacity()) {
+    samples_.push_back(latency);
+  } else {
+    samples_[num_recorded_ % samples_.size()] = latency;
+  }
+  if (++num_recorded_ % kRecomputeInterval != 0) {
+    return;
+  }
+  std::vector<absl::Duration> sorted = samples_;
+  const size_t rank = std::min<size_t>(
+      sorted.size() - 1,
+      static_cast<size_t>(std::ceil(percentile_ / 100 * sorted.size())) - 1);
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+  percentile_nanos_.store(absl::ToInt64Nanoseconds(sorted[rank]),
+                          std::memory_order_relaxed);
+}
+
+absl::Duration LatencyTracker::Percentile() const {
+  const int64_t nanos = percentile_nanos_.load(std::memory_order_relaxed);
+  return nanos == std::numeric_limits<int64_t>::max()
+             ? absl::InfiniteDuration()
+             : absl::Nanoseconds(nanos);
+}
+
+}  // namespace kv_server
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_LATENCY_TRACKER_H_
+#define COMPONENTS_INTERNAL_SERVER_LATENCY_TRACKER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Tracks a percentile of the latencies of the most recent requests, e.g. to
+// decide when a request is slow enough to be hedged.
+//
+// Thread safe. The percentile is recomputed every `kRecomputeInterval`
+// samples, so reading it is cheap.
+class LatencyTracker {
+ public:
+  // `percentile` is in (0, 100].
+  explicit LatencyTracker(double percentile, int num_samples = 1024);
+
+  void Record(absl::Duration latency);
+
+  // Returns the percentile of the recorded latencies, or an infinite duration
+  // until enough latencies are recorded.
+  absl::Duration Percentile() const;
+
+ private:
+  static constexpr int kRecomputeInterval = 64;
+
+  const double percentile_;
+  mutable absl::Mutex mutex_;
+  // Ring buffer of the latest latencies.
+  std::vector<absl::Duration> samples_ ABSL_GUARDED_BY(mutex_);
+  int64_t num_recorded_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::atomic<int64_t> percentile_nanos_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_LATENCY_TRACKER_H_
@@ -0,0 +1,54 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/latency_tracker.h"
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(LatencyTrackerTest, InfiniteUntilEnoughSamples) {
+  LatencyTracker tracker(/*percentile=*/90, /*num_samples=*/128);
+  for (int i = 0; i < 63; ++i) {
+    tracker.Record(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(tracker.Percentile(), absl::InfiniteDuration());
+  tracker.Record(absl::Milliseconds(1));
+  EXPECT_EQ(tracker.Percentile(), absl::Milliseconds(1));
+}
+
+TEST(LatencyTrackerTest, ComputesPercentile) {
+  LatencyTracker tracker(/*percentile=*/90, /*num_samples=*/128);
+  for (int i = 1; i <= 128; ++i) {
+    tracker.Record(absl::Milliseconds(i));
+  }
+  // ceil(0.9 * 128) = 116th smallest latency.
+  EXPECT_EQ(tracker.Percentile(), absl::Milliseconds(116));
+}
+
+TEST(LatencyTrackerTest, ForgetsOldestSamples) {
+  LatencyTracker tracker(/*percentile=*/50, /*num_samples=*/64);
+  for (int i = 0; i < 64; ++i) {
+    tracker.Record(absl::Seconds(1));
+  }
+  EXPECT_EQ(tracker.Percentile(), absl::Seconds(1));
+  for (int i = 0; i < 64; ++i) {
+    tracker.Record(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(tracker.Percentile(), absl::Milliseconds(1));
+}
+
+}  // namespace
+}  // namespace kv_server
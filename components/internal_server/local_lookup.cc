@@ -20,9 +20,12 @@
 #include <utility>
 #include <vector>
 
+#include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "components/data_server/cache/cache.h"
 #include "components/internal_server/lookup.h"
 #include "components/internal_server/lookup.pb.h"
+#include "components/internal_server/lookup_response_writer.h"
 #include "components/query/driver.h"
 #include "components/query/scanner.h"
 #include "glog/logging.h"
@@ -35,6 +38,7 @@ using privacy_sandbox::server_common::MetricsRecorder;
 using privacy_sandbox::server_common::ScopeLatencyRecorder;
 
 constexpr char kKeySetNotFound[] = "KeysetNotFound";
+constexpr char kKeyNotFound[] = "Key not found";
 constexpr char kLocalRunQuery[] = "LocalRunQuery";
 
 class LocalLookup : public Lookup {
@@ -47,6 +51,45 @@ class LocalLookup : public Lookup {
     return ProcessKeys(keys);
   }
 
+  absl::StatusOr<std::string> GetKeyValuesSerialized(
+      const absl::flat_hash_set<std::string_view>& keys) const override {
+    if (keys.empty()) {
+      return std::string();
+    }
+    const std::vector<std::string_view> key_list(keys.begin(), keys.end());
+    // Shared with the cache, so that the writer references them without a
+    // copy, and they outlive concurrent updates until the response is written.
+    const auto values = cache_.GetValues(key_list);
+    InternalLookupResponseWriter writer(key_list.size());
+    for (size_t i = 0; i < key_list.size(); ++i) {
+      if (values[i] != nullptr) {
+        writer.AddValue(key_list[i], *values[i]);
+      } else {
+        writer.AddStatus(key_list[i], absl::StatusCode::kNotFound,
+                         kKeyNotFound);
+      }
+    }
+    return writer.Serialize();
+  }
+
+  absl::Status AddKeyValues(absl::Span<const std::string_view> keys,
+                            InternalLookupResponse& response) const override {
+    const auto values = cache_.GetValues(keys);
+    auto& results = *response.mutable_kv_pairs();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      // Filled in place, a temporary result would be copied into the map.
+      SingleLookupResult& result = results[keys[i]];
+      if (values[i] != nullptr) {
+        result.set_value(*values[i]);
+      } else {
+        auto status = result.mutable_status();
+        status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
+        status->set_message(kKeyNotFound);
+      }
+    }
+    return absl::OkStatus();
+  }
+
   absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
       const absl::flat_hash_set<std::string_view>& key_set) const override {
     return ProcessKeysetKeys(key_set);
@@ -66,17 +109,18 @@ class LocalLookup : public Lookup {
     }
     auto kv_pairs = cache_.GetKeyValuePairs(keys);
 
+    auto& results = *response.mutable_kv_pairs();
     for (const auto& key : keys) {
-      SingleLookupResult result;
+      // Filled in place, a temporary result would be copied into the map.
+      SingleLookupResult& result = results[key];
       const auto key_iter = kv_pairs.find(key);
       if (key_iter == kv_pairs.end()) {
         auto status = result.mutable_status();
         status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
-        status->set_message("Key not found");
+        status->set_message(kKeyNotFound);
       } else {
         result.set_value(std::move(key_iter->second));
       }
-      (*response.mutable_kv_pairs())[key] = std::move(result);
     }
     return response;
   }
@@ -94,7 +138,7 @@ class LocalLookup : public Lookup {
       if (value_set.empty()) {
         auto status = result.mutable_status();
         status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
-        status->set_message("Key not found");
+        status->set_message(kKeyNotFound);
         metrics_recorder_.IncrementEventCounter(kKeySetNotFound);
       } else {
         auto keyset_values = result.mutable_keyset_values();
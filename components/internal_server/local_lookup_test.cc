@@ -16,21 +16,28 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "components/data_server/cache/key_value_cache.h"
 #include "components/data_server/cache/mocks.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 #include "public/test_util/proto_matcher.h"
 #include "src/cpp/telemetry/mocks.h"
+#include "src/cpp/telemetry/telemetry_provider.h"
 
 namespace kv_server {
 namespace {
 
 using google::protobuf::TextFormat;
 using privacy_sandbox::server_common::MockMetricsRecorder;
+using privacy_sandbox::server_common::TelemetryProvider;
 using testing::_;
 using testing::Return;
 using testing::ReturnRef;
@@ -116,6 +123,107 @@ TEST_F(LocalLookupTest, GetKeyValues_EmptyRequest_ReturnsEmptyResponse) {
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
+TEST_F(LocalLookupTest, GetKeyValuesSerialized_MatchesGetKeyValues) {
+  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_))
+      .Times(2)
+      .WillRepeatedly(Return(
+          absl::flat_hash_map<std::string, std::string>{{"key1", "value1"}}));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_, mock_metrics_recorder_);
+  auto serialized_response =
+      local_lookup->GetKeyValuesSerialized({"key1", "key2"});
+  ASSERT_TRUE(serialized_response.ok());
+  InternalLookupResponse response;
+  ASSERT_TRUE(response.ParseFromString(*serialized_response));
+  auto expected = local_lookup->GetKeyValues({"key1", "key2"});
+  ASSERT_TRUE(expected.ok());
+  EXPECT_THAT(response, EqualsProto(*expected));
+}
+
+TEST_F(LocalLookupTest, GetKeyValuesSerialized_EmptyRequest_ReturnsEmpty) {
+  auto local_lookup = CreateLocalLookup(mock_cache_, mock_metrics_recorder_);
+  auto serialized_response = local_lookup->GetKeyValuesSerialized({});
+  ASSERT_TRUE(serialized_response.ok());
+  EXPECT_TRUE(serialized_response->empty());
+}
+
+TEST_F(LocalLookupTest, AddKeyValues_AddsResultsToResponse) {
+  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_))
+      .WillOnce(Return(
+          absl::flat_hash_map<std::string, std::string>{{"key1", "value1"}}));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_, mock_metrics_recorder_);
+  InternalLookupResponse response;
+  (*response.mutable_kv_pairs())["key3"].set_value("value3");
+  const std::vector<std::string_view> keys = {"key1", "key2"};
+  ASSERT_TRUE(local_lookup->AddKeyValues(keys, response).ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key1"
+             value { value: "value1" }
+           }
+           kv_pairs {
+             key: "key2"
+             value { status { code: 5 message: "Key not found" } }
+           }
+           kv_pairs {
+             key: "key3"
+             value { value: "value3" }
+           }
+      )pb",
+      &expected);
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+TEST_F(LocalLookupTest, ConcurrentLookupsAndUpdates_ReturnWrittenValues) {
+  auto noop_metrics_recorder =
+      TelemetryProvider::GetInstance().CreateMetricsRecorder();
+  auto cache = KeyValueCache::Create(*noop_metrics_recorder);
+  cache->UpdateKeyValue("key1", "value0", 1);
+  auto local_lookup = CreateLocalLookup(*cache, *noop_metrics_recorder);
+  absl::Notification start;
+  auto lookup_fn = [&local_lookup, &start]() {
+    start.WaitForNotification();
+    for (int i = 0; i < 100; ++i) {
+      auto serialized_response =
+          local_lookup->GetKeyValuesSerialized({"key1", "key2"});
+      ASSERT_TRUE(serialized_response.ok());
+      InternalLookupResponse response;
+      ASSERT_TRUE(response.ParseFromString(*serialized_response));
+      EXPECT_THAT(response.kv_pairs().at("key1").value(),
+                  testing::StartsWith("value"));
+      EXPECT_EQ(response.kv_pairs().at("key2").status().code(),
+                static_cast<int>(absl::StatusCode::kNotFound));
+
+      InternalLookupResponse added_response;
+      const std::vector<std::string_view> keys = {"key1"};
+      ASSERT_TRUE(local_lookup->AddKeyValues(keys, added_response).ok());
+      EXPECT_THAT(added_response.kv_pairs().at("key1").value(),
+                  testing::StartsWith("value"));
+    }
+  };
+  auto update_fn = [&cache, &start]() {
+    start.WaitForNotification();
+    for (int i = 1; i <= 1000; ++i) {
+      // Long values, so that freed ones would be reported.
+      cache->UpdateKeyValue(
+          "key1", absl::StrCat("value", std::string(1000, 'a' + i % 26)),
+          i + 1);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back(lookup_fn);
+  }
+  threads.emplace_back(update_fn);
+  start.Notify();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST_F(LocalLookupTest, GetKeyValueSets_KeysFound_Success) {
   auto mock_get_key_value_set_result =
       std::make_unique<MockGetKeyValueSetResult>();
@@ -19,10 +19,14 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "components/internal_server/lookup.pb.h"
 
 namespace kv_server {
@@ -35,6 +39,42 @@ class Lookup {
   virtual absl::StatusOr<InternalLookupResponse> GetKeyValues(
       const absl::flat_hash_set<std::string_view>& keys) const = 0;
 
+  // Same as `GetKeyValues`, serialized. Overridden by lookups that can write
+  // the response without building it.
+  virtual absl::StatusOr<std::string> GetKeyValuesSerialized(
+      const absl::flat_hash_set<std::string_view>& keys) const {
+    auto response = GetKeyValues(keys);
+    if (!response.ok()) {
+      return response.status();
+    }
+    return response->SerializeAsString();
+  }
+
+  // Adds the results of `keys`, which must be distinct, to `response`. Keys
+  // without a result are added as not found. Overridden by lookups that can
+  // write the results in place, without a key set and a response of their own.
+  virtual absl::Status AddKeyValues(absl::Span<const std::string_view> keys,
+                                    InternalLookupResponse& response) const {
+    auto key_values = GetKeyValues(
+        absl::flat_hash_set<std::string_view>(keys.begin(), keys.end()));
+    if (!key_values.ok()) {
+      return key_values.status();
+    }
+    auto& kv_pairs = *key_values->mutable_kv_pairs();
+    auto& results = *response.mutable_kv_pairs();
+    for (const auto key : keys) {
+      SingleLookupResult& result = results[key];
+      if (const auto key_iter = kv_pairs.find(key);
+          key_iter != kv_pairs.end()) {
+        result = std::move(key_iter->second);
+      } else {
+        result.mutable_status()->set_code(
+            static_cast<int>(absl::StatusCode::kNotFound));
+      }
+    }
+    return absl::OkStatus();
+  }
+
   virtual absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
       const absl::flat_hash_set<std::string_view>& key_set) const = 0;
 
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "components/internal_server/lookup.pb.h"
+#include "components/internal_server/lookup_response_writer.h"
+
+using kv_server::InternalLookupResponse;
+using kv_server::InternalLookupResponseWriter;
+using kv_server::SingleLookupResult;
+
+constexpr int kValueSize = 64;
+
+// One in ten keys is missing, as in lookups spanning several shards.
+static std::vector<std::pair<std::string, std::string>> GenerateKeyValues(
+    int64_t num_keys) {
+  std::vector<std::pair<std::string, std::string>> key_values;
+  key_values.reserve(num_keys);
+  for (int64_t i = 0; i < num_keys; ++i) {
+    key_values.emplace_back(absl::StrCat("key", i),
+                            i % 10 == 0 ? "" : std::string(kValueSize, 'v'));
+  }
+  return key_values;
+}
+
+// Builds the response message and serializes it, as done before the writer.
+static void BM_SerializeLookupResponseMessage(benchmark::State& state) {
+  const auto key_values = GenerateKeyValues(state.range(0));
+  for (auto _ : state) {
+    InternalLookupResponse response;
+    for (const auto& [key, value] : key_values) {
+      SingleLookupResult result;
+      if (value.empty()) {
+        auto status = result.mutable_status();
+        status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
+        status->set_message("Key not found");
+      } else {
+        result.set_value(value);
+      }
+      (*response.mutable_kv_pairs())[key] = std::move(result);
+    }
+    benchmark::DoNotOptimize(response.SerializeAsString());
+  }
+  state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_WriteLookupResponse(benchmark::State& state) {
+  const auto key_values = GenerateKeyValues(state.range(0));
+  for (auto _ : state) {
+    InternalLookupResponseWriter writer(key_values.size());
+    for (const auto& [key, value] : key_values) {
+      if (value.empty()) {
+        writer.AddStatus(key, absl::StatusCode::kNotFound, "Key not found");
+      } else {
+        writer.AddValue(key, value);
+      }
+    }
+    benchmark::DoNotOptimize(writer.Serialize());
+  }
+  state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+BENCHMARK(BM_SerializeLookupResponseMessage)->Arg(1'000)->Arg(10'000);
+BENCHMARK(BM_WriteLookupResponse)->Arg(1'000)->Arg(10'000);
+
+BENCHMARK_MAIN();
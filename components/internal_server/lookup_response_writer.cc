@@ -0,0 +1,192 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/lookup_response_writer.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "components/internal_server/lookup.pb.h"
+#include "components/internal_server/string_padder.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+// Field numbers of the entries of `InternalLookupResponse.kv_pairs`.
+constexpr int kMapEntryKeyFieldNumber = 1;
+constexpr int kMapEntryValueFieldNumber = 2;
+
+size_t LengthDelimitedFieldSize(int field_number, size_t length) {
+  return CodedOutputStream::VarintSize32(WireFormatLite::MakeTag(
+             field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) +
+         WireFormatLite::LengthDelimitedSize(length);
+}
+
+uint8_t* WriteLengthDelimitedHeader(int field_number, size_t length,
+                                    uint8_t* target) {
+  target = WireFormatLite::WriteTagToArray(
+      field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, target);
+  return CodedOutputStream::WriteVarint32ToArray(length, target);
+}
+
+uint8_t* WriteBytes(int field_number, std::string_view bytes,
+                    uint8_t* target) {
+  target = WriteLengthDelimitedHeader(field_number, bytes.size(), target);
+  std::memcpy(target, bytes.data(), bytes.size());
+  return target + bytes.size();
+}
+
+// Size of a `google.rpc.Status`, default fields are omitted as in proto3.
+size_t StatusSize(absl::StatusCode code, std::string_view message) {
+  size_t size = 0;
+  if (code != absl::StatusCode::kOk) {
+    size += WireFormatLite::TagSize(google::rpc::Status::kCodeFieldNumber,
+                                    WireFormatLite::TYPE_INT32) +
+            WireFormatLite::Int32Size(static_cast<int32_t>(code));
+  }
+  if (!message.empty()) {
+    size += LengthDelimitedFieldSize(google::rpc::Status::kMessageFieldNumber,
+                                     message.size());
+  }
+  return size;
+}
+
+uint8_t* WriteStatus(absl::StatusCode code, std::string_view message,
+                     uint8_t* target) {
+  if (code != absl::StatusCode::kOk) {
+    target = WireFormatLite::WriteInt32ToArray(
+        google::rpc::Status::kCodeFieldNumber, static_cast<int32_t>(code),
+        target);
+  }
+  if (!message.empty()) {
+    target =
+        WriteBytes(google::rpc::Status::kMessageFieldNumber, message, target);
+  }
+  return target;
+}
+
+}  // namespace
+
+InternalLookupResponseWriter::InternalLookupResponseWriter(
+    size_t expected_num_keys) {
+  results_.reserve(expected_num_keys);
+}
+
+void InternalLookupResponseWriter::AddValue(std::string_view key,
+                                            std::string_view value) {
+  results_.push_back({.key = key,
+                      .data = value,
+                      .is_status = false,
+                      .status_code = absl::StatusCode::kOk});
+}
+
+void InternalLookupResponseWriter::AddStatus(std::string_view key,
+                                             absl::StatusCode code,
+                                             std::string_view message) {
+  results_.push_back(
+      {.key = key, .data = message, .is_status = true, .status_code = code});
+}
+
+std::string InternalLookupResponseWriter::Serialize() const {
+  // Sizes of the `SingleLookupResult`s and of the map entries, which prefix
+  // them on the wire.
+  std::vector<std::pair<size_t, size_t>> sizes;
+  sizes.reserve(results_.size());
+  size_t total_size = 0;
+  for (const Result& result : results_) {
+    const size_t result_size =
+        result.is_status
+            ? LengthDelimitedFieldSize(
+                  SingleLookupResult::kStatusFieldNumber,
+                  StatusSize(result.status_code, result.data))
+            : LengthDelimitedFieldSize(SingleLookupResult::kValueFieldNumber,
+                                       result.data.size());
+    const size_t entry_size =
+        LengthDelimitedFieldSize(kMapEntryKeyFieldNumber, result.key.size()) +
+        LengthDelimitedFieldSize(kMapEntryValueFieldNumber, result_size);
+    sizes.emplace_back(result_size, entry_size);
+    total_size += LengthDelimitedFieldSize(
+        InternalLookupResponse::kKvPairsFieldNumber, entry_size);
+  }
+
+  std::string output(total_size, '\0');
+  uint8_t* target = reinterpret_cast<uint8_t*>(output.data());
+  for (size_t i = 0; i < results_.size(); ++i) {
+    const Result& result = results_[i];
+    const auto [result_size, entry_size] = sizes[i];
+    target = WriteLengthDelimitedHeader(
+        InternalLookupResponse::kKvPairsFieldNumber, entry_size, target);
+    target = WriteBytes(kMapEntryKeyFieldNumber, result.key, target);
+    target = WriteLengthDelimitedHeader(kMapEntryValueFieldNumber, result_size,
+                                        target);
+    if (result.is_status) {
+      target = WriteLengthDelimitedHeader(
+          SingleLookupResult::kStatusFieldNumber,
+          StatusSize(result.status_code, result.data), target);
+      target = WriteStatus(result.status_code, result.data, target);
+    } else {
+      target = WriteBytes(SingleLookupResult::kValueFieldNumber, result.data,
+                          target);
+    }
+  }
+  DCHECK_EQ(target, reinterpret_cast<uint8_t*>(output.data()) + total_size);
+  return output;
+}
+
+void AppendResponsePadding(int32_t buckets_per_doubling,
+                           std::string& serialized_response) {
+  // At least an empty padding field is appended, so that padded responses
+  // are never empty.
+  const size_t min_field_size = LengthDelimitedFieldSize(
+      InternalLookupResponse::kPaddingFieldNumber, 0);
+  const size_t original_size = serialized_response.size();
+  size_t remaining =
+      RoundUpToBucket(original_size + min_field_size, buckets_per_doubling) -
+      original_size;
+  serialized_response.resize(original_size + remaining, '0');
+  uint8_t* target =
+      reinterpret_cast<uint8_t*>(serialized_response.data()) + original_size;
+  while (remaining > 0) {
+    DCHECK_GE(remaining, min_field_size);
+    // Sizes whose filler length doesn't fit in the remaining varint bytes,
+    // e.g. 130, are split into two fields. Parsing keeps the last one.
+    size_t filler_length = 0;
+    for (size_t length_size = 1; length_size <= 5; ++length_size) {
+      const size_t header_size = min_field_size - 1 + length_size;
+      if (remaining >= header_size &&
+          LengthDelimitedFieldSize(InternalLookupResponse::kPaddingFieldNumber,
+                                   remaining - header_size) == remaining) {
+        filler_length = remaining - header_size;
+        break;
+      }
+    }
+    // The filler is already in place.
+    WriteLengthDelimitedHeader(InternalLookupResponse::kPaddingFieldNumber,
+                               filler_length, target);
+    const size_t field_size = LengthDelimitedFieldSize(
+        InternalLookupResponse::kPaddingFieldNumber, filler_length);
+    target += field_size;
+    remaining -= field_size;
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_LOOKUP_RESPONSE_WRITER_H_
+#define COMPONENTS_INTERNAL_SERVER_LOOKUP_RESPONSE_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+
+namespace kv_server {
+
+// Writes a serialized `InternalLookupResponse` holding values and statuses
+// without building the message. The output is computed in one pass into a
+// buffer of the exact size, instead of allocating a `SingleLookupResult` and
+// a map node per key.
+//
+// Only references the added keys, values and messages, which must outlive the
+// writer.
+class InternalLookupResponseWriter {
+ public:
+  explicit InternalLookupResponseWriter(size_t expected_num_keys = 0);
+
+  void AddValue(std::string_view key, std::string_view value);
+  void AddStatus(std::string_view key, absl::StatusCode code,
+                 std::string_view message);
+
+  // Returns the serialized response. Parses into the same message as the one
+  // built with the same keys.
+  std::string Serialize() const;
+
+ private:
+  struct Result {
+    std::string_view key;
+    // Value, or status message if `is_status`.
+    std::string_view data;
+    bool is_status;
+    absl::StatusCode status_code;
+  };
+
+  std::vector<Result> results_;
+};
+
+// Appends an `InternalLookupResponse.padding` field to `serialized_response`
+// so that its size is rounded up to a bucket, see `RoundUpToBucket`. The
+// response is padded in place, without reframing it, and is never empty once
+// padded.
+void AppendResponsePadding(int32_t buckets_per_doubling,
+                           std::string& serialized_response);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_LOOKUP_RESPONSE_WRITER_H_
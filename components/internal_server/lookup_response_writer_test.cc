@@ -0,0 +1,102 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/lookup_response_writer.h"
+
+#include <string>
+
+#include "components/internal_server/lookup.pb.h"
+#include "components/internal_server/string_padder.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+
+TEST(InternalLookupResponseWriterTest, EmptyResponse) {
+  InternalLookupResponseWriter writer;
+  EXPECT_EQ(writer.Serialize(), "");
+}
+
+TEST(InternalLookupResponseWriterTest, WritesValuesAndStatuses) {
+  // Long enough for multi-byte lengths.
+  const std::string long_value(1000, 'v');
+  InternalLookupResponseWriter writer(/*expected_num_keys=*/4);
+  writer.AddValue("key1", "value1");
+  writer.AddValue("key2", long_value);
+  writer.AddValue("key3", "");
+  writer.AddStatus("key4", absl::StatusCode::kNotFound, "Key not found");
+  writer.AddStatus("key5", absl::StatusCode::kInternal, "");
+
+  InternalLookupResponse expected;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key1"
+             value { value: "value1" }
+           }
+           kv_pairs {
+             key: "key3"
+             value { value: "" }
+           }
+           kv_pairs {
+             key: "key4"
+             value { status { code: 5 message: "Key not found" } }
+           }
+           kv_pairs {
+             key: "key5"
+             value { status { code: 13 } }
+           })pb",
+      &expected));
+  (*expected.mutable_kv_pairs())["key2"].set_value(long_value);
+
+  const std::string serialized = writer.Serialize();
+  InternalLookupResponse response;
+  ASSERT_TRUE(response.ParseFromString(serialized));
+  EXPECT_THAT(response, EqualsProto(expected));
+  EXPECT_EQ(serialized.size(), expected.ByteSizeLong());
+}
+
+TEST(AppendResponsePaddingTest, PadsToBucket) {
+  // Covers multi-byte lengths, and the sizes that can't be padded with a
+  // single field.
+  for (int value_length = 0; value_length < 20000; ++value_length) {
+    InternalLookupResponse response;
+    (*response.mutable_kv_pairs())["key1"].set_value(
+        std::string(value_length, 'v'));
+    std::string padded = response.SerializeAsString();
+    const size_t unpadded_size = padded.size();
+    AppendResponsePadding(/*buckets_per_doubling=*/4, padded);
+    ASSERT_EQ(padded.size(), RoundUpToBucket(unpadded_size + 2, 4));
+    InternalLookupResponse padded_response;
+    ASSERT_TRUE(padded_response.ParseFromString(padded));
+    padded_response.clear_padding();
+    ASSERT_THAT(padded_response, EqualsProto(response));
+  }
+}
+
+TEST(AppendResponsePaddingTest, PaddedEmptyResponseIsNotEmpty) {
+  std::string padded;
+  AppendResponsePadding(/*buckets_per_doubling=*/1, padded);
+  EXPECT_EQ(padded.size(), 2);
+  InternalLookupResponse response;
+  ASSERT_TRUE(response.ParseFromString(padded));
+  EXPECT_THAT(response, EqualsProto(InternalLookupResponse()));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -14,6 +14,7 @@
 
 #include "components/internal_server/lookup_server_impl.h"
 
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -21,10 +22,14 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
 #include "components/data_server/request_handler/ohttp_server_encryptor.h"
 #include "components/internal_server/lookup.grpc.pb.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/lookup_response_writer.h"
+#include "components/internal_server/session_encryptor.h"
 #include "components/internal_server/string_padder.h"
 #include "glog/logging.h"
 #include "google/protobuf/message.h"
@@ -85,7 +90,10 @@ grpc::Status LookupServiceImpl::InternalLookup(
     return grpc::Status(grpc::StatusCode::CANCELLED,
                         "Deadline exceeded or client cancelled, abandoning.");
   }
+  // Read before the lookup, so that the version is never newer than the data.
+  const int64_t data_version = GetDataVersion();
   ProcessKeys(request->keys(), *response);
+  response->set_data_version(data_version);
   return grpc::Status::OK;
 }
 
@@ -125,10 +133,10 @@ grpc::Status LookupServiceImpl::SecureLookup(
                         "Failed parsing incoming request");
   }
 
-  auto payload_to_encrypt = GetPayload(request.lookup_sets(), request.keys());
+  auto payload_to_encrypt = GetPayload(request);
   if (payload_to_encrypt.empty()) {
-    // we cannot encrypt an empty payload. Note, that soon we will add logic
-    // to pad responses, so this branch will never be hit.
+    // OHTTP cannot encrypt an empty payload. Only unpadded responses can be
+    // empty.
     return grpc::Status::OK;
   }
   auto encrypted_response_payload =
@@ -141,15 +149,281 @@ grpc::Status LookupServiceImpl::SecureLookup(
   return grpc::Status::OK;
 }
 
+// Answers the lookups of a stream as they are read, so that a slow lookup
+// doesn't hold back the following ones. Only the writes are serialized, as the
+// stream allows a single write in flight.
+class LookupServiceImpl::SecureLookupStreamReactor
+    : public grpc::ServerBidiReactor<SecureLookupStreamRequest,
+                                     SecureLookupStreamResponse> {
+ public:
+  explicit SecureLookupStreamReactor(const LookupServiceImpl& service)
+      : service_(service) {
+    StartRead(&request_);
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      // The client is done writing, or the stream is broken.
+      EndReads(grpc::Status::OK);
+      return;
+    }
+    // Reads are started one at a time, so the session and the last request id
+    // are only accessed by one read at a time.
+    if (request_encryptor_ == nullptr) {
+      SecureLookupStreamResponse salt_response;
+      if (auto status = StartSession(request_.ohttp_session_key(),
+                                     salt_response);
+          !status.ok()) {
+        EndReads(std::move(status));
+        return;
+      }
+      VLOG(9) << "SecureLookupStream session established";
+      Write(std::move(salt_response));
+      StartRead(&request_);
+      return;
+    }
+    // Nonces are derived from the ids, which must not be reused.
+    if (request_.request_id() <= last_request_id_) {
+      EndReads(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                            "Request ids must be strictly increasing."));
+      return;
+    }
+    last_request_id_ = request_.request_id();
+    SecureLookupStreamRequest request = std::move(request_);
+    {
+      absl::MutexLock lock(&mutex_);
+      ++num_lookups_in_flight_;
+    }
+    StartRead(&request_);
+
+    SecureLookupStreamResponse response;
+    response.set_request_id(request.request_id());
+    auto payload_maybe = service_.GetSessionPayload(
+        *request_encryptor_, *response_encryptor_, request);
+    if (payload_maybe.ok()) {
+      response.set_encrypted_response(*std::move(payload_maybe));
+    } else {
+      response.mutable_status()->set_code(
+          static_cast<int>(payload_maybe.status().code()));
+      response.mutable_status()->set_message(
+          std::string(payload_maybe.status().message()));
+    }
+    Write(std::move(response));
+    {
+      absl::MutexLock lock(&mutex_);
+      --num_lookups_in_flight_;
+    }
+    MaybeFinish();
+  }
+
+  void OnWriteDone(bool ok) override {
+    const SecureLookupStreamResponse* next_response = nullptr;
+    {
+      absl::MutexLock lock(&mutex_);
+      write_queue_.pop_front();
+      if (!ok) {
+        // No further write can succeed, so the responses are dropped.
+        write_failed_ = true;
+        write_queue_.clear();
+      }
+      if (write_queue_.empty()) {
+        writing_ = false;
+      } else {
+        next_response = &write_queue_.front();
+      }
+    }
+    if (next_response != nullptr) {
+      StartWrite(next_response);
+    } else {
+      MaybeFinish();
+    }
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  // Derives the session keys from the OHTTP encrypted secret of the client and
+  // sets `salt_response` to the response that shares the salt.
+  grpc::Status StartSession(std::string_view ohttp_session_key,
+                            SecureLookupStreamResponse& salt_response) {
+    // The session secret and salt are the only messages of the session that
+    // pay for an HPKE setup.
+    OhttpServerEncryptor key_encryptor(service_.key_fetcher_manager_);
+    auto session_secret_maybe = key_encryptor.DecryptRequest(ohttp_session_key);
+    if (!session_secret_maybe.ok()) {
+      return service_.ToInternalGrpcStatus(session_secret_maybe.status(),
+                                           kDecryptionError);
+    }
+    auto request_encryptor_maybe =
+        SessionEncryptor::Derive(*session_secret_maybe, /*salt=*/"",
+                                 SessionEncryptor::Direction::kRequest);
+    if (!request_encryptor_maybe.ok()) {
+      return service_.ToInternalGrpcStatus(request_encryptor_maybe.status(),
+                                           kDecryptionError);
+    }
+    // Responses are encrypted under a key that depends on a fresh salt, so
+    // that a replayed stream never gets a different response under a used
+    // nonce.
+    const std::string salt = SessionEncryptor::GenerateKey();
+    auto response_encryptor_maybe =
+        SessionEncryptor::Derive(*session_secret_maybe, salt,
+                                 SessionEncryptor::Direction::kResponse);
+    if (!response_encryptor_maybe.ok()) {
+      return service_.ToInternalGrpcStatus(response_encryptor_maybe.status(),
+                                           kEncryptionError);
+    }
+    auto encrypted_salt_maybe = key_encryptor.EncryptResponse(salt);
+    if (!encrypted_salt_maybe.ok()) {
+      return service_.ToInternalGrpcStatus(encrypted_salt_maybe.status(),
+                                           kEncryptionError);
+    }
+    salt_response.set_ohttp_session_salt(*std::move(encrypted_salt_maybe));
+    request_encryptor_ = *std::move(request_encryptor_maybe);
+    response_encryptor_ = *std::move(response_encryptor_maybe);
+    return grpc::Status::OK;
+  }
+
+  // Queues `response`, and writes it right away if no write is in flight.
+  void Write(SecureLookupStreamResponse response) {
+    const SecureLookupStreamResponse* next_response = nullptr;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (write_failed_) {
+        return;
+      }
+      // Responses stay in place until written, as deque doesn't move elements
+      // on push_back.
+      write_queue_.push_back(std::move(response));
+      if (!writing_) {
+        writing_ = true;
+        next_response = &write_queue_.front();
+      }
+    }
+    if (next_response != nullptr) {
+      StartWrite(next_response);
+    }
+  }
+
+  // Stops reading, and finishes the stream with `status` once the responses
+  // of the lookups in flight are written.
+  void EndReads(grpc::Status status) {
+    {
+      absl::MutexLock lock(&mutex_);
+      reading_ = false;
+      status_ = std::move(status);
+    }
+    MaybeFinish();
+  }
+
+  void MaybeFinish() {
+    grpc::Status status;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (finished_ || reading_ || num_lookups_in_flight_ > 0 || writing_) {
+        return;
+      }
+      finished_ = true;
+      status = status_;
+    }
+    Finish(std::move(status));
+  }
+
+  const LookupServiceImpl& service_;
+  SecureLookupStreamRequest request_;
+  uint64_t last_request_id_ = 0;
+  std::unique_ptr<SessionEncryptor> request_encryptor_;
+  std::unique_ptr<SessionEncryptor> response_encryptor_;
+  absl::Mutex mutex_;
+  std::deque<SecureLookupStreamResponse> write_queue_ ABSL_GUARDED_BY(mutex_);
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  bool write_failed_ ABSL_GUARDED_BY(mutex_) = false;
+  bool reading_ ABSL_GUARDED_BY(mutex_) = true;
+  int num_lookups_in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool finished_ ABSL_GUARDED_BY(mutex_) = false;
+  grpc::Status status_ ABSL_GUARDED_BY(mutex_);
+};
+
+grpc::ServerBidiReactor<SecureLookupStreamRequest, SecureLookupStreamResponse>*
+LookupServiceImpl::SecureLookupStream(grpc::CallbackServerContext* context) {
+  return new SecureLookupStreamReactor(*this);
+}
+
+absl::StatusOr<std::string> LookupServiceImpl::GetSessionPayload(
+    const SessionEncryptor& request_encryptor,
+    const SessionEncryptor& response_encryptor,
+    const SecureLookupStreamRequest& request) const {
+  ScopeLatencyRecorder latency_recorder(std::string(kSecureLookup),
+                                        metrics_recorder_);
+  auto padded_serialized_request_maybe = request_encryptor.Decrypt(
+      SessionEncryptor::Direction::kRequest, request.request_id(),
+      request.encrypted_request());
+  if (!padded_serialized_request_maybe.ok()) {
+    metrics_recorder_.IncrementEventCounter(kDecryptionError);
+    return padded_serialized_request_maybe.status();
+  }
+  auto serialized_request_maybe = Unpad(*padded_serialized_request_maybe);
+  if (!serialized_request_maybe.ok()) {
+    metrics_recorder_.IncrementEventCounter(kUnpaddingError);
+    return serialized_request_maybe.status();
+  }
+  InternalLookupRequest lookup_request;
+  if (!lookup_request.ParseFromString(*serialized_request_maybe)) {
+    metrics_recorder_.IncrementEventCounter(kDeserializationError);
+    return absl::InvalidArgumentError("Failed parsing incoming request");
+  }
+  // Unlike OHTTP, the session can encrypt an empty payload.
+  std::string payload = GetPayload(lookup_request);
+  if (auto status = response_encryptor.EncryptInPlace(
+          SessionEncryptor::Direction::kResponse, request.request_id(),
+          payload);
+      !status.ok()) {
+    metrics_recorder_.IncrementEventCounter(kEncryptionError);
+    return status;
+  }
+  return payload;
+}
+
 std::string LookupServiceImpl::GetPayload(
+    const InternalLookupRequest& request) const {
+  std::string payload =
+      GetUnpaddedPayload(request.lookup_sets(), request.keys());
+  if (request.response_padding_buckets_per_doubling() > 0) {
+    AppendResponsePadding(request.response_padding_buckets_per_doubling(),
+                          payload);
+  }
+  return payload;
+}
+
+std::string LookupServiceImpl::GetUnpaddedPayload(
     const bool lookup_sets, const RepeatedPtrField<std::string>& keys) const {
-  InternalLookupResponse response;
+  // Read before the lookup, so that the version is never newer than the data.
+  const int64_t data_version = GetDataVersion();
   if (lookup_sets) {
+    InternalLookupResponse response;
     ProcessKeysetKeys(keys, response);
-  } else {
-    ProcessKeys(keys, response);
+    response.set_data_version(data_version);
+    return response.SerializeAsString();
+  }
+  if (keys.empty()) return "";
+  const absl::flat_hash_set<std::string_view> key_set(keys.begin(),
+                                                      keys.end());
+  // Values are written to the payload directly, without building the
+  // response message first.
+  auto serialized_response = lookup_.GetKeyValuesSerialized(key_set);
+  if (!serialized_response.ok()) return "";
+  if (data_version != 0) {
+    // Parsing concatenated messages merges them.
+    InternalLookupResponse version;
+    version.set_data_version(data_version);
+    version.AppendToString(&*serialized_response);
   }
-  return response.SerializeAsString();
+  return *std::move(serialized_response);
+}
+
+int64_t LookupServiceImpl::GetDataVersion() const {
+  return data_version_ == nullptr
+             ? 0
+             : data_version_->load(std::memory_order_relaxed);
 }
 
 grpc::Status LookupServiceImpl::InternalRunQuery(
@@ -17,10 +17,13 @@
 #ifndef COMPONENTS_INTERNAL_SERVER_LOOKUP_SERVER_IMPL_H_
 #define COMPONENTS_INTERNAL_SERVER_LOOKUP_SERVER_IMPL_H_
 
+#include <atomic>
 #include <string>
 
+#include "absl/status/statusor.h"
 #include "components/internal_server/lookup.grpc.pb.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/session_encryptor.h"
 #include "grpcpp/grpcpp.h"
 #include "src/cpp/encryption/key_fetcher/interface/key_fetcher_manager_interface.h"
 #include "src/cpp/telemetry/metrics_recorder.h"
@@ -29,16 +32,22 @@
 namespace kv_server {
 // Implements the internal lookup service for the data store.
 class LookupServiceImpl final
-    : public kv_server::InternalLookupService::Service {
+    : public kv_server::InternalLookupService::
+          WithCallbackMethod_SecureLookupStream<
+              kv_server::InternalLookupService::Service> {
  public:
+  // If not null, `data_version` is the version of the data of `lookup`, which
+  // is reported in responses.
   LookupServiceImpl(
       const Lookup& lookup,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
-      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder)
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+      const std::atomic<int64_t>* data_version = nullptr)
       : lookup_(lookup),
         key_fetcher_manager_(key_fetcher_manager),
-        metrics_recorder_(metrics_recorder) {}
+        metrics_recorder_(metrics_recorder),
+        data_version_(data_version) {}
 
   ~LookupServiceImpl() override = default;
 
@@ -51,15 +60,31 @@ class LookupServiceImpl final
                             const kv_server::SecureLookupRequest* request,
                             kv_server::SecureLookupResponse* response) override;
 
+  // Establishes a session with the secret of the first request and answers
+  // with the salt of the response key, then answers the lookups of the
+  // following requests concurrently, in any order.
+  grpc::ServerBidiReactor<kv_server::SecureLookupStreamRequest,
+                          kv_server::SecureLookupStreamResponse>*
+  SecureLookupStream(grpc::CallbackServerContext* context) override;
+
   grpc::Status InternalRunQuery(
       grpc::ServerContext* context,
       const kv_server::InternalRunQueryRequest* request,
       kv_server::InternalRunQueryResponse* response) override;
 
  private:
-  std::string GetPayload(
+  class SecureLookupStreamReactor;
+
+  // Returns the serialized response to `request`, padded as requested.
+  std::string GetPayload(const InternalLookupRequest& request) const;
+  std::string GetUnpaddedPayload(
       const bool lookup_sets,
       const google::protobuf::RepeatedPtrField<std::string>& keys) const;
+  // Returns the encrypted payload for the lookup of `request`.
+  absl::StatusOr<std::string> GetSessionPayload(
+      const SessionEncryptor& request_encryptor,
+      const SessionEncryptor& response_encryptor,
+      const SecureLookupStreamRequest& request) const;
   void ProcessKeys(const google::protobuf::RepeatedPtrField<std::string>& keys,
                    InternalLookupResponse& response) const;
   void ProcessKeysetKeys(
@@ -67,10 +92,12 @@ class LookupServiceImpl final
       InternalLookupResponse& response) const;
   grpc::Status ToInternalGrpcStatus(const absl::Status& status,
                                     const char* eventName) const;
+  int64_t GetDataVersion() const;
   const Lookup& lookup_;
   privacy_sandbox::server_common::KeyFetcherManagerInterface&
       key_fetcher_manager_;
   privacy_sandbox::server_common::MetricsRecorder& metrics_recorder_;
+  const std::atomic<int64_t>* data_version_;
 };
 
 }  // namespace kv_server
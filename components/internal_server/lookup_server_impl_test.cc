@@ -15,6 +15,7 @@
 
 #include "components/internal_server/lookup_server_impl.h"
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <utility>
@@ -45,7 +46,8 @@ class LookupServiceImplTest : public ::testing::Test {
  protected:
   LookupServiceImplTest() {
     lookup_service_ = std::make_unique<LookupServiceImpl>(
-        mock_lookup_, fake_key_fetcher_manager_, mock_metrics_recorder_);
+        mock_lookup_, fake_key_fetcher_manager_, mock_metrics_recorder_,
+        &data_version_);
     grpc::ServerBuilder builder;
     builder.RegisterService(lookup_service_.get());
     server_ = (builder.BuildAndStart());
@@ -61,6 +63,7 @@ class LookupServiceImplTest : public ::testing::Test {
   MockLookup mock_lookup_;
   privacy_sandbox::server_common::FakeKeyFetcherManager
       fake_key_fetcher_manager_;
+  std::atomic<int64_t> data_version_ = 0;
   std::unique_ptr<LookupServiceImpl> lookup_service_;
   std::unique_ptr<grpc::Server> server_;
   std::unique_ptr<InternalLookupService::Stub> stub_;
@@ -91,6 +94,23 @@ TEST_F(LookupServiceImplTest, InternalLookup_Success) {
   EXPECT_THAT(response, EqualsProto(expected));
 }
 
+TEST_F(LookupServiceImplTest, InternalLookup_ReportsDataVersion) {
+  data_version_ = 42;
+  InternalLookupRequest request;
+  request.add_keys("key1");
+  InternalLookupResponse lookup_response;
+  (*lookup_response.mutable_kv_pairs())["key1"].set_value("value1");
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_)).WillOnce(Return(lookup_response));
+
+  InternalLookupResponse response;
+  grpc::ClientContext context;
+
+  grpc::Status status = stub_->InternalLookup(&context, request, &response);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(response.data_version(), 42);
+  EXPECT_EQ(response.kv_pairs().at("key1").value(), "value1");
+}
+
 TEST_F(LookupServiceImplTest,
        InternalLookup_LookupReturnsStatus_EmptyResponse) {
   InternalLookupRequest request;
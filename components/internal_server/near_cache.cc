@@ -0,0 +1,117 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/near_cache.h"
+
+#include <iterator>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+
+namespace kv_server {
+namespace {
+
+// Accounts for the list node and the index slot of an entry.
+constexpr int64_t kEntryOverheadBytes = 64;
+
+// Other statuses are errors of the lookup rather than data.
+bool IsCacheable(const SingleLookupResult& result) {
+  return result.has_value() ||
+         (result.has_status() &&
+          result.status().code() ==
+              static_cast<int>(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+
+NearCache::NearCache(int32_t num_shards, Options options)
+    : options_(std::move(options)), shards_(num_shards) {}
+
+std::optional<SingleLookupResult> NearCache::Get(int32_t shard_num,
+                                                 std::string_view key) {
+  absl::MutexLock lock(&mu_);
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    return std::nullopt;
+  }
+  const auto entry = it->second;
+  if (entry->shard_num != shard_num ||
+      entry->generation != shards_[shard_num].generation ||
+      absl::Now() - entry->insert_time > options_.max_age) {
+    EraseLocked(entry);
+    return std::nullopt;
+  }
+  entries_.splice(entries_.begin(), entries_, entry);
+  return entry->result;
+}
+
+void NearCache::Put(int32_t shard_num, std::string_view replica,
+                    const std::vector<std::string_view>& keys,
+                    const InternalLookupResponse& response) {
+  const absl::Time now = absl::Now();
+  absl::MutexLock lock(&mu_);
+  Shard& shard = shards_[shard_num];
+  const int64_t data_version = response.data_version();
+  if (auto [it, inserted] =
+          shard.data_versions.try_emplace(std::string(replica), data_version);
+      !inserted) {
+    if (data_version < it->second) {
+      // Served before an update this replica already reported.
+      return;
+    }
+    if (data_version > it->second) {
+      it->second = data_version;
+      // Entries of the old generation are dropped as they are found.
+      ++shard.generation;
+    }
+  }
+  for (const auto key : keys) {
+    const auto result_iter = response.kv_pairs().find(key);
+    if (result_iter == response.kv_pairs().end() ||
+        !IsCacheable(result_iter->second)) {
+      continue;
+    }
+    Entry new_entry{.key = std::string(key),
+                    .result = result_iter->second,
+                    .shard_num = shard_num,
+                    .generation = shard.generation,
+                    .insert_time = now};
+    const int64_t new_entry_size = EntrySize(new_entry);
+    if (new_entry_size > options_.max_bytes) {
+      continue;
+    }
+    if (const auto it = index_.find(new_entry.key); it != index_.end()) {
+      EraseLocked(it->second);
+    }
+    while (size_bytes_ + new_entry_size > options_.max_bytes) {
+      EraseLocked(std::prev(entries_.end()));
+    }
+    entries_.push_front(std::move(new_entry));
+    index_.emplace(entries_.front().key, entries_.begin());
+    size_bytes_ += new_entry_size;
+  }
+}
+
+int64_t NearCache::EntrySize(const Entry& entry) {
+  return entry.key.size() + entry.result.ByteSizeLong() + kEntryOverheadBytes;
+}
+
+void NearCache::EraseLocked(std::list<Entry>::iterator it) {
+  size_bytes_ -= EntrySize(*it);
+  index_.erase(it->key);
+  entries_.erase(it);
+}
+
+}  // namespace kv_server
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_NEAR_CACHE_H_
+#define COMPONENTS_INTERNAL_SERVER_NEAR_CACHE_H_
+
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/internal_server/lookup.pb.h"
+
+namespace kv_server {
+
+// Memory bounded LRU cache of the values looked up on remote shards, so that
+// popular keys are not fetched over the network for every lookup.
+//
+// Responses of remote shards carry the data version of the replica that
+// served them, which changes whenever the replica applies a data update. When
+// a replica reports a newer version, all the entries of its shard are
+// invalidated. Updates are only observed through responses, so `max_age`
+// bounds how stale entries can get.
+//
+// Thread safe.
+class NearCache {
+ public:
+  struct Options {
+    // Upper bound of the size of all keys and results held by the cache.
+    int64_t max_bytes = 64 << 20;
+    // Entries older than this are not returned.
+    absl::Duration max_age = absl::Seconds(1);
+  };
+
+  NearCache(int32_t num_shards, Options options);
+
+  NearCache(const NearCache&) = delete;
+  NearCache& operator=(const NearCache&) = delete;
+
+  // Returns the cached result of `key`, which belongs to `shard_num`, if any.
+  std::optional<SingleLookupResult> Get(int32_t shard_num,
+                                        std::string_view key);
+
+  // Caches the results of `keys` in `response`, served by `replica` of
+  // `shard_num`. Only values and not found statuses are cached. Nothing is
+  // cached if `replica` already reported a newer data version.
+  void Put(int32_t shard_num, std::string_view replica,
+           const std::vector<std::string_view>& keys,
+           const InternalLookupResponse& response);
+
+ private:
+  struct Entry {
+    std::string key;
+    SingleLookupResult result;
+    int32_t shard_num;
+    // Generation of the shard when the entry was inserted.
+    int64_t generation;
+    absl::Time insert_time;
+  };
+
+  struct Shard {
+    // Incremented whenever the entries of the shard are invalidated.
+    int64_t generation = 0;
+    // Last data version reported by each replica of the shard.
+    absl::flat_hash_map<std::string, int64_t> data_versions;
+  };
+
+  static int64_t EntrySize(const Entry& entry);
+  void EraseLocked(std::list<Entry>::iterator it)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+  absl::Mutex mu_;
+  std::vector<Shard> shards_ ABSL_GUARDED_BY(mu_);
+  int64_t size_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+  // Most recently used first.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mu_);
+  // Keys point into `entries_`.
+  absl::flat_hash_map<std::string_view, std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_NEAR_CACHE_H_
@@ -0,0 +1,98 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/near_cache.h"
+
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+InternalLookupResponse MakeResponse(int64_t data_version) {
+  InternalLookupResponse response;
+  response.set_data_version(data_version);
+  (*response.mutable_kv_pairs())["key1"].set_value("value1");
+  (*response.mutable_kv_pairs())["key2"].mutable_status()->set_code(
+      static_cast<int>(absl::StatusCode::kNotFound));
+  (*response.mutable_kv_pairs())["key3"].mutable_status()->set_code(
+      static_cast<int>(absl::StatusCode::kInternal));
+  return response;
+}
+
+const std::vector<std::string_view> kKeys = {"key1", "key2", "key3"};
+
+TEST(NearCacheTest, CachesValuesAndNotFound) {
+  NearCache cache(/*num_shards=*/2, {});
+  const InternalLookupResponse response = MakeResponse(1);
+  cache.Put(1, "replica1", kKeys, response);
+  auto result = cache.Get(1, "key1");
+  ASSERT_TRUE(result.has_value());
+  EXPECT_THAT(*result, EqualsProto(response.kv_pairs().at("key1")));
+  result = cache.Get(1, "key2");
+  ASSERT_TRUE(result.has_value());
+  EXPECT_THAT(*result, EqualsProto(response.kv_pairs().at("key2")));
+  EXPECT_FALSE(cache.Get(1, "key3").has_value());
+  EXPECT_FALSE(cache.Get(1, "key4").has_value());
+}
+
+TEST(NearCacheTest, NewerDataVersionInvalidatesShard) {
+  NearCache cache(/*num_shards=*/2, {});
+  cache.Put(1, "replica1", {"key1"}, MakeResponse(1));
+  // Versions of different replicas are not compared.
+  cache.Put(1, "replica2", {"key2"}, MakeResponse(100));
+  EXPECT_TRUE(cache.Get(1, "key1").has_value());
+  EXPECT_TRUE(cache.Get(1, "key2").has_value());
+
+  cache.Put(1, "replica1", {}, MakeResponse(2));
+  EXPECT_FALSE(cache.Get(1, "key1").has_value());
+  EXPECT_FALSE(cache.Get(1, "key2").has_value());
+}
+
+TEST(NearCacheTest, OlderDataVersionIsNotCached) {
+  NearCache cache(/*num_shards=*/2, {});
+  cache.Put(1, "replica1", {}, MakeResponse(2));
+  cache.Put(1, "replica1", {"key1"}, MakeResponse(1));
+  EXPECT_FALSE(cache.Get(1, "key1").has_value());
+}
+
+TEST(NearCacheTest, ExpiresEntries) {
+  NearCache cache(/*num_shards=*/2, {.max_age = absl::Milliseconds(10)});
+  cache.Put(1, "replica1", {"key1"}, MakeResponse(1));
+  EXPECT_TRUE(cache.Get(1, "key1").has_value());
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_FALSE(cache.Get(1, "key1").has_value());
+}
+
+TEST(NearCacheTest, EvictsLeastRecentlyUsed) {
+  // Fits two entries but not three.
+  NearCache cache(/*num_shards=*/2, {.max_bytes = 200});
+  cache.Put(1, "replica1", {"key1", "key2"}, MakeResponse(1));
+  EXPECT_TRUE(cache.Get(1, "key1").has_value());
+  InternalLookupResponse response;
+  response.set_data_version(1);
+  (*response.mutable_kv_pairs())["key4"].set_value("value4");
+  cache.Put(1, "replica1", {"key4"}, response);
+  EXPECT_TRUE(cache.Get(1, "key1").has_value());
+  EXPECT_FALSE(cache.Get(1, "key2").has_value());
+  EXPECT_TRUE(cache.Get(1, "key4").has_value());
+}
+
+}  // namespace
+}  // namespace kv_server
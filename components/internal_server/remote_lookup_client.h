@@ -19,16 +19,27 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"
 #include "absl/status/statusor.h"
 #include "components/internal_server/lookup.grpc.pb.h"
+#include "grpcpp/grpcpp.h"
 #include "src/cpp/encryption/key_fetcher/interface/key_fetcher_manager_interface.h"
 #include "src/cpp/telemetry/metrics_recorder.h"
 #include "src/cpp/telemetry/telemetry.h"
 
 namespace kv_server {
 
+struct RemoteLookupClientOptions {
+  // Sends the lookups over one long-lived SecureLookupStream session instead
+  // of one SecureLookup call each, so that the HPKE setup is paid once per
+  // session. Per-lookup cancellation is not supported on the stream, a
+  // cancelled lookup still completes, but ShardedLookup doesn't wait for it.
+  bool use_lookup_stream = false;
+};
+
 class RemoteLookupClient {
  public:
   virtual ~RemoteLookupClient() = default;
@@ -39,17 +50,32 @@ class RemoteLookupClient {
   // with preventing double serialization.
   virtual absl::StatusOr<InternalLookupResponse> GetValues(
       std::string_view serialized_message, int32_t padding_length) const = 0;
+  // Asynchronous version of GetValues that does not block the calling thread
+  // on the remote server. `on_done` is called with the response, usually from
+  // a gRPC thread. `serialized_message` only needs to outlive this call,
+  // `context` must stay valid until `on_done` is called. The call can be
+  // bounded with `context.set_deadline` and cancelled with
+  // `context.TryCancel`.
+  virtual void GetValuesAsync(
+      grpc::ClientContext& context, std::string_view serialized_message,
+      int32_t padding_length,
+      absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+          on_done) const {
+    std::move(on_done)(GetValues(serialized_message, padding_length));
+  }
   virtual std::string_view GetIpAddress() const = 0;
   static std::unique_ptr<RemoteLookupClient> Create(
       std::string ip_address,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
-      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder);
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+      RemoteLookupClientOptions options = {});
   static std::unique_ptr<RemoteLookupClient> Create(
       std::unique_ptr<InternalLookupService::Stub> stub,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
-      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder);
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+      RemoteLookupClientOptions options = {});
 };
 
 }  // namespace kv_server
@@ -11,18 +11,29 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "components/data_server/request_handler/ohttp_client_encryptor.h"
 #include "components/internal_server/constants.h"
 #include "components/internal_server/lookup.grpc.pb.h"
 #include "components/internal_server/remote_lookup_client.h"
+#include "components/internal_server/session_encryptor.h"
 #include "components/internal_server/string_padder.h"
 #include "glog/logging.h"
+#include "grpcpp/alarm.h"
 #include "grpcpp/grpcpp.h"
 
 namespace kv_server {
@@ -35,6 +46,341 @@ constexpr char kSecureLookupFailure[] = "SecureLookupFailure";
 constexpr char kDecryptionFailure[] = "DecryptionFailure";
 constexpr char kRemoteLookupGetValues[] = "RemoteLookupGetValues";
 
+using LookupCallback =
+    absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>;
+
+// Client side of a SecureLookupStream session. Lookups are encrypted with the
+// request key, written to the stream one at a time, in the order of their
+// ids, and matched with their responses by request id. Responses are only
+// decrypted once the first response has brought the salt of their key. Once
+// the stream is done the pending lookups fail, and the session must outlive
+// the stub until it is finished.
+class LookupSession final
+    : public grpc::ClientBidiReactor<SecureLookupStreamRequest,
+                                     SecureLookupStreamResponse>,
+      public std::enable_shared_from_this<LookupSession> {
+ public:
+  LookupSession(const LookupSession&) = delete;
+  LookupSession& operator=(const LookupSession&) = delete;
+
+  // Starts the stream and sends the session secret, encrypted with OHTTP.
+  static absl::StatusOr<std::shared_ptr<LookupSession>> Start(
+      InternalLookupService::Stub& stub,
+      privacy_sandbox::server_common::KeyFetcherManagerInterface&
+          key_fetcher_manager,
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder) {
+    std::string session_secret = SessionEncryptor::GenerateKey();
+    auto request_encryptor_maybe = SessionEncryptor::Derive(
+        session_secret, /*salt=*/"", SessionEncryptor::Direction::kRequest);
+    if (!request_encryptor_maybe.ok()) {
+      return request_encryptor_maybe.status();
+    }
+    // Kept to decrypt the salt of the response key.
+    auto key_encryptor =
+        std::make_unique<OhttpClientEncryptor>(key_fetcher_manager);
+    auto encrypted_session_secret_maybe =
+        key_encryptor->EncryptRequest(session_secret);
+    if (!encrypted_session_secret_maybe.ok()) {
+      metrics_recorder.IncrementEventCounter(kEncryptionFailure);
+      return encrypted_session_secret_maybe.status();
+    }
+    // Not using make_shared, as the constructor is private.
+    std::shared_ptr<LookupSession> session(new LookupSession(
+        *std::move(request_encryptor_maybe), std::move(session_secret),
+        std::move(key_encryptor), metrics_recorder));
+    const SecureLookupStreamRequest* key_request = nullptr;
+    {
+      absl::MutexLock lock(&session->mutex_);
+      SecureLookupStreamRequest& request =
+          session->write_queue_.emplace_back();
+      request.set_ohttp_session_key(
+          *std::move(encrypted_session_secret_maybe));
+      key_request = &request;
+      session->writing_ = true;
+    }
+    stub.async()->SecureLookupStream(&session->context_, session.get());
+    // Lookups are written from outside of the reactions, the hold is removed
+    // once no more writes will be started.
+    session->AddHold();
+    session->StartWrite(key_request);
+    session->StartRead(&session->response_);
+    session->StartCall();
+    return session;
+  }
+
+  // Sends the lookup. `on_done` is called with its response, or with an error
+  // if `deadline` passes or the stream fails first.
+  void SendLookup(std::string_view serialized_message, int32_t padding_length,
+                  std::chrono::system_clock::time_point deadline,
+                  LookupCallback on_done) {
+    // Pads and encrypts in a single buffer, sized for both up front.
+    std::string request;
+    request.reserve(PaddedLength(serialized_message, padding_length) +
+                    SessionEncryptor::kOverhead);
+    AppendPadded(serialized_message, padding_length, request);
+    absl::Status failure;
+    const SecureLookupStreamRequest* request_to_write = nullptr;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (done_) {
+        failure = absl::UnavailableError("Lookup session is done");
+      } else {
+        // Ids are assigned in the order of the writes, since the server
+        // requires them to increase.
+        const uint64_t request_id = ++last_request_id_;
+        failure = request_encryptor_->EncryptInPlace(
+            SessionEncryptor::Direction::kRequest, request_id, request);
+        if (failure.ok()) {
+          request_to_write = Enqueue(request_id, deadline, std::move(on_done),
+                                     std::move(request));
+        } else {
+          metrics_recorder_.IncrementEventCounter(kEncryptionFailure);
+        }
+      }
+    }
+    if (!failure.ok()) {
+      std::move(on_done)(std::move(failure));
+      return;
+    }
+    if (request_to_write != nullptr) {
+      StartWrite(request_to_write);
+    }
+  }
+
+  // Whether lookups fail right away because the stream is done.
+  bool IsDone() const {
+    absl::MutexLock lock(&mutex_);
+    return done_;
+  }
+
+  // Whether all the operations of the stream are completed.
+  bool IsFinished() const {
+    absl::MutexLock lock(&mutex_);
+    return finished_;
+  }
+
+  void Cancel() { context_.TryCancel(); }
+
+  void WaitUntilFinished() const {
+    absl::MutexLock lock(&mutex_, absl::Condition(&finished_));
+  }
+
+  void OnWriteDone(bool ok) override {
+    const SecureLookupStreamRequest* request_to_write = nullptr;
+    bool remove_hold = false;
+    {
+      absl::MutexLock lock(&mutex_);
+      write_queue_.pop_front();
+      if (!ok) {
+        done_ = true;
+      }
+      if (done_) {
+        write_queue_.clear();
+      }
+      if (write_queue_.empty()) {
+        writing_ = false;
+      } else {
+        request_to_write = &write_queue_.front();
+      }
+      remove_hold = ShouldRemoveHoldLocked();
+    }
+    if (request_to_write != nullptr) {
+      StartWrite(request_to_write);
+    }
+    if (remove_hold) {
+      RemoveHold();
+    }
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      bool remove_hold = false;
+      {
+        absl::MutexLock lock(&mutex_);
+        done_ = true;
+        remove_hold = ShouldRemoveHoldLocked();
+      }
+      if (remove_hold) {
+        RemoveHold();
+      }
+      return;
+    }
+    SecureLookupStreamResponse response = std::move(response_);
+    if (response_encryptor_ == nullptr) {
+      // The first response only brings the salt of the response key.
+      if (auto status = SetResponseKey(response); !status.ok()) {
+        metrics_recorder_.IncrementEventCounter(kDecryptionFailure);
+        LOG(ERROR) << "Failed to establish the lookup session: " << status;
+        // Fails the pending lookups once the stream is done.
+        context_.TryCancel();
+      }
+      StartRead(&response_);
+      return;
+    }
+    StartRead(&response_);
+    Finish(response.request_id(), ProcessResponse(response));
+  }
+
+  void OnDone(const grpc::Status& status) override {
+    if (!status.ok()) {
+      metrics_recorder_.IncrementEventCounter(kSecureLookupFailure);
+      LOG(ERROR) << status.error_code() << ": " << status.error_message();
+    }
+    const absl::Status error =
+        status.ok() ? absl::UnavailableError("Lookup session ended")
+                    : absl::Status((absl::StatusCode)status.error_code(),
+                                   status.error_message());
+    absl::flat_hash_map<uint64_t, PendingLookup> pending;
+    {
+      absl::MutexLock lock(&mutex_);
+      done_ = true;
+      pending.swap(pending_);
+    }
+    for (auto& [request_id, pending_lookup] : pending) {
+      pending_lookup.deadline_alarm.reset();
+      std::move(pending_lookup.on_done)(error);
+    }
+    // Last, as the session may be destroyed right after.
+    absl::MutexLock lock(&mutex_);
+    finished_ = true;
+  }
+
+ private:
+  struct PendingLookup {
+    LookupCallback on_done;
+    std::unique_ptr<grpc::Alarm> deadline_alarm;
+  };
+
+  LookupSession(
+      std::unique_ptr<SessionEncryptor> request_encryptor,
+      std::string session_secret,
+      std::unique_ptr<OhttpClientEncryptor> key_encryptor,
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder)
+      : request_encryptor_(std::move(request_encryptor)),
+        metrics_recorder_(metrics_recorder),
+        session_secret_(std::move(session_secret)),
+        key_encryptor_(std::move(key_encryptor)) {}
+
+  absl::Status SetResponseKey(SecureLookupStreamResponse& response) {
+    if (response.ohttp_session_salt().empty()) {
+      return absl::InvalidArgumentError("Missing session salt");
+    }
+    auto salt_maybe = key_encryptor_->DecryptResponse(
+        std::move(*response.mutable_ohttp_session_salt()));
+    if (!salt_maybe.ok()) {
+      return salt_maybe.status();
+    }
+    auto response_encryptor_maybe = SessionEncryptor::Derive(
+        session_secret_, salt_maybe->GetPlaintextData(),
+        SessionEncryptor::Direction::kResponse);
+    if (!response_encryptor_maybe.ok()) {
+      return response_encryptor_maybe.status();
+    }
+    response_encryptor_ = *std::move(response_encryptor_maybe);
+    key_encryptor_.reset();
+    session_secret_.clear();
+    return absl::OkStatus();
+  }
+
+  absl::StatusOr<InternalLookupResponse> ProcessResponse(
+      const SecureLookupStreamResponse& secure_response) const {
+    if (secure_response.has_status()) {
+      metrics_recorder_.IncrementEventCounter(kSecureLookupFailure);
+      return absl::Status(
+          (absl::StatusCode)secure_response.status().code(),
+          secure_response.status().message());
+    }
+    auto decrypted_response_maybe = response_encryptor_->Decrypt(
+        SessionEncryptor::Direction::kResponse, secure_response.request_id(),
+        secure_response.encrypted_response());
+    if (!decrypted_response_maybe.ok()) {
+      metrics_recorder_.IncrementEventCounter(kDecryptionFailure);
+      return decrypted_response_maybe.status();
+    }
+    InternalLookupResponse response;
+    if (!response.ParseFromString(*decrypted_response_maybe)) {
+      return absl::InvalidArgumentError("Failed parsing the response.");
+    }
+    response.clear_padding();
+    return response;
+  }
+
+  // Adds the lookup to the pending ones and queues its request. Returns the
+  // request to write if no write is in flight.
+  const SecureLookupStreamRequest* Enqueue(
+      uint64_t request_id, std::chrono::system_clock::time_point deadline,
+      LookupCallback on_done, std::string encrypted_request)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    PendingLookup& pending = pending_[request_id];
+    pending.on_done = std::move(on_done);
+    if (deadline != std::chrono::system_clock::time_point::max()) {
+      pending.deadline_alarm = std::make_unique<grpc::Alarm>();
+      pending.deadline_alarm->Set(
+          deadline, [session = weak_from_this(), request_id](bool ok) {
+            // Not ok if the alarm was cancelled by the response.
+            if (!ok) return;
+            if (auto locked_session = session.lock()) {
+              locked_session->Finish(
+                  request_id,
+                  absl::DeadlineExceededError("Deadline exceeded on session"));
+            }
+          });
+    }
+    SecureLookupStreamRequest& request = write_queue_.emplace_back();
+    request.set_request_id(request_id);
+    request.set_encrypted_request(std::move(encrypted_request));
+    if (writing_) {
+      return nullptr;
+    }
+    writing_ = true;
+    return &request;
+  }
+
+  // The hold keeps the stream open for writes, it is removed once, when the
+  // stream is done and no write is in flight.
+  bool ShouldRemoveHoldLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (!done_ || writing_ || hold_removed_) {
+      return false;
+    }
+    hold_removed_ = true;
+    return true;
+  }
+
+  // Completes the lookup, unless it was already completed.
+  void Finish(uint64_t request_id,
+              absl::StatusOr<InternalLookupResponse> response) {
+    PendingLookup pending;
+    {
+      absl::MutexLock lock(&mutex_);
+      auto it = pending_.find(request_id);
+      if (it == pending_.end()) return;
+      pending = std::move(it->second);
+      pending_.erase(it);
+    }
+    pending.deadline_alarm.reset();
+    std::move(pending.on_done)(std::move(response));
+  }
+
+  grpc::ClientContext context_;
+  const std::unique_ptr<SessionEncryptor> request_encryptor_;
+  privacy_sandbox::server_common::MetricsRecorder& metrics_recorder_;
+  // Only accessed by the reactions, which are serialized. The secret and its
+  // OHTTP context are released once the response key is set.
+  std::string session_secret_;
+  std::unique_ptr<OhttpClientEncryptor> key_encryptor_;
+  std::unique_ptr<SessionEncryptor> response_encryptor_;
+  SecureLookupStreamResponse response_;
+  mutable absl::Mutex mutex_;
+  bool done_ ABSL_GUARDED_BY(mutex_) = false;
+  bool finished_ ABSL_GUARDED_BY(mutex_) = false;
+  // Whether the front of `write_queue_` is being written.
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  bool hold_removed_ ABSL_GUARDED_BY(mutex_) = false;
+  uint64_t last_request_id_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::deque<SecureLookupStreamRequest> write_queue_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<uint64_t, PendingLookup> pending_ ABSL_GUARDED_BY(mutex_);
+};
+
 class RemoteLookupClientImpl : public RemoteLookupClient {
  public:
   RemoteLookupClientImpl(const RemoteLookupClientImpl&) = delete;
@@ -44,22 +390,38 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
       std::string ip_address,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
-      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder)
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+      RemoteLookupClientOptions options)
       : ip_address_(
             absl::StrFormat("%s:%s", ip_address, kRemoteLookupServerPort)),
         stub_(InternalLookupService::NewStub(grpc::CreateChannel(
             ip_address_, grpc::InsecureChannelCredentials()))),
         key_fetcher_manager_(key_fetcher_manager),
-        metrics_recorder_(metrics_recorder) {}
+        metrics_recorder_(metrics_recorder),
+        options_(std::move(options)) {}
 
   explicit RemoteLookupClientImpl(
       std::unique_ptr<InternalLookupService::Stub> stub,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
-      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder)
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+      RemoteLookupClientOptions options)
       : stub_(std::move(stub)),
         key_fetcher_manager_(key_fetcher_manager),
-        metrics_recorder_(metrics_recorder) {}
+        metrics_recorder_(metrics_recorder),
+        options_(std::move(options)) {}
+
+  ~RemoteLookupClientImpl() override {
+    // The streams must be finished before the stub and its channel are
+    // destroyed.
+    absl::MutexLock lock(&session_mutex_);
+    for (const auto& session : sessions_) {
+      session->Cancel();
+    }
+    for (const auto& session : sessions_) {
+      session->WaitUntilFinished();
+    }
+  }
 
   absl::StatusOr<InternalLookupResponse> GetValues(
       std::string_view serialized_message,
@@ -67,6 +429,121 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
     ScopeLatencyRecorder latency_recorder(std::string(kRemoteLookupGetValues),
                                           metrics_recorder_);
     OhttpClientEncryptor encryptor(key_fetcher_manager_);
+    auto secure_lookup_request_maybe =
+        BuildSecureLookupRequest(serialized_message, padding_length, encryptor);
+    if (!secure_lookup_request_maybe.ok()) {
+      return secure_lookup_request_maybe.status();
+    }
+    SecureLookupResponse secure_response;
+    grpc::ClientContext context;
+    grpc::Status status = stub_->SecureLookup(
+        &context, *secure_lookup_request_maybe, &secure_response);
+    return ProcessSecureLookupResponse(status, secure_response, encryptor);
+  }
+
+  void GetValuesAsync(
+      grpc::ClientContext& context, std::string_view serialized_message,
+      int32_t padding_length,
+      absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+          on_done) const override {
+    if (options_.use_lookup_stream) {
+      GetValuesOnSession(context, serialized_message, padding_length,
+                         std::move(on_done));
+      return;
+    }
+    // Owns the state of the call until the response is processed.
+    struct Call {
+      Call(const RemoteLookupClientImpl& client,
+           absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+               on_done)
+          : latency_recorder(std::string(kRemoteLookupGetValues),
+                             client.metrics_recorder_),
+            encryptor(client.key_fetcher_manager_),
+            on_done(std::move(on_done)) {}
+
+      ScopeLatencyRecorder latency_recorder;
+      OhttpClientEncryptor encryptor;
+      SecureLookupRequest request;
+      SecureLookupResponse response;
+      absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+          on_done;
+    };
+    auto call = std::make_unique<Call>(*this, std::move(on_done));
+    auto secure_lookup_request_maybe = BuildSecureLookupRequest(
+        serialized_message, padding_length, call->encryptor);
+    if (!secure_lookup_request_maybe.ok()) {
+      std::move(call->on_done)(secure_lookup_request_maybe.status());
+      return;
+    }
+    call->request = *std::move(secure_lookup_request_maybe);
+    Call* const call_ptr = call.release();
+    // gRPC callbacks must be copyable, so the call is released here and
+    // deleted once it is done.
+    stub_->async()->SecureLookup(
+        &context, &call_ptr->request, &call_ptr->response,
+        [this, call_ptr](grpc::Status status) {
+          std::unique_ptr<Call> call(call_ptr);
+          auto on_done = std::move(call->on_done);
+          auto response = ProcessSecureLookupResponse(status, call->response,
+                                                      call->encryptor);
+          // Records the latency before handing the response over.
+          call.reset();
+          std::move(on_done)(std::move(response));
+        });
+  }
+
+  std::string_view GetIpAddress() const override { return ip_address_; }
+
+ private:
+  void GetValuesOnSession(
+      grpc::ClientContext& context, std::string_view serialized_message,
+      int32_t padding_length,
+      absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+          on_done) const {
+    auto latency_recorder = std::make_unique<ScopeLatencyRecorder>(
+        std::string(kRemoteLookupGetValues), metrics_recorder_);
+    auto session_maybe = GetSession();
+    if (!session_maybe.ok()) {
+      std::move(on_done)(session_maybe.status());
+      return;
+    }
+    (*session_maybe)
+        ->SendLookup(
+            serialized_message, padding_length, context.deadline(),
+            [latency_recorder = std::move(latency_recorder),
+             on_done = std::move(on_done)](
+                absl::StatusOr<InternalLookupResponse> response) mutable {
+              // Records the latency before handing the response over.
+              latency_recorder.reset();
+              std::move(on_done)(std::move(response));
+            });
+  }
+
+  // Returns the current session, starting a new one if there is none or it
+  // is done.
+  absl::StatusOr<std::shared_ptr<LookupSession>> GetSession() const {
+    absl::MutexLock lock(&session_mutex_);
+    if (!sessions_.empty() && !sessions_.back()->IsDone()) {
+      return sessions_.back();
+    }
+    // Done sessions are kept until they are finished.
+    sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                   [](const auto& session) {
+                                     return session->IsFinished();
+                                   }),
+                    sessions_.end());
+    auto session_maybe =
+        LookupSession::Start(*stub_, key_fetcher_manager_, metrics_recorder_);
+    if (!session_maybe.ok()) {
+      return session_maybe.status();
+    }
+    sessions_.push_back(*session_maybe);
+    return *std::move(session_maybe);
+  }
+
+  absl::StatusOr<SecureLookupRequest> BuildSecureLookupRequest(
+      std::string_view serialized_message, int32_t padding_length,
+      OhttpClientEncryptor& encryptor) const {
     auto encrypted_padded_serialized_request_maybe =
         encryptor.EncryptRequest(Pad(serialized_message, padding_length));
     if (!encrypted_padded_serialized_request_maybe.ok()) {
@@ -75,11 +552,14 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
     }
     SecureLookupRequest secure_lookup_request;
     secure_lookup_request.set_ohttp_request(
-        *encrypted_padded_serialized_request_maybe);
-    SecureLookupResponse secure_response;
-    grpc::ClientContext context;
-    grpc::Status status =
-        stub_->SecureLookup(&context, secure_lookup_request, &secure_response);
+        *std::move(encrypted_padded_serialized_request_maybe));
+    return secure_lookup_request;
+  }
+
+  // `encryptor` must be the one that encrypted the request.
+  absl::StatusOr<InternalLookupResponse> ProcessSecureLookupResponse(
+      const grpc::Status& status, SecureLookupResponse& secure_response,
+      OhttpClientEncryptor& encryptor) const {
     if (!status.ok()) {
       metrics_recorder_.IncrementEventCounter(kSecureLookupFailure);
       LOG(ERROR) << status.error_code() << ": " << status.error_message();
@@ -88,12 +568,12 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
     }
     InternalLookupResponse response;
     if (secure_response.ohttp_response().empty()) {
-      // we cannot decrypt an empty response. Note, that soon we will add logic
-      // to pad responses, so this branch will never be hit.
+      // OHTTP cannot encrypt an empty payload, so the server sends none. Only
+      // unpadded responses can be empty.
       return response;
     }
-    auto decrypted_response_maybe =
-        encryptor.DecryptResponse(std::move(secure_response.ohttp_response()));
+    auto decrypted_response_maybe = encryptor.DecryptResponse(
+        std::move(*secure_response.mutable_ohttp_response()));
     if (!decrypted_response_maybe.ok()) {
       metrics_recorder_.IncrementEventCounter(kDecryptionFailure);
       return decrypted_response_maybe.status();
@@ -103,17 +583,20 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
             decrypted_response_maybe->GetPlaintextData())) {
       return absl::InvalidArgumentError("Failed parsing the response.");
     }
+    response.clear_padding();
     return response;
   }
 
-  std::string_view GetIpAddress() const override { return ip_address_; }
-
- private:
   const std::string ip_address_;
   std::unique_ptr<InternalLookupService::Stub> stub_;
   privacy_sandbox::server_common::KeyFetcherManagerInterface&
       key_fetcher_manager_;
   privacy_sandbox::server_common::MetricsRecorder& metrics_recorder_;
+  const RemoteLookupClientOptions options_;
+  mutable absl::Mutex session_mutex_;
+  // The last one is the current session.
+  mutable std::vector<std::shared_ptr<LookupSession>> sessions_
+      ABSL_GUARDED_BY(session_mutex_);
 };
 
 }  // namespace
@@ -122,17 +605,21 @@ std::unique_ptr<RemoteLookupClient> RemoteLookupClient::Create(
     std::string ip_address,
     privacy_sandbox::server_common::KeyFetcherManagerInterface&
         key_fetcher_manager,
-    privacy_sandbox::server_common::MetricsRecorder& metrics_recorder) {
+    privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+    RemoteLookupClientOptions options) {
   return std::make_unique<RemoteLookupClientImpl>(
-      std::move(ip_address), key_fetcher_manager, metrics_recorder);
+      std::move(ip_address), key_fetcher_manager, metrics_recorder,
+      std::move(options));
 }
 std::unique_ptr<RemoteLookupClient> RemoteLookupClient::Create(
     std::unique_ptr<InternalLookupService::Stub> stub,
     privacy_sandbox::server_common::KeyFetcherManagerInterface&
         key_fetcher_manager,
-    privacy_sandbox::server_common::MetricsRecorder& metrics_recorder) {
+    privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+    RemoteLookupClientOptions options) {
   return std::make_unique<RemoteLookupClientImpl>(
-      std::move(stub), key_fetcher_manager, metrics_recorder);
+      std::move(stub), key_fetcher_manager, metrics_recorder,
+      std::move(options));
 }
 
 }  // namespace kv_server
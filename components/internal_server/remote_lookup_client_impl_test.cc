@@ -12,10 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/request_handler/ohttp_client_encryptor.h"
 #include "components/internal_server/lookup_server_impl.h"
 #include "components/internal_server/mocks.h"
 #include "components/internal_server/remote_lookup_client.h"
+#include "components/internal_server/session_encryptor.h"
+#include "components/internal_server/string_padder.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "grpcpp/grpcpp.h"
@@ -113,6 +124,28 @@ TEST_F(RemoteLookupClientImplTest, EncryptedPaddedEmptySuccessfulCall) {
   EXPECT_THAT(response, EqualsProto(expected));
 }
 
+TEST_F(RemoteLookupClientImplTest, PaddedResponsesSuccessfulCalls) {
+  InternalLookupRequest request;
+  request.add_keys("key1");
+  request.set_response_padding_buckets_per_doubling(1);
+  InternalLookupResponse local_lookup_response;
+  (*local_lookup_response.mutable_kv_pairs())["key1"].set_value("value1");
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_))
+      .WillOnce(Return(local_lookup_response));
+  auto response_status =
+      remote_lookup_client_->GetValues(request.SerializeAsString(), 0);
+  ASSERT_TRUE(response_status.ok()) << response_status.status();
+  EXPECT_THAT(*response_status, EqualsProto(local_lookup_response));
+
+  // Padded responses are never empty.
+  InternalLookupRequest empty_request;
+  empty_request.set_response_padding_buckets_per_doubling(1);
+  response_status =
+      remote_lookup_client_->GetValues(empty_request.SerializeAsString(), 0);
+  ASSERT_TRUE(response_status.ok()) << response_status.status();
+  EXPECT_THAT(*response_status, EqualsProto(InternalLookupResponse()));
+}
+
 TEST_F(RemoteLookupClientImplTest, EncryptedPaddedSuccessfulKeysettLookup) {
   std::vector<std::string> keys = {"key1"};
   InternalLookupRequest request;
@@ -167,5 +200,203 @@ TEST_F(RemoteLookupClientImplTest,
   EXPECT_EQ(0, response.mutable_kv_pairs()->size());
 }
 
+TEST_F(RemoteLookupClientImplTest, AsyncCallPastDeadlineFails) {
+  // Holds the response back, so that the deadline is reached first.
+  // Shared, as the server may still wait on it at the end of the test.
+  auto lookup_released = std::make_shared<absl::Notification>();
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_))
+      .WillRepeatedly(
+          [lookup_released](const absl::flat_hash_set<std::string_view>& keys) {
+            lookup_released->WaitForNotification();
+            return InternalLookupResponse();
+          });
+  InternalLookupRequest request;
+  request.add_keys("key1");
+  grpc::ClientContext context;
+  context.set_deadline(absl::ToChronoTime(absl::Now()));
+  absl::Notification done;
+  absl::StatusOr<InternalLookupResponse> response_status;
+  remote_lookup_client_->GetValuesAsync(
+      context, request.SerializeAsString(), /*padding_length=*/0,
+      [&done, &response_status](
+          absl::StatusOr<InternalLookupResponse> response) {
+        response_status = std::move(response);
+        done.Notify();
+      });
+  done.WaitForNotification();
+  lookup_released->Notify();
+  EXPECT_EQ(response_status.status().code(),
+            absl::StatusCode::kDeadlineExceeded);
+}
+
+TEST_F(RemoteLookupClientImplTest, StreamedAsyncCallsShareSession) {
+  auto stream_lookup_client = RemoteLookupClient::Create(
+      InternalLookupService::NewStub(
+          server_->InProcessChannel(grpc::ChannelArguments())),
+      fake_key_fetcher_manager_, mock_metrics_recorder_,
+      {.use_lookup_stream = true});
+  constexpr int kNumLookups = 3;
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_))
+      .Times(kNumLookups)
+      .WillRepeatedly([](const absl::flat_hash_set<std::string_view>& keys) {
+        InternalLookupResponse response;
+        for (const auto key : keys) {
+          (*response.mutable_kv_pairs())[std::string(key)].set_value(
+              absl::StrCat(key, "_value"));
+        }
+        return response;
+      });
+  std::vector<grpc::ClientContext> contexts(kNumLookups);
+  std::vector<absl::StatusOr<InternalLookupResponse>> responses(kNumLookups);
+  absl::BlockingCounter done(kNumLookups);
+  for (int i = 0; i < kNumLookups; ++i) {
+    InternalLookupRequest request;
+    request.add_keys(absl::StrCat("key", i));
+    stream_lookup_client->GetValuesAsync(
+        contexts[i], request.SerializeAsString(), /*padding_length=*/10,
+        [&done, &response = responses[i]](
+            absl::StatusOr<InternalLookupResponse> result) {
+          response = std::move(result);
+          done.DecrementCount();
+        });
+  }
+  done.Wait();
+  for (int i = 0; i < kNumLookups; ++i) {
+    ASSERT_TRUE(responses[i].ok()) << responses[i].status();
+    InternalLookupResponse expected;
+    (*expected.mutable_kv_pairs())[absl::StrCat("key", i)].set_value(
+        absl::StrCat("key", i, "_value"));
+    EXPECT_THAT(*responses[i], EqualsProto(expected));
+  }
+}
+
+TEST_F(RemoteLookupClientImplTest, StreamedLookupsAreAnsweredConcurrently) {
+  auto stream_lookup_client = RemoteLookupClient::Create(
+      InternalLookupService::NewStub(
+          server_->InProcessChannel(grpc::ChannelArguments())),
+      fake_key_fetcher_manager_, mock_metrics_recorder_,
+      {.use_lookup_stream = true});
+  // The first lookup only completes once the second one is done, which
+  // requires the server not to answer them one after the other.
+  absl::Notification fast_lookup_done;
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_))
+      .Times(2)
+      .WillRepeatedly(
+          [&fast_lookup_done](
+              const absl::flat_hash_set<std::string_view>& keys) {
+            InternalLookupResponse response;
+            if (keys.contains("slow")) {
+              if (fast_lookup_done.WaitForNotificationWithTimeout(
+                      absl::Seconds(5))) {
+                (*response.mutable_kv_pairs())["slow"].set_value("value");
+              }
+            } else {
+              fast_lookup_done.Notify();
+            }
+            return response;
+          });
+  grpc::ClientContext slow_context;
+  grpc::ClientContext fast_context;
+  absl::StatusOr<InternalLookupResponse> slow_response;
+  absl::BlockingCounter done(2);
+  InternalLookupRequest slow_request;
+  slow_request.add_keys("slow");
+  stream_lookup_client->GetValuesAsync(
+      slow_context, slow_request.SerializeAsString(), /*padding_length=*/0,
+      [&done, &slow_response](absl::StatusOr<InternalLookupResponse> result) {
+        slow_response = std::move(result);
+        done.DecrementCount();
+      });
+  InternalLookupRequest fast_request;
+  fast_request.add_keys("fast");
+  stream_lookup_client->GetValuesAsync(
+      fast_context, fast_request.SerializeAsString(), /*padding_length=*/0,
+      [&done](absl::StatusOr<InternalLookupResponse> result) {
+        done.DecrementCount();
+      });
+  done.Wait();
+  ASSERT_TRUE(slow_response.ok()) << slow_response.status();
+  InternalLookupResponse expected;
+  (*expected.mutable_kv_pairs())["slow"].set_value("value");
+  EXPECT_THAT(*slow_response, EqualsProto(expected));
+}
+
+TEST_F(RemoteLookupClientImplTest, StreamedAsyncCallPastDeadlineFails) {
+  auto stream_lookup_client = RemoteLookupClient::Create(
+      InternalLookupService::NewStub(
+          server_->InProcessChannel(grpc::ChannelArguments())),
+      fake_key_fetcher_manager_, mock_metrics_recorder_,
+      {.use_lookup_stream = true});
+  // Holds the response back, so that the deadline is reached first.
+  // Shared, as the server may still wait on it at the end of the test.
+  auto lookup_released = std::make_shared<absl::Notification>();
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_))
+      .WillRepeatedly(
+          [lookup_released](const absl::flat_hash_set<std::string_view>& keys) {
+            lookup_released->WaitForNotification();
+            return InternalLookupResponse();
+          });
+  InternalLookupRequest request;
+  request.add_keys("key1");
+  grpc::ClientContext context;
+  context.set_deadline(absl::ToChronoTime(absl::Now()));
+  absl::Notification done;
+  absl::StatusOr<InternalLookupResponse> response_status;
+  stream_lookup_client->GetValuesAsync(
+      context, request.SerializeAsString(), /*padding_length=*/0,
+      [&done, &response_status](
+          absl::StatusOr<InternalLookupResponse> response) {
+        response_status = std::move(response);
+        done.Notify();
+      });
+  done.WaitForNotification();
+  lookup_released->Notify();
+  EXPECT_EQ(response_status.status().code(),
+            absl::StatusCode::kDeadlineExceeded);
+}
+
+TEST_F(RemoteLookupClientImplTest, StreamRejectsRepeatedRequestId) {
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_))
+      .WillRepeatedly(Return(InternalLookupResponse()));
+  auto stub = InternalLookupService::NewStub(
+      server_->InProcessChannel(grpc::ChannelArguments()));
+  grpc::ClientContext context;
+  auto stream = stub->SecureLookupStream(&context);
+  const std::string session_secret = SessionEncryptor::GenerateKey();
+  OhttpClientEncryptor key_encryptor(fake_key_fetcher_manager_);
+  auto encrypted_session_secret = key_encryptor.EncryptRequest(session_secret);
+  ASSERT_TRUE(encrypted_session_secret.ok());
+  SecureLookupStreamRequest key_request;
+  key_request.set_ohttp_session_key(*encrypted_session_secret);
+  ASSERT_TRUE(stream->Write(key_request));
+  SecureLookupStreamResponse response;
+  ASSERT_TRUE(stream->Read(&response));
+  EXPECT_FALSE(response.ohttp_session_salt().empty());
+
+  auto request_encryptor = SessionEncryptor::Derive(
+      session_secret, /*salt=*/"", SessionEncryptor::Direction::kRequest);
+  ASSERT_TRUE(request_encryptor.ok());
+  InternalLookupRequest lookup_request;
+  lookup_request.add_keys("key1");
+  const std::string padded_request =
+      Pad(lookup_request.SerializeAsString(), /*extra_padding=*/0);
+  auto encrypted_request = (*request_encryptor)
+                               ->Encrypt(SessionEncryptor::Direction::kRequest,
+                                         /*message_id=*/1, padded_request);
+  ASSERT_TRUE(encrypted_request.ok());
+  SecureLookupStreamRequest request;
+  request.set_request_id(1);
+  request.set_encrypted_request(*encrypted_request);
+  ASSERT_TRUE(stream->Write(request));
+  ASSERT_TRUE(stream->Read(&response));
+  EXPECT_EQ(response.request_id(), 1);
+  EXPECT_FALSE(response.has_status());
+
+  // A replayed request id would reuse a nonce, so the stream is ended.
+  stream->Write(request);
+  EXPECT_FALSE(stream->Read(&response));
+  EXPECT_EQ(stream->Finish().error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
 }  // namespace
 }  // namespace kv_server
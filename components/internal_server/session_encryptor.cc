@@ -0,0 +1,144 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/session_encryptor.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
+#include "openssl/digest.h"
+#include "openssl/hkdf.h"
+#include "openssl/rand.h"
+
+namespace kv_server {
+namespace {
+
+constexpr size_t kNonceLength = 12;
+constexpr std::string_view kRequestKeyInfo = "kv-server lookup request key";
+constexpr std::string_view kResponseKeyInfo = "kv-server lookup response key";
+
+// [32 bit direction][64 bit message id], both big endian.
+std::array<uint8_t, kNonceLength> MakeNonce(
+    SessionEncryptor::Direction direction, uint64_t message_id) {
+  std::array<uint8_t, kNonceLength> nonce;
+  const auto direction_value = static_cast<uint32_t>(direction);
+  for (int i = 0; i < 4; ++i) {
+    nonce[i] = static_cast<uint8_t>(direction_value >> (8 * (3 - i)));
+  }
+  for (int i = 0; i < 8; ++i) {
+    nonce[4 + i] = static_cast<uint8_t>(message_id >> (8 * (7 - i)));
+  }
+  return nonce;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<SessionEncryptor>> SessionEncryptor::Create(
+    std::string_view key) {
+  if (key.size() != kKeyLength) {
+    return absl::InvalidArgumentError("Invalid session key length");
+  }
+  // Not using make_unique, as the constructor is private.
+  std::unique_ptr<SessionEncryptor> encryptor(new SessionEncryptor());
+  if (!EVP_AEAD_CTX_init(encryptor->context_.get(), EVP_aead_aes_256_gcm(),
+                         reinterpret_cast<const uint8_t*>(key.data()),
+                         key.size(), EVP_AEAD_DEFAULT_TAG_LENGTH,
+                         /*impl=*/nullptr)) {
+    return absl::InternalError("Failed to initialize the session key");
+  }
+  return encryptor;
+}
+
+std::string SessionEncryptor::GenerateKey() {
+  std::string key(kKeyLength, '\0');
+  RAND_bytes(reinterpret_cast<uint8_t*>(key.data()), key.size());
+  return key;
+}
+
+absl::StatusOr<std::string> SessionEncryptor::DeriveKey(
+    std::string_view secret, std::string_view salt, Direction direction) {
+  const std::string_view info = direction == Direction::kRequest
+                                    ? kRequestKeyInfo
+                                    : kResponseKeyInfo;
+  std::string key(kKeyLength, '\0');
+  if (!HKDF(reinterpret_cast<uint8_t*>(key.data()), key.size(), EVP_sha256(),
+            reinterpret_cast<const uint8_t*>(secret.data()), secret.size(),
+            reinterpret_cast<const uint8_t*>(salt.data()), salt.size(),
+            reinterpret_cast<const uint8_t*>(info.data()), info.size())) {
+    return absl::InternalError("Failed to derive the session key");
+  }
+  return key;
+}
+
+absl::StatusOr<std::unique_ptr<SessionEncryptor>> SessionEncryptor::Derive(
+    std::string_view secret, std::string_view salt, Direction direction) {
+  auto key = DeriveKey(secret, salt, direction);
+  if (!key.ok()) {
+    return key.status();
+  }
+  return Create(*key);
+}
+
+absl::StatusOr<std::string> SessionEncryptor::Encrypt(
+    Direction direction, uint64_t message_id,
+    std::string_view plaintext) const {
+  std::string message;
+  message.reserve(plaintext.size() + kOverhead);
+  message.append(plaintext);
+  if (auto status = EncryptInPlace(direction, message_id, message);
+      !status.ok()) {
+    return status;
+  }
+  return message;
+}
+
+absl::Status SessionEncryptor::EncryptInPlace(Direction direction,
+                                              uint64_t message_id,
+                                              std::string& message) const {
+  const auto nonce = MakeNonce(direction, message_id);
+  const size_t plaintext_length = message.size();
+  message.resize(plaintext_length + kOverhead);
+  auto* data = reinterpret_cast<uint8_t*>(message.data());
+  size_t ciphertext_length = 0;
+  // The input and output buffers may alias exactly.
+  if (!EVP_AEAD_CTX_seal(context_.get(), data, &ciphertext_length,
+                         message.size(), nonce.data(), nonce.size(), data,
+                         plaintext_length, /*ad=*/nullptr, /*ad_len=*/0)) {
+    return absl::InternalError("Failed to encrypt the session message");
+  }
+  message.resize(ciphertext_length);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> SessionEncryptor::Decrypt(
+    Direction direction, uint64_t message_id,
+    std::string_view ciphertext) const {
+  const auto nonce = MakeNonce(direction, message_id);
+  std::string plaintext(ciphertext.size(), '\0');
+  size_t plaintext_length = 0;
+  if (!EVP_AEAD_CTX_open(
+          context_.get(), reinterpret_cast<uint8_t*>(plaintext.data()),
+          &plaintext_length, plaintext.size(), nonce.data(), nonce.size(),
+          reinterpret_cast<const uint8_t*>(ciphertext.data()),
+          ciphertext.size(), /*ad=*/nullptr, /*ad_len=*/0)) {
+    return absl::InvalidArgumentError("Failed to decrypt the session message");
+  }
+  plaintext.resize(plaintext_length);
+  return plaintext;
+}
+
+}  // namespace kv_server
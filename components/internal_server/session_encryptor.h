@@ -0,0 +1,79 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_SESSION_ENCRYPTOR_H_
+#define COMPONENTS_INTERNAL_SERVER_SESSION_ENCRYPTOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "openssl/aead.h"
+
+namespace kv_server {
+
+// Encrypts the messages of a lookup session with AES-256-GCM under a key that
+// is exchanged once per session, so that the lookups of the session don't pay
+// for an HPKE setup each.
+// Nonces are derived from the direction and the id of the message, so every
+// message id must be used at most once per key. Thread safe.
+class SessionEncryptor {
+ public:
+  enum class Direction : uint32_t { kRequest = 0, kResponse = 1 };
+
+  static constexpr size_t kKeyLength = 32;
+  // Number of bytes added to a message by its encryption.
+  static constexpr size_t kOverhead = 16;
+
+  SessionEncryptor(const SessionEncryptor&) = delete;
+  SessionEncryptor& operator=(const SessionEncryptor&) = delete;
+
+  // `key` must be `kKeyLength` bytes long.
+  static absl::StatusOr<std::unique_ptr<SessionEncryptor>> Create(
+      std::string_view key);
+  // Returns a new random key, also used as a secret or a salt.
+  static std::string GenerateKey();
+  // Derives the key of `direction` from the session `secret` and `salt` with
+  // HKDF-SHA256. A salt that is random per session gives a fresh key, even if
+  // the secret is replayed.
+  static absl::StatusOr<std::string> DeriveKey(std::string_view secret,
+                                               std::string_view salt,
+                                               Direction direction);
+  // Creates the encryptor of `direction` with the key derived by `DeriveKey`.
+  static absl::StatusOr<std::unique_ptr<SessionEncryptor>> Derive(
+      std::string_view secret, std::string_view salt, Direction direction);
+
+  absl::StatusOr<std::string> Encrypt(Direction direction, uint64_t message_id,
+                                      std::string_view plaintext) const;
+  // Replaces the plaintext in `message` with its ciphertext, without copying
+  // it. Reserving `kOverhead` more bytes in `message` avoids a reallocation.
+  absl::Status EncryptInPlace(Direction direction, uint64_t message_id,
+                              std::string& message) const;
+  absl::StatusOr<std::string> Decrypt(Direction direction, uint64_t message_id,
+                                      std::string_view ciphertext) const;
+
+ private:
+  SessionEncryptor() = default;
+
+  bssl::ScopedEVP_AEAD_CTX context_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_SESSION_ENCRYPTOR_H_
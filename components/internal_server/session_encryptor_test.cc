@@ -0,0 +1,101 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/session_encryptor.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using Direction = SessionEncryptor::Direction;
+
+TEST(SessionEncryptorTest, EncryptDecrypt) {
+  const std::string key = SessionEncryptor::GenerateKey();
+  auto client = SessionEncryptor::Create(key);
+  auto server = SessionEncryptor::Create(key);
+  ASSERT_TRUE(client.ok()) << client.status();
+  ASSERT_TRUE(server.ok()) << server.status();
+
+  auto request = (*client)->Encrypt(Direction::kRequest, 7, "request");
+  ASSERT_TRUE(request.ok()) << request.status();
+  EXPECT_EQ(request->find("request"), std::string::npos);
+  auto decrypted_request = (*server)->Decrypt(Direction::kRequest, 7, *request);
+  ASSERT_TRUE(decrypted_request.ok()) << decrypted_request.status();
+  EXPECT_EQ(*decrypted_request, "request");
+
+  auto response = (*server)->Encrypt(Direction::kResponse, 7, "");
+  ASSERT_TRUE(response.ok()) << response.status();
+  auto decrypted_response =
+      (*client)->Decrypt(Direction::kResponse, 7, *response);
+  ASSERT_TRUE(decrypted_response.ok()) << decrypted_response.status();
+  EXPECT_EQ(*decrypted_response, "");
+}
+
+TEST(SessionEncryptorTest, EncryptInPlace) {
+  auto encryptor = SessionEncryptor::Create(SessionEncryptor::GenerateKey());
+  ASSERT_TRUE(encryptor.ok()) << encryptor.status();
+  std::string message = "request";
+  ASSERT_TRUE(
+      (*encryptor)->EncryptInPlace(Direction::kRequest, 3, message).ok());
+  EXPECT_EQ(message.size(), 7 + SessionEncryptor::kOverhead);
+  auto decrypted = (*encryptor)->Decrypt(Direction::kRequest, 3, message);
+  ASSERT_TRUE(decrypted.ok()) << decrypted.status();
+  EXPECT_EQ(*decrypted, "request");
+}
+
+TEST(SessionEncryptorTest, DecryptFailsForOtherMessage) {
+  const std::string key = SessionEncryptor::GenerateKey();
+  auto encryptor = SessionEncryptor::Create(key);
+  ASSERT_TRUE(encryptor.ok()) << encryptor.status();
+  auto ciphertext = (*encryptor)->Encrypt(Direction::kRequest, 1, "request");
+  ASSERT_TRUE(ciphertext.ok()) << ciphertext.status();
+
+  EXPECT_FALSE((*encryptor)->Decrypt(Direction::kRequest, 2, *ciphertext).ok());
+  EXPECT_FALSE(
+      (*encryptor)->Decrypt(Direction::kResponse, 1, *ciphertext).ok());
+  auto other = SessionEncryptor::Create(SessionEncryptor::GenerateKey());
+  ASSERT_TRUE(other.ok()) << other.status();
+  EXPECT_FALSE((*other)->Decrypt(Direction::kRequest, 1, *ciphertext).ok());
+}
+
+TEST(SessionEncryptorTest, DeriveKey) {
+  const std::string secret = SessionEncryptor::GenerateKey();
+  const std::string salt = SessionEncryptor::GenerateKey();
+  auto key = SessionEncryptor::DeriveKey(secret, salt, Direction::kResponse);
+  ASSERT_TRUE(key.ok()) << key.status();
+  EXPECT_EQ(key->size(), SessionEncryptor::kKeyLength);
+  auto same_key =
+      SessionEncryptor::DeriveKey(secret, salt, Direction::kResponse);
+  ASSERT_TRUE(same_key.ok()) << same_key.status();
+  EXPECT_EQ(*key, *same_key);
+
+  auto other_salt_key = SessionEncryptor::DeriveKey(
+      secret, SessionEncryptor::GenerateKey(), Direction::kResponse);
+  ASSERT_TRUE(other_salt_key.ok()) << other_salt_key.status();
+  EXPECT_NE(*key, *other_salt_key);
+  auto request_key =
+      SessionEncryptor::DeriveKey(secret, salt, Direction::kRequest);
+  ASSERT_TRUE(request_key.ok()) << request_key.status();
+  EXPECT_NE(*key, *request_key);
+}
+
+TEST(SessionEncryptorTest, CreateFailsForInvalidKey) {
+  EXPECT_FALSE(SessionEncryptor::Create("short").ok());
+}
+
+}  // namespace
+}  // namespace kv_server
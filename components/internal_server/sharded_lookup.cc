@@ -14,21 +14,28 @@
 #include "components/internal_server/sharded_lookup.h"
 
 #include <algorithm>
-#include <future>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/internal_server/latency_tracker.h"
 #include "components/internal_server/lookup.h"
 #include "components/internal_server/lookup.pb.h"
 #include "components/internal_server/remote_lookup_client.h"
+#include "components/internal_server/string_padder.h"
 #include "components/query/driver.h"
 #include "components/query/scanner.h"
 #include "components/sharding/shard_manager.h"
 #include "glog/logging.h"
+#include "grpcpp/grpcpp.h"
 #include "pir/hashing/sha256_hash_family.h"
 #include "src/cpp/telemetry/metrics_recorder.h"
 
@@ -57,6 +64,11 @@ constexpr char kShardedLookupServerRequestFailed[] =
     "ShardedLookupServerRequestFailed";
 constexpr char kLookupFuturesCreationFailure[] = "LookupFuturesCreationFailure";
 constexpr char kShardedLookupFailure[] = "ShardedLookupFailure";
+constexpr char kShardedLookupHedgedRequest[] = "ShardedLookupHedgedRequest";
+constexpr char kShardedLookupCoalescedRequest[] =
+    "ShardedLookupCoalescedRequest";
+constexpr char kNearCacheHit[] = "NearCacheHit";
+constexpr char kNearCacheMiss[] = "NearCacheMiss";
 
 void UpdateResponse(
     const std::vector<std::string_view>& key_list,
@@ -88,19 +100,169 @@ void SetRequestFailed(const std::vector<std::string_view>& key_list,
   LOG(ERROR) << "Sharded lookup failed:" << response.DebugString();
 }
 
+// Requests sent to the remote shards for one lookup. A request can be hedged
+// by sending it to another replica of its shard: the first successful
+// response wins and the other request is cancelled.
+//
+// Shared with the callbacks of the requests, so that the lookup doesn't wait
+// for requests still in flight once their shard is decided. Cancelled lookups
+// on a stream, in particular, only complete with their response or deadline.
+class RemoteShardRequests
+    : public std::enable_shared_from_this<RemoteShardRequests> {
+ public:
+  RemoteShardRequests(int32_t num_shards, absl::Time deadline,
+                      std::shared_ptr<LatencyTracker> latency_tracker)
+      : shards_(num_shards),
+        deadline_(deadline),
+        latency_tracker_(std::move(latency_tracker)) {}
+
+  // Sends the request of `shard_num` to `client`, unless the shard already has
+  // a response or two requests were sent.
+  void Send(int32_t shard_num, const RemoteLookupClient& client,
+            std::string_view serialized_request, int32_t padding) {
+    grpc::ClientContext* context;
+    int attempt;
+    {
+      absl::MutexLock lock(&mutex_);
+      Shard& shard = shards_[shard_num];
+      if (shard.done || shard.num_attempts == kMaxAttempts) {
+        return;
+      }
+      if (shard.num_attempts == 0) {
+        ++num_pending_shards_;
+      }
+      attempt = shard.num_attempts++;
+      ++shard.num_in_flight;
+      shard.clients[attempt] = &client;
+      shard.contexts[attempt] = std::make_unique<grpc::ClientContext>();
+      context = shard.contexts[attempt].get();
+      if (deadline_ != absl::InfiniteFuture()) {
+        context->set_deadline(absl::ToChronoTime(deadline_));
+      }
+    }
+    client.GetValuesAsync(
+        *context, serialized_request, padding,
+        [requests = shared_from_this(), shard_num, attempt,
+         start = absl::Now()](absl::StatusOr<InternalLookupResponse> result) {
+          requests->OnResponse(shard_num, attempt, std::move(result),
+                               absl::Now() - start);
+        });
+  }
+
+  // Returns true if every shard has its response before `time`.
+  bool WaitForResponsesUntil(absl::Time time) {
+    absl::MutexLock lock(&mutex_);
+    return mutex_.AwaitWithDeadline(
+        absl::Condition(this, &RemoteShardRequests::AllShardsDone), time);
+  }
+
+  // Shards that were sent a request and have no response yet.
+  std::vector<int32_t> PendingShards() {
+    absl::MutexLock lock(&mutex_);
+    std::vector<int32_t> pending_shards;
+    const int32_t num_shards = shards_.size();
+    for (int32_t shard_num = 0; shard_num < num_shards; shard_num++) {
+      if (shards_[shard_num].num_attempts > 0 && !shards_[shard_num].done) {
+        pending_shards.push_back(shard_num);
+      }
+    }
+    return pending_shards;
+  }
+
+  // Waits until every shard has its response. Requests that lost to another
+  // one of their shard may still be in flight.
+  void WaitForResponses() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &RemoteShardRequests::AllShardsDone));
+  }
+
+  absl::StatusOr<InternalLookupResponse> TakeResponse(int32_t shard_num) {
+    absl::MutexLock lock(&mutex_);
+    return std::move(shards_[shard_num].response);
+  }
+
+  // Replica whose response was used for `shard_num`.
+  const RemoteLookupClient* Responder(int32_t shard_num) {
+    absl::MutexLock lock(&mutex_);
+    return shards_[shard_num].responder;
+  }
+
+ private:
+  static constexpr int kMaxAttempts = 2;
+
+  struct Shard {
+    const RemoteLookupClient* clients[kMaxAttempts] = {};
+    std::unique_ptr<grpc::ClientContext> contexts[kMaxAttempts];
+    int num_attempts = 0;
+    int num_in_flight = 0;
+    // Whether `response` is final.
+    bool done = false;
+    absl::StatusOr<InternalLookupResponse> response =
+        absl::UnknownError("Lookup did not complete.");
+    const RemoteLookupClient* responder = nullptr;
+  };
+
+  bool AllShardsDone() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return num_pending_shards_ == 0;
+  }
+
+  void OnResponse(int32_t shard_num, int attempt,
+                  absl::StatusOr<InternalLookupResponse> result,
+                  absl::Duration latency) {
+    if (result.ok() && latency_tracker_ != nullptr) {
+      latency_tracker_->Record(latency);
+    }
+    std::vector<grpc::ClientContext*> losers;
+    {
+      absl::MutexLock lock(&mutex_);
+      Shard& shard = shards_[shard_num];
+      --shard.num_in_flight;
+      // A failed request only decides the response once no other request of
+      // the shard can succeed.
+      if (!shard.done && (result.ok() || shard.num_in_flight == 0)) {
+        shard.done = true;
+        shard.response = std::move(result);
+        shard.responder = shard.clients[attempt];
+        --num_pending_shards_;
+        for (int i = 0; i < shard.num_attempts; i++) {
+          if (i != attempt) {
+            losers.push_back(shard.contexts[i].get());
+          }
+        }
+      }
+    }
+    // The contexts are valid as long as this is shared with their callbacks.
+    for (grpc::ClientContext* loser : losers) {
+      loser->TryCancel();
+    }
+  }
+
+  absl::Mutex mutex_;
+  std::vector<Shard> shards_ ABSL_GUARDED_BY(mutex_);
+  int num_pending_shards_ ABSL_GUARDED_BY(mutex_) = 0;
+  const absl::Time deadline_;
+  // Shared, since late responses can outlive the sharded lookup.
+  const std::shared_ptr<LatencyTracker> latency_tracker_;
+};
+
 class ShardedLookup : public Lookup {
  public:
   explicit ShardedLookup(
       const Lookup& local_lookup, const int32_t num_shards,
       const int32_t current_shard_num, const ShardManager& shard_manager,
       privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
-      KeySharder key_sharder)
+      KeySharder key_sharder, ShardedLookupOptions options)
       : local_lookup_(local_lookup),
         num_shards_(num_shards),
         current_shard_num_(current_shard_num),
         shard_manager_(shard_manager),
         metrics_recorder_(metrics_recorder),
-        key_sharder_(std::move(key_sharder)) {
+        key_sharder_(std::move(key_sharder)),
+        options_(std::move(options)),
+        latency_tracker_(options_.hedging_percentile > 0
+                             ? std::make_shared<LatencyTracker>(
+                                   options_.hedging_percentile)
+                             : nullptr) {
     CHECK_GT(num_shards, 1) << "num_shards for ShardedLookup must be > 1";
   }
 
@@ -114,6 +276,9 @@ class ShardedLookup : public Lookup {
   // status code.
   absl::StatusOr<InternalLookupResponse> GetKeyValues(
       const absl::flat_hash_set<std::string_view>& keys) const override {
+    if (options_.coalescing_window > absl::ZeroDuration() && !keys.empty()) {
+      return CoalesceKeyValues(keys);
+    }
     return ProcessShardedKeys(keys);
   }
 
@@ -218,6 +383,57 @@ class ShardedLookup : public Lookup {
     int32_t padding;
   };
 
+  // Keys of concurrent GetKeyValues calls, looked up together.
+  struct KeyBatch {
+    absl::flat_hash_set<std::string> keys;
+    absl::StatusOr<InternalLookupResponse> response;
+    absl::Notification done;
+  };
+
+  // Adds `keys` to the open batch, or opens one and looks it up once the
+  // coalescing window is over. Each caller gets the results of its own keys.
+  absl::StatusOr<InternalLookupResponse> CoalesceKeyValues(
+      const absl::flat_hash_set<std::string_view>& keys) const {
+    std::shared_ptr<KeyBatch> batch;
+    bool opened_batch = false;
+    {
+      absl::MutexLock lock(&batch_mutex_);
+      if (open_batch_ == nullptr) {
+        open_batch_ = std::make_shared<KeyBatch>();
+        opened_batch = true;
+      }
+      batch = open_batch_;
+      batch->keys.insert(keys.begin(), keys.end());
+    }
+    if (opened_batch) {
+      absl::SleepFor(options_.coalescing_window);
+      {
+        absl::MutexLock lock(&batch_mutex_);
+        open_batch_ = nullptr;
+      }
+      // No key is added once the batch is closed.
+      const absl::flat_hash_set<std::string_view> batch_keys(
+          batch->keys.begin(), batch->keys.end());
+      batch->response = ProcessShardedKeys(batch_keys);
+      batch->done.Notify();
+    } else {
+      metrics_recorder_.IncrementEventCounter(kShardedLookupCoalescedRequest);
+      batch->done.WaitForNotification();
+    }
+    if (!batch->response.ok()) {
+      return batch->response.status();
+    }
+    InternalLookupResponse response;
+    const auto& kv_pairs = batch->response->kv_pairs();
+    for (const auto key : keys) {
+      if (const auto key_iter = kv_pairs.find(key);
+          key_iter != kv_pairs.end()) {
+        (*response.mutable_kv_pairs())[key] = key_iter->second;
+      }
+    }
+    return response;
+  }
+
   std::vector<ShardLookupInput> BucketKeys(
       const absl::flat_hash_set<std::string_view>& keys) const {
     ShardLookupInput sli;
@@ -240,19 +456,33 @@ class ShardedLookup : public Lookup {
       request.mutable_keys()->Assign(lookup_input.keys.begin(),
                                      lookup_input.keys.end());
       request.set_lookup_sets(lookup_sets);
+      request.set_response_padding_buckets_per_doubling(
+          options_.padding_buckets_per_doubling);
       lookup_input.serialized_request = request.SerializeAsString();
     }
   }
 
+  // Pads the requests of remote shards to the same length, so that they
+  // don't reveal how the keys are distributed. The request of the current
+  // shard is never sent, so it is neither padded nor counted.
   void ComputePadding(std::vector<ShardLookupInput>& lookup_inputs) const {
     int32_t max_length = 0;
-    for (const auto& lookup_input : lookup_inputs) {
-      max_length =
-          std::max(max_length, int32_t(lookup_input.serialized_request.size()));
+    for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+      if (shard_num == current_shard_num_) {
+        continue;
+      }
+      max_length = std::max(
+          max_length,
+          int32_t(lookup_inputs[shard_num].serialized_request.size()));
     }
-    for (auto& lookup_input : lookup_inputs) {
+    const int32_t padded_length =
+        RoundUpToBucket(max_length, options_.padding_buckets_per_doubling);
+    for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+      auto& lookup_input = lookup_inputs[shard_num];
       lookup_input.padding =
-          max_length - lookup_input.serialized_request.size();
+          shard_num == current_shard_num_
+              ? 0
+              : padded_length - lookup_input.serialized_request.size();
     }
   }
 
@@ -265,42 +495,91 @@ class ShardedLookup : public Lookup {
     return lookup_inputs;
   }
 
-  absl::StatusOr<
-      std::vector<std::future<absl::StatusOr<InternalLookupResponse>>>>
-  GetLookupFutures(const std::vector<ShardLookupInput>& shard_lookup_inputs,
-                   std::function<absl::StatusOr<InternalLookupResponse>(
+  // Sends the requests of remote shards asynchronously, then looks up the
+  // keys of the current shard on this thread while they are in flight. No
+  // thread is created. Requests still in flight after the hedging delay are
+  // sent to another replica too. Returns the responses once all of them are
+  // received. If `responders` is not null, it is set to the replica that
+  // served each remote shard.
+  absl::StatusOr<std::vector<absl::StatusOr<InternalLookupResponse>>>
+  GetLookupResults(const std::vector<ShardLookupInput>& shard_lookup_inputs,
+                   absl::FunctionRef<absl::StatusOr<InternalLookupResponse>(
                        const std::vector<std::string_view>& key_list)>
-                       get_local_future) const {
-    std::vector<std::future<absl::StatusOr<InternalLookupResponse>>> responses;
+                       get_local_result,
+                   std::vector<const RemoteLookupClient*>* responders =
+                       nullptr) const {
+    // Looks up all the clients first, so that no request is left in flight
+    // when one is missing.
+    std::vector<RemoteLookupClient*> clients(num_shards_, nullptr);
     for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
-      auto& shard_lookup_input = shard_lookup_inputs[shard_num];
       if (shard_num == current_shard_num_) {
-        // Eventually this whole branch will go away.
-        responses.push_back(std::async(std::launch::async, get_local_future,
-                                       std::ref(shard_lookup_input.keys)));
-      } else {
-        const auto client = shard_manager_.Get(shard_num);
-        if (client == nullptr) {
-          metrics_recorder_.IncrementEventCounter(kLookupClientMissing);
-          return absl::InternalError("Internal lookup client is unavailable.");
+        continue;
+      }
+      clients[shard_num] = shard_manager_.Get(shard_num);
+      if (clients[shard_num] == nullptr) {
+        metrics_recorder_.IncrementEventCounter(kLookupClientMissing);
+        return absl::InternalError("Internal lookup client is unavailable.");
+      }
+    }
+    const absl::Time start = absl::Now();
+    auto requests = std::make_shared<RemoteShardRequests>(
+        num_shards_, start + options_.timeout, latency_tracker_);
+    for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+      if (shard_num == current_shard_num_) {
+        continue;
+      }
+      auto& shard_lookup_input = shard_lookup_inputs[shard_num];
+      requests->Send(shard_num, *clients[shard_num],
+                     shard_lookup_input.serialized_request,
+                     shard_lookup_input.padding);
+    }
+    std::vector<absl::StatusOr<InternalLookupResponse>> responses(num_shards_);
+    // Eventually this will go away.
+    responses[current_shard_num_] =
+        get_local_result(shard_lookup_inputs[current_shard_num_].keys);
+    if (latency_tracker_ != nullptr &&
+        !requests->WaitForResponsesUntil(start +
+                                         latency_tracker_->Percentile())) {
+      for (int32_t shard_num : requests->PendingShards()) {
+        const auto hedge_client =
+            shard_manager_.GetOtherReplica(shard_num, clients[shard_num]);
+        if (hedge_client == nullptr) {
+          continue;
         }
-        responses.push_back(std::async(
-            std::launch::async,
-            [client](std::string_view serialized_request, int32_t padding) {
-              return client->GetValues(serialized_request, padding);
-            },
-            shard_lookup_input.serialized_request, shard_lookup_input.padding));
+        metrics_recorder_.IncrementEventCounter(kShardedLookupHedgedRequest);
+        auto& shard_lookup_input = shard_lookup_inputs[shard_num];
+        requests->Send(shard_num, *hedge_client,
+                       shard_lookup_input.serialized_request,
+                       shard_lookup_input.padding);
+      }
+    }
+    requests->WaitForResponses();
+    if (responders != nullptr) {
+      responders->assign(num_shards_, nullptr);
+    }
+    for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+      if (shard_num == current_shard_num_) {
+        continue;
+      }
+      responses[shard_num] = requests->TakeResponse(shard_num);
+      if (responders != nullptr) {
+        (*responders)[shard_num] = requests->Responder(shard_num);
       }
     }
     return responses;
   }
 
-  absl::StatusOr<InternalLookupResponse> GetLocalValues(
-      const std::vector<std::string_view>& key_list) const {
-    InternalLookupResponse response;
-    absl::flat_hash_set<std::string_view> keys(key_list.begin(),
-                                               key_list.end());
-    return local_lookup_.GetKeyValues(keys);
+  // Adds the values of the keys of the current shard straight to `response`,
+  // instead of to a response of their own that would be merged into it.
+  // Returns an empty response for the shard, or the lookup error.
+  absl::StatusOr<InternalLookupResponse> AddLocalValues(
+      const std::vector<std::string_view>& key_list,
+      InternalLookupResponse& response) const {
+    if (auto status = local_lookup_.AddKeyValues(key_list, response);
+        !status.ok()) {
+      return status;
+    }
+    return InternalLookupResponse();
   }
 
   absl::StatusOr<InternalLookupResponse> GetLocalKeyValuesSet(
@@ -320,25 +599,69 @@ class ShardedLookup : public Lookup {
     return local_lookup_.GetKeyValueSet(key_list_set);
   }
 
+  // Moves the remote keys found in the near cache from `lookup_inputs` to
+  // `response`. Returns true if keys were found and no remote key is left.
+  bool TakeNearCachedValues(std::vector<ShardLookupInput>& lookup_inputs,
+                            InternalLookupResponse& response) const {
+    bool found_keys = false;
+    bool missed_keys = false;
+    for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+      if (shard_num == current_shard_num_) {
+        continue;
+      }
+      auto& keys = lookup_inputs[shard_num].keys;
+      auto missed_keys_end = std::remove_if(
+          keys.begin(), keys.end(), [&](std::string_view key) {
+            auto result = options_.near_cache->Get(shard_num, key);
+            if (!result.has_value()) {
+              metrics_recorder_.IncrementEventCounter(kNearCacheMiss);
+              return false;
+            }
+            metrics_recorder_.IncrementEventCounter(kNearCacheHit);
+            (*response.mutable_kv_pairs())[key] = *std::move(result);
+            return true;
+          });
+      found_keys |= missed_keys_end != keys.end();
+      missed_keys |= missed_keys_end != keys.begin();
+      keys.erase(missed_keys_end, keys.end());
+    }
+    return found_keys && !missed_keys;
+  }
+
   absl::StatusOr<InternalLookupResponse> ProcessShardedKeys(
       const absl::flat_hash_set<std::string_view>& keys) const {
     InternalLookupResponse response;
     if (keys.empty()) {
       return response;
     }
-    const auto shard_lookup_inputs = ShardKeys(keys, false);
-    auto responses =
-        GetLookupFutures(shard_lookup_inputs,
-                         [this](const std::vector<std::string_view>& key_list) {
-                           return GetLocalValues(key_list);
-                         });
+    auto shard_lookup_inputs = BucketKeys(keys);
+    absl::StatusOr<std::vector<absl::StatusOr<InternalLookupResponse>>>
+        responses;
+    std::vector<const RemoteLookupClient*> responders;
+    if (options_.near_cache != nullptr &&
+        TakeNearCachedValues(shard_lookup_inputs, response)) {
+      // Remote shards are only asked when a remote key is not cached, so
+      // that whole lookups of popular keys stay on this server.
+      responses.emplace(num_shards_, InternalLookupResponse());
+      (*responses)[current_shard_num_] = AddLocalValues(
+          shard_lookup_inputs[current_shard_num_].keys, response);
+    } else {
+      SerializeShardedRequests(shard_lookup_inputs, false);
+      ComputePadding(shard_lookup_inputs);
+      responses = GetLookupResults(
+          shard_lookup_inputs,
+          [this, &response](const std::vector<std::string_view>& key_list) {
+            return AddLocalValues(key_list, response);
+          },
+          &responders);
+    }
     if (!responses.ok()) {
       return responses.status();
     }
     // process responses
     for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
       auto& shard_lookup_input = shard_lookup_inputs[shard_num];
-      auto result = (*responses)[shard_num].get();
+      auto& result = (*responses)[shard_num];
       if (!result.ok()) {
         // mark all keys as internal failure
         metrics_recorder_.IncrementEventCounter(
@@ -346,6 +669,16 @@ class ShardedLookup : public Lookup {
         SetRequestFailed(shard_lookup_input.keys, response);
         continue;
       }
+      if (shard_num == current_shard_num_) {
+        // Already in `response`.
+        continue;
+      }
+      if (options_.near_cache != nullptr && !responders.empty() &&
+          responders[shard_num] != nullptr) {
+        options_.near_cache->Put(shard_num,
+                                 responders[shard_num]->GetIpAddress(),
+                                 shard_lookup_input.keys, *result);
+      }
       auto kv_pairs = result->mutable_kv_pairs();
       UpdateResponse(shard_lookup_input.keys, *kv_pairs, response);
     }
@@ -387,7 +720,7 @@ class ShardedLookup : public Lookup {
       const absl::flat_hash_set<std::string_view>& key_set) const {
     const auto shard_lookup_inputs = ShardKeys(key_set, true);
     auto responses =
-        GetLookupFutures(shard_lookup_inputs,
+        GetLookupResults(shard_lookup_inputs,
                          [this](const std::vector<std::string_view>& key_list) {
                            return GetLocalKeyValuesSet(key_list);
                          });
@@ -399,7 +732,7 @@ class ShardedLookup : public Lookup {
     absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>> key_sets;
     for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
       auto& shard_lookup_input = shard_lookup_inputs[shard_num];
-      auto result = (*responses)[shard_num].get();
+      auto& result = (*responses)[shard_num];
       if (!result.ok()) {
         metrics_recorder_.IncrementEventCounter(kShardedLookupFailure);
         return result.status();
@@ -416,6 +749,12 @@ class ShardedLookup : public Lookup {
   const ShardManager& shard_manager_;
   MetricsRecorder& metrics_recorder_;
   KeySharder key_sharder_;
+  const ShardedLookupOptions options_;
+  // Latencies of remote requests, only tracked when hedging is enabled.
+  std::shared_ptr<LatencyTracker> latency_tracker_;
+  mutable absl::Mutex batch_mutex_;
+  // Batch that GetKeyValues calls can still add keys to, if any.
+  mutable std::shared_ptr<KeyBatch> open_batch_ ABSL_GUARDED_BY(batch_mutex_);
 };
 
 }  // namespace
@@ -424,10 +763,10 @@ std::unique_ptr<Lookup> CreateShardedLookup(
     const Lookup& local_lookup, const int32_t num_shards,
     const int32_t current_shard_num, const ShardManager& shard_manager,
     privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
-    KeySharder key_sharder) {
+    KeySharder key_sharder, ShardedLookupOptions options) {
   return std::make_unique<ShardedLookup>(
       local_lookup, num_shards, current_shard_num, shard_manager,
-      metrics_recorder, std::move(key_sharder));
+      metrics_recorder, std::move(key_sharder), std::move(options));
 }
 
 }  // namespace kv_server
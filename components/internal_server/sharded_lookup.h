@@ -20,18 +20,46 @@
 #include <memory>
 #include <string>
 
+#include "absl/time/time.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/near_cache.h"
+#include "components/internal_server/remote_lookup_client.h"
 #include "components/sharding/shard_manager.h"
 #include "public/sharding/key_sharder.h"
 #include "src/cpp/telemetry/metrics_recorder.h"
 
 namespace kv_server {
 
+struct ShardedLookupOptions {
+  // Deadline of the requests to remote shards, from the start of the lookup.
+  absl::Duration timeout = absl::InfiniteDuration();
+  // Percentile, in (0, 100], of the latencies of recent requests to remote
+  // shards after which a request still in flight is hedged by sending it to
+  // another replica of the shard. The first response is used and the other
+  // request is cancelled. Zero disables hedging.
+  double hedging_percentile = 0;
+  // How long the first of concurrent GetKeyValues calls waits for others, so
+  // that their keys are deduplicated and looked up with one request per
+  // shard. Zero disables coalescing.
+  absl::Duration coalescing_window = absl::ZeroDuration();
+  // If not null, values of remote keys are looked up in `near_cache` first
+  // and cached there once fetched. Must outlive the lookups.
+  NearCache* near_cache = nullptr;
+  // Number of length buckets between consecutive powers of two that the
+  // requests to remote shards, and their responses, are padded to, so that
+  // their length only reveals its bucket. Fewer buckets hide more, at the
+  // cost of more padding. Zero pads requests to the longest one only, and
+  // doesn't pad responses.
+  int32_t padding_buckets_per_doubling = 0;
+  // Options of the clients of the remote shards.
+  RemoteLookupClientOptions remote_lookup_client_options;
+};
+
 std::unique_ptr<Lookup> CreateShardedLookup(
     const Lookup& local_lookup, const int32_t num_shards,
     const int32_t current_shard_num, const ShardManager& shard_manager,
     privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
-    KeySharder key_sharder);
+    KeySharder key_sharder, ShardedLookupOptions options = {});
 
 }  // namespace kv_server
 
@@ -14,11 +14,16 @@
 
 #include "components/internal_server/sharded_lookup.h"
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
 #include "components/data_server/cache/mocks.h"
 #include "components/internal_server/mocks.h"
 #include "components/sharding/mocks.h"
@@ -37,6 +42,75 @@ using testing::_;
 using testing::Return;
 using testing::ReturnRef;
 
+// Answers from its own thread once `local_lookup_done` is notified, like a
+// remote shard still working while the current shard is looked up.
+class DelayedRemoteLookupClient : public MockRemoteLookupClient {
+ public:
+  explicit DelayedRemoteLookupClient(absl::Notification& local_lookup_done)
+      : local_lookup_done_(local_lookup_done) {}
+
+  ~DelayedRemoteLookupClient() override {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void GetValuesAsync(
+      grpc::ClientContext& context, std::string_view serialized_message,
+      int32_t padding_length,
+      absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+          on_done) const override {
+    thread_ = std::thread([this, on_done = std::move(on_done)]() mutable {
+      local_lookup_done_.WaitForNotification();
+      InternalLookupResponse response;
+      (*response.mutable_kv_pairs())["key1"].set_value("value1");
+      std::move(on_done)(std::move(response));
+    });
+  }
+
+ private:
+  absl::Notification& local_lookup_done_;
+  mutable std::thread thread_;
+};
+
+// Answers from its own thread after 1ms, or after 300ms for the call number
+// `slow_call` across all the clients sharing `num_calls`.
+class SlowRemoteLookupClient : public MockRemoteLookupClient {
+ public:
+  SlowRemoteLookupClient(std::atomic<int>& num_calls, int slow_call)
+      : num_calls_(num_calls), slow_call_(slow_call) {}
+
+  ~SlowRemoteLookupClient() override {
+    absl::MutexLock lock(&mutex_);
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void GetValuesAsync(
+      grpc::ClientContext& context, std::string_view serialized_message,
+      int32_t padding_length,
+      absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+          on_done) const override {
+    const absl::Duration delay = num_calls_++ == slow_call_
+                                     ? absl::Milliseconds(300)
+                                     : absl::Milliseconds(1);
+    absl::MutexLock lock(&mutex_);
+    threads_.emplace_back([delay, on_done = std::move(on_done)]() mutable {
+      absl::SleepFor(delay);
+      InternalLookupResponse response;
+      (*response.mutable_kv_pairs())["key1"].set_value("value1");
+      std::move(on_done)(std::move(response));
+    });
+  }
+
+ private:
+  std::atomic<int>& num_calls_;
+  const int slow_call_;
+  mutable absl::Mutex mutex_;
+  mutable std::vector<std::thread> threads_;
+};
+
 class ShardedLookupTest : public ::testing::Test {
  protected:
   int32_t num_shards_ = 2;
@@ -108,6 +182,207 @@ TEST_F(ShardedLookupTest, GetKeyValues_Success) {
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
+TEST_F(ShardedLookupTest, GetKeyValues_LooksUpLocallyWhileRemoteInFlight) {
+  absl::Notification local_lookup_done;
+  const std::thread::id calling_thread = std::this_thread::get_id();
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_))
+      .WillOnce([&local_lookup_done, calling_thread](
+                    const absl::flat_hash_set<std::string_view>&) {
+        EXPECT_EQ(std::this_thread::get_id(), calling_thread);
+        local_lookup_done.Notify();
+        InternalLookupResponse response;
+        (*response.mutable_kv_pairs())["key4"].set_value("value4");
+        return response;
+      });
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(),
+      [&local_lookup_done](
+          const std::string& ip) -> std::unique_ptr<RemoteLookupClient> {
+        if (ip != "1") {
+          return std::make_unique<MockRemoteLookupClient>();
+        }
+        return std::make_unique<DelayedRemoteLookupClient>(local_lookup_done);
+      });
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      mock_metrics_recorder_, key_sharder_);
+  auto response = sharded_lookup->GetKeyValues({"key1", "key4"});
+  ASSERT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_CoalescesConcurrentLookups) {
+  InternalLookupResponse local_lookup_response;
+  (*local_lookup_response.mutable_kv_pairs())["key4"].set_value("value4");
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_))
+      .WillOnce(Return(local_lookup_response));
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings = {{"0"},
+                                                                    {"1"}};
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto client = std::make_unique<MockRemoteLookupClient>();
+        if (ip == "1") {
+          // Both lookups share one request for the deduplicated key.
+          InternalLookupRequest request;
+          request.add_keys("key1");
+          EXPECT_CALL(*client, GetValues(request.SerializeAsString(), 0))
+              .WillOnce([]() {
+                InternalLookupResponse response;
+                (*response.mutable_kv_pairs())["key1"].set_value("value1");
+                return response;
+              });
+        }
+        return client;
+      });
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      mock_metrics_recorder_, key_sharder_,
+      ShardedLookupOptions{.coalescing_window = absl::Milliseconds(200)});
+
+  absl::StatusOr<InternalLookupResponse> first_response;
+  std::thread first_lookup([&sharded_lookup, &first_response]() {
+    first_response = sharded_lookup->GetKeyValues({"key1", "key4"});
+  });
+  absl::SleepFor(absl::Milliseconds(20));
+  auto second_response = sharded_lookup->GetKeyValues({"key1"});
+  first_lookup.join();
+
+  ASSERT_TRUE(first_response.ok());
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(*first_response, EqualsProto(expected));
+  ASSERT_TRUE(second_response.ok());
+  expected.mutable_kv_pairs()->erase("key4");
+  EXPECT_THAT(*second_response, EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_ServesCachedRemoteKeysLocally) {
+  InternalLookupResponse local_lookup_response;
+  (*local_lookup_response.mutable_kv_pairs())["key4"].set_value("value4");
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_))
+      .Times(2)
+      .WillRepeatedly(Return(local_lookup_response));
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings = {{"0"},
+                                                                    {"1"}};
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto client = std::make_unique<MockRemoteLookupClient>();
+        EXPECT_CALL(*client, GetIpAddress()).WillRepeatedly(Return("ip"));
+        if (ip == "1") {
+          // The second lookup does not ask the remote shard.
+          EXPECT_CALL(*client, GetValues(_, _)).WillOnce([]() {
+            InternalLookupResponse response;
+            (*response.mutable_kv_pairs())["key1"].set_value("value1");
+            return response;
+          });
+        }
+        return client;
+      });
+  NearCache near_cache(num_shards_, {});
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      mock_metrics_recorder_, key_sharder_,
+      ShardedLookupOptions{.near_cache = &near_cache});
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &expected);
+  for (int i = 0; i < 2; i++) {
+    auto response = sharded_lookup->GetKeyValues({"key1", "key4"});
+    ASSERT_TRUE(response.ok());
+    EXPECT_THAT(*response, EqualsProto(expected));
+  }
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_HedgesSlowRequestToOtherReplica) {
+  // Enough fast lookups to compute the hedging delay, then a slow one.
+  constexpr int kNumLookups = 65;
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_))
+      .Times(kNumLookups)
+      .WillRepeatedly([](const absl::flat_hash_set<std::string_view>&) {
+        InternalLookupResponse response;
+        (*response.mutable_kv_pairs())["key4"].set_value("value4");
+        return response;
+      });
+  std::atomic<int> num_calls = 0;
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings = {
+      {"0"}, {"1", "2"}};
+  auto random_generator = std::make_unique<MockRandomGenerator>();
+  EXPECT_CALL(*random_generator, Get(_)).WillRepeatedly(Return(0));
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings), std::move(random_generator),
+      [&num_calls](
+          const std::string& ip) -> std::unique_ptr<RemoteLookupClient> {
+        return std::make_unique<SlowRemoteLookupClient>(num_calls,
+                                                        kNumLookups - 1);
+      });
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      mock_metrics_recorder_, key_sharder_,
+      ShardedLookupOptions{.hedging_percentile = 50});
+  for (int i = 0; i < kNumLookups - 1; i++) {
+    ASSERT_TRUE(sharded_lookup->GetKeyValues({"key1", "key4"}).ok());
+  }
+  EXPECT_EQ(num_calls.load(), kNumLookups - 1);
+
+  const absl::Time start = absl::Now();
+  auto response = sharded_lookup->GetKeyValues({"key1", "key4"});
+  ASSERT_TRUE(response.ok());
+  // The slow request was sent to the other replica too. It ignores
+  // cancellation, as lookups on a stream do, but is not waited for.
+  EXPECT_EQ(num_calls.load(), kNumLookups + 1);
+  EXPECT_LT(absl::Now() - start, absl::Milliseconds(250));
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
 TEST_F(ShardedLookupTest, GetKeyValues_KeyMissing_ReturnsStatus) {
   InternalLookupResponse local_lookup_response;
   TextFormat::ParseFromString(
@@ -446,6 +721,47 @@ TEST_F(ShardedLookupTest, GetKeyValues_ReturnsKeysFromCachePadding) {
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
+TEST_F(ShardedLookupTest, GetKeyValues_PadsRemoteRequestsToBucket) {
+  auto num_shards = 4;
+  // "key4" and "verylongkey2" are on the current shard 0, whose 22 bytes long
+  // request is not sent. "key1" and "key2" are on shard 1, which makes a 14
+  // bytes long request, padded to the bucket of 16 bytes, like the requests
+  // without keys.
+  absl::flat_hash_set<std::string_view> keys = {"key4", "verylongkey2",
+                                                "key1", "key2"};
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_))
+      .WillOnce(Return(InternalLookupResponse()));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < num_shards; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "0") {
+          EXPECT_CALL(*mock_remote_lookup_client, GetValues(_, _))
+              .WillOnce([](const std::string_view serialized_message,
+                           const int32_t padding_length) {
+                EXPECT_EQ(serialized_message.size() + padding_length, 16);
+                InternalLookupRequest request;
+                EXPECT_TRUE(request.ParseFromString(serialized_message));
+                EXPECT_EQ(request.response_padding_buckets_per_doubling(), 1);
+                return InternalLookupResponse();
+              });
+        }
+        return mock_remote_lookup_client;
+      });
+
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards, shard_num_, *(*shard_manager),
+      mock_metrics_recorder_, key_sharder_,
+      ShardedLookupOptions{.padding_buckets_per_doubling = 1});
+  EXPECT_TRUE(sharded_lookup->GetKeyValues(keys).ok());
+}
+
 TEST_F(ShardedLookupTest, GetKeyValueSets_KeysFound_Success) {
   InternalLookupResponse local_lookup_response;
   TextFormat::ParseFromString(
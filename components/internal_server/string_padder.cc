@@ -13,6 +13,7 @@
 // limitations under the License.
 #include "components/internal_server/string_padder.h"
 
+#include <cmath>
 #include <string>
 
 #include "glog/logging.h"
@@ -22,13 +23,45 @@
 namespace kv_server {
 
 std::string Pad(std::string_view string_to_pad, int32_t extra_padding) {
-  int output_size = sizeof(u_int32_t) + string_to_pad.size() + extra_padding;
-  std::string output(output_size, '0');
+  std::string output;
+  AppendPadded(string_to_pad, extra_padding, output);
+  return output;
+}
+
+void AppendPadded(std::string_view string_to_pad, int32_t extra_padding,
+                  std::string& output) {
+  const size_t offset = output.size();
+  output.resize(offset + PaddedLength(string_to_pad, extra_padding), '0');
 
-  quiche::QuicheDataWriter data_writer(output.size(), output.data());
+  quiche::QuicheDataWriter data_writer(output.size() - offset,
+                                       output.data() + offset);
   data_writer.WriteUInt32(string_to_pad.size());
   data_writer.WriteStringPiece(string_to_pad);
-  return output;
+}
+
+size_t PaddedLength(std::string_view string_to_pad, int32_t extra_padding) {
+  return sizeof(u_int32_t) + string_to_pad.size() + extra_padding;
+}
+
+int32_t RoundUpToBucket(int32_t length, int32_t buckets_per_doubling) {
+  if (buckets_per_doubling <= 0 || length <= 1) {
+    return length;
+  }
+  int64_t power_of_two = 1;
+  while (power_of_two * 2 <= length) {
+    power_of_two *= 2;
+  }
+  if (power_of_two == length) {
+    return length;
+  }
+  for (int32_t bucket = 1; bucket < buckets_per_doubling; ++bucket) {
+    const auto bucket_length = static_cast<int64_t>(std::ceil(
+        power_of_two * std::exp2(double(bucket) / buckets_per_doubling)));
+    if (bucket_length >= length) {
+      return bucket_length;
+    }
+  }
+  return power_of_two * 2;
 }
 
 absl::StatusOr<std::string> Unpad(std::string_view padded_string) {
@@ -28,6 +28,17 @@ namespace kv_server {
 //  length               data           filler
 // filler.size() == extra_padding
 std::string Pad(std::string_view string_to_pad, int32_t extra_padding);
+// Same as Pad, but appends the padded string to `output`, e.g. to write it
+// straight into a buffer that is then encrypted in place.
+void AppendPadded(std::string_view string_to_pad, int32_t extra_padding,
+                  std::string& output);
+// Length of the output of Pad.
+size_t PaddedLength(std::string_view string_to_pad, int32_t extra_padding);
+// Rounds `length` up to the nearest bucket, so that a padded length only
+// reveals its bucket. Buckets grow geometrically, `buckets_per_doubling` of
+// them between consecutive powers of two, e.g. 1 rounds up to powers of two.
+// Zero returns `length`.
+int32_t RoundUpToBucket(int32_t length, int32_t buckets_per_doubling);
 // Takes the string padded with the method above OR in the same format
 // and returns the string.
 absl::StatusOr<std::string> Unpad(std::string_view padded_string);
@@ -14,8 +14,10 @@
 
 #include "components/internal_server/string_padder.h"
 
+#include <string>
 #include <string_view>
 
+#include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
 
 namespace kv_server {
@@ -57,6 +59,34 @@ TEST(PadUnpadEmtpyString, Success) {
   EXPECT_EQ(*original_string_status, kTestString);
 }
 
+TEST(AppendPadded, MatchesPad) {
+  const std::string_view kTestString = "string to pad";
+  std::string output = "prefix";
+  AppendPadded(kTestString, 10, output);
+  EXPECT_EQ(output, absl::StrCat("prefix", Pad(kTestString, 10)));
+  EXPECT_EQ(output.size(), 6 + PaddedLength(kTestString, 10));
+}
+
+TEST(RoundUpToBucket, PowersOfTwo) {
+  EXPECT_EQ(RoundUpToBucket(0, 1), 0);
+  EXPECT_EQ(RoundUpToBucket(1, 1), 1);
+  EXPECT_EQ(RoundUpToBucket(5, 1), 8);
+  EXPECT_EQ(RoundUpToBucket(8, 1), 8);
+  EXPECT_EQ(RoundUpToBucket(1000, 1), 1024);
+}
+
+TEST(RoundUpToBucket, SeveralBucketsPerDoubling) {
+  // Buckets between 64 and 128 are 77, 91 and 108.
+  EXPECT_EQ(RoundUpToBucket(65, 4), 77);
+  EXPECT_EQ(RoundUpToBucket(91, 4), 91);
+  EXPECT_EQ(RoundUpToBucket(100, 4), 108);
+  EXPECT_EQ(RoundUpToBucket(120, 4), 128);
+}
+
+TEST(RoundUpToBucket, ZeroBucketsKeepsLength) {
+  EXPECT_EQ(RoundUpToBucket(1000, 0), 1000);
+}
+
 TEST(UnpadFailure, Success) {
   auto original_string_status = Unpad("garbage");
   ASSERT_FALSE(original_string_status.ok());
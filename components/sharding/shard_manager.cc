@@ -13,6 +13,8 @@
 // limitations under the License.
 #include "components/sharding/shard_manager.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iterator>
 #include <map>
 #include <memory>
@@ -26,22 +28,118 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "glog/logging.h"
 
 namespace kv_server {
 namespace {
 
+// Weight of the latest result in the moving averages of a replica.
+constexpr double kEwmaWeight = 0.2;
+// A replica is ejected once this share of its recent requests failed...
+constexpr double kEjectionErrorRate = 0.5;
+// ...and at least this many results were recorded.
+constexpr int kEjectionMinResults = 5;
+constexpr absl::Duration kEjectionDuration = absl::Seconds(10);
+
 class RandomGeneratorImpl : public RandomGenerator {
  public:
-  RandomGeneratorImpl() : generator_{rand_dev_()} {}
-
+  // Called concurrently by readers, so each thread has its own generator.
   int64_t Get(int64_t upper_bound) {
-    std::uniform_int_distribution<int> distr(0, upper_bound - 1);
-    return distr(generator_);
+    thread_local std::mt19937 generator{std::random_device{}()};
+    std::uniform_int_distribution<int64_t> distr(0, upper_bound - 1);
+    return distr(generator);
+  }
+};
+
+void UpdateEwma(std::atomic<double>& average, double value) {
+  double current = average.load(std::memory_order_relaxed);
+  while (!average.compare_exchange_weak(
+      current, current + kEwmaWeight * (value - current),
+      std::memory_order_relaxed)) {
+  }
+}
+
+// Forwards calls to the client of one replica and tracks the load and health
+// of the replica from their results.
+class ReplicaClient : public RemoteLookupClient {
+ public:
+  explicit ReplicaClient(std::unique_ptr<RemoteLookupClient> client)
+      : client_(std::move(client)) {}
+
+  absl::StatusOr<InternalLookupResponse> GetValues(
+      std::string_view serialized_message,
+      int32_t padding_length) const override {
+    const absl::Time start = OnStart();
+    auto response = client_->GetValues(serialized_message, padding_length);
+    OnDone(start, response.status());
+    return response;
+  }
+
+  void GetValuesAsync(
+      grpc::ClientContext& context, std::string_view serialized_message,
+      int32_t padding_length,
+      absl::AnyInvocable<void(absl::StatusOr<InternalLookupResponse>) &&>
+          on_done) const override {
+    const absl::Time start = OnStart();
+    client_->GetValuesAsync(
+        context, serialized_message, padding_length,
+        [this, start, on_done = std::move(on_done)](
+            absl::StatusOr<InternalLookupResponse> response) mutable {
+          OnDone(start, response.status());
+          std::move(on_done)(std::move(response));
+        });
+  }
+
+  std::string_view GetIpAddress() const override {
+    return client_->GetIpAddress();
+  }
+
+  bool IsEjected(absl::Time now) const {
+    return now < absl::FromUnixNanos(
+                     ejected_until_ns_.load(std::memory_order_relaxed));
+  }
+
+  // Expected cost of sending one more request: the average latency scaled by
+  // the requests the replica is already working on.
+  double Cost() const {
+    return std::max(latency_ms_.load(std::memory_order_relaxed), 0.001) *
+           (num_in_flight_.load(std::memory_order_relaxed) + 1);
   }
 
  private:
-  std::random_device rand_dev_;
-  std::mt19937 generator_;
+  absl::Time OnStart() const {
+    num_in_flight_.fetch_add(1, std::memory_order_relaxed);
+    return absl::Now();
+  }
+
+  void OnDone(absl::Time start, const absl::Status& status) const {
+    num_in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    // Cancelled requests lost a hedge and say nothing about the replica.
+    if (absl::IsCancelled(status)) {
+      return;
+    }
+    const absl::Time now = absl::Now();
+    UpdateEwma(latency_ms_, absl::ToDoubleMilliseconds(now - start));
+    UpdateEwma(error_rate_, status.ok() ? 0 : 1);
+    if (num_results_.fetch_add(1, std::memory_order_relaxed) + 1 >=
+            kEjectionMinResults &&
+        error_rate_.load(std::memory_order_relaxed) > kEjectionErrorRate &&
+        !IsEjected(now)) {
+      LOG(WARNING) << "Ejecting replica " << GetIpAddress() << " for "
+                   << kEjectionDuration;
+      ejected_until_ns_.store(absl::ToUnixNanos(now + kEjectionDuration),
+                              std::memory_order_relaxed);
+    }
+  }
+
+  std::unique_ptr<RemoteLookupClient> client_;
+  mutable std::atomic<int32_t> num_in_flight_ = 0;
+  mutable std::atomic<int64_t> num_results_ = 0;
+  mutable std::atomic<double> latency_ms_ = 0;
+  mutable std::atomic<double> error_rate_ = 0;
+  mutable std::atomic<int64_t> ejected_until_ns_ = 0;
 };
 
 class ShardManagerImpl : public ShardManager {
@@ -71,7 +169,8 @@ class ShardManagerImpl : public ShardManager {
         if (key_iter != remote_lookup_clients_.end()) {
           continue;
         }
-        remote_lookup_clients_.insert({ip, client_factory_(ip)});
+        remote_lookup_clients_.insert(
+            {ip, std::make_unique<ReplicaClient>(client_factory_(ip))});
       }
       cluster_mappings_vector.emplace_back(std::move(vc));
     }
@@ -88,8 +187,55 @@ class ShardManagerImpl : public ShardManager {
     if (shard_replicas.size() == 0) {
       return nullptr;
     }
-    const auto replica_idx = random_generator_->Get(shard_replicas.size());
-    const auto& ip_address = shard_replicas[replica_idx];
+    // Power of two choices: compare two random replicas, which keeps traffic
+    // away from slow, busy or failing replicas without herding on the best
+    // one.
+    const int64_t num_replicas = shard_replicas.size();
+    const int64_t first_idx = random_generator_->Get(num_replicas);
+    ReplicaClient* first = GetClient(shard_replicas[first_idx]);
+    if (num_replicas == 1) {
+      return first;
+    }
+    const int64_t second_idx =
+        (first_idx + 1 + random_generator_->Get(num_replicas - 1)) %
+        num_replicas;
+    ReplicaClient* second = GetClient(shard_replicas[second_idx]);
+    if (first == nullptr || second == nullptr) {
+      return first == nullptr ? second : first;
+    }
+    const absl::Time now = absl::Now();
+    if (first->IsEjected(now) != second->IsEjected(now)) {
+      return first->IsEjected(now) ? second : first;
+    }
+    return second->Cost() < first->Cost() ? second : first;
+  }
+
+  RemoteLookupClient* GetOtherReplica(
+      int64_t shard_num, const RemoteLookupClient* excluded) const override {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (shard_num < 0 || shard_num >= num_shards_ ||
+        cluster_mappings_.size() != num_shards_) {
+      return nullptr;
+    }
+    const auto& shard_replicas = cluster_mappings_[shard_num];
+    std::vector<RemoteLookupClient*> other_clients;
+    other_clients.reserve(shard_replicas.size());
+    const absl::Time now = absl::Now();
+    for (const auto& ip_address : shard_replicas) {
+      if (auto* client = GetClient(ip_address);
+          client != nullptr && client != excluded && !client->IsEjected(now)) {
+        other_clients.push_back(client);
+      }
+    }
+    if (other_clients.empty()) {
+      return nullptr;
+    }
+    return other_clients[random_generator_->Get(other_clients.size())];
+  }
+
+ private:
+  ReplicaClient* GetClient(const std::string& ip_address) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
     const auto key_iter = remote_lookup_clients_.find(ip_address);
     if (key_iter == remote_lookup_clients_.end()) {
       return nullptr;
@@ -98,12 +244,11 @@ class ShardManagerImpl : public ShardManager {
     }
   }
 
- private:
   mutable absl::Mutex mutex_;
   // (idx) shard id -> set of ip_addresses
   std::vector<std::vector<std::string>> cluster_mappings_
       ABSL_GUARDED_BY(mutex_);
-  absl::flat_hash_map<std::string, std::unique_ptr<RemoteLookupClient>>
+  absl::flat_hash_map<std::string, std::unique_ptr<ReplicaClient>>
       remote_lookup_clients_ ABSL_GUARDED_BY(mutex_);
   int32_t num_shards_;
   std::function<std::unique_ptr<RemoteLookupClient>(const std::string& ip)>
@@ -141,16 +286,18 @@ absl::StatusOr<std::unique_ptr<ShardManager>> ShardManager::Create(
     privacy_sandbox::server_common::KeyFetcherManagerInterface&
         key_fetcher_manager,
     const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings,
-    privacy_sandbox::server_common::MetricsRecorder& metrics_recorder) {
+    privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+    RemoteLookupClientOptions client_options) {
   auto validationStatus = ValidateMapping(num_shards, cluster_mappings);
   if (!validationStatus.ok()) {
     return validationStatus;
   }
   auto shard_manager = std::make_unique<ShardManagerImpl>(
       cluster_mappings.size(),
-      [&key_fetcher_manager, &metrics_recorder](const std::string& ip) {
+      [&key_fetcher_manager, &metrics_recorder,
+       client_options](const std::string& ip) {
         return RemoteLookupClient::Create(ip, key_fetcher_manager,
-                                          metrics_recorder);
+                                          metrics_recorder, client_options);
       },
       std::make_unique<RandomGeneratorImpl>());
   shard_manager->InsertBatch(std::move(cluster_mappings));
@@ -39,8 +39,9 @@ class RandomGenerator {
 
 // This class allows communication between a UDF server and data servers.
 // A mapping from a shard number to a set of ip addresses should be inserted
-// periodically. The class allows to retreive a RemoteLookupClient assigned to a
-// random ip address from the provided pool. ShardManager is thread safe.
+// periodically. The class allows to retreive a RemoteLookupClient assigned to
+// an ip address from the provided pool, picked by the latency, load and error
+// rate the returned clients observed. ShardManager is thread safe.
 class ShardManager {
  public:
   virtual ~ShardManager() = default;
@@ -50,14 +51,22 @@ class ShardManager {
   virtual void InsertBatch(const std::vector<absl::flat_hash_set<std::string>>&
                                cluster_mappings) = 0;
   // Given the shard number, get a remote lookup client for one of the replicas
-  // in the pool.
+  // in the pool. Of two random replicas, prefers one that is not ejected for
+  // failing most of its recent requests, then the one with the lower average
+  // latency times requests in flight.
   virtual RemoteLookupClient* Get(int64_t shard_num) const = 0;
+  // Given the shard number, get a remote lookup client for one of the replicas
+  // in the pool other than `excluded`, e.g. to hedge a request sent to
+  // `excluded`. Returns nullptr if the shard has no other healthy replica.
+  virtual RemoteLookupClient* GetOtherReplica(
+      int64_t shard_num, const RemoteLookupClient* excluded) const = 0;
   static absl::StatusOr<std::unique_ptr<ShardManager>> Create(
       int32_t num_shards,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
       const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings,
-      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder);
+      privacy_sandbox::server_common::MetricsRecorder& metrics_recorder,
+      RemoteLookupClientOptions client_options = {});
   static absl::StatusOr<std::unique_ptr<ShardManager>> Create(
       int32_t num_shards,
       const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings,
@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "components/internal_server/constants.h"
+#include "components/internal_server/mocks.h"
 #include "components/sharding/mocks.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -30,6 +31,8 @@ namespace {
 
 using privacy_sandbox::server_common::FakeKeyFetcherManager;
 using privacy_sandbox::server_common::MockMetricsRecorder;
+using testing::_;
+using testing::Return;
 
 class ShardManagerTest : public ::testing::Test {
  protected:
@@ -118,9 +121,12 @@ TEST_F(ShardManagerTest, InsertMissingReplicasRetrieveSuccess) {
 TEST_F(ShardManagerTest, InsertRetrieveTwoVersions) {
   auto random_generator = std::make_unique<MockRandomGenerator>();
   MockMetricsRecorder mock_metrics_recorder_;
+  // Each Get compares two replicas, which are tied until they serve requests.
   EXPECT_CALL(*random_generator, Get(testing::_))
       .WillOnce([]() { return 0; })
-      .WillOnce([]() { return 1; });
+      .WillOnce([]() { return 0; })
+      .WillOnce([]() { return 1; })
+      .WillOnce([]() { return 0; });
   std::string instance_id_1 = "some_ip_1";
   std::string instance_id_2 = "some_ip_2";
   std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
@@ -147,5 +153,61 @@ TEST_F(ShardManagerTest, InsertRetrieveTwoVersions) {
   EXPECT_EQ(etalon, result);
 }
 
+TEST_F(ShardManagerTest, GetAvoidsFailingReplica) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings = {
+      {"healthy", "failing"}, {"some_ip"}};
+  auto shard_manager = ShardManager::Create(
+      2, std::move(cluster_mappings), std::make_unique<MockRandomGenerator>(),
+      [](const std::string& ip) {
+        auto client = std::make_unique<MockRemoteLookupClient>();
+        const bool is_failing = ip == "failing";
+        EXPECT_CALL(*client, GetIpAddress())
+            .WillRepeatedly(Return(is_failing ? "failing" : "healthy"));
+        EXPECT_CALL(*client, GetValues(_, _))
+            .WillRepeatedly(
+                [is_failing]() -> absl::StatusOr<InternalLookupResponse> {
+                  if (is_failing) {
+                    return absl::UnavailableError("failing");
+                  }
+                  return InternalLookupResponse();
+                });
+        return client;
+      });
+  ASSERT_TRUE(shard_manager.ok());
+  RemoteLookupClient* failing = (*shard_manager)->Get(0);
+  if (failing->GetIpAddress() != "failing") {
+    failing = (*shard_manager)->GetOtherReplica(0, failing);
+  }
+  ASSERT_EQ(failing->GetIpAddress(), "failing");
+  // Enough failures for the replica to be ejected.
+  for (int i = 0; i < 5; i++) {
+    EXPECT_FALSE(failing->GetValues("", 0).ok());
+  }
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ((*shard_manager)->Get(0)->GetIpAddress(), "healthy");
+  }
+  EXPECT_EQ((*shard_manager)->GetOtherReplica(0, (*shard_manager)->Get(0)),
+            nullptr);
+}
+
+TEST_F(ShardManagerTest, GetOtherReplicaExcludesReplica) {
+  int32_t num_shards = 2;
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings = {
+      {"some_ip_1", "some_ip_2"}, {"some_ip_3"}};
+  auto shard_manager =
+      ShardManager::Create(num_shards, fake_key_fetcher_manager_,
+                           std::move(cluster_mappings), mock_metrics_recorder_);
+  ASSERT_TRUE(shard_manager.ok());
+  for (int i = 0; i < 10; i++) {
+    const RemoteLookupClient* client = (*shard_manager)->Get(0);
+    const RemoteLookupClient* other_client =
+        (*shard_manager)->GetOtherReplica(0, client);
+    ASSERT_NE(other_client, nullptr);
+    EXPECT_NE(other_client, client);
+  }
+  EXPECT_EQ((*shard_manager)->GetOtherReplica(1, (*shard_manager)->Get(1)),
+            nullptr);
+}
+
 }  // namespace
 }  // namespace kv_server
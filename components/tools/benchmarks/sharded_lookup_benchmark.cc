@@ -0,0 +1,337 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/internal_server/local_lookup.h"
+#include "components/internal_server/lookup.h"
+#include "components/internal_server/lookup_server_impl.h"
+#include "components/internal_server/remote_lookup_client.h"
+#include "components/internal_server/sharded_lookup.h"
+#include "components/sharding/shard_manager.h"
+#include "components/tools/benchmarks/benchmark_util.h"
+#include "glog/logging.h"
+#include "grpcpp/grpcpp.h"
+#include "public/sharding/key_sharder.h"
+#include "src/cpp/encryption/key_fetcher/src/fake_key_fetcher_manager.h"
+#include "src/cpp/telemetry/metrics_recorder.h"
+#include "src/cpp/telemetry/telemetry_provider.h"
+
+ABSL_FLAG(std::vector<std::string>, num_shards,
+          std::vector<std::string>({"2", "4", "8"}),
+          "Numbers of shards of the clusters that we look keys up in.");
+ABSL_FLAG(std::vector<std::string>, query_size,
+          std::vector<std::string>({"10", "100", "1000"}),
+          "Number of keys looked up by each request.");
+ABSL_FLAG(int64_t, record_size, 64, "Size of each value, in bytes.");
+ABSL_FLAG(int64_t, set_size, 10, "Number of elements of each value set.");
+ABSL_FLAG(bool, use_lookup_stream, false,
+          "Whether remote lookups are multiplexed over one encrypted stream "
+          "per shard.");
+ABSL_FLAG(int32_t, padding_buckets_per_doubling, 0,
+          "Number of length buckets between consecutive powers of two that "
+          "requests to remote shards, and their responses, are padded to.");
+ABSL_FLAG(int64_t, iterations, -1,
+          "Number of iterations to run each benchmark.");
+ABSL_FLAG(int64_t, min_threads, 1,
+          "Minimum number of threads issuing requests concurrently.");
+ABSL_FLAG(int64_t, max_threads, 1,
+          "Maximum number of threads issuing requests concurrently.");
+
+namespace kv_server {
+namespace {
+
+using kv_server::benchmark::GenerateRandomString;
+using kv_server::benchmark::ParseInt64List;
+using privacy_sandbox::server_common::FakeKeyFetcherManager;
+using privacy_sandbox::server_common::MetricsRecorder;
+using privacy_sandbox::server_common::TelemetryProvider;
+
+// Format variables used to generate benchmark names.
+//
+// => ns - number of shards of the cluster.
+// => qz - query size, i.e., number of keys looked up by each request.
+constexpr std::string_view kGetKeyValuesFmt =
+    "BM_ShardedLookup_GetKeyValues/ns:%d/qz:%d";
+constexpr std::string_view kGetKeyValueSetFmt =
+    "BM_ShardedLookup_GetKeyValueSet/ns:%d/qz:%d";
+constexpr std::string_view kRunQueryFmt =
+    "BM_ShardedLookup_RunQuery/ns:%d/qz:%d";
+
+constexpr std::string_view kRequestsPerSec = "Requests/s";
+
+std::string GetKey(int64_t i) { return absl::StrCat("key", i); }
+std::string GetSetKey(int64_t i) { return absl::StrCat("set", i); }
+
+// Each shard has a single replica.
+class FirstReplicaGenerator : public RandomGenerator {
+ public:
+  int64_t Get(int64_t upper_bound) override { return 0; }
+};
+
+// A cluster of shards that all run in this process. Shard 0 is the current
+// shard, whose keys are looked up locally. The other shards are served by
+// `LookupServiceImpl`s behind in-process gRPC channels, so that lookups pay
+// for the fan-out, padding, encryption, gRPC and merging of the responses,
+// but not for the network.
+class FakeCluster {
+ public:
+  FakeCluster(int32_t num_shards, int64_t num_keys,
+              MetricsRecorder& metrics_recorder)
+      : key_sharder_(ShardingFunction{/*seed=*/""}) {
+    const int64_t record_size = absl::GetFlag(FLAGS_record_size);
+    const std::string value = GenerateRandomString(record_size);
+    std::vector<std::string> set_value;
+    for (int64_t i = 0; i < absl::GetFlag(FLAGS_set_size); ++i) {
+      set_value.push_back(GenerateRandomString(record_size));
+    }
+    std::vector<std::string_view> set_view(set_value.begin(), set_value.end());
+    std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+    for (int32_t shard_num = 0; shard_num < num_shards; ++shard_num) {
+      Shard& shard =
+          *shards_.emplace_back(std::make_unique<Shard>(metrics_recorder));
+      // Each shard only holds its own keys, as loaded from sharded files.
+      for (int64_t i = 0; i < num_keys; ++i) {
+        const std::string key = GetKey(i);
+        if (key_sharder_.GetShardNumForKey(key, num_shards).shard_num ==
+            shard_num) {
+          shard.cache->UpdateKeyValue(key, value, /*logical_commit_time=*/1);
+        }
+        const std::string set_key = GetSetKey(i);
+        if (key_sharder_.GetShardNumForKey(set_key, num_shards).shard_num ==
+            shard_num) {
+          shard.cache->UpdateKeyValueSet(set_key, absl::MakeSpan(set_view),
+                                         /*logical_commit_time=*/1);
+        }
+      }
+      shard.service = std::make_unique<LookupServiceImpl>(
+          *shard.local_lookup, key_fetcher_manager_, metrics_recorder);
+      grpc::ServerBuilder builder;
+      builder.RegisterService(shard.service.get());
+      shard.server = builder.BuildAndStart();
+      cluster_mappings.push_back({std::to_string(shard_num)});
+    }
+    const RemoteLookupClientOptions client_options = {
+        .use_lookup_stream = absl::GetFlag(FLAGS_use_lookup_stream),
+    };
+    auto shard_manager = ShardManager::Create(
+        num_shards, std::move(cluster_mappings),
+        std::make_unique<FirstReplicaGenerator>(),
+        [this, client_options, &metrics_recorder](const std::string& ip) {
+          grpc::Server& server = *shards_[std::stoi(ip)]->server;
+          return RemoteLookupClient::Create(
+              InternalLookupService::NewStub(
+                  server.InProcessChannel(grpc::ChannelArguments())),
+              key_fetcher_manager_, metrics_recorder, client_options);
+        });
+    CHECK(shard_manager.ok()) << shard_manager.status();
+    shard_manager_ = *std::move(shard_manager);
+    sharded_lookup_ = CreateShardedLookup(
+        *shards_[0]->local_lookup, num_shards, /*current_shard_num=*/0,
+        *shard_manager_, metrics_recorder, key_sharder_,
+        ShardedLookupOptions{
+            .padding_buckets_per_doubling =
+                absl::GetFlag(FLAGS_padding_buckets_per_doubling),
+        });
+  }
+
+  ~FakeCluster() {
+    // The clients must be done with their calls before the servers stop.
+    sharded_lookup_.reset();
+    shard_manager_.reset();
+    for (auto& shard : shards_) {
+      shard->server->Shutdown();
+      shard->server->Wait();
+    }
+  }
+
+  const Lookup& sharded_lookup() const { return *sharded_lookup_; }
+
+ private:
+  struct Shard {
+    explicit Shard(MetricsRecorder& metrics_recorder)
+        : cache(KeyValueCache::Create(metrics_recorder)),
+          local_lookup(CreateLocalLookup(*cache, metrics_recorder)) {}
+
+    std::unique_ptr<Cache> cache;
+    std::unique_ptr<Lookup> local_lookup;
+    std::unique_ptr<LookupServiceImpl> service;
+    std::unique_ptr<grpc::Server> server;
+  };
+
+  KeySharder key_sharder_;
+  FakeKeyFetcherManager key_fetcher_manager_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::unique_ptr<ShardManager> shard_manager_;
+  std::unique_ptr<Lookup> sharded_lookup_;
+};
+
+struct BenchmarkArgs {
+  int64_t query_size = 1;
+  const FakeCluster* cluster = nullptr;
+};
+
+// Runs `lookup` once per iteration and reports the percentiles of its
+// latency, in microseconds, along with the throughput.
+template <typename LookupFn>
+void RunLookups(::benchmark::State& state, LookupFn lookup) {
+  std::vector<double> latencies_us;
+  for (auto _ : state) {
+    const absl::Time start = absl::Now();
+    const auto status = lookup();
+    latencies_us.push_back(absl::ToDoubleMicroseconds(absl::Now() - start));
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  if (latencies_us.empty()) {
+    return;
+  }
+  std::sort(latencies_us.begin(), latencies_us.end());
+  for (const auto& [name, percentile] :
+       {std::pair{"p50_us", 0.5}, {"p90_us", 0.9}, {"p99_us", 0.99}}) {
+    const size_t index = std::min(
+        latencies_us.size() - 1, size_t(percentile * latencies_us.size()));
+    state.counters[name] = ::benchmark::Counter(
+        latencies_us[index], ::benchmark::Counter::kAvgThreads);
+  }
+  state.counters[std::string(kRequestsPerSec)] =
+      ::benchmark::Counter(state.iterations(), ::benchmark::Counter::kIsRate);
+}
+
+void BM_GetKeyValues(::benchmark::State& state, BenchmarkArgs args) {
+  std::vector<std::string> keys;
+  for (int64_t i = 0; i < args.query_size; ++i) {
+    keys.push_back(GetKey(i));
+  }
+  const absl::flat_hash_set<std::string_view> keys_view(keys.begin(),
+                                                        keys.end());
+  RunLookups(state, [&]() {
+    return args.cluster->sharded_lookup().GetKeyValues(keys_view).status();
+  });
+}
+
+void BM_GetKeyValueSet(::benchmark::State& state, BenchmarkArgs args) {
+  std::vector<std::string> keys;
+  for (int64_t i = 0; i < args.query_size; ++i) {
+    keys.push_back(GetSetKey(i));
+  }
+  const absl::flat_hash_set<std::string_view> keys_view(keys.begin(),
+                                                        keys.end());
+  RunLookups(state, [&]() {
+    return args.cluster->sharded_lookup().GetKeyValueSet(keys_view).status();
+  });
+}
+
+void BM_RunQuery(::benchmark::State& state, BenchmarkArgs args) {
+  std::vector<std::string> keys;
+  for (int64_t i = 0; i < args.query_size; ++i) {
+    keys.push_back(GetSetKey(i));
+  }
+  const std::string query = absl::StrJoin(keys, " | ");
+  RunLookups(state, [&]() {
+    return args.cluster->sharded_lookup().RunQuery(query).status();
+  });
+}
+
+// Registers a function to benchmark. CPU time is measured for the whole
+// process, so that it includes the work of the remote shards.
+void RegisterBenchmark(
+    std::string name, BenchmarkArgs args,
+    std::function<void(::benchmark::State&, BenchmarkArgs)> benchmark) {
+  auto b =
+      ::benchmark::RegisterBenchmark(name.c_str(), benchmark, std::move(args));
+  auto min = std::max(absl::GetFlag(FLAGS_min_threads), 1L);
+  auto max = absl::GetFlag(FLAGS_max_threads);
+  b->ThreadRange(min, max < min ? min : max);
+  b->MeasureProcessCPUTime();
+  b->UseRealTime();
+  if (absl::GetFlag(FLAGS_iterations) > 0) {
+    b->Iterations(absl::GetFlag(FLAGS_iterations));
+  }
+}
+
+// Returns the clusters, which must outlive the benchmarks.
+std::vector<std::unique_ptr<FakeCluster>> RegisterBenchmarks(
+    MetricsRecorder& metrics_recorder) {
+  auto num_shards_list = ParseInt64List(absl::GetFlag(FLAGS_num_shards));
+  auto query_sizes = ParseInt64List(absl::GetFlag(FLAGS_query_size));
+  CHECK(num_shards_list.ok()) << num_shards_list.status();
+  CHECK(query_sizes.ok()) << query_sizes.status();
+  const int64_t num_keys =
+      *std::max_element(query_sizes->begin(), query_sizes->end());
+  std::vector<std::unique_ptr<FakeCluster>> clusters;
+  for (auto num_shards : num_shards_list.value()) {
+    const auto& cluster = clusters.emplace_back(
+        std::make_unique<FakeCluster>(num_shards, num_keys, metrics_recorder));
+    for (auto query_size : query_sizes.value()) {
+      const auto args = BenchmarkArgs{
+          .query_size = query_size,
+          .cluster = cluster.get(),
+      };
+      ::kv_server::RegisterBenchmark(
+          absl::StrFormat(kGetKeyValuesFmt, num_shards, query_size), args,
+          BM_GetKeyValues);
+      ::kv_server::RegisterBenchmark(
+          absl::StrFormat(kGetKeyValueSetFmt, num_shards, query_size), args,
+          BM_GetKeyValueSet);
+      ::kv_server::RegisterBenchmark(
+          absl::StrFormat(kRunQueryFmt, num_shards, query_size), args,
+          BM_RunQuery);
+    }
+  }
+  return clusters;
+}
+
+}  // namespace
+}  // namespace kv_server
+
+// Benchmarks for lookups fanned out to the shards of a cluster, all served in
+// process. Sample run:
+//
+//  GLOG_logtostderr=1 bazel run -c opt \
+//    //components/tools/benchmarks:sharded_lookup_benchmark \
+//    --//:instance=local \
+//    --//:platform=local -- \
+//    --num_shards=2,8 --query_size=100 --use_lookup_stream=true \
+//    --benchmark_counters_tabular=true
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  ::benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  auto noop_metrics_recorder =
+      ::kv_server::TelemetryProvider::GetInstance().CreateMetricsRecorder();
+  const auto clusters =
+      ::kv_server::RegisterBenchmarks(*noop_metrics_recorder);
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
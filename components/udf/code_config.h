@@ -30,6 +30,9 @@ struct CodeConfig {
   std::string udf_handler_name;
   int64_t logical_commit_time;
   int64_t version;
+  // Whether the handler is invoked in binary mode, see
+  // `UdfClient::ExecuteBinaryCode`.
+  bool binary_io = false;
 };
 
 bool operator==(const CodeConfig& lhs_config, const CodeConfig& rhs_config);
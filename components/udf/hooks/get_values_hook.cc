@@ -166,6 +166,14 @@ class GetValuesHookImpl : public GetValuesHook {
     VLOG(9) << "getValues result: " << payload.io_proto.DebugString();
   }
 
+  absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const absl::flat_hash_set<std::string_view>& keys) const {
+    if (lookup_ == nullptr) {
+      return absl::InternalError("getValues has not been initialized yet");
+    }
+    return lookup_->GetKeyValues(keys);
+  }
+
  private:
   void SetStatus(absl::StatusCode code, std::string_view message,
                  FunctionBindingIoProto& io) {
@@ -22,7 +22,9 @@
 #include <tuple>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
 #include "components/data_server/cache/cache.h"
 #include "components/internal_server/lookup.h"
 #include "roma/config/src/function_binding_object_v2.h"
@@ -50,6 +52,11 @@ class GetValuesHook {
   virtual void operator()(
       google::scp::roma::FunctionBindingPayload<>& payload) = 0;
 
+  // Looks up `keys` the same way the UDF's getValues call does, for callers
+  // that serve requests without executing the UDF.
+  virtual absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const absl::flat_hash_set<std::string_view>& keys) const = 0;
+
   static std::unique_ptr<GetValuesHook> Create(OutputType output_type);
 };
 
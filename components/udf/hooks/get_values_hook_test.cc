@@ -105,6 +105,27 @@ TEST(GetValuesHookTest, StringOutput_SuccessfullyProcessesResultsWithStatus) {
   EXPECT_EQ(io.output_string(), expected.dump());
 }
 
+TEST(GetValuesHookTest, GetKeyValuesUsesLookup) {
+  absl::flat_hash_set<std::string_view> keys = {"key1"};
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   })pb",
+                              &lookup_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeyValues(keys))
+      .WillOnce(Return(lookup_response));
+
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  EXPECT_FALSE(get_values_hook->GetKeyValues(keys).ok());
+  get_values_hook->FinishInit(std::move(mock_lookup));
+  const auto maybe_response = get_values_hook->GetKeyValues(keys);
+  ASSERT_TRUE(maybe_response.ok()) << maybe_response.status();
+  EXPECT_THAT(*maybe_response, EqualsProto(lookup_response));
+}
+
 TEST(GetValuesHookTest, StringOutput_LookupReturnsError) {
   absl::flat_hash_set<std::string_view> keys = {"key1"};
   auto mock_lookup = std::make_unique<MockLookup>();
@@ -37,9 +37,25 @@ class MockUdfClient : public UdfClient {
               (UDFExecutionMetadata&&,
                const google::protobuf::RepeatedPtrField<UDFArgument>&),
               (const, override));
+  MOCK_METHOD(void, ExecuteCodeAsync,
+              (UDFExecutionMetadata&&,
+               const google::protobuf::RepeatedPtrField<UDFArgument>&,
+               ExecuteCodeCallback),
+              (const, override));
+  MOCK_METHOD((absl::StatusOr<std::string>), ExecuteCodeWithJsonArguments,
+              (std::string_view, std::vector<std::string>), (const, override));
+  MOCK_METHOD(void, ExecuteCodeWithJsonArgumentsAsync,
+              (std::string_view, std::vector<std::string>, ExecuteCodeCallback),
+              (const, override));
+  MOCK_METHOD((absl::StatusOr<std::string>), ExecuteBinaryCode,
+              (UDFExecutionMetadata&&,
+               const google::protobuf::RepeatedPtrField<UDFArgument>&),
+              (const, override));
   MOCK_METHOD((absl::Status), Stop, (), (override));
   MOCK_METHOD((absl::Status), SetCodeObject, (CodeConfig), (override));
   MOCK_METHOD((absl::Status), SetWasmCodeObject, (CodeConfig), (override));
+  MOCK_METHOD(bool, IsPassthroughCodeLoaded, (), (const, override));
+  MOCK_METHOD(bool, IsBinaryIoCodeLoaded, (), (const, override));
 };
 
 }  // namespace kv_server
@@ -18,6 +18,8 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -39,6 +41,28 @@ class NoopUdfClientImpl : public UdfClient {
       const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
     return "";
   }
+  void ExecuteCodeAsync(
+      UDFExecutionMetadata&&,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments,
+      ExecuteCodeCallback on_done) const {
+    std::move(on_done)("");
+  }
+  absl::StatusOr<std::string> ExecuteCodeWithJsonArguments(
+      std::string_view json_request_metadata,
+      std::vector<std::string> json_arguments) const {
+    return "";
+  }
+  void ExecuteCodeWithJsonArgumentsAsync(
+      std::string_view json_request_metadata,
+      std::vector<std::string> json_arguments,
+      ExecuteCodeCallback on_done) const {
+    std::move(on_done)("");
+  }
+  absl::StatusOr<std::string> ExecuteBinaryCode(
+      UDFExecutionMetadata&&,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
+    return "";
+  }
 
   absl::Status Stop() { return absl::OkStatus(); }
 
@@ -49,6 +73,10 @@ class NoopUdfClientImpl : public UdfClient {
   absl::Status SetWasmCodeObject(CodeConfig code_config) {
     return absl::OkStatus();
   }
+
+  bool IsPassthroughCodeLoaded() const { return false; }
+
+  bool IsBinaryIoCodeLoaded() const { return false; }
 };
 
 }  // namespace
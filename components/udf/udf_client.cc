@@ -14,23 +14,29 @@
 
 #include "components/udf/udf_client.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "glog/logging.h"
 #include "google/protobuf/util/json_util.h"
+#include "public/udf/constants.h"
 #include "roma/config/src/config.h"
 #include "roma/interface/roma.h"
 #include "roma/roma_service/roma_service.h"
+#include "src/cpp/util/status_macro/status_macros.h"
 
 namespace kv_server {
 
@@ -58,37 +64,73 @@ class UdfClientImpl : public UdfClient {
                          absl::Duration udf_timeout = absl::Seconds(5))
       : udf_timeout_(udf_timeout), roma_service_(std::move(config)) {}
 
-  // Converts the arguments into plain JSON strings to pass to Roma.
   absl::StatusOr<std::string> ExecuteCode(
       UDFExecutionMetadata&& execution_metadata,
       const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
-    execution_metadata.set_udf_interface_version(kUdfInterfaceVersion);
-    std::vector<std::string> string_args;
-    string_args.reserve(arguments.size() + 1);
-    std::string json_metadata;
-    if (const auto json_status =
-            MessageToJsonString(execution_metadata, &json_metadata);
-        !json_status.ok()) {
-      return json_status;
+    PS_ASSIGN_OR_RETURN(
+        std::vector<std::string> string_args,
+        BuildJsonArguments(std::move(execution_metadata), arguments));
+    return ExecuteCode(std::move(string_args));
+  }
+
+  void ExecuteCodeAsync(
+      UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments,
+      ExecuteCodeCallback on_done) const {
+    auto maybe_string_args =
+        BuildJsonArguments(std::move(execution_metadata), arguments);
+    if (!maybe_string_args.ok()) {
+      std::move(on_done)(maybe_string_args.status());
+      return;
     }
-    string_args.push_back(json_metadata);
+    ExecuteStringArgumentsAsync(std::move(maybe_string_args).value(),
+                                std::move(on_done));
+  }
 
-    for (int i = 0; i < arguments.size(); ++i) {
-      const auto& arg = arguments[i];
-      const google::protobuf::Message* arg_data;
-      if (arg.tags().values().empty()) {
-        arg_data = &arg.data();
-      } else {
-        arg_data = &arg;
-      }
-      std::string json_arg;
-      if (const auto json_status = MessageToJsonString(*arg_data, &json_arg);
-          !json_status.ok()) {
-        return json_status;
-      }
-      string_args.push_back(json_arg);
+  absl::StatusOr<std::string> ExecuteCodeWithJsonArguments(
+      std::string_view json_request_metadata,
+      std::vector<std::string> json_arguments) const {
+    return ExecuteCode(
+        BuildJsonArguments(json_request_metadata, std::move(json_arguments)));
+  }
+
+  void ExecuteCodeWithJsonArgumentsAsync(
+      std::string_view json_request_metadata,
+      std::vector<std::string> json_arguments,
+      ExecuteCodeCallback on_done) const {
+    ExecuteStringArgumentsAsync(
+        BuildJsonArguments(json_request_metadata, std::move(json_arguments)),
+        std::move(on_done));
+  }
+
+  absl::StatusOr<std::string> ExecuteBinaryCode(
+      UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
+    execution_metadata.set_udf_interface_version(kUdfInterfaceVersion);
+    BinaryUDFInput input;
+    *input.mutable_execution_metadata() = std::move(execution_metadata);
+    *input.mutable_arguments() = arguments;
+    // Roma exchanges JSON strings with the sandbox, so the bytes travel as a
+    // base64 encoded JSON string in both directions.
+    PS_ASSIGN_OR_RETURN(
+        std::string json_output,
+        ExecuteCode({absl::StrCat("\"",
+                                  absl::Base64Escape(input.SerializeAsString()),
+                                  "\"")}));
+    std::string_view base64_output = json_output;
+    if (base64_output.size() < 2 || base64_output.front() != '"' ||
+        base64_output.back() != '"') {
+      return absl::InvalidArgumentError(
+          "Binary UDF output must be a base64 encoded string");
     }
-    return ExecuteCode(std::move(string_args));
+    base64_output.remove_prefix(1);
+    base64_output.remove_suffix(1);
+    std::string output;
+    if (!absl::Base64Unescape(base64_output, &output)) {
+      return absl::InvalidArgumentError(
+          "Binary UDF output is not valid base64");
+    }
+    return output;
   }
 
   absl::StatusOr<std::string> ExecuteCode(std::vector<std::string> keys) const {
@@ -144,6 +186,9 @@ class UdfClientImpl : public UdfClient {
     std::shared_ptr<absl::Notification> notification =
         std::make_shared<absl::Notification>();
     VLOG(9) << "Setting UDF: " << code_config.js;
+    const bool is_passthrough_code =
+        code_config.js == kDefaultUdfCodeSnippet &&
+        code_config.udf_handler_name == kDefaultUdfHandlerName;
     CodeObject code_object =
         BuildCodeObject(std::move(code_config.js), std::move(code_config.wasm),
                         code_config.version);
@@ -172,6 +217,8 @@ class UdfClientImpl : public UdfClient {
     handler_name_ = std::move(code_config.udf_handler_name);
     logical_commit_time_ = code_config.logical_commit_time;
     version_ = code_config.version;
+    passthrough_code_loaded_ = is_passthrough_code;
+    binary_io_code_loaded_ = code_config.binary_io;
     return absl::OkStatus();
   }
 
@@ -183,7 +230,92 @@ class UdfClientImpl : public UdfClient {
     return absl::OkStatus();
   }
 
+  bool IsPassthroughCodeLoaded() const { return passthrough_code_loaded_; }
+
+  bool IsBinaryIoCodeLoaded() const { return binary_io_code_loaded_; }
+
  private:
+  // Converts the arguments into plain JSON strings to pass to Roma.
+  absl::StatusOr<std::vector<std::string>> BuildJsonArguments(
+      UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
+    execution_metadata.set_udf_interface_version(kUdfInterfaceVersion);
+    std::vector<std::string> string_args;
+    string_args.reserve(arguments.size() + 1);
+    std::string json_metadata;
+    if (const auto json_status =
+            MessageToJsonString(execution_metadata, &json_metadata);
+        !json_status.ok()) {
+      return json_status;
+    }
+    string_args.push_back(json_metadata);
+
+    for (int i = 0; i < arguments.size(); ++i) {
+      const auto& arg = arguments[i];
+      const google::protobuf::Message* arg_data;
+      if (arg.tags().values().empty()) {
+        arg_data = &arg.data();
+      } else {
+        arg_data = &arg;
+      }
+      std::string json_arg;
+      if (const auto json_status = MessageToJsonString(*arg_data, &json_arg);
+          !json_status.ok()) {
+        return json_status;
+      }
+      string_args.push_back(json_arg);
+    }
+    return string_args;
+  }
+
+  // Converts request metadata and arguments that are already JSON into the
+  // plain JSON strings to pass to Roma.
+  std::vector<std::string> BuildJsonArguments(
+      std::string_view json_request_metadata,
+      std::vector<std::string> json_arguments) const {
+    std::vector<std::string> string_args;
+    string_args.reserve(json_arguments.size() + 1);
+    // Matches the JSON form of UDFExecutionMetadata, whose request metadata
+    // the handlers always set, so UDFs see the same input on both paths.
+    string_args.push_back(absl::StrCat(
+        R"({"udfInterfaceVersion":)", kUdfInterfaceVersion,
+        R"(,"requestMetadata":)",
+        json_request_metadata.empty() ? "{}" : json_request_metadata, "}"));
+    for (auto& json_arg : json_arguments) {
+      string_args.push_back(std::move(json_arg));
+    }
+    return string_args;
+  }
+
+  void ExecuteStringArgumentsAsync(std::vector<std::string> string_args,
+                                   ExecuteCodeCallback on_done) const {
+    // Roma only takes copyable callbacks.
+    auto shared_on_done =
+        std::make_shared<ExecuteCodeCallback>(std::move(on_done));
+    InvocationStrRequest<> invocation_request =
+        BuildInvocationRequest(std::move(string_args));
+    VLOG(9) << "Executing UDF asynchronously";
+    // There is no wait here to bound the execution time: Roma enforces
+    // `udf_timeout_` through the timeout tag of the invocation request.
+    const auto status = roma_service_.Execute(
+        std::make_unique<InvocationStrRequest<>>(std::move(invocation_request)),
+        [shared_on_done](
+            std::unique_ptr<absl::StatusOr<ResponseObject>> response) {
+          ExecuteCodeCallback& callback = *shared_on_done;
+          if (response->ok()) {
+            std::move(callback)(std::move((*response)->resp));
+          } else {
+            LOG(ERROR) << "Error executing UDF: " << response->status();
+            std::move(callback)(std::move(response->status()));
+          }
+        });
+    if (!status.ok()) {
+      LOG(ERROR) << "Error sending UDF for execution: " << status;
+      ExecuteCodeCallback& callback = *shared_on_done;
+      std::move(callback)(status);
+    }
+  }
+
   InvocationStrRequest<> BuildInvocationRequest(
       std::vector<std::string> keys) const {
     return {.id = kInvocationRequestId,
@@ -204,6 +336,8 @@ class UdfClientImpl : public UdfClient {
   std::string handler_name_;
   int64_t logical_commit_time_ = -1;
   int64_t version_ = 1;
+  std::atomic<bool> passthrough_code_loaded_ = false;
+  std::atomic<bool> binary_io_code_loaded_ = false;
   const absl::Duration udf_timeout_;
   // Per b/299667930, RomaService has been extended to support metadata storage
   // as a side effect of RomaService::Execute(), making it no longer const.
@@ -19,8 +19,10 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "components/udf/code_config.h"
@@ -50,6 +52,40 @@ class UdfClient {
       const google::protobuf::RepeatedPtrField<UDFArgument>& arguments)
       const = 0;
 
+  using ExecuteCodeCallback =
+      absl::AnyInvocable<void(absl::StatusOr<std::string>) &&>;
+
+  // Asynchronous version of ExecuteCode(metadata, arguments). Returns once
+  // the UDF is dispatched. `on_done` is called exactly once with the UDF
+  // output or the error, usually from a Roma thread.
+  virtual void ExecuteCodeAsync(
+      UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments,
+      ExecuteCodeCallback on_done) const = 0;
+
+  // Executes the UDF with the request metadata and arguments already
+  // serialized to JSON, skipping the proto to JSON conversion. An empty
+  // `json_request_metadata` means the request has no metadata, which the UDF
+  // sees as an empty object like with `ExecuteCode`.
+  virtual absl::StatusOr<std::string> ExecuteCodeWithJsonArguments(
+      std::string_view json_request_metadata,
+      std::vector<std::string> json_arguments) const = 0;
+
+  // Asynchronous version of ExecuteCodeWithJsonArguments, with the same
+  // contract for `on_done` as ExecuteCodeAsync.
+  virtual void ExecuteCodeWithJsonArgumentsAsync(
+      std::string_view json_request_metadata,
+      std::vector<std::string> json_arguments,
+      ExecuteCodeCallback on_done) const = 0;
+
+  // Executes the UDF in binary mode: the metadata and arguments are passed as
+  // a serialized BinaryUDFInput and the UDF returns serialized proto bytes,
+  // which are returned as is.
+  virtual absl::StatusOr<std::string> ExecuteBinaryCode(
+      UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments)
+      const = 0;
+
   virtual absl::Status Stop() = 0;
 
   // Sets the code object that will be used for UDF execution
@@ -58,6 +94,15 @@ class UdfClient {
   // Sets the WASM code object that will be used for UDF execution
   virtual absl::Status SetWasmCodeObject(CodeConfig code_config) = 0;
 
+  // Returns true if the loaded code object is the default UDF
+  // (`kDefaultUdfCodeSnippet`), which only returns the values of the keys it
+  // is given. Such requests can then be served without executing the UDF.
+  virtual bool IsPassthroughCodeLoaded() const = 0;
+
+  // Returns true if the loaded code object was marked as taking binary input
+  // and output in its config, see `ExecuteBinaryCode`.
+  virtual bool IsBinaryIoCodeLoaded() const = 0;
+
   // Creates a UDF executor. This calls Roma::Init, which forks.
   static absl::StatusOr<std::unique_ptr<UdfClient>> Create(
       google::scp::roma::Config<>&& config = google::scp::roma::Config(),
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
 #include "components/internal_server/mocks.h"
 #include "components/udf/code_config.h"
 #include "components/udf/hooks/get_values_hook.h"
@@ -30,6 +31,7 @@
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
+#include "public/udf/constants.h"
 #include "roma/config/src/config.h"
 #include "roma/interface/roma.h"
 
@@ -212,6 +214,142 @@ TEST(UdfClientTest, JsEchoCallSucceeds_SimpleUDFArg_string_tagged_list) {
   EXPECT_TRUE(stop.ok());
 }
 
+TEST(UdfClientTest, JsEchoCallSucceeds_JsonArguments) {
+  auto udf_client = CreateUdfClient();
+  EXPECT_TRUE(udf_client.ok());
+
+  absl::Status code_obj_status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = (metadata, input) => 'Hello world! ' + "
+            "JSON.stringify(metadata) + ' ' + JSON.stringify(input);",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+  });
+  EXPECT_TRUE(code_obj_status.ok());
+
+  absl::StatusOr<std::string> result =
+      udf_client.value()->ExecuteCodeWithJsonArguments(
+          R"({"hostname":"example.com"})",
+          {R"({"tags":["tag1"],"data":["key1"]})"});
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(*result,
+            R"("Hello world! {\"udfInterfaceVersion\":1,)"
+            R"(\"requestMetadata\":{\"hostname\":\"example.com\"}} )"
+            R"({\"tags\":[\"tag1\"],\"data\":[\"key1\"]}")");
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
+TEST(UdfClientTest, JsEchoCallSucceeds_JsonArgumentsWithoutMetadata) {
+  auto udf_client = CreateUdfClient();
+  EXPECT_TRUE(udf_client.ok());
+
+  absl::Status code_obj_status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = (metadata, input) => 'Hello world! ' + "
+            "JSON.stringify(metadata) + ' ' + JSON.stringify(input);",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+  });
+  EXPECT_TRUE(code_obj_status.ok());
+
+  absl::StatusOr<std::string> json_result =
+      udf_client.value()->ExecuteCodeWithJsonArguments(
+          "", {R"({"tags":["tag1"],"data":["key1"]})"});
+  EXPECT_TRUE(json_result.ok());
+  EXPECT_EQ(*json_result,
+            R"("Hello world! {\"udfInterfaceVersion\":1,)"
+            R"(\"requestMetadata\":{}} )"
+            R"({\"tags\":[\"tag1\"],\"data\":[\"key1\"]}")");
+
+  // Handlers always set the request metadata on the proto path.
+  UDFExecutionMetadata udf_metadata;
+  udf_metadata.mutable_request_metadata();
+  google::protobuf::RepeatedPtrField<UDFArgument> args;
+  args.Add([] {
+    UDFArgument arg;
+    arg.mutable_tags()->add_values()->set_string_value("tag1");
+    arg.mutable_data()->mutable_list_value()->add_values()->set_string_value(
+        "key1");
+    return arg;
+  }());
+  absl::StatusOr<std::string> proto_result =
+      udf_client.value()->ExecuteCode(std::move(udf_metadata), args);
+  EXPECT_TRUE(proto_result.ok());
+  EXPECT_EQ(*json_result, *proto_result);
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
+TEST(UdfClientTest, JsEchoCallSucceeds_BinaryIO) {
+  auto udf_client = CreateUdfClient();
+  EXPECT_TRUE(udf_client.ok());
+
+  absl::Status code_obj_status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = (input) => input;",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+  });
+  EXPECT_TRUE(code_obj_status.ok());
+
+  google::protobuf::RepeatedPtrField<UDFArgument> args;
+  args.Add([] {
+    UDFArgument arg;
+    arg.mutable_tags()->add_values()->set_string_value("tag1");
+    arg.mutable_data()->set_string_value("ECHO");
+    return arg;
+  }());
+  absl::StatusOr<std::string> result =
+      udf_client.value()->ExecuteBinaryCode({}, args);
+  ASSERT_TRUE(result.ok()) << result.status();
+  BinaryUDFInput echoed_input;
+  ASSERT_TRUE(echoed_input.ParseFromString(*result));
+  EXPECT_EQ(echoed_input.execution_metadata().udf_interface_version(), 1);
+  ASSERT_EQ(echoed_input.arguments_size(), 1);
+  EXPECT_EQ(echoed_input.arguments(0).data().string_value(), "ECHO");
+  EXPECT_EQ(echoed_input.arguments(0).tags().values(0).string_value(), "tag1");
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
+TEST(UdfClientTest, JsEchoAsyncCallSucceeds) {
+  auto udf_client = CreateUdfClient();
+  EXPECT_TRUE(udf_client.ok());
+
+  absl::Status code_obj_status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = (metadata, input) => 'Hello world! ' + "
+            "JSON.stringify(input);",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+  });
+  EXPECT_TRUE(code_obj_status.ok());
+
+  google::protobuf::RepeatedPtrField<UDFArgument> args;
+  args.Add([] {
+    UDFArgument arg;
+    arg.mutable_data()->set_string_value("ECHO");
+    return arg;
+  }());
+  absl::StatusOr<std::string> result;
+  absl::Notification done;
+  udf_client.value()->ExecuteCodeAsync(
+      {}, args, [&result, &done](absl::StatusOr<std::string> output) {
+        result = std::move(output);
+        done.Notify();
+      });
+  done.WaitForNotification();
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(*result, R"("Hello world! \"ECHO\"")");
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
 TEST(UdfClientTest, JsEchoCallSucceeds_SimpleUDFArg_struct) {
   auto udf_client = CreateUdfClient();
   EXPECT_TRUE(udf_client.ok());
@@ -473,6 +611,61 @@ TEST(UdfClientTest, UpdatesCodeObjectTwice) {
   EXPECT_TRUE(stop.ok());
 }
 
+TEST(UdfClientTest, DetectsPassthroughCodeObject) {
+  auto udf_client = CreateUdfClient();
+  EXPECT_TRUE(udf_client.ok());
+  EXPECT_FALSE(udf_client.value()->IsPassthroughCodeLoaded());
+
+  auto status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = kDefaultUdfCodeSnippet,
+      .udf_handler_name = kDefaultUdfHandlerName,
+      .logical_commit_time = 1,
+      .version = 1,
+  });
+  EXPECT_TRUE(status.ok());
+  EXPECT_TRUE(udf_client.value()->IsPassthroughCodeLoaded());
+
+  status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = () => 'world';",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 2,
+      .version = 2,
+  });
+  EXPECT_TRUE(status.ok());
+  EXPECT_FALSE(udf_client.value()->IsPassthroughCodeLoaded());
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
+TEST(UdfClientTest, TracksBinaryIoModeOfCodeObject) {
+  auto udf_client = CreateUdfClient();
+  EXPECT_TRUE(udf_client.ok());
+  EXPECT_FALSE(udf_client.value()->IsBinaryIoCodeLoaded());
+
+  auto status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = (input) => input;",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+      .binary_io = true,
+  });
+  EXPECT_TRUE(status.ok());
+  EXPECT_TRUE(udf_client.value()->IsBinaryIoCodeLoaded());
+
+  status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = () => 'world';",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 2,
+      .version = 2,
+  });
+  EXPECT_TRUE(status.ok());
+  EXPECT_FALSE(udf_client.value()->IsBinaryIoCodeLoaded());
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
 TEST(UdfClientTest, IgnoresCodeObjectWithSameCommitTime) {
   auto udf_client = CreateUdfClient();
   EXPECT_TRUE(udf_client.ok());
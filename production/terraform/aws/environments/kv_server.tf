@@ -78,9 +78,25 @@ module "kv_server" {
   data_loading_file_format = var.data_loading_file_format
 
   # Variables related to sharding.
-  num_shards             = var.num_shards
-  use_sharding_key_regex = var.use_sharding_key_regex
-  sharding_key_regex     = var.sharding_key_regex
+  num_shards                = var.num_shards
+  use_sharding_key_regex    = var.use_sharding_key_regex
+  sharding_key_regex        = var.sharding_key_regex
+  sharding_key_delimiter    = var.sharding_key_delimiter
+  sharding_function_version = var.sharding_function_version
+
+  # Variables related to optional features, all disabled by default.
+  realtime_batch_max_delay_millis       = var.realtime_batch_max_delay_millis
+  realtime_batch_max_size               = var.realtime_batch_max_size
+  bypass_passthrough_udf                = var.bypass_passthrough_udf
+  partition_result_cache_max_megabytes  = var.partition_result_cache_max_megabytes
+  partition_result_cache_max_age_millis = var.partition_result_cache_max_age_millis
+  json_value_cache_max_megabytes        = var.json_value_cache_max_megabytes
+  sharded_lookup_hedging_percentile     = var.sharded_lookup_hedging_percentile
+  sharded_lookup_coalescing_micros      = var.sharded_lookup_coalescing_micros
+  sharded_lookup_use_stream             = var.sharded_lookup_use_stream
+  sharded_lookup_padding_buckets        = var.sharded_lookup_padding_buckets
+  near_cache_max_megabytes              = var.near_cache_max_megabytes
+  near_cache_max_age_millis             = var.near_cache_max_age_millis
 
   # Variables related to UDF exeuction.
   udf_num_workers    = var.udf_num_workers
@@ -257,6 +257,90 @@ variable "sharding_key_regex" {
   type        = string
 }
 
+variable "sharding_key_delimiter" {
+  description = "If set, keys are sharded by their part before this delimiter. Cheaper than an equivalent sharding key regex, which takes precedence."
+  default     = ""
+  type        = string
+}
+
+variable "sharding_function_version" {
+  description = "Version of the function used to assign keys to shards. 0 is SHA256 based, 1 is HighwayHash based and much cheaper. Must match the version that sharded data files were generated with. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "realtime_batch_max_delay_millis" {
+  description = "How long realtime updates may be held to be applied to the cache together with later ones, in milliseconds. Zero applies every update right away. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "realtime_batch_max_size" {
+  description = "Number of pending realtime mutations after which they are applied without waiting for realtime_batch_max_delay_millis. Default is 10000."
+  default     = 10000
+  type        = number
+}
+
+variable "bypass_passthrough_udf" {
+  description = "Whether V1 requests are looked up directly, without executing the UDF, while the default passthrough UDF is loaded. Default is false."
+  default     = false
+  type        = bool
+}
+
+variable "partition_result_cache_max_megabytes" {
+  description = "Memory budget of the cache of UDF outputs of v2 partitions, in megabytes. Zero disables the cache. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "partition_result_cache_max_age_millis" {
+  description = "How long UDF outputs of v2 partitions may be served from the cache, in milliseconds. Bounds the staleness of data read from other shards. Default is 10000."
+  default     = 10000
+  type        = number
+}
+
+variable "json_value_cache_max_megabytes" {
+  description = "Memory budget of the cache of values parsed from JSON for V1 responses, in megabytes. Zero disables the cache. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "sharded_lookup_hedging_percentile" {
+  description = "Percentile of the latencies of recent requests to remote shards after which a request still in flight is also sent to another replica of the shard. Zero disables hedging. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "sharded_lookup_coalescing_micros" {
+  description = "How long a lookup of remote keys waits for concurrent ones, in microseconds, so that their keys are sent together with one request per shard. Zero disables coalescing. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "sharded_lookup_use_stream" {
+  description = "Whether lookups of remote keys are multiplexed over one encrypted stream per replica instead of one call per lookup. All shards must support the stream. Default is false."
+  default     = false
+  type        = bool
+}
+
+variable "sharded_lookup_padding_buckets" {
+  description = "Number of length buckets between consecutive powers of two that requests to remote shards are padded to. Zero pads them to the longest request only. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "near_cache_max_megabytes" {
+  description = "Memory budget of the cache of values looked up on remote shards, in megabytes. Zero disables the cache. Default is 0."
+  default     = 0
+  type        = number
+}
+
+variable "near_cache_max_age_millis" {
+  description = "How long values looked up on remote shards may be served from the cache, in milliseconds. Default is 1000."
+  default     = 1000
+  type        = number
+}
+
 variable "udf_timeout_millis" {
   description = "UDF execution timeout in milliseconds. Default is 5000."
   default     = 5000
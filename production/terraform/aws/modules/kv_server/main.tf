@@ -167,6 +167,20 @@ module "parameter" {
   logging_verbosity_level_parameter_value                = var.logging_verbosity_level
   use_sharding_key_regex_parameter_value                 = var.use_sharding_key_regex
   sharding_key_regex_parameter_value                     = var.sharding_key_regex
+  sharding_key_delimiter_parameter_value                 = var.sharding_key_delimiter
+  sharding_function_version_parameter_value              = var.sharding_function_version
+  realtime_batch_max_delay_millis_parameter_value        = var.realtime_batch_max_delay_millis
+  realtime_batch_max_size_parameter_value                = var.realtime_batch_max_size
+  bypass_passthrough_udf_parameter_value                 = var.bypass_passthrough_udf
+  partition_result_cache_max_megabytes_parameter_value   = var.partition_result_cache_max_megabytes
+  partition_result_cache_max_age_millis_parameter_value  = var.partition_result_cache_max_age_millis
+  json_value_cache_max_megabytes_parameter_value         = var.json_value_cache_max_megabytes
+  sharded_lookup_hedging_percentile_parameter_value      = var.sharded_lookup_hedging_percentile
+  sharded_lookup_coalescing_micros_parameter_value       = var.sharded_lookup_coalescing_micros
+  sharded_lookup_use_stream_parameter_value              = var.sharded_lookup_use_stream
+  sharded_lookup_padding_buckets_parameter_value         = var.sharded_lookup_padding_buckets
+  near_cache_max_megabytes_parameter_value               = var.near_cache_max_megabytes
+  near_cache_max_age_millis_parameter_value              = var.near_cache_max_age_millis
 }
 
 module "security_group_rules" {
@@ -214,6 +228,19 @@ module "iam_role_policies" {
     module.parameter.logging_verbosity_level_parameter_arn,
     module.parameter.use_real_coordinators_parameter_arn,
     module.parameter.use_sharding_key_regex_parameter_arn,
+    module.parameter.sharding_function_version_parameter_arn,
+    module.parameter.realtime_batch_max_delay_millis_parameter_arn,
+    module.parameter.realtime_batch_max_size_parameter_arn,
+    module.parameter.bypass_passthrough_udf_parameter_arn,
+    module.parameter.partition_result_cache_max_megabytes_parameter_arn,
+    module.parameter.partition_result_cache_max_age_millis_parameter_arn,
+    module.parameter.json_value_cache_max_megabytes_parameter_arn,
+    module.parameter.sharded_lookup_hedging_percentile_parameter_arn,
+    module.parameter.sharded_lookup_coalescing_micros_parameter_arn,
+    module.parameter.sharded_lookup_use_stream_parameter_arn,
+    module.parameter.sharded_lookup_padding_buckets_parameter_arn,
+    module.parameter.near_cache_max_megabytes_parameter_arn,
+    module.parameter.near_cache_max_age_millis_parameter_arn,
   module.parameter.udf_timeout_millis_parameter_arn]
   coordinator_parameter_arns = (
     var.use_real_coordinators ? [
@@ -231,6 +258,11 @@ module "iam_role_policies" {
       module.parameter.sharding_key_regex_parameter_arn
     ] : []
   )
+  sharding_key_delimiter_arns = (
+    var.sharding_key_delimiter != "" ? [
+      module.parameter.sharding_key_delimiter_parameter_arn
+    ] : []
+  )
 }
 
 module "iam_group_policies" {
@@ -59,6 +59,11 @@ variable "sharding_key_regex_arns" {
   type        = set(string)
 }
 
+variable "sharding_key_delimiter_arns" {
+  description = "A set of arns for sharding key delimiter"
+  type        = set(string)
+}
+
 variable "sns_data_updates_topic_arn" {
   description = "ARN for the sns topic that receives s3 delta file updates."
   type        = string
@@ -180,6 +180,105 @@ resource "aws_ssm_parameter" "sharding_key_regex_parameter" {
   overwrite = true
 }
 
+resource "aws_ssm_parameter" "sharding_key_delimiter_parameter" {
+  count     = (var.sharding_key_delimiter_parameter_value != "") ? 1 : 0
+  name      = "${var.service}-${var.environment}-sharding-key-delimiter"
+  type      = "String"
+  value     = var.sharding_key_delimiter_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "sharding_function_version_parameter" {
+  name      = "${var.service}-${var.environment}-sharding-function-version"
+  type      = "String"
+  value     = var.sharding_function_version_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "realtime_batch_max_delay_millis_parameter" {
+  name      = "${var.service}-${var.environment}-realtime-batch-max-delay-millis"
+  type      = "String"
+  value     = var.realtime_batch_max_delay_millis_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "realtime_batch_max_size_parameter" {
+  name      = "${var.service}-${var.environment}-realtime-batch-max-size"
+  type      = "String"
+  value     = var.realtime_batch_max_size_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "bypass_passthrough_udf_parameter" {
+  name      = "${var.service}-${var.environment}-bypass-passthrough-udf"
+  type      = "String"
+  value     = var.bypass_passthrough_udf_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "partition_result_cache_max_megabytes_parameter" {
+  name      = "${var.service}-${var.environment}-partition-result-cache-max-megabytes"
+  type      = "String"
+  value     = var.partition_result_cache_max_megabytes_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "partition_result_cache_max_age_millis_parameter" {
+  name      = "${var.service}-${var.environment}-partition-result-cache-max-age-millis"
+  type      = "String"
+  value     = var.partition_result_cache_max_age_millis_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "json_value_cache_max_megabytes_parameter" {
+  name      = "${var.service}-${var.environment}-json-value-cache-max-megabytes"
+  type      = "String"
+  value     = var.json_value_cache_max_megabytes_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "sharded_lookup_hedging_percentile_parameter" {
+  name      = "${var.service}-${var.environment}-sharded-lookup-hedging-percentile"
+  type      = "String"
+  value     = var.sharded_lookup_hedging_percentile_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "sharded_lookup_coalescing_micros_parameter" {
+  name      = "${var.service}-${var.environment}-sharded-lookup-coalescing-micros"
+  type      = "String"
+  value     = var.sharded_lookup_coalescing_micros_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "sharded_lookup_use_stream_parameter" {
+  name      = "${var.service}-${var.environment}-sharded-lookup-use-stream"
+  type      = "String"
+  value     = var.sharded_lookup_use_stream_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "sharded_lookup_padding_buckets_parameter" {
+  name      = "${var.service}-${var.environment}-sharded-lookup-padding-buckets"
+  type      = "String"
+  value     = var.sharded_lookup_padding_buckets_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "near_cache_max_megabytes_parameter" {
+  name      = "${var.service}-${var.environment}-near-cache-max-megabytes"
+  type      = "String"
+  value     = var.near_cache_max_megabytes_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "near_cache_max_age_millis_parameter" {
+  name      = "${var.service}-${var.environment}-near-cache-max-age-millis"
+  type      = "String"
+  value     = var.near_cache_max_age_millis_parameter_value
+  overwrite = true
+}
+
 resource "aws_ssm_parameter" "udf_timeout_millis_parameter" {
   name      = "${var.service}-${var.environment}-udf-timeout-millis"
   type      = "String"
@@ -110,6 +110,62 @@ output "sharding_key_regex_parameter_arn" {
   value = (var.use_sharding_key_regex_parameter_value) ? aws_ssm_parameter.sharding_key_regex_parameter[0].arn : ""
 }
 
+output "sharding_key_delimiter_parameter_arn" {
+  value = (var.sharding_key_delimiter_parameter_value != "") ? aws_ssm_parameter.sharding_key_delimiter_parameter[0].arn : ""
+}
+
+output "sharding_function_version_parameter_arn" {
+  value = aws_ssm_parameter.sharding_function_version_parameter.arn
+}
+
+output "realtime_batch_max_delay_millis_parameter_arn" {
+  value = aws_ssm_parameter.realtime_batch_max_delay_millis_parameter.arn
+}
+
+output "realtime_batch_max_size_parameter_arn" {
+  value = aws_ssm_parameter.realtime_batch_max_size_parameter.arn
+}
+
+output "bypass_passthrough_udf_parameter_arn" {
+  value = aws_ssm_parameter.bypass_passthrough_udf_parameter.arn
+}
+
+output "partition_result_cache_max_megabytes_parameter_arn" {
+  value = aws_ssm_parameter.partition_result_cache_max_megabytes_parameter.arn
+}
+
+output "partition_result_cache_max_age_millis_parameter_arn" {
+  value = aws_ssm_parameter.partition_result_cache_max_age_millis_parameter.arn
+}
+
+output "json_value_cache_max_megabytes_parameter_arn" {
+  value = aws_ssm_parameter.json_value_cache_max_megabytes_parameter.arn
+}
+
+output "sharded_lookup_hedging_percentile_parameter_arn" {
+  value = aws_ssm_parameter.sharded_lookup_hedging_percentile_parameter.arn
+}
+
+output "sharded_lookup_coalescing_micros_parameter_arn" {
+  value = aws_ssm_parameter.sharded_lookup_coalescing_micros_parameter.arn
+}
+
+output "sharded_lookup_use_stream_parameter_arn" {
+  value = aws_ssm_parameter.sharded_lookup_use_stream_parameter.arn
+}
+
+output "sharded_lookup_padding_buckets_parameter_arn" {
+  value = aws_ssm_parameter.sharded_lookup_padding_buckets_parameter.arn
+}
+
+output "near_cache_max_megabytes_parameter_arn" {
+  value = aws_ssm_parameter.near_cache_max_megabytes_parameter.arn
+}
+
+output "near_cache_max_age_millis_parameter_arn" {
+  value = aws_ssm_parameter.near_cache_max_age_millis_parameter.arn
+}
+
 output "udf_timeout_millis_parameter_arn" {
   value = aws_ssm_parameter.udf_timeout_millis_parameter.arn
 }
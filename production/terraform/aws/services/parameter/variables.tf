@@ -134,6 +134,76 @@ variable "sharding_key_regex_parameter_value" {
   type        = string
 }
 
+variable "sharding_key_delimiter_parameter_value" {
+  description = "Sharding key delimiter."
+  type        = string
+}
+
+variable "sharding_function_version_parameter_value" {
+  description = "Version of the function used to assign keys to shards."
+  type        = number
+}
+
+variable "realtime_batch_max_delay_millis_parameter_value" {
+  description = "How long realtime updates may be held before they are applied, in milliseconds."
+  type        = number
+}
+
+variable "realtime_batch_max_size_parameter_value" {
+  description = "Number of pending realtime mutations after which they are applied."
+  type        = number
+}
+
+variable "bypass_passthrough_udf_parameter_value" {
+  description = "Whether V1 requests bypass the default passthrough UDF."
+  type        = bool
+}
+
+variable "partition_result_cache_max_megabytes_parameter_value" {
+  description = "Memory budget of the partition result cache, in megabytes."
+  type        = number
+}
+
+variable "partition_result_cache_max_age_millis_parameter_value" {
+  description = "Maximum age of partition result cache entries, in milliseconds."
+  type        = number
+}
+
+variable "json_value_cache_max_megabytes_parameter_value" {
+  description = "Memory budget of the JSON value cache, in megabytes."
+  type        = number
+}
+
+variable "sharded_lookup_hedging_percentile_parameter_value" {
+  description = "Latency percentile after which requests to remote shards are hedged."
+  type        = number
+}
+
+variable "sharded_lookup_coalescing_micros_parameter_value" {
+  description = "Coalescing window of lookups of remote keys, in microseconds."
+  type        = number
+}
+
+variable "sharded_lookup_use_stream_parameter_value" {
+  description = "Whether lookups of remote keys use one stream per replica."
+  type        = bool
+}
+
+variable "sharded_lookup_padding_buckets_parameter_value" {
+  description = "Number of padding length buckets per doubling of requests to remote shards."
+  type        = number
+}
+
+variable "near_cache_max_megabytes_parameter_value" {
+  description = "Memory budget of the near cache, in megabytes."
+  type        = number
+}
+
+variable "near_cache_max_age_millis_parameter_value" {
+  description = "Maximum age of near cache entries, in milliseconds."
+  type        = number
+}
+
 variable "udf_timeout_millis_parameter_value" {
   description = "UDF execution timeout in milliseconds."
   type        = number
@@ -90,6 +90,20 @@ module "kv_server" {
     logging-verbosity-level                   = var.logging_verbosity_level
     use-sharding-key-regex                    = var.use_sharding_key_regex
     sharding-key-regex                        = var.sharding_key_regex
+    sharding-key-delimiter                    = var.sharding_key_delimiter
+    sharding-function-version                 = var.sharding_function_version
+    realtime-batch-max-delay-millis           = var.realtime_batch_max_delay_millis
+    realtime-batch-max-size                   = var.realtime_batch_max_size
+    bypass-passthrough-udf                    = var.bypass_passthrough_udf
+    partition-result-cache-max-megabytes      = var.partition_result_cache_max_megabytes
+    partition-result-cache-max-age-millis     = var.partition_result_cache_max_age_millis
+    json-value-cache-max-megabytes            = var.json_value_cache_max_megabytes
+    sharded-lookup-hedging-percentile         = var.sharded_lookup_hedging_percentile
+    sharded-lookup-coalescing-micros          = var.sharded_lookup_coalescing_micros
+    sharded-lookup-use-stream                 = var.sharded_lookup_use_stream
+    sharded-lookup-padding-buckets            = var.sharded_lookup_padding_buckets
+    near-cache-max-megabytes                  = var.near_cache_max_megabytes
+    near-cache-max-age-millis                 = var.near_cache_max_age_millis
     tls-key                                   = var.tls_key
     tls-cert                                  = var.tls_cert
   }
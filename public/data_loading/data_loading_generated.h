@@ -50,6 +50,10 @@ struct ShardMappingRecord;
 struct ShardMappingRecordBuilder;
 struct ShardMappingRecordT;
 
+struct CompressionDictionaryRecord;
+struct CompressionDictionaryRecordBuilder;
+struct CompressionDictionaryRecordT;
+
 struct DataRecord;
 struct DataRecordBuilder;
 struct DataRecordT;
@@ -235,26 +239,32 @@ enum class Record : uint8_t {
   KeyValueMutationRecord = 1,
   UserDefinedFunctionsConfig = 2,
   ShardMappingRecord = 3,
+  CompressionDictionaryRecord = 4,
   MIN = NONE,
-  MAX = ShardMappingRecord
+  MAX = CompressionDictionaryRecord
 };
 
-inline const Record (&EnumValuesRecord())[4] {
-  static const Record values[] = {Record::NONE, Record::KeyValueMutationRecord,
-                                  Record::UserDefinedFunctionsConfig,
-                                  Record::ShardMappingRecord};
+inline const Record (&EnumValuesRecord())[5] {
+  static const Record values[] = {
+      Record::NONE, Record::KeyValueMutationRecord,
+      Record::UserDefinedFunctionsConfig, Record::ShardMappingRecord,
+      Record::CompressionDictionaryRecord};
   return values;
 }
 
 inline const char* const* EnumNamesRecord() {
-  static const char* const names[5] = {"NONE", "KeyValueMutationRecord",
+  static const char* const names[6] = {"NONE",
+                                       "KeyValueMutationRecord",
                                        "UserDefinedFunctionsConfig",
-                                       "ShardMappingRecord", nullptr};
+                                       "ShardMappingRecord",
+                                       "CompressionDictionaryRecord",
+                                       nullptr};
   return names;
 }
 
 inline const char* EnumNameRecord(Record e) {
-  if (flatbuffers::IsOutRange(e, Record::NONE, Record::ShardMappingRecord))
+  if (flatbuffers::IsOutRange(e, Record::NONE,
+                              Record::CompressionDictionaryRecord))
     return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesRecord()[index];
@@ -280,6 +290,11 @@ struct RecordTraits<kv_server::ShardMappingRecord> {
   static const Record enum_value = Record::ShardMappingRecord;
 };
 
+template <>
+struct RecordTraits<kv_server::CompressionDictionaryRecord> {
+  static const Record enum_value = Record::CompressionDictionaryRecord;
+};
+
 template <typename T>
 struct RecordUnionTraits {
   static const Record enum_value = Record::NONE;
@@ -300,6 +315,11 @@ struct RecordUnionTraits<kv_server::ShardMappingRecordT> {
   static const Record enum_value = Record::ShardMappingRecord;
 };
 
+template <>
+struct RecordUnionTraits<kv_server::CompressionDictionaryRecordT> {
+  static const Record enum_value = Record::CompressionDictionaryRecord;
+};
+
 struct RecordUnion {
   Record type;
   void* value;
@@ -376,6 +396,19 @@ struct RecordUnion {
                ? reinterpret_cast<const kv_server::ShardMappingRecordT*>(value)
                : nullptr;
   }
+  kv_server::CompressionDictionaryRecordT* AsCompressionDictionaryRecord() {
+    return type == Record::CompressionDictionaryRecord
+               ? reinterpret_cast<kv_server::CompressionDictionaryRecordT*>(
+                     value)
+               : nullptr;
+  }
+  const kv_server::CompressionDictionaryRecordT*
+  AsCompressionDictionaryRecord() const {
+    return type == Record::CompressionDictionaryRecord
+               ? reinterpret_cast<
+                     const kv_server::CompressionDictionaryRecordT*>(value)
+               : nullptr;
+  }
 };
 
 bool VerifyRecord(flatbuffers::Verifier& verifier, const void* obj,
@@ -693,6 +726,7 @@ struct UserDefinedFunctionsConfigT : public flatbuffers::NativeTable {
   std::string handler_name{};
   int64_t logical_commit_time = 0;
   int64_t version = 0;
+  bool binary_io = false;
 };
 
 struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
@@ -705,7 +739,8 @@ struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
     VT_CODE_SNIPPET = 6,
     VT_HANDLER_NAME = 8,
     VT_LOGICAL_COMMIT_TIME = 10,
-    VT_VERSION = 12
+    VT_VERSION = 12,
+    VT_BINARY_IO = 14
   };
   kv_server::UserDefinedFunctionsLanguage language() const {
     return static_cast<kv_server::UserDefinedFunctionsLanguage>(
@@ -721,6 +756,7 @@ struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
     return GetField<int64_t>(VT_LOGICAL_COMMIT_TIME, 0);
   }
   int64_t version() const { return GetField<int64_t>(VT_VERSION, 0); }
+  bool binary_io() const { return GetField<uint8_t>(VT_BINARY_IO, 0) != 0; }
   bool Verify(flatbuffers::Verifier& verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<int8_t>(verifier, VT_LANGUAGE, 1) &&
@@ -729,7 +765,9 @@ struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
            VerifyOffset(verifier, VT_HANDLER_NAME) &&
            verifier.VerifyString(handler_name()) &&
            VerifyField<int64_t>(verifier, VT_LOGICAL_COMMIT_TIME, 8) &&
-           VerifyField<int64_t>(verifier, VT_VERSION, 8) && verifier.EndTable();
+           VerifyField<int64_t>(verifier, VT_VERSION, 8) &&
+           VerifyField<uint8_t>(verifier, VT_BINARY_IO, 1) &&
+           verifier.EndTable();
   }
   UserDefinedFunctionsConfigT* UnPack(
       const flatbuffers::resolver_function_t* _resolver = nullptr) const;
@@ -764,6 +802,10 @@ struct UserDefinedFunctionsConfigBuilder {
     fbb_.AddElement<int64_t>(UserDefinedFunctionsConfig::VT_VERSION, version,
                              0);
   }
+  void add_binary_io(bool binary_io) {
+    fbb_.AddElement<uint8_t>(UserDefinedFunctionsConfig::VT_BINARY_IO,
+                             static_cast<uint8_t>(binary_io), 0);
+  }
   explicit UserDefinedFunctionsConfigBuilder(
       flatbuffers::FlatBufferBuilder& _fbb)
       : fbb_(_fbb) {
@@ -783,12 +825,14 @@ CreateUserDefinedFunctionsConfig(
         kv_server::UserDefinedFunctionsLanguage::Javascript,
     flatbuffers::Offset<flatbuffers::String> code_snippet = 0,
     flatbuffers::Offset<flatbuffers::String> handler_name = 0,
-    int64_t logical_commit_time = 0, int64_t version = 0) {
+    int64_t logical_commit_time = 0, int64_t version = 0,
+    bool binary_io = false) {
   UserDefinedFunctionsConfigBuilder builder_(_fbb);
   builder_.add_version(version);
   builder_.add_logical_commit_time(logical_commit_time);
   builder_.add_handler_name(handler_name);
   builder_.add_code_snippet(code_snippet);
+  builder_.add_binary_io(binary_io);
   builder_.add_language(language);
   return builder_.Finish();
 }
@@ -804,12 +848,13 @@ CreateUserDefinedFunctionsConfigDirect(
     kv_server::UserDefinedFunctionsLanguage language =
         kv_server::UserDefinedFunctionsLanguage::Javascript,
     const char* code_snippet = nullptr, const char* handler_name = nullptr,
-    int64_t logical_commit_time = 0, int64_t version = 0) {
+    int64_t logical_commit_time = 0, int64_t version = 0,
+    bool binary_io = false) {
   auto code_snippet__ = code_snippet ? _fbb.CreateString(code_snippet) : 0;
   auto handler_name__ = handler_name ? _fbb.CreateString(handler_name) : 0;
   return kv_server::CreateUserDefinedFunctionsConfig(
       _fbb, language, code_snippet__, handler_name__, logical_commit_time,
-      version);
+      version, binary_io);
 }
 
 flatbuffers::Offset<UserDefinedFunctionsConfig>
@@ -894,6 +939,102 @@ flatbuffers::Offset<ShardMappingRecord> CreateShardMappingRecord(
     flatbuffers::FlatBufferBuilder& _fbb, const ShardMappingRecordT* _o,
     const flatbuffers::rehasher_function_t* _rehasher = nullptr);
 
+struct CompressionDictionaryRecordT : public flatbuffers::NativeTable {
+  typedef CompressionDictionaryRecord TableType;
+  std::vector<uint8_t> dictionary{};
+  int64_t logical_commit_time = 0;
+};
+
+struct CompressionDictionaryRecord FLATBUFFERS_FINAL_CLASS
+    : private flatbuffers::Table {
+  typedef CompressionDictionaryRecordT NativeTableType;
+  typedef CompressionDictionaryRecordBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_DICTIONARY = 4,
+    VT_LOGICAL_COMMIT_TIME = 6
+  };
+  const flatbuffers::Vector<uint8_t>* dictionary() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t>*>(VT_DICTIONARY);
+  }
+  int64_t logical_commit_time() const {
+    return GetField<int64_t>(VT_LOGICAL_COMMIT_TIME, 0);
+  }
+  bool Verify(flatbuffers::Verifier& verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_DICTIONARY) &&
+           verifier.VerifyVector(dictionary()) &&
+           VerifyField<int64_t>(verifier, VT_LOGICAL_COMMIT_TIME, 8) &&
+           verifier.EndTable();
+  }
+  CompressionDictionaryRecordT* UnPack(
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  void UnPackTo(
+      CompressionDictionaryRecordT* _o,
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  static flatbuffers::Offset<CompressionDictionaryRecord> Pack(
+      flatbuffers::FlatBufferBuilder& _fbb,
+      const CompressionDictionaryRecordT* _o,
+      const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+};
+
+struct CompressionDictionaryRecordBuilder {
+  typedef CompressionDictionaryRecord Table;
+  flatbuffers::FlatBufferBuilder& fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_dictionary(
+      flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dictionary) {
+    fbb_.AddOffset(CompressionDictionaryRecord::VT_DICTIONARY, dictionary);
+  }
+  void add_logical_commit_time(int64_t logical_commit_time) {
+    fbb_.AddElement<int64_t>(
+        CompressionDictionaryRecord::VT_LOGICAL_COMMIT_TIME,
+        logical_commit_time, 0);
+  }
+  explicit CompressionDictionaryRecordBuilder(
+      flatbuffers::FlatBufferBuilder& _fbb)
+      : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  flatbuffers::Offset<CompressionDictionaryRecord> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<CompressionDictionaryRecord>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<CompressionDictionaryRecord>
+CreateCompressionDictionaryRecord(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dictionary = 0,
+    int64_t logical_commit_time = 0) {
+  CompressionDictionaryRecordBuilder builder_(_fbb);
+  builder_.add_logical_commit_time(logical_commit_time);
+  builder_.add_dictionary(dictionary);
+  return builder_.Finish();
+}
+
+struct CompressionDictionaryRecord::Traits {
+  using type = CompressionDictionaryRecord;
+  static auto constexpr Create = CreateCompressionDictionaryRecord;
+};
+
+inline flatbuffers::Offset<CompressionDictionaryRecord>
+CreateCompressionDictionaryRecordDirect(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const std::vector<uint8_t>* dictionary = nullptr,
+    int64_t logical_commit_time = 0) {
+  auto dictionary__ = dictionary ? _fbb.CreateVector<uint8_t>(*dictionary) : 0;
+  return kv_server::CreateCompressionDictionaryRecord(_fbb, dictionary__,
+                                                      logical_commit_time);
+}
+
+flatbuffers::Offset<CompressionDictionaryRecord>
+CreateCompressionDictionaryRecord(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const CompressionDictionaryRecordT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+
 struct DataRecordT : public flatbuffers::NativeTable {
   typedef DataRecord TableType;
   kv_server::RecordUnion record{};
@@ -931,6 +1072,13 @@ struct DataRecord FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
                ? static_cast<const kv_server::ShardMappingRecord*>(record())
                : nullptr;
   }
+  const kv_server::CompressionDictionaryRecord*
+  record_as_CompressionDictionaryRecord() const {
+    return record_type() == kv_server::Record::CompressionDictionaryRecord
+               ? static_cast<const kv_server::CompressionDictionaryRecord*>(
+                     record())
+               : nullptr;
+  }
   bool Verify(flatbuffers::Verifier& verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint8_t>(verifier, VT_RECORD_TYPE, 1) &&
@@ -966,6 +1114,12 @@ DataRecord::record_as<kv_server::ShardMappingRecord>() const {
   return record_as_ShardMappingRecord();
 }
 
+template <>
+inline const kv_server::CompressionDictionaryRecord*
+DataRecord::record_as<kv_server::CompressionDictionaryRecord>() const {
+  return record_as_CompressionDictionaryRecord();
+}
+
 struct DataRecordBuilder {
   typedef DataRecord Table;
   flatbuffers::FlatBufferBuilder& fbb_;
@@ -1182,6 +1336,10 @@ inline void UserDefinedFunctionsConfig::UnPackTo(
     auto _e = version();
     _o->version = _e;
   }
+  {
+    auto _e = binary_io();
+    _o->binary_io = _e;
+  }
 }
 
 inline flatbuffers::Offset<UserDefinedFunctionsConfig>
@@ -1210,9 +1368,10 @@ CreateUserDefinedFunctionsConfig(
       _o->handler_name.empty() ? 0 : _fbb.CreateString(_o->handler_name);
   auto _logical_commit_time = _o->logical_commit_time;
   auto _version = _o->version;
+  auto _binary_io = _o->binary_io;
   return kv_server::CreateUserDefinedFunctionsConfig(
       _fbb, _language, _code_snippet, _handler_name, _logical_commit_time,
-      _version);
+      _version, _binary_io);
 }
 
 inline ShardMappingRecordT* ShardMappingRecord::UnPack(
@@ -1260,6 +1419,59 @@ inline flatbuffers::Offset<ShardMappingRecord> CreateShardMappingRecord(
                                              _physical_shard);
 }
 
+inline CompressionDictionaryRecordT* CompressionDictionaryRecord::UnPack(
+    const flatbuffers::resolver_function_t* _resolver) const {
+  auto _o = std::make_unique<CompressionDictionaryRecordT>();
+  UnPackTo(_o.get(), _resolver);
+  return _o.release();
+}
+
+inline void CompressionDictionaryRecord::UnPackTo(
+    CompressionDictionaryRecordT* _o,
+    const flatbuffers::resolver_function_t* _resolver) const {
+  (void)_o;
+  (void)_resolver;
+  {
+    auto _e = dictionary();
+    if (_e) {
+      _o->dictionary.resize(_e->size());
+      std::copy(_e->begin(), _e->end(), _o->dictionary.begin());
+    }
+  }
+  {
+    auto _e = logical_commit_time();
+    _o->logical_commit_time = _e;
+  }
+}
+
+inline flatbuffers::Offset<CompressionDictionaryRecord>
+CompressionDictionaryRecord::Pack(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const CompressionDictionaryRecordT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  return CreateCompressionDictionaryRecord(_fbb, _o, _rehasher);
+}
+
+inline flatbuffers::Offset<CompressionDictionaryRecord>
+CreateCompressionDictionaryRecord(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const CompressionDictionaryRecordT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  (void)_rehasher;
+  (void)_o;
+  struct _VectorArgs {
+    flatbuffers::FlatBufferBuilder* __fbb;
+    const CompressionDictionaryRecordT* __o;
+    const flatbuffers::rehasher_function_t* __rehasher;
+  } _va = {&_fbb, _o, _rehasher};
+  (void)_va;
+  auto _dictionary =
+      _o->dictionary.size() ? _fbb.CreateVector(_o->dictionary) : 0;
+  auto _logical_commit_time = _o->logical_commit_time;
+  return kv_server::CreateCompressionDictionaryRecord(_fbb, _dictionary,
+                                                      _logical_commit_time);
+}
+
 inline DataRecordT* DataRecord::UnPack(
     const flatbuffers::resolver_function_t* _resolver) const {
   auto _o = std::make_unique<DataRecordT>();
@@ -1431,6 +1643,11 @@ inline bool VerifyRecord(flatbuffers::Verifier& verifier, const void* obj,
       auto ptr = reinterpret_cast<const kv_server::ShardMappingRecord*>(obj);
       return verifier.VerifyTable(ptr);
     }
+    case Record::CompressionDictionaryRecord: {
+      auto ptr =
+          reinterpret_cast<const kv_server::CompressionDictionaryRecord*>(obj);
+      return verifier.VerifyTable(ptr);
+    }
     default:
       return true;
   }
@@ -1469,6 +1686,11 @@ inline void* RecordUnion::UnPack(
       auto ptr = reinterpret_cast<const kv_server::ShardMappingRecord*>(obj);
       return ptr->UnPack(resolver);
     }
+    case Record::CompressionDictionaryRecord: {
+      auto ptr =
+          reinterpret_cast<const kv_server::CompressionDictionaryRecord*>(obj);
+      return ptr->UnPack(resolver);
+    }
     default:
       return nullptr;
   }
@@ -1494,6 +1716,12 @@ inline flatbuffers::Offset<void> RecordUnion::Pack(
       auto ptr = reinterpret_cast<const kv_server::ShardMappingRecordT*>(value);
       return CreateShardMappingRecord(_fbb, ptr, _rehasher).Union();
     }
+    case Record::CompressionDictionaryRecord: {
+      auto ptr =
+          reinterpret_cast<const kv_server::CompressionDictionaryRecordT*>(
+              value);
+      return CreateCompressionDictionaryRecord(_fbb, ptr, _rehasher).Union();
+    }
     default:
       return 0;
   }
@@ -1517,6 +1745,12 @@ inline RecordUnion::RecordUnion(const RecordUnion& u)
           *reinterpret_cast<kv_server::ShardMappingRecordT*>(u.value));
       break;
     }
+    case Record::CompressionDictionaryRecord: {
+      value = new kv_server::CompressionDictionaryRecordT(
+          *reinterpret_cast<kv_server::CompressionDictionaryRecordT*>(
+              u.value));
+      break;
+    }
     default:
       break;
   }
@@ -1540,6 +1774,12 @@ inline void RecordUnion::Reset() {
       delete ptr;
       break;
     }
+    case Record::CompressionDictionaryRecord: {
+      auto ptr =
+          reinterpret_cast<kv_server::CompressionDictionaryRecordT*>(value);
+      delete ptr;
+      break;
+    }
     default:
       break;
   }
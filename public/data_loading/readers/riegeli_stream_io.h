@@ -18,10 +18,14 @@
 #define PUBLIC_DATA_LOADING_READERS_RIEGELI_STREAM_IO_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <functional>
 #include <future>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -30,16 +34,73 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/types/span.h"
 #include "components/telemetry/server_definition.h"
 #include "glog/logging.h"
 #include "public/data_loading/readers/stream_record_reader.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/data_loading/shard_index_utils.h"
 #include "riegeli/bytes/istream_reader.h"
 #include "riegeli/records/record_reader.h"
 #include "src/cpp/telemetry/telemetry_provider.h"
 
 namespace kv_server {
 
+// Accumulates copies of records into a reusable buffer and passes them to
+// `callback` in batches of at most `max_batch_size` records. Once warmed up,
+// adding records does not allocate. Not thread safe.
+class RecordBatchBuffer {
+ public:
+  RecordBatchBuffer(
+      int64_t max_batch_size,
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback)
+      : max_batch_size_(std::max<int64_t>(max_batch_size, 1)),
+        callback_(callback) {
+    record_offsets_.reserve(max_batch_size_ + 1);
+    records_.reserve(max_batch_size_);
+  }
+
+  // Copies `record` into the batch and flushes the batch if it is full.
+  // Returns the status of the flush, if any.
+  absl::Status Add(std::string_view record) {
+    record_offsets_.push_back(buffer_.size());
+    buffer_.append(record);
+    if (record_offsets_.size() >= max_batch_size_) {
+      return Flush();
+    }
+    return absl::OkStatus();
+  }
+
+  // Calls `callback` with the buffered records, if any, and clears the
+  // buffer.
+  absl::Status Flush() {
+    if (record_offsets_.empty()) {
+      return absl::OkStatus();
+    }
+    // Views are built after all records are copied because appending to
+    // `buffer_` may reallocate it.
+    record_offsets_.push_back(buffer_.size());
+    for (int64_t i = 0; i + 1 < record_offsets_.size(); i++) {
+      records_.emplace_back(buffer_.data() + record_offsets_[i],
+                            record_offsets_[i + 1] - record_offsets_[i]);
+    }
+    auto status = callback_(records_);
+    records_.clear();
+    record_offsets_.clear();
+    buffer_.clear();
+    return status;
+  }
+
+ private:
+  const int64_t max_batch_size_;
+  const std::function<absl::Status(absl::Span<const std::string_view>)>&
+      callback_;
+  std::string buffer_;
+  std::vector<size_t> record_offsets_;
+  std::vector<std::string_view> records_;
+};
+
 // Reader that can read streams in Riegeli format.
 template <typename RecordT>
 class RiegeliStreamReader : public StreamRecordReader {
@@ -74,6 +135,9 @@ class RiegeliStreamReader : public StreamRecordReader {
     RecordT record;
     absl::Status overall_status;
     while (reader_.ReadRecord(record)) {
+      if (IsShardIndexRecord(record)) {
+        continue;
+      }
       overall_status.Update(callback(record));
     }
     if (!overall_status.ok()) {
@@ -82,6 +146,26 @@ class RiegeliStreamReader : public StreamRecordReader {
     return reader_.status();
   }
 
+  absl::Status ReadStreamRecordBatches(
+      int64_t max_batch_size,
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback) override {
+    RecordBatchBuffer batch_buffer(max_batch_size, callback);
+    std::string_view record;
+    absl::Status overall_status;
+    while (reader_.ReadRecord(record)) {
+      if (IsShardIndexRecord(record)) {
+        continue;
+      }
+      overall_status.Update(batch_buffer.Add(record));
+    }
+    overall_status.Update(batch_buffer.Flush());
+    if (!overall_status.ok()) {
+      LOG(ERROR) << overall_status;
+    }
+    return reader_.status();
+  }
+
   bool IsOpen() const { return reader_.is_open(); }
   absl::Status Status() const { return reader_.status(); }
 
@@ -91,6 +175,7 @@ class RiegeliStreamReader : public StreamRecordReader {
 
 const int64_t kDefaultNumWorkerThreads = std::thread::hardware_concurrency();
 constexpr int64_t kDefaultMinShardSize = 8 * 1024 * 1024;  // 8MB
+constexpr int64_t kDefaultNumShardsPerWorkerThread = 8;
 constexpr std::string_view kReadShardRecordsLatencyEvent =
     "ConcurrentStreamRecordReader::ReadShardRecords";
 constexpr std::string_view kReadStreamRecordsLatencyEvent =
@@ -98,10 +183,12 @@ constexpr std::string_view kReadStreamRecordsLatencyEvent =
 
 // A `ConcurrentStreamRecordReader` reads a Riegeli data stream containing
 // `RecordT` records concurrently. The reader splits the data stream
-// into shards with an approximately equal number of records and reads the
-// shards in parallel. Each record in the underlying data stream is guaranteed
-// to be read exactly once. The concurrency level can be configured using
-// `ConcurrentStreamRecordReader<RecordT>::Options`.
+// into many small byte range shards (several per worker thread) and worker
+// threads pull shards from a shared queue until all shards are consumed, so
+// that fast workers pick up the slack of slow ones when record density is
+// skewed across the stream. Each record in the underlying data stream is
+// guaranteed to be read exactly once. The concurrency level can be configured
+// using `ConcurrentStreamRecordReader<RecordT>::Options`.
 //
 // Sample usage:
 //
@@ -124,12 +211,18 @@ constexpr std::string_view kReadStreamRecordsLatencyEvent =
 // support seeking, can be read independently and point to the same
 // underlying underlying Riegeli data stream, e.g., multiple `std::ifstream`
 // streams pointing to the same underlying file.
+//
+// If the data stream has a shard index, `RestrictToShard` limits reading to
+// the sections of one shard (plus sections shared by all shards).
 template <typename RecordT>
 class ConcurrentStreamRecordReader : public StreamRecordReader {
  public:
   struct Options {
     int64_t num_worker_threads = kDefaultNumWorkerThreads;
     int64_t min_shard_size_bytes = kDefaultMinShardSize;
+    // Target number of shards per worker thread. Higher values give better
+    // load balancing at the cost of more seeks.
+    int64_t num_shards_per_worker_thread = kDefaultNumShardsPerWorkerThread;
     std::function<bool(const riegeli::SkippedRegion&)> recovery_callback =
         [](const riegeli::SkippedRegion& region) {
           LOG(WARNING) << "Skipping over corrupted region: " << region;
@@ -146,6 +239,14 @@ class ConcurrentStreamRecordReader : public StreamRecordReader {
   absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override;
   absl::Status ReadStreamRecords(
       const std::function<absl::Status(const RecordT&)>& callback) override;
+  // Each worker thread accumulates the records it reads into its own batch,
+  // so `callback` may be called concurrently from multiple threads.
+  absl::Status ReadStreamRecordBatches(
+      int64_t max_batch_size,
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback) override;
+  absl::StatusOr<bool> RestrictToShard(int32_t shard_num,
+                                       int32_t num_shards) override;
 
  private:
   // Defines a byte range in the underlying record stream that will be read
@@ -153,6 +254,9 @@ class ConcurrentStreamRecordReader : public StreamRecordReader {
   struct ShardRange {
     int64_t start_pos;
     int64_t end_pos;
+    // False if the range does not start right where the previous range
+    // ends, i.e., the records in between are skipped on purpose.
+    bool follows_previous_range = true;
   };
   // Defines metadata/stats returned by a shard reading task. This is useful
   // for correctness checks.
@@ -161,13 +265,39 @@ class ConcurrentStreamRecordReader : public StreamRecordReader {
     int64_t next_shard_first_record_pos;
     int64_t num_records_read;
   };
+  // Pulls shards from `shards` using `next_shard_index` until there are no
+  // more shards left and stores the result of reading shard `i` in
+  // `shard_results[i]`. Stops early if any worker fails.
+  // If `batch_callback` is set, records are passed to it in batches of at
+  // most `max_batch_size` records instead of to `record_callback`.
+  absl::Status ReadShardsFromQueue(
+      const std::vector<ShardRange>& shards,
+      std::atomic<int64_t>& next_shard_index, std::atomic<bool>& failed,
+      std::vector<absl::StatusOr<ShardResult>>& shard_results,
+      const std::function<absl::Status(const RecordT&)>& record_callback,
+      int64_t max_batch_size,
+      const std::function<absl::Status(absl::Span<const std::string_view>)>*
+          batch_callback);
+  absl::Status ReadStreamRecordsImpl(
+      const std::function<absl::Status(const RecordT&)>& record_callback,
+      int64_t max_batch_size,
+      const std::function<absl::Status(absl::Span<const std::string_view>)>*
+          batch_callback);
   absl::StatusOr<ShardResult> ReadShardRecords(
       const ShardRange& shard,
+      riegeli::RecordReader<riegeli::IStreamReader<>>& record_reader,
       const std::function<absl::Status(const RecordT&)>& record_callback);
   absl::StatusOr<std::vector<ShardRange>> BuildShards();
+  // Splits `sections` into shards of roughly equal size.
+  std::vector<ShardRange> SplitSections(const std::vector<ShardRange>& sections,
+                                        int64_t total_size);
   absl::StatusOr<int64_t> RecordStreamSize();
+  // Reads the `ShardIndex` record at the end of the stream.
+  absl::StatusOr<ShardIndex> ReadShardIndex();
   std::function<std::unique_ptr<RecordStream>()> stream_factory_;
   Options options_;
+  // If set, only these sections of the stream are read.
+  std::optional<std::vector<ShardRange>> restricted_sections_;
 };
 
 template <typename RecordT>
@@ -175,8 +305,10 @@ ConcurrentStreamRecordReader<RecordT>::ConcurrentStreamRecordReader(
     std::function<std::unique_ptr<RecordStream>()> stream_factory,
     Options options)
     : stream_factory_(std::move(stream_factory)), options_(std::move(options)) {
-  CHECK(options.num_worker_threads >= 1)
+  CHECK(options_.num_worker_threads >= 1)
       << "Number of work threads must be at least 1.";
+  CHECK(options_.num_shards_per_worker_thread >= 1)
+      << "Number of shards per worker thread must be at least 1.";
 }
 
 template <typename RecordT>
@@ -203,6 +335,97 @@ ConcurrentStreamRecordReader<RecordT>::RecordStreamSize() {
   return size;
 }
 
+template <typename RecordT>
+absl::StatusOr<ShardIndex>
+ConcurrentStreamRecordReader<RecordT>::ReadShardIndex() {
+  absl::StatusOr<int64_t> stream_size = RecordStreamSize();
+  if (!stream_size.ok()) {
+    return stream_size.status();
+  }
+  auto record_stream = stream_factory_();
+  riegeli::RecordReader<riegeli::IStreamReader<>> record_reader(
+      riegeli::IStreamReader(&record_stream->Stream()),
+      riegeli::RecordReaderBase::Options().set_recovery(
+          options_.recovery_callback));
+  std::string_view record;
+  if (!record_reader.Seek(*stream_size) || !record_reader.SeekBack() ||
+      !record_reader.ReadRecord(record)) {
+    if (!record_reader.ok()) {
+      return record_reader.status();
+    }
+    return absl::NotFoundError("Data stream has no records.");
+  }
+  return ParseShardIndexRecord(record);
+}
+
+template <typename RecordT>
+absl::StatusOr<bool> ConcurrentStreamRecordReader<RecordT>::RestrictToShard(
+    int32_t shard_num, int32_t num_shards) {
+  auto metadata = GetKVFileMetadata();
+  if (!metadata.ok()) {
+    return metadata.status();
+  }
+  if (num_shards <= 1 ||
+      metadata->sharding_metadata().num_index_shards() != num_shards) {
+    return false;
+  }
+  auto shard_index = ReadShardIndex();
+  if (!shard_index.ok()) {
+    // E.g., the writer was not closed properly. All records can still be
+    // read, just not selectively.
+    LOG(WARNING) << "Failed to read shard index, reading all records: "
+                 << shard_index.status();
+    return false;
+  }
+  std::vector<ShardRange> sections;
+  for (const auto& section : shard_index->sections()) {
+    if (section.shard_num() != shard_num && section.shard_num() >= 0) {
+      continue;
+    }
+    if (section.end_pos() <= section.start_pos()) {
+      continue;
+    }
+    sections.push_back(ShardRange{
+        .start_pos = section.start_pos(),
+        .end_pos = section.end_pos() - 1,
+        .follows_previous_range = false,
+    });
+  }
+  VLOG(2) << "Reading " << sections.size() << " out of "
+          << shard_index->sections_size() << " sections for shard "
+          << shard_num;
+  restricted_sections_ = std::move(sections);
+  return true;
+}
+
+template <typename RecordT>
+std::vector<typename ConcurrentStreamRecordReader<RecordT>::ShardRange>
+ConcurrentStreamRecordReader<RecordT>::SplitSections(
+    const std::vector<ShardRange>& sections, int64_t total_size) {
+  const int64_t target_num_shards =
+      options_.num_worker_threads * options_.num_shards_per_worker_thread;
+  const int64_t shard_size =
+      std::max(int64_t(std::ceil((double)total_size / target_num_shards)),
+               options_.min_shard_size_bytes);
+  std::vector<ShardRange> shards;
+  for (const auto& section : sections) {
+    int64_t shard_start_pos = section.start_pos;
+    bool follows_previous_range = section.follows_previous_range;
+    while (shard_start_pos <= section.end_pos) {
+      const int64_t shard_end_pos =
+          std::min(shard_start_pos + shard_size, section.end_pos);
+      shards.push_back(ShardRange{
+          .start_pos = shard_start_pos,
+          .end_pos = shard_end_pos,
+          .follows_previous_range = follows_previous_range,
+      });
+      follows_previous_range = true;
+      shard_start_pos = shard_end_pos + 1;
+    }
+  }
+  return shards;
+}
+
 template <typename RecordT>
 absl::StatusOr<
     std::vector<typename ConcurrentStreamRecordReader<RecordT>::ShardRange>>
@@ -218,15 +441,29 @@ ConcurrentStreamRecordReader<RecordT>::BuildShards() {
         absl::StrFormat("Num worker threads %d must be at least 1.",
                         options_.num_worker_threads));
   }
+  if (options_.num_shards_per_worker_thread < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Num shards per worker thread %d must be at least 1.",
+                        options_.num_shards_per_worker_thread));
+  }
+  if (restricted_sections_.has_value()) {
+    int64_t total_size = 0;
+    for (const auto& section : *restricted_sections_) {
+      total_size += section.end_pos - section.start_pos + 1;
+    }
+    return SplitSections(*restricted_sections_, total_size);
+  }
   // The shard size must be at least `options_.min_shard_size_bytes` and
   // at most `*stream_size`.
+  const int64_t target_num_shards =
+      options_.num_worker_threads * options_.num_shards_per_worker_thread;
   int64_t shard_size = std::min(
-      *stream_size, std::max(int64_t(std::ceil((double)*stream_size /
-                                               options_.num_worker_threads)),
-                             options_.min_shard_size_bytes));
+      *stream_size,
+      std::max(int64_t(std::ceil((double)*stream_size / target_num_shards)),
+               options_.min_shard_size_bytes));
   int64_t shard_start_pos = 0;
   std::vector<ShardRangeT> shards;
-  shards.reserve(options_.num_worker_threads);
+  shards.reserve(target_num_shards);
   while (shard_start_pos < *stream_size) {
     int64_t shard_end_pos = shard_start_pos + shard_size;
     shard_end_pos = std::min(shard_end_pos, *stream_size);
@@ -247,36 +484,79 @@ ConcurrentStreamRecordReader<RecordT>::BuildShards() {
 template <typename RecordT>
 absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecords(
     const std::function<absl::Status(const RecordT&)>& callback) {
+  return ReadStreamRecordsImpl(callback, /*max_batch_size=*/1,
+                               /*batch_callback=*/nullptr);
+}
+
+template <typename RecordT>
+absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecordBatches(
+    int64_t max_batch_size,
+    const std::function<absl::Status(absl::Span<const std::string_view>)>&
+        callback) {
+  return ReadStreamRecordsImpl(/*record_callback=*/nullptr, max_batch_size,
+                               &callback);
+}
+
+template <typename RecordT>
+absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecordsImpl(
+    const std::function<absl::Status(const RecordT&)>& callback,
+    int64_t max_batch_size,
+    const std::function<absl::Status(absl::Span<const std::string_view>)>*
+        batch_callback) {
   auto start_time = absl::Now();
   auto shards = BuildShards();
-  if (!shards.ok() || shards->empty()) {
+  if (!shards.ok()) {
     return shards.status();
   }
-  std::vector<std::future<absl::StatusOr<ShardResult>>> shard_reader_tasks;
-  for (const auto& shard : *shards) {
+  if (shards->empty()) {
+    // Only possible if no section of the stream belongs to the shard that
+    // reading was restricted to.
+    return absl::OkStatus();
+  }
+  // Workers pull shards from a shared queue, so the number of workers never
+  // needs to exceed the number of shards.
+  const int64_t num_workers =
+      std::min(options_.num_worker_threads, int64_t(shards->size()));
+  std::atomic<int64_t> next_shard_index = 0;
+  std::atomic<bool> failed = false;
+  std::vector<absl::StatusOr<ShardResult>> shard_results(
+      shards->size(), absl::UnknownError("Shard was not read."));
+  std::vector<std::future<absl::Status>> shard_reader_tasks;
+  shard_reader_tasks.reserve(num_workers);
+  for (int64_t i = 0; i < num_workers; i++) {
     // TODO: b/268339067 - Investigate using an executor because
     // std::async is generally not preffered, but works fine as an
     // initial implementation.
-    shard_reader_tasks.push_back(
-        std::async(std::launch::async,
-                   &ConcurrentStreamRecordReader<RecordT>::ReadShardRecords,
-                   this, std::ref(shard), std::ref(callback)));
+    shard_reader_tasks.push_back(std::async(
+        std::launch::async,
+        &ConcurrentStreamRecordReader<RecordT>::ReadShardsFromQueue, this,
+        std::cref(*shards), std::ref(next_shard_index), std::ref(failed),
+        std::ref(shard_results), std::cref(callback), max_batch_size,
+        batch_callback));
+  }
+  absl::Status workers_status;
+  for (auto& task : shard_reader_tasks) {
+    workers_status.Update(task.get());
+  }
+  if (!workers_status.ok()) {
+    return workers_status;
   }
-  absl::StatusOr<ShardResult> prev_shard_result = shard_reader_tasks[0].get();
+  absl::StatusOr<ShardResult> prev_shard_result = shard_results[0];
   if (!prev_shard_result.ok()) {
     return prev_shard_result.status();
   }
   int64_t total_records_read = prev_shard_result->num_records_read;
-  for (int i = 1; i < shard_reader_tasks.size(); i++) {
-    absl::StatusOr<ShardResult> curr_shard_result = shard_reader_tasks[i].get();
+  for (int i = 1; i < shard_results.size(); i++) {
+    absl::StatusOr<ShardResult>& curr_shard_result = shard_results[i];
     // TODO: The stuff below should be handled more gracefully,
     // e.g., only retry the shard that failed or skipped some
     // records.
     if (!curr_shard_result.ok()) {
       return curr_shard_result.status();
     }
-    if (prev_shard_result->next_shard_first_record_pos <
-        curr_shard_result->first_record_pos) {
+    if ((*shards)[i].follows_previous_range &&
+        prev_shard_result->next_shard_first_record_pos <
+            curr_shard_result->first_record_pos) {
       return absl::InternalError(
           absl::StrFormat("Skipped some records between byte=%d and byte=%d.",
                           prev_shard_result->next_shard_first_record_pos,
@@ -296,19 +576,67 @@ absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecords(
   return absl::OkStatus();
 }
 
+template <typename RecordT>
+absl::Status ConcurrentStreamRecordReader<RecordT>::ReadShardsFromQueue(
+    const std::vector<ShardRange>& shards,
+    std::atomic<int64_t>& next_shard_index, std::atomic<bool>& failed,
+    std::vector<absl::StatusOr<ShardResult>>& shard_results,
+    const std::function<absl::Status(const RecordT&)>& record_callback,
+    int64_t max_batch_size,
+    const std::function<absl::Status(absl::Span<const std::string_view>)>*
+        batch_callback) {
+  std::unique_ptr<RecordBatchBuffer> batch_buffer;
+  std::function<absl::Status(const RecordT&)> batching_callback;
+  if (batch_callback != nullptr) {
+    batch_buffer =
+        std::make_unique<RecordBatchBuffer>(max_batch_size, *batch_callback);
+    batching_callback = [&batch_buffer](const RecordT& record) {
+      return batch_buffer->Add(record);
+    };
+  }
+  const auto& worker_callback =
+      batch_callback != nullptr ? batching_callback : record_callback;
+  // Each worker reuses a single stream and record reader for all the shards
+  // it reads and seeks to the start of each shard.
+  auto record_stream = stream_factory_();
+  riegeli::RecordReader<riegeli::IStreamReader<>> record_reader(
+      riegeli::IStreamReader(&record_stream->Stream()),
+      riegeli::RecordReaderBase::Options().set_recovery(
+          options_.recovery_callback));
+  int64_t num_shards_read = 0;
+  while (!failed.load(std::memory_order_relaxed)) {
+    const int64_t shard_index =
+        next_shard_index.fetch_add(1, std::memory_order_relaxed);
+    if (shard_index >= shards.size()) {
+      break;
+    }
+    shard_results[shard_index] =
+        ReadShardRecords(shards[shard_index], record_reader, worker_callback);
+    if (!shard_results[shard_index].ok()) {
+      failed.store(true, std::memory_order_relaxed);
+      return shard_results[shard_index].status();
+    }
+    num_shards_read++;
+  }
+  if (batch_buffer != nullptr) {
+    if (auto status = batch_buffer->Flush(); !status.ok()) {
+      LOG(ERROR) << "Record callback failed to process some records with: "
+                 << status;
+    }
+  }
+  VLOG(2) << "Worker done after reading " << num_shards_read << " shards.";
+  return absl::OkStatus();
+}
+
 template <typename RecordT>
 absl::StatusOr<typename ConcurrentStreamRecordReader<RecordT>::ShardResult>
 ConcurrentStreamRecordReader<RecordT>::ReadShardRecords(
     const ShardRange& shard,
+    riegeli::RecordReader<riegeli::IStreamReader<>>& record_reader,
     const std::function<absl::Status(const RecordT&)>& record_callback) {
   VLOG(2) << "Reading shard: "
           << "[" << shard.start_pos << "," << shard.end_pos << "]";
   auto start_time = absl::Now();
-  auto record_stream = stream_factory_();
-  riegeli::RecordReader<riegeli::IStreamReader<>> record_reader(
-      riegeli::IStreamReader(&record_stream->Stream()),
-      riegeli::RecordReaderBase::Options().set_recovery(
-          options_.recovery_callback));
   if (auto result = record_reader.Seek(shard.start_pos); !result) {
     return record_reader.status();
   }
@@ -319,9 +647,12 @@ ConcurrentStreamRecordReader<RecordT>::ReadShardRecords(
   RecordT record;
   absl::Status overall_status;
   while (next_record_pos <= shard.end_pos && record_reader.ReadRecord(record)) {
+    next_record_pos = record_reader.pos().numeric();
+    if (IsShardIndexRecord(record)) {
+      continue;
+    }
     overall_status.Update(record_callback(record));
     num_records_read++;
-    next_record_pos = record_reader.pos().numeric();
   }
   // TODO: b/269119466 - Figure out how to handle this better. Maybe add
   // metrics to track callback failures (??).
@@ -214,6 +214,16 @@ INSTANTIATE_TEST_SUITE_P(ConcurrentOptions, ConcurrentStreamRecordReaderTest,
                              ConcurrentReaderOptions{
                                  .num_worker_threads = 5,
                                  .min_shard_size_bytes = 1024 * 1024,
+                             },
+                             ConcurrentReaderOptions{
+                                 .num_worker_threads = 3,
+                                 .min_shard_size_bytes = 16,
+                                 .num_shards_per_worker_thread = 1,
+                             },
+                             ConcurrentReaderOptions{
+                                 .num_worker_threads = 3,
+                                 .min_shard_size_bytes = 16,
+                                 .num_shards_per_worker_thread = 64,
                              }));
 
 TEST_P(ConcurrentStreamRecordReaderTest, ReadsAllRecordsExactlyOnce) {
@@ -241,6 +251,34 @@ TEST_P(ConcurrentStreamRecordReaderTest, ReadsAllRecordsExactlyOnce) {
   }
 }
 
+TEST_P(ConcurrentStreamRecordReaderTest, ReadsAllRecordBatchesExactlyOnce) {
+  std::string content;
+  auto writer = riegeli::RecordWriter(riegeli::StringWriter(&content),
+                                      riegeli::RecordWriterBase::Options());
+  testing::MockFunction<absl::Status(std::string_view)> callback;
+  for (int i = 0; i < 2500; i++) {
+    auto record = absl::StrCat(i);
+    writer.WriteRecord(record);
+    EXPECT_CALL(callback, Call(record))
+        .Times(testing::Exactly(1))
+        .WillOnce(
+            [](std::string_view record_read) { return absl::OkStatus(); });
+  }
+  ASSERT_TRUE(writer.Close());
+  auto record_reader = CreateConcurrentReader(content);
+  EXPECT_TRUE(record_reader
+                  ->ReadStreamRecordBatches(
+                      /*max_batch_size=*/100,
+                      [&callback](absl::Span<const std::string_view> batch) {
+                        EXPECT_LE(batch.size(), 100);
+                        for (const auto& record : batch) {
+                          callback.Call(record).IgnoreError();
+                        }
+                        return absl::OkStatus();
+                      })
+                  .ok());
+}
+
 // Disables seeking from stringbufs.
 class NonSeekingSStreamBuf : public std::stringbuf {
  public:
@@ -17,8 +17,12 @@
 #ifndef PUBLIC_DATA_LOADING_READERS_STREAM_RECORD_READER_H_
 #define PUBLIC_DATA_LOADING_READERS_STREAM_RECORD_READER_H_
 
+#include <functional>
+#include <string_view>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
 
 namespace kv_server {
@@ -42,6 +46,33 @@ class StreamRecordReader {
   // reading and logs the error at the end.
   virtual absl::Status ReadStreamRecords(
       const std::function<absl::Status(const std::string_view&)>& callback) = 0;
+
+  // Same as `ReadStreamRecords`, but calls `callback` with batches of at most
+  // `max_batch_size` records. Records in a batch are only valid for the
+  // duration of the `callback` call. Concurrent readers may call `callback`
+  // from multiple threads at the same time.
+  //
+  // The default implementation calls `callback` once per record.
+  virtual absl::Status ReadStreamRecordBatches(
+      int64_t max_batch_size,
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback) {
+    return ReadStreamRecords([&callback](const std::string_view& record) {
+      return callback(absl::MakeConstSpan(&record, 1));
+    });
+  }
+
+  // Restricts subsequent reads to the records of shard `shard_num` if the
+  // stream has a shard index for `num_shards` shards (see
+  // `ShardingMetadata.num_index_shards`), so that sections of other shards
+  // are skipped without being read. Returns false and leaves reads
+  // unrestricted if there is no usable shard index.
+  //
+  // The default implementation does not support shard indexes.
+  virtual absl::StatusOr<bool> RestrictToShard(int32_t shard_num,
+                                               int32_t num_shards) {
+    return false;
+  }
 };
 
 // Holds a stream of data.
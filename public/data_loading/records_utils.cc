@@ -76,7 +76,8 @@ flatbuffers::Offset<UserDefinedFunctionsConfig> UdfConfigFromStruct(
       builder, udf_config_struct.language,
       udf_config_struct.code_snippet.data(),
       udf_config_struct.handler_name.data(),
-      udf_config_struct.logical_commit_time, udf_config_struct.version);
+      udf_config_struct.logical_commit_time, udf_config_struct.version,
+      udf_config_struct.binary_io);
 }
 
 flatbuffers::Offset<ShardMappingRecord> ShardMappingFromStruct(
@@ -86,6 +87,18 @@ flatbuffers::Offset<ShardMappingRecord> ShardMappingFromStruct(
                                   shard_mapping_struct.physical_shard);
 }
 
+flatbuffers::Offset<CompressionDictionaryRecord>
+CompressionDictionaryFromStruct(
+    flatbuffers::FlatBufferBuilder& builder,
+    const CompressionDictionaryRecordStruct& dictionary_struct) {
+  return CreateCompressionDictionaryRecord(
+      builder,
+      builder.CreateVector(
+          reinterpret_cast<const uint8_t*>(dictionary_struct.dictionary.data()),
+          dictionary_struct.dictionary.size()),
+      dictionary_struct.logical_commit_time);
+}
+
 RecordUnion BuildRecordUnion(const RecordT& record,
                              flatbuffers::FlatBufferBuilder& builder) {
   return std::visit(
@@ -110,6 +123,13 @@ RecordUnion BuildRecordUnion(const RecordT& record,
               .record = ShardMappingFromStruct(builder, arg).Union(),
           };
         }
+        if constexpr (std::is_same_v<VariantT,
+                                     CompressionDictionaryRecordStruct>) {
+          return RecordUnion{
+              .record_type = Record::CompressionDictionaryRecord,
+              .record = CompressionDictionaryFromStruct(builder, arg).Union(),
+          };
+        }
         if constexpr (std::is_same_v<VariantT, std::monostate>) {
           return RecordUnion{
               .record_type = Record::NONE,
@@ -217,6 +237,10 @@ RecordT GetRecordStruct(const DataRecord& data_record) {
   if (data_record.record_type() == Record::ShardMappingRecord) {
     record = GetTypedRecordStruct<ShardMappingRecordStruct>(data_record);
   }
+  if (data_record.record_type() == Record::CompressionDictionaryRecord) {
+    record =
+        GetTypedRecordStruct<CompressionDictionaryRecordStruct>(data_record);
+  }
   return record;
 }
 
@@ -241,7 +265,8 @@ bool operator==(const UserDefinedFunctionsConfigStruct& lhs_record,
          lhs_record.version == rhs_record.version &&
          lhs_record.handler_name == rhs_record.handler_name &&
          lhs_record.language == rhs_record.language &&
-         lhs_record.code_snippet == rhs_record.code_snippet;
+         lhs_record.code_snippet == rhs_record.code_snippet &&
+         lhs_record.binary_io == rhs_record.binary_io;
 }
 
 bool operator!=(const UserDefinedFunctionsConfigStruct& lhs_record,
@@ -260,6 +285,17 @@ bool operator!=(const ShardMappingRecordStruct& lhs_record,
   return !operator==(lhs_record, rhs_record);
 }
 
+bool operator==(const CompressionDictionaryRecordStruct& lhs_record,
+                const CompressionDictionaryRecordStruct& rhs_record) {
+  return lhs_record.logical_commit_time == rhs_record.logical_commit_time &&
+         lhs_record.dictionary == rhs_record.dictionary;
+}
+
+bool operator!=(const CompressionDictionaryRecordStruct& lhs_record,
+                const CompressionDictionaryRecordStruct& rhs_record) {
+  return !operator==(lhs_record, rhs_record);
+}
+
 bool operator==(const DataRecordStruct& lhs_record,
                 const DataRecordStruct& rhs_record) {
   return lhs_record.record == rhs_record.record;
@@ -375,6 +411,7 @@ UserDefinedFunctionsConfigStruct GetTypedRecordStruct(
   udf_config_struct.code_snippet = udf_config->code_snippet()->string_view();
   udf_config_struct.handler_name = udf_config->handler_name()->string_view();
   udf_config_struct.version = udf_config->version();
+  udf_config_struct.binary_io = udf_config->binary_io();
   return udf_config_struct;
 }
 
@@ -387,4 +424,20 @@ ShardMappingRecordStruct GetTypedRecordStruct(const DataRecord& data_record) {
   };
 }
 
+template <>
+CompressionDictionaryRecordStruct GetTypedRecordStruct(
+    const DataRecord& data_record) {
+  const auto* dictionary_record =
+      data_record.record_as_CompressionDictionaryRecord();
+  CompressionDictionaryRecordStruct dictionary_struct{
+      .logical_commit_time = dictionary_record->logical_commit_time(),
+  };
+  if (const auto* dictionary = dictionary_record->dictionary();
+      dictionary != nullptr) {
+    dictionary_struct.dictionary = std::string_view(
+        reinterpret_cast<const char*>(dictionary->data()), dictionary->size());
+  }
+  return dictionary_struct;
+}
+
 }  // namespace kv_server
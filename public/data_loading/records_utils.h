@@ -53,6 +53,7 @@ struct UserDefinedFunctionsConfigStruct {
   std::string_view handler_name;
   int64_t logical_commit_time;
   int64_t version;
+  bool binary_io = false;
 };
 
 struct ShardMappingRecordStruct {
@@ -60,9 +61,15 @@ struct ShardMappingRecordStruct {
   int32_t physical_shard;
 };
 
+struct CompressionDictionaryRecordStruct {
+  std::string_view dictionary;
+  int64_t logical_commit_time;
+};
+
 using RecordT =
     std::variant<std::monostate, KeyValueMutationRecordStruct,
-                 UserDefinedFunctionsConfigStruct, ShardMappingRecordStruct>;
+                 UserDefinedFunctionsConfigStruct, ShardMappingRecordStruct,
+                 CompressionDictionaryRecordStruct>;
 
 struct DataRecordStruct {
   RecordT record;
@@ -83,6 +90,11 @@ bool operator==(const ShardMappingRecordStruct& lhs_record,
 bool operator!=(const ShardMappingRecordStruct& lhs_record,
                 const ShardMappingRecordStruct& rhs_record);
 
+bool operator==(const CompressionDictionaryRecordStruct& lhs_record,
+                const CompressionDictionaryRecordStruct& rhs_record);
+bool operator!=(const CompressionDictionaryRecordStruct& lhs_record,
+                const CompressionDictionaryRecordStruct& rhs_record);
+
 bool operator==(const DataRecordStruct& lhs_record,
                 const DataRecordStruct& rhs_record);
 bool operator!=(const DataRecordStruct& lhs_record,
@@ -155,6 +167,9 @@ UserDefinedFunctionsConfigStruct GetTypedRecordStruct(
     const DataRecord& data_record);
 template <>
 ShardMappingRecordStruct GetTypedRecordStruct(const DataRecord& data_record);
+template <>
+CompressionDictionaryRecordStruct GetTypedRecordStruct(
+    const DataRecord& data_record);
 
 }  // namespace kv_server
 
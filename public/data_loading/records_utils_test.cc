@@ -77,6 +77,9 @@ TEST(UdfConfigStructTest, ValidateEqualsOperator) {
   EXPECT_EQ(GetUdfConfigStruct(), GetUdfConfigStruct());
   EXPECT_NE(GetUdfConfigStruct("code_snippet1"),
             GetUdfConfigStruct("code_snippet2"));
+  auto binary_io_udf_config = GetUdfConfigStruct();
+  binary_io_udf_config.binary_io = true;
+  EXPECT_NE(GetUdfConfigStruct(), binary_io_udf_config);
 }
 
 TEST(DataRecordStructTest, ValidateEqualsOperator) {
@@ -435,6 +438,23 @@ TEST(DataRecordTest, DeserializeDataRecord_ToStruct_UdfConfig_Success) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(DataRecordTest,
+     DeserializeDataRecord_ToStruct_UdfConfig_BinaryIo_Success) {
+  auto udf_config_struct = GetUdfConfigStruct();
+  udf_config_struct.binary_io = true;
+  auto data_record_struct = GetDataRecord(udf_config_struct);
+  testing::MockFunction<absl::Status(const DataRecordStruct&)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .WillOnce([&data_record_struct](const DataRecordStruct& actual_record) {
+        EXPECT_EQ(data_record_struct, actual_record);
+        return absl::OkStatus();
+      });
+  auto status = DeserializeDataRecord(
+      ToStringView(ToFlatBufferBuilder(data_record_struct)),
+      record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
 TEST(DataRecordTest, DeserializeDataRecord_ToFbsRecord_ShardMapping_Success) {
   auto data_record_struct = GetDataRecord(
       ShardMappingRecordStruct{.logical_shard = 0, .physical_shard = 0});
@@ -465,5 +485,23 @@ TEST(DataRecordTest, DeserializeDataRecord_ToStruct_ShardMapping_Success) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(DataRecordTest,
+     DeserializeDataRecord_ToStruct_CompressionDictionary_Success) {
+  // Dictionaries are binary, including null bytes.
+  const std::string dictionary("\x37\xa4\x30\xec\0dictionary", 15);
+  auto data_record_struct = GetDataRecord(CompressionDictionaryRecordStruct{
+      .dictionary = dictionary, .logical_commit_time = 1234567890});
+  testing::MockFunction<absl::Status(const DataRecordStruct&)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .WillOnce([&data_record_struct](const DataRecordStruct& actual_record) {
+        EXPECT_EQ(data_record_struct, actual_record);
+        return absl::OkStatus();
+      });
+  auto status = DeserializeDataRecord(
+      ToStringView(ToFlatBufferBuilder(data_record_struct)),
+      record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
 }  // namespace
 }  // namespace kv_server
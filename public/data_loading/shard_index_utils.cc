@@ -0,0 +1,44 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/shard_index_utils.h"
+
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+
+namespace kv_server {
+
+bool IsShardIndexRecord(std::string_view record) {
+  return absl::StartsWith(record, kShardIndexRecordPrefix);
+}
+
+std::string ToShardIndexRecord(const ShardIndex& shard_index) {
+  return absl::StrCat(kShardIndexRecordPrefix,
+                      shard_index.SerializeAsString());
+}
+
+absl::StatusOr<ShardIndex> ParseShardIndexRecord(std::string_view record) {
+  if (!IsShardIndexRecord(record)) {
+    return absl::InvalidArgumentError("Record is not a shard index record.");
+  }
+  record.remove_prefix(kShardIndexRecordPrefix.size());
+  ShardIndex shard_index;
+  if (!shard_index.ParseFromArray(record.data(), record.size())) {
+    return absl::InvalidArgumentError("Failed to parse shard index.");
+  }
+  return shard_index;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PUBLIC_DATA_LOADING_SHARD_INDEX_UTILS_H_
+#define PUBLIC_DATA_LOADING_SHARD_INDEX_UTILS_H_
+
+#include <string>
+#include <string_view>
+
+#include "absl/status/statusor.h"
+#include "public/data_loading/riegeli_metadata.pb.h"
+
+namespace kv_server {
+
+// Prefix of the record that holds the `ShardIndex` of a data file. The prefix
+// guarantees that the record is never mistaken for a valid
+// `data_loading.fbs:DataRecord` flatbuffer, since its first four bytes read as
+// a root table offset far beyond the size of the record.
+inline constexpr std::string_view kShardIndexRecordPrefix = "KVSHARDINDEX";
+
+// Returns true if `record` holds a serialized `ShardIndex`.
+bool IsShardIndexRecord(std::string_view record);
+
+// Serializes `shard_index` into a record that can be appended to a data file.
+std::string ToShardIndexRecord(const ShardIndex& shard_index);
+
+// Parses a record produced by `ToShardIndexRecord`.
+absl::StatusOr<ShardIndex> ParseShardIndexRecord(std::string_view record);
+
+}  // namespace kv_server
+
+#endif  // PUBLIC_DATA_LOADING_SHARD_INDEX_UTILS_H_
@@ -0,0 +1,61 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/shard_index_utils.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "public/data_loading/records_utils.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+TEST(ShardIndexUtilsTest, RoundTripsShardIndex) {
+  ShardIndex shard_index;
+  shard_index.set_num_shards(2);
+  auto* section = shard_index.add_sections();
+  section->set_shard_num(1);
+  section->set_start_pos(10);
+  section->set_end_pos(20);
+  const std::string record = ToShardIndexRecord(shard_index);
+  EXPECT_TRUE(IsShardIndexRecord(record));
+  const auto parsed = ParseShardIndexRecord(record);
+  ASSERT_TRUE(parsed.ok()) << parsed.status();
+  EXPECT_THAT(*parsed, EqualsProto(shard_index));
+}
+
+TEST(ShardIndexUtilsTest, DataRecordIsNotShardIndexRecord) {
+  auto record = ToFlatBufferBuilder(DataRecordStruct{
+      .record = KeyValueMutationRecordStruct{
+          .mutation_type = KeyValueMutationType::Update,
+          .logical_commit_time = 1,
+          .key = "key",
+          .value = "value",
+      }});
+  EXPECT_FALSE(IsShardIndexRecord(ToStringView(record)));
+  EXPECT_FALSE(ParseShardIndexRecord(ToStringView(record)).ok());
+}
+
+TEST(ShardIndexUtilsTest, ShardIndexRecordIsNotDataRecord) {
+  ShardIndex shard_index;
+  shard_index.set_num_shards(2);
+  const std::string record = ToShardIndexRecord(shard_index);
+  EXPECT_FALSE(DeserializeDataRecord(record, [](const DataRecord&) {
+                 return absl::OkStatus();
+               }).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -17,20 +17,37 @@
 #ifndef PUBLIC_DATA_LOADING_WRITERS_DELTA_RECORD_STREAM_WRITER_H_
 #define PUBLIC_DATA_LOADING_WRITERS_DELTA_RECORD_STREAM_WRITER_H_
 
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "glog/logging.h"
 #include "public/data_loading/records_utils.h"
+#include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/data_loading/shard_index_utils.h"
 #include "public/data_loading/writers/delta_record_writer.h"
+#include "riegeli/bytes/istream_reader.h"
 #include "riegeli/bytes/ostream_writer.h"
+#include "riegeli/records/record_reader.h"
 #include "riegeli/records/record_writer.h"
 
 namespace kv_server {
 
+// When `Options::num_index_shards` is greater than 1, records are written to
+// one temporary Riegeli stream per shard (see
+// `Options::temp_data_file_prefix`) until `Flush()` or `Close()`, and then
+// copied out grouped by shard, with each group starting at a new Riegeli
+// chunk. `Close()` appends the `ShardIndex` record that lists all sections.
+// Callers should check the status of a final `Flush()` before `Close()`: if
+// copying the sections out fails, the writer fails and no index is written.
 template <typename DestStreamT = std::iostream>
 class DeltaRecordStreamWriter : public DeltaRecordWriter {
  public:
@@ -44,16 +61,45 @@ class DeltaRecordStreamWriter : public DeltaRecordWriter {
   absl::Status WriteRecord(const DataRecordStruct& data_record) override;
   const Options& GetOptions() const override { return options_; }
   absl::Status Flush() override;
-  void Close() override { record_writer_->Close(); }
+  void Close() override;
   bool IsOpen() override { return record_writer_->is_open(); }
   absl::Status Status() override { return record_writer_->status(); }
 
  private:
   DeltaRecordStreamWriter(DestStreamT& dest_stream, Options options);
 
+  // Records of one section, held in a temporary stream until they are
+  // written out.
+  struct SectionWriter {
+    ~SectionWriter() {
+      record_writer.reset();
+      stream.reset();
+      if (!temp_data_file.empty()) {
+        std::filesystem::remove(temp_data_file);
+      }
+    }
+
+    // Empty if the stream is in memory.
+    std::string temp_data_file;
+    std::unique_ptr<std::iostream> stream;
+    std::unique_ptr<
+        riegeli::RecordWriter<riegeli::OStreamWriter<std::iostream*>>>
+        record_writer;
+  };
+
+  bool HasShardIndex() const { return options_.num_index_shards > 1; }
+  absl::StatusOr<SectionWriter*> GetSectionWriter(int section_num);
+  // Copies the records of the temporary sections out as one section per
+  // shard.
+  absl::Status WriteShardSections();
+
   Options options_;
   std::unique_ptr<riegeli::RecordWriter<riegeli::OStreamWriter<DestStreamT*>>>
       record_writer_;
+  // Temporary sections per shard, created on their first record. The last
+  // section holds records that are needed by all shards.
+  std::vector<std::unique_ptr<SectionWriter>> section_writers_;
+  ShardIndex shard_index_;
 };
 
 riegeli::RecordWriterBase::Options GetRecordWriterOptions(
@@ -62,12 +108,28 @@ riegeli::RecordWriterBase::Options GetRecordWriterOptions(
 template <typename DestStreamT>
 DeltaRecordStreamWriter<DestStreamT>::DeltaRecordStreamWriter(
     DestStreamT& dest_stream, Options options)
-    : options_(std::move(options)),
-      record_writer_(
-          std::make_unique<
-              riegeli::RecordWriter<riegeli::OStreamWriter<DestStreamT*>>>(
-              riegeli::OStreamWriter(&dest_stream),
-              GetRecordWriterOptions(options_))) {}
+    : options_(std::move(options)) {
+  if (HasShardIndex()) {
+    auto* sharding_metadata = options_.metadata.mutable_sharding_metadata();
+    sharding_metadata->set_num_index_shards(options_.num_index_shards);
+    sharding_metadata->set_sharding_function_version(static_cast<int32_t>(
+        options_.index_key_sharder.sharding_function_version()));
+    if (const auto& regex = options_.index_key_sharder.sharding_key_regex();
+        !regex.empty()) {
+      sharding_metadata->set_sharding_key_regex(regex);
+    }
+    if (const auto& delimiter =
+            options_.index_key_sharder.sharding_key_delimiter();
+        !delimiter.empty()) {
+      sharding_metadata->set_sharding_key_delimiter(delimiter);
+    }
+    section_writers_.resize(options_.num_index_shards + 1);
+    shard_index_.set_num_shards(options_.num_index_shards);
+  }
+  record_writer_ = std::make_unique<
+      riegeli::RecordWriter<riegeli::OStreamWriter<DestStreamT*>>>(
+      riegeli::OStreamWriter(&dest_stream), GetRecordWriterOptions(options_));
+}
 
 template <typename DestStreamT>
 absl::StatusOr<std::unique_ptr<DeltaRecordStreamWriter<DestStreamT>>>
@@ -76,9 +138,69 @@ DeltaRecordStreamWriter<DestStreamT>::Create(DestStreamT& dest_stream,
   return absl::WrapUnique(new DeltaRecordStreamWriter(dest_stream, options));
 }
 
+template <typename DestStreamT>
+absl::StatusOr<typename DeltaRecordStreamWriter<DestStreamT>::SectionWriter*>
+DeltaRecordStreamWriter<DestStreamT>::GetSectionWriter(int section_num) {
+  auto& section_writer = section_writers_[section_num];
+  if (section_writer != nullptr) {
+    return section_writer.get();
+  }
+  section_writer = std::make_unique<SectionWriter>();
+  if (options_.temp_data_file_prefix.empty()) {
+    section_writer->stream = std::make_unique<std::stringstream>();
+  } else {
+    section_writer->temp_data_file = absl::StrCat(
+        options_.temp_data_file_prefix, ".section", section_num);
+    auto file_stream = std::make_unique<std::fstream>(
+        section_writer->temp_data_file,
+        std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!file_stream->is_open()) {
+      return absl::InternalError(absl::StrCat(
+          "Failed to open temporary section file: ",
+          section_writer->temp_data_file));
+    }
+    section_writer->stream = std::move(file_stream);
+  }
+  riegeli::RecordWriterBase::Options writer_options;
+  if (!options_.enable_compression) {
+    writer_options.set_uncompressed();
+  }
+  section_writer->record_writer = std::make_unique<
+      riegeli::RecordWriter<riegeli::OStreamWriter<std::iostream*>>>(
+      riegeli::OStreamWriter<std::iostream*>(section_writer->stream.get()),
+      std::move(writer_options));
+  return section_writer.get();
+}
+
 template <typename DestStreamT>
 absl::Status DeltaRecordStreamWriter<DestStreamT>::WriteRecord(
     const DataRecordStruct& data_record) {
+  if (HasShardIndex()) {
+    int section_num = options_.num_index_shards;
+    if (const auto* kv_record =
+            std::get_if<KeyValueMutationRecordStruct>(&data_record.record)) {
+      section_num = options_.index_key_sharder
+                        .GetShardNumForKey(kv_record->key,
+                                           options_.num_index_shards)
+                        .shard_num;
+    }
+    auto section_writer = GetSectionWriter(section_num);
+    if (!section_writer.ok()) {
+      if (options_.recovery_function) {
+        options_.recovery_function(data_record);
+      }
+      return section_writer.status();
+    }
+    if (!(*section_writer)
+             ->record_writer->WriteRecord(
+                 ToStringView(ToFlatBufferBuilder(data_record)))) {
+      if (options_.recovery_function) {
+        options_.recovery_function(data_record);
+      }
+      return (*section_writer)->record_writer->status();
+    }
+    return record_writer_->status();
+  }
   if (!record_writer_->WriteRecord(
           ToStringView(ToFlatBufferBuilder(data_record))) &&
       options_.recovery_function) {
@@ -87,14 +209,81 @@ absl::Status DeltaRecordStreamWriter<DestStreamT>::WriteRecord(
   return record_writer_->status();
 }
 
+template <typename DestStreamT>
+absl::Status DeltaRecordStreamWriter<DestStreamT>::WriteShardSections() {
+  for (int section_num = 0; section_num < section_writers_.size();
+       section_num++) {
+    auto section_writer = std::move(section_writers_[section_num]);
+    if (section_writer == nullptr) {
+      continue;
+    }
+    if (!section_writer->record_writer->Close()) {
+      return section_writer->record_writer->status();
+    }
+    section_writer->stream->flush();
+    section_writer->stream->seekg(0);
+    // Flushing ends the current chunk, so the section starts at a chunk
+    // boundary and readers can seek straight to it.
+    if (!record_writer_->Flush()) {
+      return record_writer_->status();
+    }
+    const int64_t start_pos = record_writer_->pos().numeric();
+    riegeli::RecordReader<riegeli::IStreamReader<>> section_reader(
+        riegeli::IStreamReader<>(section_writer->stream.get()));
+    std::string_view record;
+    while (section_reader.ReadRecord(record)) {
+      if (!record_writer_->WriteRecord(record)) {
+        return record_writer_->status();
+      }
+    }
+    if (!section_reader.Close()) {
+      return section_reader.status();
+    }
+    if (!record_writer_->Flush()) {
+      return record_writer_->status();
+    }
+    auto* section = shard_index_.add_sections();
+    section->set_shard_num(
+        section_num < options_.num_index_shards ? section_num : -1);
+    section->set_start_pos(start_pos);
+    section->set_end_pos(record_writer_->pos().numeric());
+  }
+  return record_writer_->status();
+}
+
 template <typename DestStreamT>
 absl::Status DeltaRecordStreamWriter<DestStreamT>::Flush() {
+  if (HasShardIndex()) {
+    if (auto status = WriteShardSections(); !status.ok()) {
+      // Sections that were not copied out cannot be indexed, so the stream
+      // is failed instead of getting an index that misses records.
+      record_writer_->Fail(status);
+      return status;
+    }
+    return absl::OkStatus();
+  }
   if (!record_writer_->Flush()) {
     return record_writer_->status();
   }
   return absl::OkStatus();
 }
 
+template <typename DestStreamT>
+void DeltaRecordStreamWriter<DestStreamT>::Close() {
+  // A failed writer gets no index, `Status()` returns why it failed.
+  if (HasShardIndex() && record_writer_->ok()) {
+    if (auto status = Flush(); !status.ok()) {
+      LOG(ERROR) << "Failed to write shard sections: " << status;
+    } else {
+      // The index goes into its own chunk so that it never shares a chunk
+      // with records of a section.
+      record_writer_->Flush();
+      record_writer_->WriteRecord(ToShardIndexRecord(shard_index_));
+    }
+  }
+  record_writer_->Close();
+}
+
 }  // namespace kv_server
 
 #endif  // PUBLIC_DATA_LOADING_WRITERS_DELTA_RECORD_STREAM_WRITER_H_
@@ -16,9 +16,14 @@
 
 #include "public/data_loading/writers/delta_record_stream_writer.h"
 
+#include <atomic>
+#include <filesystem>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
 #include "public/data_loading/data_loading_generated.h"
 #include "public/data_loading/readers/riegeli_stream_io.h"
@@ -68,6 +73,16 @@ KeyValueMutationRecordStruct GetDeltaSetRecord() {
   return record;
 }
 
+// Holds a stream that can be used to read `blob` contents.
+class StringBlobStream : public RecordStream {
+ public:
+  explicit StringBlobStream(const std::string& blob) : stream_(blob) {}
+  std::istream& Stream() { return stream_; }
+
+ private:
+  std::stringstream stream_;
+};
+
 class DeltaRecordStreamWriterTest
     : public testing::TestWithParam<DeltaRecordWriter::Options> {
  protected:
@@ -198,5 +213,165 @@ TEST(DeltaRecordStreamWriterTest, ValidateWritingFailsAfterClose) {
   EXPECT_FALSE(status.ok());
 }
 
+TEST(DeltaRecordStreamWriterTest, ReadsOnlyIndexedShardSections) {
+  kv_server::InitMetricsContextMap();
+  constexpr int kNumShards = 2;
+  constexpr int kNumKeys = 100;
+  std::stringstream string_stream;
+  DeltaRecordWriter::Options options{.metadata = GetMetadata(),
+                                     .num_index_shards = kNumShards};
+  const KeySharder key_sharder = options.index_key_sharder;
+  auto record_writer = DeltaRecordStreamWriter<std::stringstream>::Create(
+      string_stream, std::move(options));
+  ASSERT_TRUE(record_writer.ok());
+  std::vector<std::string> keys;
+  for (int i = 0; i < kNumKeys; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    KeyValueMutationRecordStruct kv_record = GetKeyValueMutationRecord();
+    kv_record.key = keys.back();
+    EXPECT_TRUE((*record_writer)->WriteRecord(GetDataRecord(kv_record)).ok());
+  }
+  EXPECT_TRUE((*record_writer)
+                  ->WriteRecord(GetDataRecord(GetUserDefinedFunctionsConfig()))
+                  .ok());
+  (*record_writer)->Close();
+  const std::string content = string_stream.str();
+
+  int total_keys_read = 0;
+  for (int shard_num = 0; shard_num < kNumShards; shard_num++) {
+    ConcurrentStreamRecordReader<std::string_view> record_reader(
+        [&content]() { return std::make_unique<StringBlobStream>(content); },
+        {.num_worker_threads = 2, .min_shard_size_bytes = 1});
+    auto restricted = record_reader.RestrictToShard(shard_num, kNumShards);
+    ASSERT_TRUE(restricted.ok()) << restricted.status();
+    EXPECT_TRUE(*restricted);
+    std::atomic<int> num_udf_configs_read = 0;
+    std::atomic<int> num_keys_read = 0;
+    auto status = record_reader.ReadStreamRecords(
+        [&](std::string_view record_string) {
+          return DeserializeDataRecord(
+              record_string, [&](const DataRecordStruct& data_record) {
+                if (const auto* kv_record =
+                        std::get_if<KeyValueMutationRecordStruct>(
+                            &data_record.record)) {
+                  EXPECT_EQ(key_sharder
+                                .GetShardNumForKey(kv_record->key, kNumShards)
+                                .shard_num,
+                            shard_num);
+                  num_keys_read++;
+                } else {
+                  num_udf_configs_read++;
+                }
+                return absl::OkStatus();
+              });
+        });
+    EXPECT_TRUE(status.ok()) << status;
+    EXPECT_EQ(num_udf_configs_read.load(), 1);
+    total_keys_read += num_keys_read.load();
+  }
+  EXPECT_EQ(total_keys_read, kNumKeys);
+
+  // Readers that do not use the index still see every record but the index.
+  std::stringstream read_stream(content);
+  auto stream_reader =
+      RiegeliStreamRecordReaderFactory().CreateReader(read_stream);
+  int num_records_read = 0;
+  EXPECT_TRUE(stream_reader
+                  ->ReadStreamRecords([&num_records_read](std::string_view) {
+                    num_records_read++;
+                    return absl::OkStatus();
+                  })
+                  .ok());
+  EXPECT_EQ(num_records_read, kNumKeys + 1);
+}
+
+TEST(DeltaRecordStreamWriterTest, RecordsShardingKeyOfShardIndex) {
+  kv_server::InitMetricsContextMap();
+  std::stringstream string_stream;
+  auto record_writer = DeltaRecordStreamWriter<std::stringstream>::Create(
+      string_stream,
+      DeltaRecordWriter::Options{
+          .metadata = GetMetadata(),
+          .num_index_shards = 2,
+          .index_key_sharder = KeySharder(
+              ShardingFunction(/*seed=*/""),
+              ShardingKeyDelimiter{.delimiter = "_"}),
+      });
+  ASSERT_TRUE(record_writer.ok());
+  EXPECT_TRUE(
+      (*record_writer)->WriteRecord(GetDataRecord(GetKeyValueMutationRecord()))
+          .ok());
+  (*record_writer)->Close();
+  const std::string content = string_stream.str();
+  ConcurrentStreamRecordReader<std::string_view> record_reader(
+      [&content]() { return std::make_unique<StringBlobStream>(content); });
+  auto metadata = record_reader.GetKVFileMetadata();
+  ASSERT_TRUE(metadata.ok()) << metadata.status();
+  EXPECT_EQ(metadata->sharding_metadata().num_index_shards(), 2);
+  EXPECT_EQ(metadata->sharding_metadata().sharding_key_delimiter(), "_");
+  EXPECT_FALSE(metadata->sharding_metadata().has_sharding_key_regex());
+}
+
+TEST(DeltaRecordStreamWriterTest, WritesShardSectionsThroughTemporaryFiles) {
+  kv_server::InitMetricsContextMap();
+  constexpr int kNumKeys = 10;
+  const std::string temp_data_file_prefix =
+      std::filesystem::path(::testing::TempDir()) / "delta_sections";
+  std::stringstream string_stream;
+  auto record_writer = DeltaRecordStreamWriter<std::stringstream>::Create(
+      string_stream,
+      DeltaRecordWriter::Options{.metadata = GetMetadata(),
+                                 .num_index_shards = 2,
+                                 .temp_data_file_prefix =
+                                     temp_data_file_prefix});
+  ASSERT_TRUE(record_writer.ok());
+  for (int i = 0; i < kNumKeys; i++) {
+    KeyValueMutationRecordStruct kv_record = GetKeyValueMutationRecord();
+    const std::string key = absl::StrCat("key", i);
+    kv_record.key = key;
+    EXPECT_TRUE((*record_writer)->WriteRecord(GetDataRecord(kv_record)).ok());
+  }
+  EXPECT_TRUE(std::filesystem::exists(temp_data_file_prefix + ".section0") ||
+              std::filesystem::exists(temp_data_file_prefix + ".section1"));
+  (*record_writer)->Close();
+  EXPECT_FALSE(std::filesystem::exists(temp_data_file_prefix + ".section0"));
+  EXPECT_FALSE(std::filesystem::exists(temp_data_file_prefix + ".section1"));
+
+  std::stringstream read_stream(string_stream.str());
+  auto stream_reader =
+      RiegeliStreamRecordReaderFactory().CreateReader(read_stream);
+  int num_records_read = 0;
+  EXPECT_TRUE(stream_reader
+                  ->ReadStreamRecords([&num_records_read](std::string_view) {
+                    num_records_read++;
+                    return absl::OkStatus();
+                  })
+                  .ok());
+  EXPECT_EQ(num_records_read, kNumKeys);
+}
+
+TEST(DeltaRecordStreamWriterTest, RecoversRecordsOfUnwritableShardSections) {
+  kv_server::InitMetricsContextMap();
+  std::stringstream string_stream;
+  int num_recovered_records = 0;
+  auto record_writer = DeltaRecordStreamWriter<std::stringstream>::Create(
+      string_stream,
+      DeltaRecordWriter::Options{
+          .recovery_function =
+              [&num_recovered_records](const DataRecordStruct&) {
+                num_recovered_records++;
+              },
+          .metadata = GetMetadata(),
+          .num_index_shards = 2,
+          .temp_data_file_prefix =
+              std::filesystem::path(::testing::TempDir()) / "missing_dir" /
+              "delta_sections"});
+  ASSERT_TRUE(record_writer.ok());
+  EXPECT_FALSE(
+      (*record_writer)->WriteRecord(GetDataRecord(GetKeyValueMutationRecord()))
+          .ok());
+  EXPECT_EQ(num_recovered_records, 1);
+}
+
 }  // namespace
 }  // namespace kv_server
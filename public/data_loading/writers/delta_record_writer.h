@@ -18,11 +18,13 @@
 #define PUBLIC_DATA_LOADING_WRITERS_DELTA_RECORD_WRITER_H_
 
 #include <functional>
+#include <string>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "public/data_loading/records_utils.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/sharding/key_sharder.h"
 
 namespace kv_server {
 
@@ -56,6 +58,17 @@ class DeltaRecordWriter {
 
     // Metadata required for delta files.
     KVFileMetadata metadata;
+
+    // If greater than 1, key value mutation records are grouped into
+    // per-shard sections using `index_key_sharder` and a shard index is
+    // written at the end of the file, so that servers can skip sections that
+    // belong to other shards. See `ShardingMetadata.num_index_shards`.
+    int32_t num_index_shards = 0;
+    KeySharder index_key_sharder = KeySharder(ShardingFunction(/*seed=*/""));
+    // Prefix of the temporary files, one per section, that records of a file
+    // with a shard index are written to until the sections are written out.
+    // If empty, the temporary sections are kept in memory.
+    std::string temp_data_file_prefix;
   };
   virtual ~DeltaRecordWriter() = default;
 
@@ -34,6 +34,7 @@
 #include "public/data_loading/riegeli_metadata.pb.h"
 #include "public/data_loading/writers/delta_record_stream_writer.h"
 #include "public/data_loading/writers/delta_record_writer.h"
+#include "public/sharding/key_sharder.h"
 
 namespace kv_server {
 
@@ -72,11 +73,17 @@ class SnapshotStreamWriter {
     // `SnapshotStreamWriter` is created and initialized.
     KVFileMetadata metadata;
     // File used to store temporary data generated when writing records or
-    // record streams to the output snapshot stream. If empty, then snapshot
-    // generation is done completely in memory.
+    // record streams to the output snapshot stream, also used as the prefix
+    // of temporary shard sections. If empty, then snapshot generation is done
+    // completely in memory.
     std::string temp_data_file;
     // Whether to compress the snapshot stream or not.
     bool compress_snapshot;
+    // If greater than 1, records are grouped into per-shard sections with a
+    // shard index so that servers can skip sections of other shards. See
+    // `DeltaRecordWriter::Options::num_index_shards`.
+    int32_t num_index_shards = 0;
+    KeySharder index_key_sharder = KeySharder(ShardingFunction(/*seed=*/""));
   };
 
   ~SnapshotStreamWriter();
@@ -124,6 +131,11 @@ class SnapshotStreamWriter {
   Options options_;
   bool is_finalized_ = false;
   std::unique_ptr<UserDefinedFunctionsConfigStruct> udf_config_;
+  // Owns the bytes of the latest compression dictionary record, whose struct
+  // only holds a view.
+  std::string compression_dictionary_;
+  std::unique_ptr<CompressionDictionaryRecordStruct>
+      compression_dictionary_record_;
 };
 
 template <typename DestStreamT>
@@ -194,6 +206,9 @@ SnapshotStreamWriter<DestStreamT>::CreateDeltaRecordWriterOptions(
                           "No KeyValueMutation or UdfConfig specified. ";
           },
       .metadata = options.metadata,
+      .num_index_shards = options.num_index_shards,
+      .index_key_sharder = options.index_key_sharder,
+      .temp_data_file_prefix = options.temp_data_file,
   };
 }
 
@@ -226,6 +241,23 @@ absl::Status SnapshotStreamWriter<DestStreamT>::InsertOrUpdateRecord(
     }
     return absl::OkStatus();
   }
+  if (std::holds_alternative<CompressionDictionaryRecordStruct>(
+          data_record.record)) {
+    const auto& dictionary_record =
+        std::get<CompressionDictionaryRecordStruct>(data_record.record);
+    if (compression_dictionary_record_ == nullptr ||
+        compression_dictionary_record_->logical_commit_time <
+            dictionary_record.logical_commit_time) {
+      compression_dictionary_ = std::string(dictionary_record.dictionary);
+      compression_dictionary_record_ =
+          std::make_unique<CompressionDictionaryRecordStruct>(
+              CompressionDictionaryRecordStruct{
+                  .dictionary = compression_dictionary_,
+                  .logical_commit_time =
+                      dictionary_record.logical_commit_time});
+    }
+    return absl::OkStatus();
+  }
   return absl::OkStatus();
 }
 
@@ -292,9 +324,23 @@ absl::Status SnapshotStreamWriter<DestStreamT>::Finalize() {
       return status;
     }
   }
+  if (compression_dictionary_record_ != nullptr) {
+    if (absl::Status status = record_writer_->WriteRecord(
+            DataRecordStruct{.record = *compression_dictionary_record_});
+        !status.ok()) {
+      return status;
+    }
+  }
   if (absl::Status status = record_writer_->Flush(); !status.ok()) {
     return status;
   }
+  if (options_.num_index_shards > 1) {
+    // The shard index is only written when the writer is closed.
+    record_writer_->Close();
+    if (absl::Status status = record_writer_->Status(); !status.ok()) {
+      return status;
+    }
+  }
   is_finalized_ = true;
   return absl::OkStatus();
 }
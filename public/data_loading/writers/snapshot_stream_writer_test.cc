@@ -17,6 +17,9 @@
 #include "public/data_loading/writers/snapshot_stream_writer.h"
 
 #include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/str_format.h"
 #include "gmock/gmock.h"
@@ -342,6 +345,36 @@ TEST_P(SnapshotStreamWriterTest,
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST_P(SnapshotStreamWriterTest,
+       CompressionDictionary_UpdatesWithLargestCommitTimestampInSnapshot) {
+  std::stringstream dest_stream;
+  auto snapshot_writer =
+      SnapshotStreamWriterTest::CreateSnapshotWriter(dest_stream);
+  EXPECT_TRUE(snapshot_writer.ok()) << snapshot_writer.status();
+  for (const auto& [dictionary, logical_commit_time] :
+       std::vector<std::pair<std::string, int64_t>>{
+           {"old", 1}, {"new", 3}, {"stale", 2}}) {
+    auto status =
+        (*snapshot_writer)
+            ->WriteRecord(GetDataRecord(CompressionDictionaryRecordStruct{
+                .dictionary = dictionary,
+                .logical_commit_time = logical_commit_time}));
+    EXPECT_TRUE(status.ok()) << status;
+  }
+  auto status = (*snapshot_writer)->Finalize();
+  EXPECT_TRUE(status.ok()) << status;
+
+  DeltaRecordStreamReader record_reader(dest_stream);
+  testing::MockFunction<absl::Status(DataRecordStruct)> record_callback;
+  EXPECT_CALL(record_callback,
+              Call(GetDataRecord(CompressionDictionaryRecordStruct{
+                  .dictionary = "new", .logical_commit_time = 3})))
+      .Times(1)
+      .WillOnce([](DataRecordStruct) { return absl::OkStatus(); });
+  status = record_reader.ReadRecords(record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
 TEST(SnapshotStreamWriterTest,
      ValidateCreatingSnapshotWriterWithValidMetadata) {
   std::stringstream dest_stream;
@@ -18,24 +18,46 @@
 
 namespace kv_server {
 
+KeySharder::KeySharder(ShardingFunction sharding_function)
+    : sharding_function_(std::move(sharding_function)) {}
+
+KeySharder::KeySharder(ShardingFunction sharding_function,
+                       ShardingKeyRegex shard_key_regex)
+    : sharding_function_(std::move(sharding_function)),
+      shard_key_regex_pattern_(std::move(shard_key_regex.pattern)),
+      // https://en.cppreference.com/w/cpp/regex/syntax_option_type
+      // optimize -- "Instructs the regular expression engine to make matching
+      // faster, with the potential cost of making construction slower. For
+      // example, this might mean converting a non-deterministic FSA to a
+      // deterministic FSA." this matches our usecase.
+      shard_key_regex_(std::regex(shard_key_regex_pattern_,
+                                  std::regex_constants::optimize)) {}
+
 KeySharder::KeySharder(ShardingFunction sharding_function,
-                       std::optional<std::regex> shard_key_regex)
+                       ShardingKeyDelimiter shard_key_delimiter)
     : sharding_function_(std::move(sharding_function)),
-      shard_key_regex_(std::move(shard_key_regex)) {}
+      shard_key_delimiter_(std::move(shard_key_delimiter.delimiter)) {}
 
 Shard KeySharder::GetShardNumForKey(std::string_view key,
                                     int num_shards) const {
-  if (shard_key_regex_.has_value()) {
-    std::smatch match_result;
-    // regex doesn't support string_view yet, though there is a proposal
-    auto key_string = std::string(key);
-    if (std::regex_match(key_string, match_result, shard_key_regex_.value())) {
-      // match result doesn't implicitly convert to std::string_view, and we
-      // also need to return it, so that the caller can log it.
-      std::string sharding_key = std::move(match_result[1]);
+  if (!shard_key_delimiter_.empty()) {
+    if (const auto pos = key.find(shard_key_delimiter_);
+        pos != std::string_view::npos) {
+      std::string_view sharding_key = key.substr(0, pos);
+      return Shard{.shard_num = sharding_function_.GetShardNumForKey(
+                       sharding_key, num_shards),
+                   .sharding_key = std::string(sharding_key)};
+    }
+  } else if (shard_key_regex_.has_value()) {
+    // Matches the key in place instead of copying it into a std::string.
+    std::cmatch match_result;
+    if (std::regex_match(key.data(), key.data() + key.size(), match_result,
+                         shard_key_regex_.value())) {
+      std::string_view sharding_key(match_result[1].first,
+                                    match_result[1].length());
       return Shard{.shard_num = sharding_function_.GetShardNumForKey(
                        sharding_key, num_shards),
-                   .sharding_key = std::move(sharding_key)};
+                   .sharding_key = std::string(sharding_key)};
     }
   }
   return Shard{.shard_num =
@@ -36,26 +36,57 @@ struct Shard {
   std::string sharding_key;
 };
 
+// Extracts the sharding key as the first capture group of `pattern` when the
+// whole key matches it, e.g., "user1" for "user1_clicks" with "(.*)_.*".
+struct ShardingKeyRegex {
+  std::string pattern;
+};
+
+// Extracts the sharding key as the part of a key before the first occurrence
+// of `delimiter`, e.g., "user1" for "user1_clicks" with delimiter "_". Much
+// cheaper than an equivalent regex. Must not be empty.
+struct ShardingKeyDelimiter {
+  std::string delimiter;
+};
+
 // Key sharder generates a shard number for a key. It might apply data
 // locality logic when doing so.
 class KeySharder {
  public:
   // Constructs a key sharder that would calculate a shard number.
-  // If `shard_key_regex` is set, data locality logic is applied during the
-  // calculation.
-  explicit KeySharder(ShardingFunction sharding_function,
-                      std::optional<std::regex> shard_key_regex = std::nullopt);
+  explicit KeySharder(ShardingFunction sharding_function);
+  // Constructs a key sharder that applies data locality logic based on
+  // `shard_key_regex`.
+  KeySharder(ShardingFunction sharding_function,
+             ShardingKeyRegex shard_key_regex);
+  // Constructs a key sharder that applies data locality logic based on
+  // `shard_key_delimiter`. Keys without the delimiter are sharded as is.
+  KeySharder(ShardingFunction sharding_function,
+             ShardingKeyDelimiter shard_key_delimiter);
   // Get a shard number for the given key.
-  // If `shard_key_regex` is set, data locality logic is applied during the
+  // If a sharding key regex is set, data locality logic is applied during the
   // calculation. Specifically, it would apply the regex to the key specified in
   // `GetShardNumForKey`. If there is a match, that would be treated as the
   // sharding key. Otherwise, the key itself is treated as the sharding
   // key.
   Shard GetShardNumForKey(std::string_view key, int num_shards) const;
+  ShardingFunctionVersion sharding_function_version() const {
+    return sharding_function_.version();
+  }
+  // Pattern of the sharding key regex, empty if not set.
+  const std::string& sharding_key_regex() const {
+    return shard_key_regex_pattern_;
+  }
+  // Sharding key delimiter, empty if not set.
+  const std::string& sharding_key_delimiter() const {
+    return shard_key_delimiter_;
+  }
 
  private:
   ShardingFunction sharding_function_;
+  std::string shard_key_regex_pattern_;
   std::optional<std::regex> shard_key_regex_;
+  std::string shard_key_delimiter_;
 };
 
 }  // namespace kv_server
@@ -31,7 +31,9 @@ TEST(KeySharderTest, VerifyAssigningKeysToShards) {
 
 TEST(KeySharderTest, VerifyAssigningKeysToShardsWithRegex) {
   ShardingFunction func("");
-  KeySharder key_sharder(func, std::regex("(.*)_.*"));
+  KeySharder key_sharder(func, ShardingKeyRegex{.pattern = "(.*)_.*"});
+  EXPECT_EQ("(.*)_.*", key_sharder.sharding_key_regex());
+  EXPECT_EQ("", key_sharder.sharding_key_delimiter());
   auto result = key_sharder.GetShardNumForKey("key1_blah", 7);
   EXPECT_EQ(5, result.shard_num);
   EXPECT_EQ("key1", result.sharding_key);
@@ -47,6 +49,32 @@ TEST(KeySharderTest, VerifyAssigningKeysToShardsWithRegex) {
   EXPECT_EQ(1, key_sharder.GetShardNumForKey("key3", 7).shard_num);
 }
 
+TEST(KeySharderTest, VerifyAssigningKeysToShardsWithDelimiter) {
+  ShardingFunction func("");
+  KeySharder key_sharder(func, ShardingKeyDelimiter{.delimiter = "_"});
+  EXPECT_EQ("", key_sharder.sharding_key_regex());
+  EXPECT_EQ("_", key_sharder.sharding_key_delimiter());
+  auto result = key_sharder.GetShardNumForKey("key1_blah", 7);
+  EXPECT_EQ(5, result.shard_num);
+  EXPECT_EQ("key1", result.sharding_key);
+  result = key_sharder.GetShardNumForKey("key1_blah_blah", 7);
+  EXPECT_EQ(5, result.shard_num);
+  EXPECT_EQ("key1", result.sharding_key);
+  // no delimiter -- the whole key is used
+  result = key_sharder.GetShardNumForKey("key2", 7);
+  EXPECT_EQ(6, result.shard_num);
+  EXPECT_EQ("", result.sharding_key);
+}
+
+TEST(KeySharderTest, VerifyShardingKeyWithHighwayHash) {
+  ShardingFunction func("", ShardingFunctionVersion::kHighwayHash);
+  KeySharder key_sharder(func, ShardingKeyDelimiter{.delimiter = "_"});
+  EXPECT_EQ(ShardingFunctionVersion::kHighwayHash,
+            key_sharder.sharding_function_version());
+  EXPECT_EQ(func.GetShardNumForKey("key1", 7),
+            key_sharder.GetShardNumForKey("key1_blah", 7).shard_num);
+}
+
 // try with regex which doesn't match
 
 }  // namespace
@@ -16,14 +16,59 @@
 
 #include "public/sharding/sharding_function.h"
 
+#include <algorithm>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+
 namespace kv_server {
+namespace {
+
+// Key used by `ShardingFunctionVersion::kHighwayHash` when the seed is empty.
+// Changing it reassigns every key to a different shard.
+constexpr uint64_t kDefaultHighwayHashKey[4] = {
+    0x6b76736572766572ULL, 0x7368617264696e67ULL, 0x6869676877617968ULL,
+    0x61736876316b6579ULL};
+
+// Mixes the seed bytes into the default key, so that different seeds give
+// different shard assignments. Independent of the host byte order.
+void InitHighwayHashKey(std::string_view seed, highwayhash::HHKey& key) {
+  std::copy(std::begin(kDefaultHighwayHashKey),
+            std::end(kDefaultHighwayHashKey), std::begin(key));
+  for (size_t i = 0; i < seed.size(); i++) {
+    key[(i / 8) % 4] ^= static_cast<uint64_t>(static_cast<uint8_t>(seed[i]))
+                        << (8 * (i % 8));
+  }
+}
 
-ShardingFunction::ShardingFunction(std::string seed)
-    : hash_function_(std::move(seed)) {}
+}  // namespace
+
+ShardingFunction::ShardingFunction(std::string seed,
+                                   ShardingFunctionVersion version)
+    : version_(version), hash_function_(seed) {
+  InitHighwayHashKey(seed, highway_hash_key_);
+}
 
 int ShardingFunction::GetShardNumForKey(std::string_view key,
                                         int num_shards) const {
-  return hash_function_(key, num_shards);
+  if (version_ == ShardingFunctionVersion::kSha256) {
+    return hash_function_(key, num_shards);
+  }
+  highwayhash::HHStateT<HH_TARGET> state(highway_hash_key_);
+  highwayhash::HHResult64 result;
+  highwayhash::HighwayHashT(&state, key.data(), key.size(), &result);
+  return result % num_shards;
+}
+
+absl::StatusOr<ShardingFunctionVersion> ToShardingFunctionVersion(
+    int32_t value) {
+  switch (static_cast<ShardingFunctionVersion>(value)) {
+    case ShardingFunctionVersion::kSha256:
+    case ShardingFunctionVersion::kHighwayHash:
+      return static_cast<ShardingFunctionVersion>(value);
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unknown sharding function version: %d", value));
 }
 
 }  // namespace kv_server
@@ -17,24 +17,48 @@
 #ifndef PUBLIC_SHARDING_SHARDING_FUNCTION_H_
 #define PUBLIC_SHARDING_SHARDING_FUNCTION_H_
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 
+#include "absl/status/statusor.h"
+#include "highwayhash/highwayhash.h"
 #include "pir/hashing/sha256_hash_family.h"
 
 namespace kv_server {
 
+// Versions of the hash function used to assign keys to shards. Data files and
+// servers must agree on the version for file level sharding to be valid, so
+// versions are only ever added, never changed.
+enum class ShardingFunctionVersion : int32_t {
+  // SHA256 based. Slow, but the default for compatibility with existing data.
+  kSha256 = 0,
+  // Keyed HighwayHash. Much cheaper per key than `kSha256`.
+  kHighwayHash = 1,
+};
+
 // Sharding function to assign different keys to shard numbers within the range
 // [0, `num_shards`).
 class ShardingFunction {
  public:
-  explicit ShardingFunction(std::string seed);
+  explicit ShardingFunction(
+      std::string seed,
+      ShardingFunctionVersion version = ShardingFunctionVersion::kSha256);
   int GetShardNumForKey(std::string_view key, int num_shards) const;
+  ShardingFunctionVersion version() const { return version_; }
 
  private:
+  ShardingFunctionVersion version_;
   distributed_point_functions::SHA256HashFunction hash_function_;
+  // Only used by `ShardingFunctionVersion::kHighwayHash`.
+  HH_ALIGNAS(32) highwayhash::HHKey highway_hash_key_;
 };
 
+// Returns the version for `value`, e.g., a parameter or file metadata value.
+// Unknown values are an error.
+absl::StatusOr<ShardingFunctionVersion> ToShardingFunctionVersion(
+    int32_t value);
+
 }  // namespace kv_server
 
 #endif  // PUBLIC_SHARDING_SHARDING_FUNCTION_H_
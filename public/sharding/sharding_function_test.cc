@@ -16,6 +16,9 @@
 
 #include "public/sharding/sharding_function.h"
 
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
 
 namespace kv_server {
@@ -28,5 +31,47 @@ TEST(ShardingFunctionTest, VerifyAssigningKeysToShards) {
   EXPECT_EQ(1, func.GetShardNumForKey("key3", 7));
 }
 
+TEST(ShardingFunctionTest, VerifyHighwayHashAssignsKeysToAllShards) {
+  constexpr int kNumShards = 7;
+  constexpr int kNumKeys = 7000;
+  ShardingFunction func("", ShardingFunctionVersion::kHighwayHash);
+  ShardingFunction same_func("", ShardingFunctionVersion::kHighwayHash);
+  std::vector<int> keys_per_shard(kNumShards, 0);
+  for (int i = 0; i < kNumKeys; i++) {
+    const auto key = absl::StrCat("key", i);
+    const int shard_num = func.GetShardNumForKey(key, kNumShards);
+    ASSERT_GE(shard_num, 0);
+    ASSERT_LT(shard_num, kNumShards);
+    EXPECT_EQ(shard_num, same_func.GetShardNumForKey(key, kNumShards));
+    keys_per_shard[shard_num]++;
+  }
+  for (int num_keys : keys_per_shard) {
+    EXPECT_GT(num_keys, kNumKeys / kNumShards / 2);
+  }
+}
+
+TEST(ShardingFunctionTest, VerifyHighwayHashDependsOnSeed) {
+  ShardingFunction func("", ShardingFunctionVersion::kHighwayHash);
+  ShardingFunction seeded_func("seed", ShardingFunctionVersion::kHighwayHash);
+  int num_different_shards = 0;
+  for (int i = 0; i < 100; i++) {
+    const auto key = absl::StrCat("key", i);
+    if (func.GetShardNumForKey(key, 1000) !=
+        seeded_func.GetShardNumForKey(key, 1000)) {
+      num_different_shards++;
+    }
+  }
+  EXPECT_GT(num_different_shards, 90);
+}
+
+TEST(ShardingFunctionTest, VerifyConvertingToShardingFunctionVersion) {
+  EXPECT_EQ(ShardingFunctionVersion::kSha256,
+            ToShardingFunctionVersion(0).value());
+  EXPECT_EQ(ShardingFunctionVersion::kHighwayHash,
+            ToShardingFunctionVersion(1).value());
+  EXPECT_FALSE(ToShardingFunctionVersion(2).ok());
+  EXPECT_FALSE(ToShardingFunctionVersion(-1).ok());
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -38,6 +38,9 @@ class MockStreamRecordReader : public StreamRecordReader {
       absl::Status, ReadStreamRecords,
       (const std::function<absl::Status(const std::string_view&)>& callback),
       (override));
+
+  MOCK_METHOD(absl::StatusOr<bool>, RestrictToShard,
+              (int32_t shard_num, int32_t num_shards), (override));
 };
 
 class MockStreamRecordReaderFactory : public StreamRecordReaderFactory {
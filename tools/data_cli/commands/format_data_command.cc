@@ -16,6 +16,8 @@
 
 #include "tools/data_cli/commands/format_data_command.h"
 
+#include <cstdlib>
+#include <filesystem>
 #include <memory>
 #include <utility>
 
@@ -24,12 +26,14 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "public/data_loading/csv/csv_delta_record_stream_reader.h"
 #include "public/data_loading/csv/csv_delta_record_stream_writer.h"
 #include "public/data_loading/readers/avro_delta_record_stream_reader.h"
 #include "public/data_loading/readers/delta_record_stream_reader.h"
 #include "public/data_loading/writers/avro_delta_record_stream_writer.h"
 #include "public/data_loading/writers/delta_record_stream_writer.h"
+#include "public/sharding/key_sharder.h"
 #include "public/sharding/sharding_function.h"
 #include "src/cpp/util/status_macro/status_macros.h"
 
@@ -72,9 +76,49 @@ absl::Status ValidateParams(const FormatDataCommand::Params& params) {
         ". Valid inputs must satisfy the requirement: 0 <= shard_number < "
         "number_of_shards"));
   }
+  if (auto version =
+          ToShardingFunctionVersion(params.sharding_function_version);
+      !version.ok()) {
+    return version.status();
+  }
+  if (params.num_index_shards < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("num_index_shards must not be negative, but is ",
+                     params.num_index_shards));
+  }
+  if (!params.sharding_key_regex.empty() &&
+      !params.sharding_key_delimiter.empty()) {
+    return absl::InvalidArgumentError(
+        "At most one of sharding_key_regex and sharding_key_delimiter can be "
+        "set.");
+  }
   return absl::OkStatus();
 }
 
+KeySharder CreateKeySharder(const FormatDataCommand::Params& params) {
+  ShardingFunction sharding_function(
+      /*seed=*/"", static_cast<ShardingFunctionVersion>(
+                       params.sharding_function_version));
+  if (!params.sharding_key_regex.empty()) {
+    return KeySharder(std::move(sharding_function),
+                      ShardingKeyRegex{.pattern = params.sharding_key_regex});
+  }
+  if (!params.sharding_key_delimiter.empty()) {
+    return KeySharder(
+        std::move(sharding_function),
+        ShardingKeyDelimiter{.delimiter = params.sharding_key_delimiter});
+  }
+  return KeySharder(std::move(sharding_function));
+}
+
+std::string GetTempSectionsFilePrefix(const FormatDataCommand::Params& params) {
+  if (params.working_dir.empty()) {
+    return "";
+  }
+  return std::filesystem::path(params.working_dir) /
+         absl::StrFormat("DeltaSections.%d", std::rand());
+}
+
 absl::StatusOr<DataRecordType> GetRecordType(std::string_view record_type) {
   std::string lw_record_type = absl::AsciiStrToLower(record_type);
   if (lw_record_type == kKeyValueMutationRecord) {
@@ -164,9 +208,17 @@ absl::StatusOr<std::unique_ptr<DeltaRecordWriter>> CreateRecordWriter(
     if (params.shard_number >= 0) {
       auto* shard_metadata = metadata.mutable_sharding_metadata();
       shard_metadata->set_shard_num(params.shard_number);
+      shard_metadata->set_sharding_function_version(
+          params.sharding_function_version);
     }
     return DeltaRecordStreamWriter<std::ostream>::Create(
-        output_stream, DeltaRecordWriter::Options{.metadata = metadata});
+        output_stream,
+        DeltaRecordWriter::Options{
+            .metadata = metadata,
+            .num_index_shards = params.num_index_shards,
+            .index_key_sharder = CreateKeySharder(params),
+            .temp_data_file_prefix = GetTempSectionsFilePrefix(params),
+        });
   }
   if (lw_output_format == kAvroFormat) {
     auto delta_record_writer = AvroDeltaRecordStreamWriter::Create(
@@ -203,16 +255,20 @@ absl::StatusOr<std::unique_ptr<FormatDataCommand>> FormatDataCommand::Create(
 absl::Status FormatDataCommand::Execute() {
   LOG(INFO) << "Formatting records ...";
   int64_t records_count = 0;
-  ShardingFunction sharding_function(/*seed=*/"");
+  const KeySharder key_sharder = CreateKeySharder(params_);
   absl::Status status = record_reader_->ReadRecords([&records_count,
-                                                     &sharding_function,
+                                                     &key_sharder,
                                                      this](const DataRecord&
                                                                data_record) {
     if (params_.shard_number >= 0 &&
         data_record.record_type() == Record::KeyValueMutationRecord) {
-      auto record_shard_num = sharding_function.GetShardNumForKey(
-          data_record.record_as_KeyValueMutationRecord()->key()->string_view(),
-          params_.number_of_shards);
+      auto record_shard_num =
+          key_sharder
+              .GetShardNumForKey(data_record.record_as_KeyValueMutationRecord()
+                                     ->key()
+                                     ->string_view(),
+                                 params_.number_of_shards)
+              .shard_num;
       if (params_.shard_number != record_shard_num) {
         LOG(INFO) << "Skipping record with key: "
                   << data_record.record_as_KeyValueMutationRecord()
@@ -238,6 +294,10 @@ absl::Status FormatDataCommand::Execute() {
           return status;
         });
   });
+  if (status.ok()) {
+    // Sections of deltas with a shard index are only written out on flush.
+    status = record_writer_->Flush();
+  }
   record_writer_->Close();
   if (status.ok()) {
     LOG(INFO) << "Sucessfully formated records.";
@@ -63,6 +63,20 @@ class FormatDataCommand : public Command {
     std::string csv_encoding = "PLAINTEXT";
     int64_t shard_number = -1;
     int64_t number_of_shards = -1;
+    // See `ShardingFunctionVersion`.
+    int32_t sharding_function_version = 0;
+    // If greater than 1, DELTA output is grouped into per-shard sections with
+    // a shard index. See `DeltaRecordWriter::Options::num_index_shards`.
+    int32_t num_index_shards = 0;
+    // If set, keys are sharded by the first capture group of this regex, like
+    // on servers with the same sharding-key-regex parameter.
+    std::string sharding_key_regex;
+    // If set, keys are sharded by their part before this delimiter, like on
+    // servers with the same sharding-key-delimiter parameter.
+    std::string sharding_key_delimiter;
+    // Directory for temporary shard sections. If empty, they are kept in
+    // memory.
+    std::string working_dir;
   };
 
   static absl::StatusOr<std::unique_ptr<FormatDataCommand>> Create(
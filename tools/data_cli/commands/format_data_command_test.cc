@@ -499,5 +499,72 @@ TEST(FormatDataCommandTest, ValidateIncorrectShardingMetadataParams) {
       << status;
 }
 
+TEST(FormatDataCommandTest, ValidateGeneratingCsvToDeltaDataWithShardIndex) {
+  std::stringstream csv_stream;
+  std::stringstream delta_stream;
+  CsvDeltaRecordStreamWriter csv_writer(csv_stream);
+  const auto& record = GetDataRecord(GetKVMutationRecord());
+  EXPECT_TRUE(csv_writer.WriteRecord(record).ok());
+  EXPECT_TRUE(csv_writer.WriteRecord(record).ok());
+  csv_writer.Close();
+  auto params = GetParams();
+  params.num_index_shards = 2;
+  params.sharding_key_regex = "(.*)_.*";
+  auto command = FormatDataCommand::Create(params, csv_stream, delta_stream);
+  EXPECT_TRUE(command.ok()) << command.status();
+  EXPECT_TRUE((*command)->Execute().ok());
+  DeltaRecordStreamReader delta_reader(delta_stream);
+  auto metadata = delta_reader.ReadMetadata();
+  ASSERT_TRUE(metadata.ok()) << metadata.status();
+  EXPECT_EQ(metadata->sharding_metadata().num_index_shards(), 2);
+  EXPECT_EQ(metadata->sharding_metadata().sharding_key_regex(), "(.*)_.*");
+  testing::MockFunction<absl::Status(DataRecordStruct)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .Times(2)
+      .WillRepeatedly([&record](DataRecordStruct actual_record) {
+        EXPECT_EQ(actual_record, record);
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(delta_reader.ReadRecords(record_callback.AsStdFunction()).ok());
+}
+
+TEST(FormatDataCommandTest, ValidateShardIndexRecordsShardingKeyDelimiter) {
+  std::stringstream csv_stream;
+  std::stringstream delta_stream;
+  CsvDeltaRecordStreamWriter csv_writer(csv_stream);
+  EXPECT_TRUE(
+      csv_writer.WriteRecord(GetDataRecord(GetKVMutationRecord())).ok());
+  csv_writer.Close();
+  auto params = GetParams();
+  params.num_index_shards = 2;
+  params.sharding_key_delimiter = "_";
+  auto command = FormatDataCommand::Create(params, csv_stream, delta_stream);
+  EXPECT_TRUE(command.ok()) << command.status();
+  EXPECT_TRUE((*command)->Execute().ok());
+  auto metadata = DeltaRecordStreamReader(delta_stream).ReadMetadata();
+  ASSERT_TRUE(metadata.ok()) << metadata.status();
+  EXPECT_EQ(metadata->sharding_metadata().sharding_key_delimiter(), "_");
+  EXPECT_FALSE(metadata->sharding_metadata().has_sharding_key_regex());
+}
+
+TEST(FormatDataCommandTest, ValidateIncorrectShardingKeyParams) {
+  std::stringstream unused_stream;
+  auto params = GetParams();
+  params.sharding_key_regex = "(.*)_.*";
+  params.sharding_key_delimiter = "_";
+  absl::Status status =
+      FormatDataCommand::Create(params, unused_stream, unused_stream).status();
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument) << status;
+}
+
+TEST(FormatDataCommandTest, ValidateIncorrectNumIndexShardsParams) {
+  std::stringstream unused_stream;
+  auto params = GetParams();
+  params.num_index_shards = -1;
+  absl::Status status =
+      FormatDataCommand::Create(params, unused_stream, unused_stream).status();
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument) << status;
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -35,6 +35,7 @@
 #include "public/data_loading/filename_utils.h"
 #include "public/data_loading/readers/delta_record_stream_reader.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/sharding/key_sharder.h"
 #include "public/sharding/sharding_function.h"
 #include "src/cpp/telemetry/telemetry_provider.h"
 
@@ -89,9 +90,41 @@ absl::Status ValidateRequiredParams(GenerateSnapshotCommand::Params& params) {
         ". Valid inputs must satisfy the requirement: 0 <= shard_number < "
         "number_of_shards"));
   }
+  if (auto version =
+          ToShardingFunctionVersion(params.sharding_function_version);
+      !version.ok()) {
+    return version.status();
+  }
+  if (params.num_index_shards < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("num_index_shards must not be negative, but is ",
+                     params.num_index_shards));
+  }
+  if (!params.sharding_key_regex.empty() &&
+      !params.sharding_key_delimiter.empty()) {
+    return absl::InvalidArgumentError(
+        "At most one of sharding_key_regex and sharding_key_delimiter can be "
+        "set.");
+  }
   return absl::OkStatus();
 }
 
+KeySharder CreateKeySharder(const GenerateSnapshotCommand::Params& params) {
+  ShardingFunction sharding_function(
+      /*seed=*/"", static_cast<ShardingFunctionVersion>(
+                       params.sharding_function_version));
+  if (!params.sharding_key_regex.empty()) {
+    return KeySharder(std::move(sharding_function),
+                      ShardingKeyRegex{.pattern = params.sharding_key_regex});
+  }
+  if (!params.sharding_key_delimiter.empty()) {
+    return KeySharder(
+        std::move(sharding_function),
+        ShardingKeyDelimiter{.delimiter = params.sharding_key_delimiter});
+  }
+  return KeySharder(std::move(sharding_function));
+}
+
 std::filesystem::path GetTempAggregatorDbFile(
     const GenerateSnapshotCommand::Params& params) {
   auto filename = std::filesystem::path(params.working_dir) /
@@ -121,6 +154,8 @@ absl::StatusOr<KVFileMetadata> CreateSnapshotMetadata(
   if (params.shard_number >= 0) {
     auto* sharding_metadata = metadata.mutable_sharding_metadata();
     sharding_metadata->set_shard_num(params.shard_number);
+    sharding_metadata->set_sharding_function_version(
+        params.sharding_function_version);
   }
   return metadata;
 }
@@ -134,17 +169,18 @@ absl::Status WriteRecordsToSnapshotStream(
     const GenerateSnapshotCommand::Params& params,
     DeltaRecordStreamReader<std::istream>& record_reader,
     SnapshotStreamWriter<std::ostream>& snapshot_writer) {
-  ShardingFunction sharding_function(/*seed=*/"");
+  const KeySharder key_sharder = CreateKeySharder(params);
   return record_reader.ReadRecords(
-      [&params, &snapshot_writer,
-       &sharding_function](DataRecordStruct data_record) {
+      [&params, &snapshot_writer, &key_sharder](DataRecordStruct data_record) {
         if (params.shard_number >= 0 &&
             std::holds_alternative<KeyValueMutationRecordStruct>(
                 data_record.record)) {
           KeyValueMutationRecordStruct record_struct =
               std::get<KeyValueMutationRecordStruct>(data_record.record);
-          auto record_shard_num = sharding_function.GetShardNumForKey(
-              record_struct.key, params.number_of_shards);
+          auto record_shard_num =
+              key_sharder
+                  .GetShardNumForKey(record_struct.key, params.number_of_shards)
+                  .shard_num;
           if (params.shard_number != record_shard_num) {
             LOG(INFO) << "Skipping record with key: " << record_struct.key
                       << " . The record belongs to shard: " << record_shard_num
@@ -246,7 +282,9 @@ absl::Status GenerateSnapshotCommand::Execute() {
       {.metadata = *snapshot_metadata,
        .temp_data_file = params_.in_memory_compaction
                              ? ""
-                             : GetTempAggregatorDbFile(params_)},
+                             : GetTempAggregatorDbFile(params_),
+       .num_index_shards = params_.num_index_shards,
+       .index_key_sharder = CreateKeySharder(params_)},
       *snapshot_ostream);
   if (!snapshot_writer.ok()) {
     return snapshot_writer.status();
@@ -39,6 +39,17 @@ class GenerateSnapshotCommand : public Command {
     bool in_memory_compaction;
     int64_t shard_number = -1;
     int64_t number_of_shards = -1;
+    // See `ShardingFunctionVersion`.
+    int32_t sharding_function_version = 0;
+    // If greater than 1, the snapshot is grouped into per-shard sections with
+    // a shard index. See `DeltaRecordWriter::Options::num_index_shards`.
+    int32_t num_index_shards = 0;
+    // If set, keys are sharded by the first capture group of this regex, like
+    // on servers with the same sharding-key-regex parameter.
+    std::string sharding_key_regex;
+    // If set, keys are sharded by their part before this delimiter, like on
+    // servers with the same sharding-key-delimiter parameter.
+    std::string sharding_key_delimiter;
   };
 
   ~GenerateSnapshotCommand();
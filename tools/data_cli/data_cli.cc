@@ -68,6 +68,20 @@ ABSL_FLAG(int64_t, shard_number, -1,
 ABSL_FLAG(
     int64_t, number_of_shards, -1,
     "Total number of shards. Must be > --shard_number if shard_number >= 0.");
+ABSL_FLAG(int32_t, sharding_function_version, 0,
+          "Version of the function used to assign keys to shards. Must match "
+          "the sharding-function-version parameter of the servers. Possible "
+          "options=(0 (SHA256)|1 (HIGHWAYHASH)).");
+ABSL_FLAG(int32_t, num_index_shards, 0,
+          "If > 1, output DELTA or SNAPSHOT files are grouped into this many "
+          "per-shard sections with a shard index, so that servers with this "
+          "many shards only read their own section.");
+ABSL_FLAG(std::string, sharding_key_regex, "",
+          "If set, keys are sharded by the first capture group of this regex. "
+          "Must match the sharding-key-regex parameter of the servers.");
+ABSL_FLAG(std::string, sharding_key_delimiter, "",
+          "If set, keys are sharded by their part before this delimiter. Must "
+          "match the sharding-key-delimiter parameter of the servers.");
 
 constexpr std::string_view kUsageMessage = R"(
 Usage: data_cli <command> <flags>
@@ -87,6 +101,11 @@ Commands:
                                   If the values are binary, BASE64 is recommended.
     [--shard_number]     (Optional) Defaults to -1 (i.e., not specified).
     [--number_of_shards] (Optional) Defaults to -1 (i.e., not specified). Must be > --shard_number if shard_number >= 0.
+    [--sharding_function_version] (Optional) Defaults to 0 (SHA256). Possible options=(0|1).
+    [--num_index_shards] (Optional) Defaults to 0. If > 1, DELTA output is grouped into per-shard sections with a shard index.
+    [--sharding_key_regex] (Optional) Defaults to "". Must match the sharding-key-regex parameter of the servers.
+    [--sharding_key_delimiter] (Optional) Defaults to "". Must match the sharding-key-delimiter parameter of the servers.
+    [--working_dir]      (Optional) Defaults to "/tmp". Directory used to write temporary shard sections.
   Examples:
     (1) Generate a csv file to a delta file and write output records to std::cout.
     - data_cli format_data --input_file="$PWD/data.csv"
@@ -110,6 +129,10 @@ Commands:
     [--in_memory_compaction]    (Optional) Defaults to true. If false, file backed compaction is used.
     [--shard_number]            (Optional) Defaults to -1 (i.e., not specified).
     [--number_of_shards]        (Optional) Defaults to -1 (i.e., not specified). Must be > --shard_number if shard_number >= 0.
+    [--sharding_function_version] (Optional) Defaults to 0 (SHA256). Possible options=(0|1).
+    [--num_index_shards]        (Optional) Defaults to 0. If > 1, the snapshot is grouped into per-shard sections with a shard index.
+    [--sharding_key_regex]      (Optional) Defaults to "". Must match the sharding-key-regex parameter of the servers.
+    [--sharding_key_delimiter]  (Optional) Defaults to "". Must match the sharding-key-delimiter parameter of the servers.
   Examples:
     (1) Generate snapshot using delta files from local disk.
     - data_cli generate_snapshot --data_dir="$DATA_DIR" --starting_file="DELTA_1670532228628680" \
@@ -179,6 +202,13 @@ int main(int argc, char** argv) {
             .csv_encoding = absl::GetFlag(FLAGS_csv_encoding),
             .shard_number = absl::GetFlag(FLAGS_shard_number),
             .number_of_shards = absl::GetFlag(FLAGS_number_of_shards),
+            .sharding_function_version =
+                absl::GetFlag(FLAGS_sharding_function_version),
+            .num_index_shards = absl::GetFlag(FLAGS_num_index_shards),
+            .sharding_key_regex = absl::GetFlag(FLAGS_sharding_key_regex),
+            .sharding_key_delimiter =
+                absl::GetFlag(FLAGS_sharding_key_delimiter),
+            .working_dir = absl::GetFlag(FLAGS_working_dir),
         },
         *i_stream, *o_stream);
     if (!format_data_command.ok()) {
@@ -202,6 +232,12 @@ int main(int argc, char** argv) {
             .in_memory_compaction = absl::GetFlag(FLAGS_in_memory_compaction),
             .shard_number = absl::GetFlag(FLAGS_shard_number),
             .number_of_shards = absl::GetFlag(FLAGS_number_of_shards),
+            .sharding_function_version =
+                absl::GetFlag(FLAGS_sharding_function_version),
+            .num_index_shards = absl::GetFlag(FLAGS_num_index_shards),
+            .sharding_key_regex = absl::GetFlag(FLAGS_sharding_key_regex),
+            .sharding_key_delimiter =
+                absl::GetFlag(FLAGS_sharding_key_delimiter),
         });
     if (!generate_snapshot_command.ok()) {
       LOG(ERROR) << "Failed to create command to generate snapshot. "
@@ -43,11 +43,19 @@ ABSL_FLAG(std::string, output_path, "",
 ABSL_FLAG(int64_t, logical_commit_time, 123123123,
           "Record logical_commit_time. Default is 123123123.");
 ABSL_FLAG(int64_t, code_snippet_version, 2, "UDF version. Default is 2.");
+ABSL_FLAG(bool, udf_binary_io, false,
+          "Whether the UDF handler is invoked in binary mode, with a "
+          "serialized BinaryUDFInput instead of JSON arguments.");
 ABSL_FLAG(std::string, data_loading_file_format,
           std::string(kv_server::kFileFormats[static_cast<int>(
               kv_server::FileFormat::kRiegeli)]),
           "File format of the input data files.");
+ABSL_FLAG(std::string, compression_dictionary_file_path, "",
+          "File of a zstd dictionary, e.g. trained with `zstd --train` on "
+          "recent responses. If set, a compression dictionary record with it "
+          "is written after the UDF config.");
 
+using kv_server::CompressionDictionaryRecordStruct;
 using kv_server::DataRecordStruct;
 using kv_server::DeltaRecordStreamWriter;
 using kv_server::DeltaRecordWriter;
@@ -70,6 +78,18 @@ absl::StatusOr<std::string> ReadCodeSnippetAsString(std::string udf_file_path) {
   return udf;
 }
 
+absl::StatusOr<std::string> ReadDictionaryAsString(
+    const std::string& dictionary_file_path) {
+  std::ifstream ifs(dictionary_file_path, std::ios::binary);
+  if (!ifs) {
+    return absl::NotFoundError(
+        absl::StrCat("File not found: ", dictionary_file_path));
+  }
+  std::string dictionary((std::istreambuf_iterator<char>(ifs)),
+                         (std::istreambuf_iterator<char>()));
+  return dictionary;
+}
+
 absl::Status WriteUdfConfig(std::ostream* output_stream) {
   if (!*output_stream) {
     return absl::NotFoundError("Invalid output");
@@ -78,11 +98,21 @@ absl::Status WriteUdfConfig(std::ostream* output_stream) {
   const std::string udf_handler_name = absl::GetFlag(FLAGS_udf_handler_name);
   int64_t logical_commit_time = absl::GetFlag(FLAGS_logical_commit_time);
   int64_t version = absl::GetFlag(FLAGS_code_snippet_version);
+  const bool binary_io = absl::GetFlag(FLAGS_udf_binary_io);
   absl::StatusOr<std::string> code_snippet =
       ReadCodeSnippetAsString(std::move(udf_file_path));
   if (!code_snippet.ok()) {
     return code_snippet.status();
   }
+  const std::string dictionary_file_path =
+      absl::GetFlag(FLAGS_compression_dictionary_file_path);
+  absl::StatusOr<std::string> dictionary;
+  if (!dictionary_file_path.empty()) {
+    dictionary = ReadDictionaryAsString(dictionary_file_path);
+    if (!dictionary.ok()) {
+      return dictionary.status();
+    }
+  }
 
   KVFileMetadata metadata;
   absl::StatusOr<std::unique_ptr<DeltaRecordWriter>> delta_record_writer;
@@ -106,12 +136,22 @@ absl::Status WriteUdfConfig(std::ostream* output_stream) {
       .handler_name = std::move(udf_handler_name),
       .logical_commit_time = logical_commit_time,
       .version = version,
+      .binary_io = binary_io,
       .language = UserDefinedFunctionsLanguage::Javascript};
   if (absl::Status status = delta_record_writer.value()->WriteRecord(
           DataRecordStruct{.record = std::move(udf_config)});
       !status.ok()) {
     return status;
   }
+  if (!dictionary_file_path.empty()) {
+    if (absl::Status status = delta_record_writer.value()->WriteRecord(
+            DataRecordStruct{.record = CompressionDictionaryRecordStruct{
+                                 .dictionary = *dictionary,
+                                 .logical_commit_time = logical_commit_time}});
+        !status.ok()) {
+      return status;
+    }
+  }
   delta_record_writer.value()->Close();
   return absl::OkStatus();
 }